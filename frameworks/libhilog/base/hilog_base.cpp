@@ -22,6 +22,8 @@
 #include <atomic>
 #include <cstring>
 #include <iostream>
+#include <mutex>
+#include <pthread.h>
 #include <sys/socket.h>
 #include <sys/time.h>
 #include <sys/uio.h>
@@ -45,6 +47,41 @@ struct SocketHandler {
     }
 };
 
+/*
+ * The socket is shared by the whole process and kept open between calls. It's never closed
+ * while the process may still log, a connected datagram socket is simply connected again
+ * when hilogd goes away and comes back. Only a forked child drops the inherited socket,
+ * at that point it has a single thread so nobody else can use the descriptor.
+ */
+static SocketHandler& GetSocketHandler()
+{
+    static SocketHandler* socketHandler = new SocketHandler();
+    return *socketHandler;
+}
+
+static void ResetSocketInChild()
+{
+    SocketHandler& socketHandler = GetSocketHandler();
+    int currentFd = socketHandler.socketFd.exchange(INVALID_SOCKET);
+    socketHandler.isConnected.store(false);
+    if (currentFd >= 0) {
+        close(currentFd);
+    }
+}
+
+static void RegisterForkHandler()
+{
+    static std::once_flag registered;
+    std::call_once(registered, []() {
+        (void)pthread_atfork(nullptr, nullptr, ResetSocketInChild);
+    });
+}
+
+static bool IsPeerGone(int err)
+{
+    return err == EPIPE || err == ECONNREFUSED || err == ENOTCONN || err == ECONNRESET;
+}
+
 static int GenerateFD()
 {
     int tmpFd = TEMP_FAILURE_RETRY(socket(AF_UNIX, SOCKET_TYPE, 0));
@@ -101,7 +138,8 @@ static int CheckConnection(SocketHandler& socketHandler)
 
 static int SendMessage(HilogMsg *header, const char *tag, uint16_t tagLen, const char *fmt, uint16_t fmtLen)
 {
-    SocketHandler socketHandler;
+    RegisterForkHandler();
+    SocketHandler& socketHandler = GetSocketHandler();
     int ret = CheckSocket(socketHandler);
     if (ret < 0) {
         return ret;
@@ -126,6 +164,14 @@ static int SendMessage(HilogMsg *header, const char *tag, uint16_t tagLen, const
     vec[2].iov_base = reinterpret_cast<void*>(const_cast<char*>(fmt));    // 2 : index of log content
     vec[2].iov_len = fmtLen;                                              // 2 : index of log content
     ret = TEMP_FAILURE_RETRY(::writev(socketHandler.socketFd.load(), vec.data(), vec.size()));
+    if (ret < 0 && IsPeerGone(errno)) {
+        // hilogd was restarted, connect to the new server socket and try once more
+        socketHandler.isConnected.store(false);
+        if (CheckConnection(socketHandler) < 0) {
+            return -1;
+        }
+        ret = TEMP_FAILURE_RETRY(::writev(socketHandler.socketFd.load(), vec.data(), vec.size()));
+    }
     return ret;
 }
 
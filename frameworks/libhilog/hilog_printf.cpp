@@ -15,10 +15,13 @@
 
 #include "properties.h"
 
+#include <atomic>
 #include <cstdarg>
 #include <cstdio>
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <pthread.h>
 #include <sys/syscall.h>
 #include <unistd.h>
 #include <ctime>
@@ -32,6 +35,7 @@
 #include "hilog_common.h"
 #include "hilog_input_socket_client.h"
 #include "vsnprintf_s_p.h"
+#include "log_binary.h"
 #include "log_utils.h"
 
 using namespace std;
@@ -67,18 +71,6 @@ void HiLogUnregisterGetIdFun(RegisterFunc registerFunc)
     return;
 }
 
-static uint16_t GetFinalLevel(unsigned int domain, const std::string& tag)
-{
-    uint16_t domainLevel = GetDomainLevel(domain);
-    uint16_t tagLevel = GetTagLevel(tag);
-    uint16_t globalLevel = GetGlobalLevel();
-    uint16_t maxLevel = LOG_LEVEL_MIN;
-    maxLevel = (maxLevel < domainLevel) ? domainLevel : maxLevel;
-    maxLevel = (maxLevel < tagLevel) ? tagLevel : maxLevel;
-    maxLevel = (maxLevel < globalLevel) ? globalLevel : maxLevel;
-    return maxLevel;
-}
-
 static uint32_t ParseProcessQuota()
 {
     uint32_t proQuota = DEFAULT_QUOTA;
@@ -176,8 +168,11 @@ static size_t GetExecutablePath(char *processdir, char *processname, size_t len)
 }
 #endif
 
-int HiLogPrintArgs(const LogType type, const LogLevel level, const unsigned int domain, const char *tag,
-    const char *fmt, va_list ap)
+/* Formatters may produce a binary record instead of text when version isn't null */
+using LogFormatFunc = int (*)(char *buf, size_t bufLen, bool priv, const void *context, uint16_t *version);
+
+static int HiLogPrintImpl(const LogType type, const LogLevel level, const unsigned int domain, const char *tag,
+    LogFormatFunc formatFunc, const void *formatContext)
 {
 #ifdef DEBUG
     char dir[MAX_PATH_LEN] = {0};
@@ -235,25 +230,14 @@ int HiLogPrintArgs(const LogType type, const LogLevel level, const unsigned int
     debug = IsDebugOn();
     priv = (!debug) && IsPrivateSwitchOn();
 
-#ifdef __clang__
-/* code specific to clang compiler */
-#pragma clang diagnostic push
-#pragma clang diagnostic ignored "-Wformat-nonliteral"
-#elif __GNUC__
-/* code for GNU C compiler */
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wformat-nonliteral"
-#endif
-    ret = vsnprintfp_s(logBuf, MAX_LOG_LEN - traceBufLen, MAX_LOG_LEN - traceBufLen - 1, priv, fmt, ap);
-#ifdef __clang__
-#pragma clang diagnostic pop
-#elif __GNUC__
-#pragma GCC diagnostic pop
-#endif
+    /* trace id is text, records prefixed with it can't be binary */
+    uint16_t version = HILOG_MSG_VERSION_TEXT;
+    ret = formatFunc(logBuf, MAX_LOG_LEN - traceBufLen, priv, formatContext, (traceBufLen == 0) ? &version : nullptr);
 
     /* fill header info */
     auto tagLen = strnlen(tag, MAX_TAG_LEN - 1);
-    auto logLen = strnlen(buf, MAX_LOG_LEN - 1);
+    auto logLen = (version == HILOG_MSG_VERSION_TEXT) ? strnlen(buf, MAX_LOG_LEN - 1) : static_cast<size_t>(ret);
+    header.version = version;
     header.type = type;
     header.level = level;
 #ifndef __RECV_MSG_WITH_UCRED_
@@ -277,6 +261,146 @@ int HiLogPrintArgs(const LogType type, const LogLevel level, const unsigned int
     return HilogWriteLogMessage(&header, tag, tagLen + 1, buf, logLen + 1);
 }
 
+struct VaFormatContext {
+    const char *fmt;
+    va_list *ap;
+};
+
+static int VaFormat(char *buf, size_t bufLen, bool priv, const void *context, uint16_t *version)
+{
+    const VaFormatContext *vaContext = static_cast<const VaFormatContext *>(context);
+#ifdef __clang__
+/* code specific to clang compiler */
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wformat-nonliteral"
+#elif __GNUC__
+/* code for GNU C compiler */
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-nonliteral"
+#endif
+    return vsnprintfp_s(buf, bufLen, bufLen - 1, priv, vaContext->fmt, *vaContext->ap);
+#ifdef __clang__
+#pragma clang diagnostic pop
+#elif __GNUC__
+#pragma GCC diagnostic pop
+#endif
+}
+
+int HiLogPrintArgs(const LogType type, const LogLevel level, const unsigned int domain, const char *tag,
+    const char *fmt, va_list ap)
+{
+    va_list args;
+    va_copy(args, ap);
+    VaFormatContext context = {fmt, &args};
+    int ret = HiLogPrintImpl(type, level, domain, tag, VaFormat, &context);
+    va_end(args);
+    return ret;
+}
+
+struct PieceFormatContext {
+    LogType type;
+    LogLevel level;
+    unsigned int domain;
+    const char *tag;
+    const char *fmt;
+    const HiLogFmtPiece *pieces;
+    size_t pieceCount;
+    const HiLogFmtArg *args;
+    std::atomic<uint32_t> *formatId;
+};
+
+static constexpr uint64_t SESSION_TIME_MASK = 0xffffffff;
+
+static uint64_t NewBinarySessionId()
+{
+    LogTimeStamp now(CLOCK_MONOTONIC);
+    uint64_t nsec = static_cast<uint64_t>(now.tv_sec) * NSEC + now.tv_nsec;
+    return (static_cast<uint64_t>(getpid()) << BINARY_SESSION_PID_SHIFT) | (nsec & SESSION_TIME_MASK);
+}
+
+/* A forked child starts a new session, call sites registered in the parent send their formats again */
+static BinaryFormatSession &GetBinarySession()
+{
+    static BinaryFormatSession *session = []() {
+        BinaryFormatSession *newSession = new BinaryFormatSession(NewBinarySessionId());
+        (void)pthread_atfork(nullptr, nullptr, []() {
+            GetBinarySession().Renew(NewBinarySessionId());
+        });
+        return newSession;
+    }();
+    return *session;
+}
+
+static bool IsBinaryLogEnabled()
+{
+    static const bool binaryOn = IsBinaryLogOn();
+    return binaryOn;
+}
+
+static int SendBinaryFormat(const PieceFormatContext &context, uint64_t session, uint16_t index)
+{
+    char buf[MAX_LOG_LEN] = {0};
+    int len = EncodeBinaryFormat(buf, MAX_LOG_LEN, session, index, context.fmt);
+    if (len < 0) {
+        return len;
+    }
+    HilogMsg header = {0};
+    header.version = HILOG_MSG_VERSION_FORMAT;
+    header.type = context.type;
+    header.level = context.level;
+#ifndef __RECV_MSG_WITH_UCRED_
+    header.pid = getpid();
+#endif
+    header.tid = static_cast<uint32_t>(syscall(SYS_gettid));
+    header.domain = context.domain;
+    return HilogWriteLogMessage(&header, context.tag, strnlen(context.tag, MAX_TAG_LEN - 1) + 1, buf, len + 1);
+}
+
+/*
+ * Sends the format of the call site when hilogd doesn't know it (yet or any more), returns false if
+ * the log must be sent as text
+ */
+static bool GetBinaryFormatIndex(const PieceFormatContext &context, uint16_t &index)
+{
+    BinaryFormatSession &session = GetBinarySession();
+    session.Update(GetBinaryEpoch(), HilogGetWriteLosses());
+    uint32_t sentId = 0;
+    BinaryFormatSession::Use use = session.Acquire(*context.formatId, strnlen(context.fmt, MAX_LOG_LEN),
+        context.pieceCount, index, sentId);
+    if (use == BinaryFormatSession::Use::SEND_FORMAT) {
+        // Not stored if the send failed, the next log tries again
+        if (SendBinaryFormat(context, session.GetId(), index) < 0) {
+            return false;
+        }
+        context.formatId->store(sentId, memory_order_release);
+    }
+    return use != BinaryFormatSession::Use::TEXT;
+}
+
+static int PieceFormat(char *buf, size_t bufLen, bool priv, const void *context, uint16_t *version)
+{
+    const PieceFormatContext *pieceContext = static_cast<const PieceFormatContext *>(context);
+    uint16_t index = 0;
+    if (version != nullptr && pieceContext->formatId != nullptr && IsBinaryLogEnabled() &&
+        GetBinaryFormatIndex(*pieceContext, index)) {
+        int len = EncodeBinaryArgs(buf, bufLen, GetBinarySession().GetId(), index, pieceContext->pieces,
+            pieceContext->pieceCount, pieceContext->args, priv);
+        if (len >= 0) {
+            *version = HILOG_MSG_VERSION_BINARY;
+            return len;
+        }
+    }
+    return FormatPieces(buf, bufLen, pieceContext->fmt, pieceContext->pieces, pieceContext->pieceCount,
+        pieceContext->args, priv);
+}
+
+int HiLogPrintFormatted(LogType type, LogLevel level, unsigned int domain, const char *tag, const char *fmt,
+    const HiLogFmtPiece *pieces, size_t pieceCount, const HiLogFmtArg *args, std::atomic<uint32_t> *formatId)
+{
+    PieceFormatContext context = {type, level, domain, tag, fmt, pieces, pieceCount, args, formatId};
+    return HiLogPrintImpl(type, level, domain, tag, PieceFormat, &context);
+}
+
 int HiLogPrint(LogType type, LogLevel level, unsigned int domain, const char *tag, const char *fmt, ...)
 {
     int ret;
@@ -24,6 +24,7 @@
 #define SOCKET_FILE_DIR "/dev/unix/socket/"
 #define INPUT_SOCKET_NAME "hilogInput"
 #define INPUT_SOCKET SOCKET_FILE_DIR INPUT_SOCKET_NAME
+#define MAX_SOCKET_PACKET_LEN 4096 /* one input packet may carry several HilogMsg records */
 #define CONTROL_SOCKET_NAME "hilogControl"
 #define CONTROL_SOCKET SOCKET_FILE_DIR CONTROL_SOCKET_NAME
 #define HILOG_FILE_DIR "/data/log/hilog/"
@@ -56,6 +57,10 @@ constexpr int MAX_LOG_FILE_NUM = 1000;
 const int MSG_MAX_LEN = 2048;
 constexpr uint64_t PRIME = 0x100000001B3ull;
 constexpr uint64_t BASIS = 0xCBF29CE484222325ull;
+/* values of HilogMsg::version */
+constexpr uint16_t HILOG_MSG_VERSION_TEXT = 0; /* content is formatted text */
+constexpr uint16_t HILOG_MSG_VERSION_BINARY = 1; /* content is arguments of a registered format, see log_binary.h */
+constexpr uint16_t HILOG_MSG_VERSION_FORMAT = 2; /* content registers a format of binary logs, never stored */
 /*
  * header of log message from libhilog to hilogd
  */
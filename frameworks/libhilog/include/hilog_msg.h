@@ -94,6 +94,19 @@ using MessageHeader = struct {
     uint16_t msgLen;  // message length
 };
 
+/*
+ * MessageHeader.version of LOG_QUERY_REQUEST, hilogd answers all LOG_QUERY_RESPONSE and NEXT_RESPONSE
+ * of the query with it. Batch responses carry HilogDataMessage records (each followed by its data)
+ * back to back after the header, msgLen is the length of all of them.
+ */
+using LogQueryVersion = enum {
+    LOG_QUERY_VERSION_SINGLE = 0, // one LogQueryResponse per log
+    LOG_QUERY_VERSION_BATCH,
+    LOG_QUERY_VERSION_CONTENT, // batch, hilogd matches LogQueryRequest.content itself
+};
+#define LOG_QUERY_BATCH_MAX_LEN 32768 // whole response of batch version, header included
+#define MAX_CONTENT_PATTERN_LEN 128 // content regex of content version, include '\0'
+
 using LogQueryRequest = struct {
     MessageHeader header;
     uint8_t nPid;
@@ -113,6 +126,7 @@ using LogQueryRequest = struct {
     uint32_t noPids[MAX_PIDS];
     uint32_t noDomains[MAX_DOMAINS];
     char noTags[MAX_TAGS][MAX_TAG_LEN];
+    char content[MAX_CONTENT_PATTERN_LEN];
 };
 
 using HilogDataMessage = struct {
@@ -309,6 +323,20 @@ using LogPersistQueryResult = struct {
     uint32_t fileNum;
 };
 
+/*
+ * MessageHeader.version of LOG_PERSIST_QUERY request, hilogd answers with the same version.
+ * Results of LOG_PERSIST_QUERY_VERSION_DICT responses are LogPersistQueryResultExt.
+ */
+using LogPersistQueryVersion = enum {
+    LOG_PERSIST_QUERY_VERSION_BASE = 0,
+    LOG_PERSIST_QUERY_VERSION_DICT,
+};
+
+using LogPersistQueryResultExt = struct {
+    LogPersistQueryResult info;
+    uint32_t dictId; /* zstd dictionary ID, 0 if none */
+};
+
 using LogPersistQueryResponse = struct {
     MessageHeader msgHeader;
     LogPersistQueryResult logPersistQueryRst[];
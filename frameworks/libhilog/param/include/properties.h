@@ -27,9 +27,14 @@ bool IsDebugOn();
 uint16_t GetGlobalLevel();
 uint16_t GetDomainLevel(uint32_t domain);
 uint16_t GetTagLevel(const std::string& tag);
+uint16_t GetFinalLevel(uint32_t domain, const char *tag);
 bool IsProcessSwitchOn();
 bool IsDomainSwitchOn();
 bool IsKmsgSwitchOn();
+bool IsShmTransportOn();
+bool IsBinaryLogOn();
+bool IsWriteBatchingOn();
+uint32_t GetBinaryEpoch();
 size_t GetBufferSize(uint16_t type, bool persist);
 
 int SetPrivateSwitchOn(bool on);
@@ -41,6 +46,7 @@ int SetDomainLevel(uint32_t domain, uint16_t lvl);
 int SetProcessSwitchOn(bool on);
 int SetDomainSwitchOn(bool on);
 int SetKmsgSwitchOn(bool on);
+int SetBinaryEpoch(uint32_t epoch);
 int SetBufferSize(uint16_t type, bool persist, size_t size);
 } // namespace HiviewDFX
 } // namespace OHOS
@@ -12,11 +12,13 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
  */
+#include <algorithm>
 #include <array>
 #include <atomic>
 #include <cassert>
 #include <climits>
 #include <cstdio>
+#include <cstdlib>
 #include <cstring>
 #include <ctime>
 #include <fstream>
@@ -51,10 +53,14 @@ enum class PropType {
     PROP_TAG_LOG_LEVEL,
     PROP_DOMAIN_FLOWCTRL,
     PROP_PROCESS_FLOWCTRL,
+    PROP_BINARY_EPOCH,
 
     // Below properties are used by HiLog self, invoked only one or two times, so they needn't be cached
     PROP_KMSG,
     PROP_BUFFER_SIZE,
+    PROP_SHM_TRANSPORT,
+    PROP_BINARY_LOG,
+    PROP_WRITE_BATCHING,
 
     PROP_MAX,
 };
@@ -73,6 +79,7 @@ static pthread_mutex_t g_domainLevelLock = PTHREAD_MUTEX_INITIALIZER;
 static pthread_mutex_t g_tagLevelLock = PTHREAD_MUTEX_INITIALIZER;
 static pthread_mutex_t g_domainFlowLock = PTHREAD_MUTEX_INITIALIZER;
 static pthread_mutex_t g_processFlowLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t g_binaryEpochLock = PTHREAD_MUTEX_INITIALIZER;
 
 using PropRes = struct {
     string name;
@@ -88,10 +95,14 @@ static PropRes g_PropResources[static_cast<int>(PropType::PROP_MAX)] = {
     {"hilog.loggable.tag.", &g_tagLevelLock}, // PROP_TAG_LOG_LEVEL
     {"hilog.flowctrl.domain.on", &g_domainFlowLock}, // PROP_DOMAIN_FLOWCTRL
     {"hilog.flowctrl.proc.on", &g_processFlowLock}, // PROP_PROCESS_FLOWCTRL
+    {"hilog.binary.epoch", &g_binaryEpochLock}, // PROP_BINARY_EPOCH
 
     // Non cached:
     {"persist.sys.hilog.kmsg.on", nullptr}, // PROP_KMSG,
     {"hilog.buffersize.", nullptr}, // PROP_BUFFER_SIZE,
+    {"hilog.transport.shm.on", nullptr}, // PROP_SHM_TRANSPORT,
+    {"hilog.binary.on", nullptr}, // PROP_BINARY_LOG,
+    {"hilog.batch.on", nullptr}, // PROP_WRITE_BATCHING,
 };
 
 static string GetPropertyName(PropType propType)
@@ -263,6 +274,16 @@ static bool TextToBool(const RawPropertyData& data, bool defaultVal)
     return defaultVal;
 }
 
+static uint32_t TextToUint32(const RawPropertyData& data, uint32_t defaultVal)
+{
+    char *end = nullptr;
+    unsigned long value = strtoul(data.data(), &end, 10); // 10 : decimal
+    if (end == data.data() || *end != '\0') {
+        return defaultVal;
+    }
+    return static_cast<uint32_t>(value);
+}
+
 static uint16_t TextToLogLevel(const RawPropertyData& data, uint16_t defaultVal)
 {
     uint16_t level = PrettyStr2LogLevel(data.data());
@@ -365,6 +386,131 @@ uint16_t GetTagLevel(const string& tag)
     return levelCache->getValue();
 }
 
+/*
+ * Lock-free cache of final log levels keyed by domain and tag hash, filled through the level caches
+ * above. Each slot is guarded by a seqlock; a hit stays valid while commit ids of the level properties
+ * it was computed from are unchanged, so filtered-out logs cost no locks and no allocations.
+ */
+class LoggableCache {
+public:
+    uint16_t GetLevel(uint32_t domain, const char *tag)
+    {
+        uint64_t tagHash = HashTag(tag);
+        size_t home = static_cast<size_t>((tagHash ^ domain) % SLOT_COUNT);
+        for (size_t i = 0; i < MAX_PROBE; i++) {
+            uint16_t level = LOG_LEVEL_MIN;
+            if (Lookup(m_slots[(home + i) % SLOT_COUNT], domain, tagHash, level)) {
+                return level;
+            }
+        }
+        return Fill(home, domain, tag, tagHash);
+    }
+
+private:
+    struct Slot {
+        atomic<uint32_t> seq {0}; /* odd while written, 0 for a never used slot */
+        atomic<uint32_t> domain {0};
+        atomic<uint64_t> tagHash {0};
+        atomic<int> domainHandle {-1};
+        atomic<int> tagHandle {-1};
+        atomic<uint32_t> globalCommit {0};
+        atomic<uint32_t> domainCommit {0};
+        atomic<uint32_t> tagCommit {0};
+        atomic<uint16_t> level {LOG_LEVEL_MIN};
+    };
+
+    static constexpr size_t SLOT_COUNT = 256;
+    static constexpr size_t MAX_PROBE = 4;
+
+    static uint64_t HashTag(const char *tag)
+    {
+        uint64_t hash = BASIS;
+        for (size_t i = 0; i < MAX_TAG_LEN && tag[i] != '\0'; i++) {
+            hash ^= static_cast<unsigned char>(tag[i]);
+            hash *= PRIME;
+        }
+        return hash;
+    }
+
+    static uint32_t CommitOf(int handle)
+    {
+        return (handle == -1) ? 0 : static_cast<uint32_t>(GetParameterCommitId(handle));
+    }
+
+    bool Lookup(const Slot& slot, uint32_t domain, uint64_t tagHash, uint16_t& level) const
+    {
+        uint32_t seq = slot.seq.load(memory_order_acquire);
+        if (seq == 0 || (seq & 1) != 0) {
+            return false;
+        }
+        bool hit = slot.domain.load(memory_order_relaxed) == domain &&
+            slot.tagHash.load(memory_order_relaxed) == tagHash &&
+            slot.globalCommit.load(memory_order_relaxed) == CommitOf(m_globalHandle.load(memory_order_relaxed)) &&
+            slot.domainCommit.load(memory_order_relaxed) == CommitOf(slot.domainHandle.load(memory_order_relaxed)) &&
+            slot.tagCommit.load(memory_order_relaxed) == CommitOf(slot.tagHandle.load(memory_order_relaxed));
+        level = slot.level.load(memory_order_relaxed);
+        atomic_thread_fence(memory_order_acquire);
+        return hit && slot.seq.load(memory_order_relaxed) == seq;
+    }
+
+    uint16_t Fill(size_t home, uint32_t domain, const char *tag, uint64_t tagHash)
+    {
+        // Commit ids are taken before the levels, a change in between only invalidates the slot early
+        string tagStr(tag, strnlen(tag, MAX_TAG_LEN - 1));
+        if (m_globalHandle.load(memory_order_relaxed) == -1) {
+            m_globalHandle = static_cast<int>(FindParameter(GetPropertyName(PropType::PROP_GLOBAL_LOG_LEVEL).c_str()));
+        }
+        string domainKey = GetPropertyName(PropType::PROP_DOMAIN_LOG_LEVEL) + Uint2HexStr(domain);
+        string tagKey = GetPropertyName(PropType::PROP_TAG_LOG_LEVEL) + tagStr;
+        int domainHandle = static_cast<int>(FindParameter(domainKey.c_str()));
+        int tagHandle = static_cast<int>(FindParameter(tagKey.c_str()));
+        uint32_t globalCommit = CommitOf(m_globalHandle.load(memory_order_relaxed));
+        uint32_t domainCommit = CommitOf(domainHandle);
+        uint32_t tagCommit = CommitOf(tagHandle);
+
+        uint16_t level = LOG_LEVEL_MIN;
+        level = max(level, GetDomainLevel(domain));
+        level = max(level, GetTagLevel(tagStr));
+        level = max(level, GetGlobalLevel());
+
+        // Reuse the slot of this key if any, else a free one, else evict the home slot
+        Slot* target = &m_slots[home];
+        for (size_t i = 0; i < MAX_PROBE; i++) {
+            Slot& slot = m_slots[(home + i) % SLOT_COUNT];
+            uint32_t seq = slot.seq.load(memory_order_relaxed);
+            if (seq == 0 || (slot.domain.load(memory_order_relaxed) == domain &&
+                slot.tagHash.load(memory_order_relaxed) == tagHash)) {
+                target = &slot;
+                break;
+            }
+        }
+        uint32_t seq = target->seq.load(memory_order_relaxed);
+        if ((seq & 1) != 0 || !target->seq.compare_exchange_strong(seq, seq + 1, memory_order_acquire)) {
+            return level; /* another thread is writing the slot, skip caching */
+        }
+        atomic_thread_fence(memory_order_release);
+        target->domain.store(domain, memory_order_relaxed);
+        target->tagHash.store(tagHash, memory_order_relaxed);
+        target->domainHandle.store(domainHandle, memory_order_relaxed);
+        target->tagHandle.store(tagHandle, memory_order_relaxed);
+        target->globalCommit.store(globalCommit, memory_order_relaxed);
+        target->domainCommit.store(domainCommit, memory_order_relaxed);
+        target->tagCommit.store(tagCommit, memory_order_relaxed);
+        target->level.store(level, memory_order_relaxed);
+        target->seq.store(seq + 2, memory_order_release); // 2 : back to even, next generation
+        return level;
+    }
+
+    atomic<int> m_globalHandle {-1};
+    Slot m_slots[SLOT_COUNT];
+};
+
+uint16_t GetFinalLevel(uint32_t domain, const char *tag)
+{
+    static auto *loggableCache = new LoggableCache();
+    return loggableCache->GetLevel(domain, tag);
+}
+
 bool IsProcessSwitchOn()
 {
     static auto *switchCache = new SwitchCache(TextToBool, false, PropType::PROP_PROCESS_FLOWCTRL);
@@ -374,6 +520,16 @@ bool IsProcessSwitchOn()
     return switchCache->getValue();
 }
 
+/* Changed by hilogd on every start, clients re-send the binary log formats it has forgotten */
+uint32_t GetBinaryEpoch()
+{
+    static auto *epochCache = new CacheData<uint32_t>(TextToUint32, 0, PropType::PROP_BINARY_EPOCH);
+    if (epochCache == nullptr) {
+        return 0;
+    }
+    return epochCache->getValue();
+}
+
 bool IsDomainSwitchOn()
 {
     static auto *switchCache = new SwitchCache(TextToBool, false, PropType::PROP_DOMAIN_FLOWCTRL);
@@ -393,6 +549,36 @@ bool IsKmsgSwitchOn()
     return TextToBool(rawData, false);
 }
 
+bool IsShmTransportOn()
+{
+    RawPropertyData rawData;
+    int ret = PropertyGet(GetPropertyName(PropType::PROP_SHM_TRANSPORT), rawData.data(), HILOG_PROP_VALUE_MAX);
+    if (ret == RET_FAIL) {
+        return false;
+    }
+    return TextToBool(rawData, false);
+}
+
+bool IsBinaryLogOn()
+{
+    RawPropertyData rawData;
+    int ret = PropertyGet(GetPropertyName(PropType::PROP_BINARY_LOG), rawData.data(), HILOG_PROP_VALUE_MAX);
+    if (ret == RET_FAIL) {
+        return false;
+    }
+    return TextToBool(rawData, false);
+}
+
+bool IsWriteBatchingOn()
+{
+    RawPropertyData rawData;
+    int ret = PropertyGet(GetPropertyName(PropType::PROP_WRITE_BATCHING), rawData.data(), HILOG_PROP_VALUE_MAX);
+    if (ret == RET_FAIL) {
+        return false;
+    }
+    return TextToBool(rawData, false);
+}
+
 static string GetBufferSizePropName(uint16_t type, bool persist)
 {
     string name = persist ? "persist.sys." : "";
@@ -475,6 +661,11 @@ int SetDomainSwitchOn(bool on)
     return SetBoolValue(PropType::PROP_DOMAIN_FLOWCTRL, on);
 }
 
+int SetBinaryEpoch(uint32_t epoch)
+{
+    return PropertySet(GetPropertyName(PropType::PROP_BINARY_EPOCH), to_string(epoch));
+}
+
 int SetKmsgSwitchOn(bool on)
 {
     return SetBoolValue(PropType::PROP_KMSG, on);
@@ -19,6 +19,9 @@
 
 namespace OHOS {
 namespace HiviewDFX {
+static constexpr unsigned int RECV_BATCH_SIZE = 32;
+static constexpr size_t CONTROL_LEN = CMSG_SPACE(sizeof(struct ucred));
+
 int DgramSocketServer::RecvPacket(std::vector<char>& buffer, struct ucred *cred)
 {
     uint16_t packetLen = 0;
@@ -68,5 +71,63 @@ int DgramSocketServer::RecvPacket(std::vector<char>& buffer, struct ucred *cred)
 
     return ret;
 }
+
+void DgramSocketServer::InitBatchSlab()
+{
+    // One extra byte per slot lets too long packets be detected by MSG_TRUNC
+    size_t slotSize = maxPacketLength + 1;
+    packetSlab.resize(RECV_BATCH_SIZE * slotSize);
+    controlSlab.resize(RECV_BATCH_SIZE * CONTROL_LEN);
+    iovecs.resize(RECV_BATCH_SIZE);
+    msgHdrs.resize(RECV_BATCH_SIZE);
+    for (unsigned int i = 0; i < RECV_BATCH_SIZE; i++) {
+        iovecs[i].iov_base = packetSlab.data() + i * slotSize;
+        iovecs[i].iov_len = slotSize;
+    }
+}
+
+int DgramSocketServer::RecvPackets(std::vector<DgramPacket>& packets, bool withCred)
+{
+    if (packetSlab.empty()) {
+        InitBatchSlab();
+    }
+    for (unsigned int i = 0; i < RECV_BATCH_SIZE; i++) {
+        struct msghdr& msgh = msgHdrs[i].msg_hdr;
+        msgh.msg_name = nullptr;
+        msgh.msg_namelen = 0;
+        msgh.msg_iov = &iovecs[i];
+        msgh.msg_iovlen = 1;
+        msgh.msg_control = withCred ? controlSlab.data() + i * CONTROL_LEN : nullptr;
+        msgh.msg_controllen = withCred ? CONTROL_LEN : 0;
+        msgh.msg_flags = 0;
+        msgHdrs[i].msg_len = 0;
+    }
+
+    packets.clear();
+    int ret = RecvMMsg(msgHdrs.data(), RECV_BATCH_SIZE);
+    if (ret <= 0) {
+        return ret;
+    }
+    for (int i = 0; i < ret; i++) {
+        struct msghdr& msgh = msgHdrs[i].msg_hdr;
+        unsigned int len = msgHdrs[i].msg_len;
+        if (len == 0 || len > maxPacketLength || (msgh.msg_flags & MSG_TRUNC) != 0) {
+            continue; // skip empty or too long packet
+        }
+        DgramPacket packet;
+        packet.data = static_cast<char *>(iovecs[i].iov_base);
+        packet.len = static_cast<uint16_t>(len);
+        packet.data[len - 1] = 0;
+        if (withCred) {
+            struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msgh);
+            if (cmsg == nullptr || cmsg->cmsg_type != SCM_CREDENTIALS) {
+                continue;
+            }
+            packet.cred = *reinterpret_cast<struct ucred *>(CMSG_DATA(cmsg));
+        }
+        packets.push_back(packet);
+    }
+    return static_cast<int>(packets.size());
+}
 } // namespace HiviewDFX
 } // namespace OHOS
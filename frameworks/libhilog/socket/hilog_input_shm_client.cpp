@@ -0,0 +1,322 @@
+/*
+ * Copyright (c) 2022 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <new>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <securec.h>
+
+#include "hilog_input_shm_client.h"
+
+namespace OHOS {
+namespace HiviewDFX {
+
+static constexpr int64_t SHM_RETRY_MIN_DELAY_MS = 1000;
+static constexpr int64_t SHM_RETRY_MAX_DELAY_MS = 60000;
+
+static HilogInputShmClient g_hilogInputShmClient;
+
+static int64_t CoarseNowMs()
+{
+    timespec ts = {0};
+    (void)clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000; // 1000 : sec to msec, 1000000 : nsec
+}
+
+static size_t AlignRecord(size_t len)
+{
+    return (len + SHM_RECORD_ALIGN - 1) & ~static_cast<size_t>(SHM_RECORD_ALIGN - 1);
+}
+
+static int CreateRingFd()
+{
+    int fd = memfd_create("hilog_ring", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd < 0) {
+        return fd;
+    }
+    // Sealed size guarantees hilogd never faults on a ring shrunk behind its back
+    if (ftruncate(fd, SHM_RING_MAP_SIZE) < 0 ||
+        fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static int ConnectToServer(const std::string& socketName)
+{
+    // Nothing on this socket may block a logging thread
+    int fd = TEMP_FAILURE_RETRY(socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC | SOCK_NONBLOCK, 0));
+    if (fd < 0) {
+        return fd;
+    }
+    sockaddr_un addr = {AF_UNIX, {0}};
+    std::string path = SOCKET_FILE_DIR + socketName;
+    if (strcpy_s(addr.sun_path, sizeof(addr.sun_path), path.c_str()) != EOK ||
+        TEMP_FAILURE_RETRY(connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr))) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static bool SendRegistration(int socketFd, int memFd, int eventFd)
+{
+    HilogShmRegisterMsg msg = {SHM_RING_MAGIC, SHM_RING_VERSION, SHM_RING_MAP_SIZE};
+    iovec iov = {&msg, sizeof(msg)};
+    std::array<char, CMSG_SPACE(sizeof(int) * SHM_FD_COUNT)> control = {0};
+    msghdr msgh = {0};
+    msgh.msg_iov = &iov;
+    msgh.msg_iovlen = 1;
+    msgh.msg_control = control.data();
+    msgh.msg_controllen = control.size();
+    cmsghdr *cmsg = CMSG_FIRSTHDR(&msgh);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int) * SHM_FD_COUNT);
+    int fds[SHM_FD_COUNT] = {memFd, eventFd};
+    if (memcpy_s(CMSG_DATA(cmsg), sizeof(fds), fds, sizeof(fds)) != 0) {
+        return false;
+    }
+    // hilogd answers when it has taken the ring, the answer is read by later logs
+    return TEMP_FAILURE_RETRY(sendmsg(socketFd, &msgh, MSG_NOSIGNAL | MSG_DONTWAIT)) ==
+        static_cast<ssize_t>(sizeof(msg));
+}
+
+extern "C" int HilogShmWriteLogMessage(HilogMsg *header, const char *tag, uint16_t tagLen, const char *fmt,
+    uint16_t fmtLen)
+{
+    return g_hilogInputShmClient.WriteLogMessage(header, tag, tagLen, fmt, fmtLen);
+}
+
+extern "C" uint32_t HilogShmGetWriteLosses()
+{
+    return g_hilogInputShmClient.GetWriteLosses();
+}
+
+HilogInputShmClient::~HilogInputShmClient()
+{
+    std::lock_guard<std::mutex> lock(m_ringMtx);
+    Unregister();
+    // Late logs of other threads at exit go to the socket
+    m_state = State::FAILED;
+    m_deadlineMs = INT64_MAX;
+}
+
+int HilogInputShmClient::StartRegistration()
+{
+    static std::once_flag forkHandlerFlag;
+    std::call_once(forkHandlerFlag, []() {
+        (void)pthread_atfork(PrepareFork, ParentAfterFork, ChildAfterFork);
+    });
+
+    int memFd = CreateRingFd();
+    if (memFd < 0) {
+        return -1;
+    }
+    void *map = mmap(nullptr, SHM_RING_MAP_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, memFd, 0);
+    if (map == MAP_FAILED) {
+        close(memFd);
+        return -1;
+    }
+    m_ring = new (map) HilogShmRingHeader();
+    m_ring->magic = SHM_RING_MAGIC;
+    m_ring->version = SHM_RING_VERSION;
+    m_ring->dataSize = SHM_RING_DATA_SIZE;
+    m_ring->consumerWaiting.store(1);
+    m_ring->heartbeat.store(0);
+    m_ring->writePos.store(0);
+    m_ring->readPos.store(0);
+    m_ringData = static_cast<char *>(map) + SHM_RING_DATA_OFFSET;
+
+    m_eventFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    m_registrationFd = ConnectToServer(m_socketName);
+    bool registered = (m_eventFd >= 0) && (m_registrationFd >= 0) &&
+        SendRegistration(m_registrationFd, memFd, m_eventFd);
+    close(memFd); // hilogd keeps its own mapping
+    if (!registered) {
+        Unregister();
+        return -1;
+    }
+    return 0;
+}
+
+void HilogInputShmClient::CheckRegistration()
+{
+    char status = -1;
+    ssize_t ret = TEMP_FAILURE_RETRY(recv(m_registrationFd, &status, sizeof(status), MSG_DONTWAIT));
+    if (ret == sizeof(status) && status == 0) {
+        m_state = State::REGISTERED;
+        m_retryDelayMs = 0;
+        return;
+    }
+    bool again = (ret < 0) && (errno == EAGAIN || errno == EWOULDBLOCK);
+    if (!again || CoarseNowMs() >= m_deadlineMs) {
+        Fail();
+    }
+}
+
+void HilogInputShmClient::Fail()
+{
+    if (m_state == State::REGISTERED) {
+        m_writeLosses.fetch_add(1, std::memory_order_relaxed);
+    }
+    Unregister();
+    m_state = State::FAILED;
+    m_retryDelayMs = (m_retryDelayMs == 0) ? SHM_RETRY_MIN_DELAY_MS :
+        std::min(m_retryDelayMs * 2, SHM_RETRY_MAX_DELAY_MS); // 2 : delay doubles after every failure
+    m_deadlineMs = CoarseNowMs() + m_retryDelayMs;
+}
+
+bool HilogInputShmClient::IsRingUsable()
+{
+    if (m_state == State::FAILED && CoarseNowMs() >= m_deadlineMs) {
+        m_state = State::UNREGISTERED;
+    }
+    if (m_state == State::UNREGISTERED) {
+        if (StartRegistration() == 0) {
+            m_state = State::PENDING;
+            m_deadlineMs = CoarseNowMs() + SHM_REGISTER_TIMEOUT_MS;
+        } else {
+            Fail();
+        }
+    }
+    if (m_state == State::PENDING) {
+        CheckRegistration();
+    }
+    if (m_state == State::REGISTERED && IsServerGone()) {
+        Fail();
+    }
+    return m_state == State::REGISTERED;
+}
+
+void HilogInputShmClient::Unregister()
+{
+    if (m_ring != nullptr) {
+        munmap(m_ring, SHM_RING_MAP_SIZE);
+        m_ring = nullptr;
+        m_ringData = nullptr;
+    }
+    if (m_eventFd >= 0) {
+        close(m_eventFd);
+        m_eventFd = -1;
+    }
+    if (m_registrationFd >= 0) {
+        close(m_registrationFd);
+        m_registrationFd = -1;
+    }
+}
+
+bool HilogInputShmClient::IsServerGone() const
+{
+    uint32_t heartbeat = m_ring->heartbeat.load(std::memory_order_relaxed);
+    if (heartbeat == 0) {
+        return true;
+    }
+    // A busy hilogd may beat late, only then ask the connection
+    if (ShmHeartbeatNow() - heartbeat <= SHM_HEARTBEAT_TIMEOUT_SEC) {
+        return false;
+    }
+    pollfd info = {m_registrationFd, POLLIN, 0};
+    // Server never writes after registration, so any event means it closed the connection
+    return poll(&info, 1, 0) != 0;
+}
+
+void HilogInputShmClient::WakeUpServer()
+{
+    // Pairs with the fence of hilogd before it goes to sleep, either it sees the new
+    // write position or we see its waiting flag
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_ring->consumerWaiting.load(std::memory_order_relaxed) != 0) {
+        m_ring->consumerWaiting.store(0, std::memory_order_relaxed);
+        uint64_t one = 1;
+        (void)TEMP_FAILURE_RETRY(write(m_eventFd, &one, sizeof(one)));
+    }
+}
+
+int HilogInputShmClient::WriteLogMessage(HilogMsg *header, const char *tag, uint16_t tagLen, const char *fmt,
+    uint16_t fmtLen)
+{
+    struct timeval tv = {0};
+    gettimeofday(&tv, nullptr);
+    header->tv_sec = static_cast<uint32_t>(tv.tv_sec);
+    header->tv_nsec = static_cast<uint32_t>(tv.tv_usec * 1000);     // 1000 : usec convert to nsec
+    header->len = sizeof(HilogMsg) + tagLen + fmtLen;
+    header->tag_len = tagLen;
+
+    std::lock_guard<std::mutex> lock(m_ringMtx);
+    if (!IsRingUsable()) {
+        return -1;
+    }
+
+    size_t recordLen = AlignRecord(header->len);
+    uint64_t writePos = m_ring->writePos.load(std::memory_order_relaxed);
+    uint64_t readPos = m_ring->readPos.load(std::memory_order_acquire);
+    size_t offset = writePos & (SHM_RING_DATA_SIZE - 1);
+    size_t spaceToEnd = SHM_RING_DATA_SIZE - offset;
+    size_t needed = (recordLen > spaceToEnd) ? (spaceToEnd + recordLen) : recordLen;
+    if (needed > SHM_RING_DATA_SIZE - (writePos - readPos)) {
+        return -1;
+    }
+    if (recordLen > spaceToEnd) {
+        // Zero length record sends the reader to the ring start
+        *reinterpret_cast<uint16_t *>(m_ringData + offset) = 0;
+        writePos += spaceToEnd;
+        offset = 0;
+    }
+    char *record = m_ringData + offset;
+    if (memcpy_s(record, recordLen, header, sizeof(HilogMsg)) != 0 ||
+        memcpy_s(record + sizeof(HilogMsg), recordLen - sizeof(HilogMsg), tag, tagLen) != 0 ||
+        memcpy_s(record + sizeof(HilogMsg) + tagLen, recordLen - sizeof(HilogMsg) - tagLen, fmt, fmtLen) != 0) {
+        return -1;
+    }
+    m_ring->writePos.store(writePos + recordLen, std::memory_order_release);
+    WakeUpServer();
+    return header->len;
+}
+
+void HilogInputShmClient::PrepareFork()
+{
+    g_hilogInputShmClient.m_ringMtx.lock();
+}
+
+void HilogInputShmClient::ParentAfterFork()
+{
+    g_hilogInputShmClient.m_ringMtx.unlock();
+}
+
+void HilogInputShmClient::ChildAfterFork()
+{
+    // The ring is registered for the parent, the child registers its own on first write
+    HilogInputShmClient& client = g_hilogInputShmClient;
+    client.Unregister();
+    client.m_state = State::UNREGISTERED;
+    client.m_retryDelayMs = 0;
+    client.m_ringMtx.unlock();
+}
+} // namespace HiviewDFX
+} // namespace OHOS
@@ -0,0 +1,417 @@
+/*
+ * Copyright (c) 2022 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <securec.h>
+
+#include "hilog_input_shm_server.h"
+
+namespace OHOS {
+namespace HiviewDFX {
+static constexpr unsigned int MAX_SHM_CLIENTS = 256;
+static constexpr int EPOLL_TIMEOUT_MS = 1000;
+static constexpr int MAX_EPOLL_EVENTS = 32;
+static constexpr size_t DRAIN_BATCH_SIZE = 32;
+static constexpr size_t MAX_RECORD_LEN = sizeof(HilogMsg) + MAX_TAG_LEN + MAX_LOG_LEN;
+
+HilogInputShmServer::HilogInputShmServer(BatchHandlingFunc batchHandler)
+    : HilogInputShmServer(INPUT_SHM_SOCKET_NAME, batchHandler)
+{
+}
+
+HilogInputShmServer::HilogInputShmServer(const std::string& socketName, BatchHandlingFunc batchHandler)
+    : m_registrationServer(socketName, MAX_SHM_CLIENTS), m_batchHandler(batchHandler), m_stopServer(false)
+{
+}
+
+HilogInputShmServer::~HilogInputShmServer()
+{
+    StopServingThread();
+    std::vector<int> fds;
+    for (auto& [fd, ring] : m_rings) {
+        fds.push_back(fd);
+    }
+    for (int fd : fds) {
+        RemoveRing(fd);
+    }
+    while (!m_pending.empty()) {
+        RemovePending(m_pending.begin()->first);
+    }
+    if (m_epollFd >= 0) {
+        close(m_epollFd);
+    }
+}
+
+int HilogInputShmServer::Init()
+{
+    int ret = m_registrationServer.Init();
+    if (ret < 0) {
+        return ret;
+    }
+    ret = m_registrationServer.Listen(MAX_SHM_CLIENTS);
+    if (ret < 0) {
+        return ret;
+    }
+    m_epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (m_epollFd < 0) {
+        return m_epollFd;
+    }
+    epoll_event event = {0};
+    event.events = EPOLLIN;
+    event.data.fd = m_registrationServer.GetHandler();
+    return epoll_ctl(m_epollFd, EPOLL_CTL_ADD, event.data.fd, &event);
+}
+
+bool HilogInputShmServer::RunServingThread()
+{
+    if (m_serverThread.joinable() || m_epollFd < 0) {
+        return false;
+    }
+    m_stopServer.store(false);
+    m_serverThread = std::thread(&HilogInputShmServer::ServingThread, this);
+    return true;
+}
+
+void HilogInputShmServer::StopServingThread()
+{
+    m_stopServer.store(true);
+    if (m_serverThread.joinable()) {
+        m_serverThread.join();
+    }
+}
+
+void HilogInputShmServer::ServingThread()
+{
+    prctl(PR_SET_NAME, "hilogd.shm");
+    m_recordSlab.resize(DRAIN_BATCH_SIZE * MAX_RECORD_LEN);
+    m_packets.reserve(DRAIN_BATCH_SIZE);
+    std::array<epoll_event, MAX_EPOLL_EVENTS> events;
+    while (!m_stopServer.load()) {
+        // Busy rings are drained further right after the new events are taken
+        int timeout = m_busyRings.empty() ? EPOLL_TIMEOUT_MS : 0;
+        int count = TEMP_FAILURE_RETRY(epoll_wait(m_epollFd, events.data(), events.size(), timeout));
+        if (count < 0) {
+            std::cerr << "Shared memory transport epoll failed, errno: " << errno << "\n";
+            break;
+        }
+        BeatHeartbeat();
+        for (int i = 0; i < count; i++) {
+            int fd = events[i].data.fd;
+            if (fd == m_registrationServer.GetHandler()) {
+                OnConnection();
+                continue;
+            }
+            if (m_pending.count(fd) != 0) {
+                OnRegistration(fd);
+                continue;
+            }
+            auto it = m_rings.find(fd);
+            if (it == m_rings.end()) {
+                continue;
+            }
+            std::shared_ptr<Ring> ring = it->second;
+            if (fd == ring->eventFd) {
+                uint64_t counter = 0;
+                (void)TEMP_FAILURE_RETRY(read(ring->eventFd, &counter, sizeof(counter)));
+                m_busyRings.insert(ring->eventFd);
+                continue;
+            }
+            // Registration connection is closed when the client goes away, nobody writes into the ring
+            // anymore, so take what is left and drop the ring
+            (void)DrainRing(*ring, SIZE_MAX);
+            RemoveRing(fd);
+        }
+        DrainBusyRings();
+        RemoveStalePending();
+    }
+}
+
+void HilogInputShmServer::DrainBusyRings()
+{
+    std::vector<int> busy(m_busyRings.begin(), m_busyRings.end());
+    for (int fd : busy) {
+        auto it = m_rings.find(fd);
+        if (it == m_rings.end()) {
+            m_busyRings.erase(fd);
+            continue;
+        }
+        DrainResult result = DrainRing(*it->second, 1);
+        if (result == DrainResult::INVALID) {
+            RemoveRing(fd);
+        } else if (result == DrainResult::EMPTY) {
+            m_busyRings.erase(fd);
+        }
+    }
+}
+
+static int64_t NowMs()
+{
+    timespec ts = {0};
+    (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000; // 1000 : sec to msec, 1000000 : nsec
+}
+
+void HilogInputShmServer::BeatHeartbeat()
+{
+    uint32_t now = ShmHeartbeatNow();
+    if (now == m_heartbeat) {
+        return;
+    }
+    m_heartbeat = now;
+    for (auto& [fd, ring] : m_rings) {
+        ring->header->heartbeat.store(now, std::memory_order_relaxed);
+    }
+}
+
+/* again is set if the message hasn't arrived yet */
+static bool ReceiveRegistration(int fd, int (&fds)[SHM_FD_COUNT], bool& again)
+{
+    HilogShmRegisterMsg msg = {0};
+    iovec iov = {&msg, sizeof(msg)};
+    // Listening sockets are created with SO_PASSCRED, so credentials come along with the descriptors
+    std::array<char, CMSG_SPACE(sizeof(int) * SHM_FD_COUNT) + CMSG_SPACE(sizeof(ucred))> control = {0};
+    msghdr msgh = {0};
+    msgh.msg_iov = &iov;
+    msgh.msg_iovlen = 1;
+    msgh.msg_control = control.data();
+    msgh.msg_controllen = control.size();
+    ssize_t ret = TEMP_FAILURE_RETRY(recvmsg(fd, &msgh, MSG_CMSG_CLOEXEC | MSG_DONTWAIT));
+    again = (ret < 0) && (errno == EAGAIN || errno == EWOULDBLOCK);
+    size_t fdCount = 0;
+    for (cmsghdr *cmsg = CMSG_FIRSTHDR(&msgh); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msgh, cmsg)) {
+        if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) {
+            continue;
+        }
+        const int *receivedFds = reinterpret_cast<const int *>(CMSG_DATA(cmsg));
+        size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        for (size_t i = 0; i < count; i++) {
+            if (fdCount < SHM_FD_COUNT) {
+                fds[fdCount] = receivedFds[i];
+            } else {
+                close(receivedFds[i]);
+            }
+            fdCount++;
+        }
+    }
+    bool valid = (fdCount == SHM_FD_COUNT) && (msgh.msg_flags & MSG_CTRUNC) == 0 &&
+        ret == static_cast<ssize_t>(sizeof(msg)) && msg.magic == SHM_RING_MAGIC &&
+        msg.version == SHM_RING_VERSION && msg.mapSize == SHM_RING_MAP_SIZE;
+    if (!valid) {
+        for (size_t i = 0; i < std::min(fdCount, SHM_FD_COUNT); i++) {
+            close(fds[i]);
+        }
+    }
+    return valid;
+}
+
+static void *MapRing(int memFd)
+{
+    // The client must not be able to shrink the ring under our mapping
+    struct stat st = {0};
+    int seals = fcntl(memFd, F_GET_SEALS);
+    if (fstat(memFd, &st) < 0 || static_cast<size_t>(st.st_size) < SHM_RING_MAP_SIZE ||
+        seals < 0 || (seals & F_SEAL_SHRINK) == 0) {
+        return nullptr;
+    }
+    void *map = mmap(nullptr, SHM_RING_MAP_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, memFd, 0);
+    return (map == MAP_FAILED) ? nullptr : map;
+}
+
+void HilogInputShmServer::OnConnection()
+{
+    int fd = m_registrationServer.Accept();
+    if (fd < 0) {
+        return;
+    }
+    PendingRegistration pending = {{0}, NowMs() + SHM_REGISTER_TIMEOUT_MS};
+    socklen_t credLen = sizeof(pending.cred);
+    epoll_event event = {0};
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    if (m_rings.size() / SHM_FD_COUNT + m_pending.size() >= MAX_SHM_CLIENTS ||
+        getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &pending.cred, &credLen) < 0 ||
+        epoll_ctl(m_epollFd, EPOLL_CTL_ADD, fd, &event) < 0) {
+        close(fd);
+        return;
+    }
+    // The ring comes in the first message, read it once it is there
+    m_pending[fd] = pending;
+}
+
+void HilogInputShmServer::OnRegistration(int fd)
+{
+    int fds[SHM_FD_COUNT] = {-1, -1};
+    bool again = false;
+    bool received = ReceiveRegistration(fd, fds, again);
+    if (again) {
+        return;
+    }
+    ucred cred = m_pending[fd].cred;
+    m_pending.erase(fd);
+    (void)epoll_ctl(m_epollFd, EPOLL_CTL_DEL, fd, nullptr);
+    if (!received) {
+        close(fd);
+        return;
+    }
+    void *map = MapRing(fds[0]);
+    close(fds[0]);
+    HilogShmRingHeader *header = static_cast<HilogShmRingHeader *>(map);
+    if (header == nullptr || header->magic != SHM_RING_MAGIC || header->dataSize != SHM_RING_DATA_SIZE) {
+        if (map != nullptr) {
+            munmap(map, SHM_RING_MAP_SIZE);
+        }
+        close(fds[1]);
+        close(fd);
+        return;
+    }
+
+    auto ring = std::make_shared<Ring>();
+    ring->registrationFd = fd;
+    ring->eventFd = fds[1];
+    ring->header = header;
+    ring->data = static_cast<const char *>(map) + SHM_RING_DATA_OFFSET;
+    ring->cred = cred;
+    epoll_event event = {0};
+    event.events = EPOLLIN;
+    event.data.fd = ring->eventFd;
+    (void)epoll_ctl(m_epollFd, EPOLL_CTL_ADD, ring->eventFd, &event);
+    event.events = EPOLLRDHUP | EPOLLHUP;
+    event.data.fd = ring->registrationFd;
+    (void)epoll_ctl(m_epollFd, EPOLL_CTL_ADD, ring->registrationFd, &event);
+    m_rings[ring->eventFd] = ring;
+    m_rings[ring->registrationFd] = ring;
+    header->heartbeat.store(ShmHeartbeatNow(), std::memory_order_relaxed);
+
+    char status = 0;
+    (void)TEMP_FAILURE_RETRY(send(fd, &status, sizeof(status), MSG_NOSIGNAL | MSG_DONTWAIT));
+}
+
+void HilogInputShmServer::RemovePending(int fd)
+{
+    m_pending.erase(fd);
+    (void)epoll_ctl(m_epollFd, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+}
+
+void HilogInputShmServer::RemoveStalePending()
+{
+    if (m_pending.empty()) {
+        return;
+    }
+    int64_t now = NowMs();
+    std::vector<int> stale;
+    for (auto& [fd, pending] : m_pending) {
+        if (pending.deadlineMs <= now) {
+            stale.push_back(fd);
+        }
+    }
+    for (int fd : stale) {
+        RemovePending(fd);
+    }
+}
+
+void HilogInputShmServer::RemoveRing(int fd)
+{
+    auto it = m_rings.find(fd);
+    if (it == m_rings.end()) {
+        return;
+    }
+    std::shared_ptr<Ring> ring = it->second;
+    m_busyRings.erase(ring->eventFd);
+    m_rings.erase(ring->eventFd);
+    m_rings.erase(ring->registrationFd);
+    (void)epoll_ctl(m_epollFd, EPOLL_CTL_DEL, ring->eventFd, nullptr);
+    (void)epoll_ctl(m_epollFd, EPOLL_CTL_DEL, ring->registrationFd, nullptr);
+    close(ring->eventFd);
+    close(ring->registrationFd);
+    // The client stops writing into a ring nobody drains
+    ring->header->heartbeat.store(0, std::memory_order_relaxed);
+    munmap(ring->header, SHM_RING_MAP_SIZE);
+}
+
+HilogInputShmServer::DrainResult HilogInputShmServer::DrainRing(Ring& ring, size_t maxBatches)
+{
+    HilogShmRingHeader *header = ring.header;
+    uint64_t readPos = header->readPos.load(std::memory_order_relaxed);
+    size_t batches = 0;
+    while (true) {
+        // Everything coming from the ring is written by an untrusted process, so check it all
+        uint64_t writePos = header->writePos.load(std::memory_order_acquire);
+        uint64_t available = writePos - readPos;
+        if (available > SHM_RING_DATA_SIZE) {
+            return DrainResult::INVALID;
+        }
+        m_packets.clear();
+        while (available > 0 && m_packets.size() < DRAIN_BATCH_SIZE) {
+            size_t offset = readPos & (SHM_RING_DATA_SIZE - 1);
+            size_t spaceToEnd = SHM_RING_DATA_SIZE - offset;
+            uint16_t len = *reinterpret_cast<const uint16_t *>(ring.data + offset);
+            if (len == 0) {
+                if (spaceToEnd > available) {
+                    return DrainResult::INVALID;
+                }
+                readPos += spaceToEnd;
+                available -= spaceToEnd;
+                continue;
+            }
+            size_t recordLen = (len + SHM_RECORD_ALIGN - 1) & ~static_cast<size_t>(SHM_RECORD_ALIGN - 1);
+            if (len < sizeof(HilogMsg) || len > MAX_RECORD_LEN || recordLen > spaceToEnd || recordLen > available) {
+                return DrainResult::INVALID;
+            }
+            char *slot = m_recordSlab.data() + m_packets.size() * MAX_RECORD_LEN;
+            if (memcpy_s(slot, MAX_RECORD_LEN, ring.data + offset, len) != 0) {
+                return DrainResult::INVALID;
+            }
+            reinterpret_cast<HilogMsg *>(slot)->len = len; // client may have changed it after our check
+            slot[len - 1] = 0;
+            DgramPacket packet;
+            packet.data = slot;
+            packet.len = len;
+            packet.cred = ring.cred;
+            m_packets.push_back(packet);
+            readPos += recordLen;
+            available -= recordLen;
+        }
+        header->readPos.store(readPos, std::memory_order_release);
+        if (!m_packets.empty()) {
+            m_batchHandler(m_packets);
+            if (++batches >= maxBatches) {
+                return DrainResult::MORE;
+            }
+            continue;
+        }
+
+        // Ring is empty, ask for a signal and check once more to not miss a record written meanwhile
+        header->consumerWaiting.store(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (header->writePos.load(std::memory_order_acquire) == readPos) {
+            return DrainResult::EMPTY;
+        }
+        header->consumerWaiting.store(0, std::memory_order_relaxed);
+    }
+}
+} // namespace HiviewDFX
+} // namespace OHOS
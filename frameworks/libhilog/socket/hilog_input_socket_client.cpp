@@ -13,19 +13,247 @@
  * limitations under the License.
  */
 
+#include <pthread.h>
+#include <set>
 #include <sys/time.h>
 
+#include <securec.h>
+#include <hilog/log.h>
+
+#include "hilog_input_shm_client.h"
 #include "hilog_input_socket_client.h"
+#include "properties.h"
 
 namespace OHOS {
 namespace HiviewDFX {
+static constexpr auto BATCH_FLUSH_INTERVAL = std::chrono::milliseconds(20);
+static const char BATCH_DROP_TAG[] = "LOGLIMITP";
+
+/* Clients with batching on, the fork handlers flush them all */
+static std::mutex g_batchingClientsMtx;
+static std::set<HilogInputSocketClient*> g_batchingClients;
+static std::once_flag g_batchingParamFlag;
+
 static HilogInputSocketClient g_hilogInputSocketClient;
 extern "C" int HilogWriteLogMessage(HilogMsg *header, const char *tag, uint16_t tagLen, const char *fmt,
     uint16_t fmtLen)
 {
+    // Shared memory ring is tried first when enabled, the socket stays as fallback
+    static const bool useShm = IsShmTransportOn();
+    if (useShm) {
+        int ret = HilogShmWriteLogMessage(header, tag, tagLen, fmt, fmtLen);
+        if (ret >= 0) {
+            return ret;
+        }
+    }
+    // Parameter is read at the first log, HiLogSetWriteBatching() called before wins
+    std::call_once(g_batchingParamFlag, []() {
+        if (IsWriteBatchingOn()) {
+            g_hilogInputSocketClient.SetBatching(true);
+        }
+    });
     return g_hilogInputSocketClient.WriteLogMessage(header, tag, tagLen, fmt, fmtLen);
 }
 
+extern "C" uint32_t HilogGetWriteLosses()
+{
+    return g_hilogInputSocketClient.GetWriteLosses() + HilogShmGetWriteLosses();
+}
+
+extern "C" void HiLogSetWriteBatching(bool enable)
+{
+    std::call_once(g_batchingParamFlag, []() {});
+    g_hilogInputSocketClient.SetBatching(enable);
+}
+
+HilogInputSocketClient::~HilogInputSocketClient()
+{
+    SetBatching(false);
+}
+
+void HilogInputSocketClient::SetBatching(bool enable)
+{
+    std::unique_ptr<std::thread> flushThread;
+    {
+        std::lock_guard<std::mutex> clientsLock(g_batchingClientsMtx);
+        std::lock_guard<std::mutex> lock(m_batchMtx);
+        if (m_batching == enable) {
+            return;
+        }
+        m_batching = enable;
+        if (enable) {
+            static std::once_flag forkHandlerFlag;
+            std::call_once(forkHandlerFlag, []() {
+                (void)pthread_atfork(PrepareFork, ParentAfterFork, ChildAfterFork);
+            });
+            g_batchingClients.insert(this);
+            m_stopFlush = false;
+            m_flushThread = std::make_unique<std::thread>(&HilogInputSocketClient::FlushLoop, this);
+            return;
+        }
+        g_batchingClients.erase(this);
+        (void)SendBatchLocked();
+        m_stopFlush = true;
+        flushThread = std::move(m_flushThread);
+    }
+    m_batchCv.notify_all();
+    if (flushThread && flushThread->joinable()) {
+        flushThread->join();
+    }
+}
+
+void HilogInputSocketClient::FlushBatch()
+{
+    std::lock_guard<std::mutex> lock(m_batchMtx);
+    (void)SendBatchLocked();
+}
+
+void HilogInputSocketClient::FlushLoop()
+{
+    std::unique_lock<std::mutex> lock(m_batchMtx);
+    while (!m_stopFlush) {
+        if (m_batchLen == 0) {
+            m_batchCv.wait(lock);
+            continue;
+        }
+        // Give more records a chance to join the packet, then send whatever is there
+        m_batchCv.wait_for(lock, BATCH_FLUSH_INTERVAL);
+        (void)SendBatchLocked();
+    }
+}
+
+int HilogInputSocketClient::SendBatchLocked()
+{
+    if (m_batchLen == 0) {
+        return 0;
+    }
+    int ret = CheckSocket();
+    if (ret >= 0) {
+        ret = Write(m_batchBuf, m_batchLen);
+        if (ret < 0) {
+            Connect();
+            ret = Write(m_batchBuf, m_batchLen);
+        }
+    }
+    if (ret < 0) {
+        // Every record of the batch is lost, the next batch starts with how many
+        m_batchDropped += m_batchRecords;
+        m_writeLosses.fetch_add(1, std::memory_order_relaxed);
+    }
+    m_batchLen = 0;
+    m_batchRecords = 0;
+    return ret;
+}
+
+bool HilogInputSocketClient::CopyToBatchLocked(const HilogMsg *header, const char *tag, uint16_t tagLen,
+    const char *fmt, uint16_t fmtLen)
+{
+    size_t recordLen = sizeof(HilogMsg) + tagLen + fmtLen;
+    if (m_batchLen + recordLen > sizeof(m_batchBuf)) {
+        return false;
+    }
+    char *record = m_batchBuf + m_batchLen;
+    size_t room = sizeof(m_batchBuf) - m_batchLen;
+    if (memcpy_s(record, room, header, sizeof(HilogMsg)) != 0 ||
+        memcpy_s(record + sizeof(HilogMsg), room - sizeof(HilogMsg), tag, tagLen) != 0 ||
+        memcpy_s(record + sizeof(HilogMsg) + tagLen, room - sizeof(HilogMsg) - tagLen, fmt, fmtLen) != 0) {
+        return false;
+    }
+    m_batchLen += recordLen;
+    return true;
+}
+
+void HilogInputSocketClient::AppendDropNoticeLocked(const HilogMsg *header)
+{
+    char content[MAX_LOG_LEN] = {0};
+    int len = snprintf_s(content, sizeof(content), sizeof(content) - 1, "%u line(s) dropped!", m_batchDropped);
+    if (len < 0) {
+        return;
+    }
+    HilogMsg notice = *header;
+    notice.version = HILOG_MSG_VERSION_TEXT;
+    notice.level = LOG_WARN;
+    notice.tag_len = sizeof(BATCH_DROP_TAG);
+    notice.len = sizeof(HilogMsg) + sizeof(BATCH_DROP_TAG) + len + 1;
+    if (CopyToBatchLocked(&notice, BATCH_DROP_TAG, sizeof(BATCH_DROP_TAG), content, len + 1)) {
+        // Counted again if this batch is lost too
+        m_batchRecords += m_batchDropped;
+        m_batchDropped = 0;
+    }
+}
+
+int HilogInputSocketClient::AppendToBatch(const HilogMsg *header, const char *tag, uint16_t tagLen,
+    const char *fmt, uint16_t fmtLen)
+{
+    std::unique_lock<std::mutex> lock(m_batchMtx);
+    if (!m_batching) {
+        return -1;
+    }
+    size_t recordLen = header->len;
+    if (m_batchLen + recordLen > sizeof(m_batchBuf)) {
+        (void)SendBatchLocked();
+    }
+    bool wasEmpty = (m_batchLen == 0);
+    if (wasEmpty && m_batchDropped > 0) {
+        AppendDropNoticeLocked(header);
+    }
+    if (!CopyToBatchLocked(header, tag, tagLen, fmt, fmtLen)) {
+        // No room behind the drop notice, it goes alone
+        (void)SendBatchLocked();
+        wasEmpty = true;
+        if (!CopyToBatchLocked(header, tag, tagLen, fmt, fmtLen)) {
+            return -1;
+        }
+    }
+    m_batchRecords++;
+
+    if (header->level >= LOG_ERROR) {
+        // Don't keep important records waiting, the process may be about to die
+        int ret = SendBatchLocked();
+        if (ret < 0) {
+            // The caller sends this record again alone, only the others are lost
+            m_batchDropped--;
+            return ret;
+        }
+        return static_cast<int>(recordLen);
+    }
+    if (wasEmpty) {
+        m_batchCv.notify_one();
+    }
+    return static_cast<int>(recordLen);
+}
+
+void HilogInputSocketClient::PrepareFork()
+{
+    g_batchingClientsMtx.lock();
+    for (HilogInputSocketClient *client : g_batchingClients) {
+        client->m_batchMtx.lock();
+        // Pending records are sent once, before the child gets a copy of them
+        (void)client->SendBatchLocked();
+    }
+}
+
+void HilogInputSocketClient::ParentAfterFork()
+{
+    for (HilogInputSocketClient *client : g_batchingClients) {
+        client->m_batchMtx.unlock();
+    }
+    g_batchingClientsMtx.unlock();
+}
+
+void HilogInputSocketClient::ChildAfterFork()
+{
+    // Flush threads aren't running in the child, it starts with batching off
+    for (HilogInputSocketClient *client : g_batchingClients) {
+        client->m_batching = false;
+        client->m_batchDropped = 0;
+        (void)client->m_flushThread.release();
+        client->m_batchMtx.unlock();
+    }
+    g_batchingClients.clear();
+    g_batchingClientsMtx.unlock();
+}
+
 int HilogInputSocketClient::WriteLogMessage(HilogMsg *header, const char *tag, uint16_t tagLen, const char *fmt,
     uint16_t fmtLen)
 {
@@ -41,6 +269,13 @@ int HilogInputSocketClient::WriteLogMessage(HilogMsg *header, const char *tag, u
     header->len = sizeof(HilogMsg) + tagLen + fmtLen;
     header->tag_len = tagLen;
 
+    if (m_batching.load(std::memory_order_relaxed)) {
+        ret = AppendToBatch(header, tag, tagLen, fmt, fmtLen);
+        if (ret >= 0) {
+            return ret;
+        }
+    }
+
     iovec vec[3];
     vec[0].iov_base = header;                                              // 0 : index of hos log header
     vec[0].iov_len = sizeof(HilogMsg);                                     // 0 : index of hos log header
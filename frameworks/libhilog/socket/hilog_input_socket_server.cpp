@@ -15,6 +15,7 @@
 
 #include "hilog_input_socket_server.h"
 #include <sys/prctl.h>
+#include <sys/socket.h>
 #include <thread>
 
 namespace OHOS {
@@ -46,6 +47,8 @@ void HilogInputSocketServer::StopServingThread()
     std::swap(m_serverThread, tmp);
     if (tmp.joinable()) {
         m_stopServer.store(true);
+        // Wake up the serving thread blocked in receive, the socket isn't read anymore
+        (void)shutdown(GetHandler(), SHUT_RD);
         tmp.join();
     }
 }
@@ -53,6 +56,10 @@ void HilogInputSocketServer::StopServingThread()
 void HilogInputSocketServer::ServingThread()
 {
     prctl(PR_SET_NAME, "hilogd.server");
+    if (m_batchHandler) {
+        BatchServingThread();
+        return;
+    }
     int ret;
     std::vector<char> data;
 #ifndef __RECV_MSG_WITH_UCRED_
@@ -76,5 +83,24 @@ void HilogInputSocketServer::ServingThread()
     }
 #endif
 }
+
+void HilogInputSocketServer::BatchServingThread()
+{
+#ifndef __RECV_MSG_WITH_UCRED_
+    constexpr bool withCred = false;
+#else
+    constexpr bool withCred = true;
+#endif
+    int ret;
+    std::vector<DgramPacket> packets;
+    while ((ret = RecvPackets(packets, withCred)) >= 0) {
+        if (ret > 0) {
+            m_batchHandler(packets);
+        }
+        if (m_stopServer.load()) {
+            break;
+        }
+    }
+}
 } // namespace HiviewDFX
 } // namespace OHOS
@@ -22,13 +22,26 @@
 
 namespace OHOS {
 namespace HiviewDFX {
+struct DgramPacket {
+    char *data; /* points into receive slab, valid until next RecvPackets() */
+    uint16_t len;
+    struct ucred cred; /* filled only if credentials were requested */
+};
+
 class DgramSocketServer : public SocketServer {
 public:
     DgramSocketServer(const std::string& socketName, uint16_t maxLength)
         : SocketServer(socketName, SOCK_DGRAM), maxPacketLength(maxLength) {}
     int RecvPacket(std::vector<char>& buffer, struct ucred *cred = nullptr);
+    int RecvPackets(std::vector<DgramPacket>& packets, bool withCred = false);
 private:
+    void InitBatchSlab();
+
     uint16_t maxPacketLength;
+    std::vector<char> packetSlab;
+    std::vector<char> controlSlab;
+    std::vector<struct iovec> iovecs;
+    std::vector<struct mmsghdr> msgHdrs;
 };
 } // namespace HiviewDFX
 } // namespace OHOS
@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2022 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HILOG_INPUT_SHM_CLIENT_H
+#define HILOG_INPUT_SHM_CLIENT_H
+
+#include <atomic>
+#include <mutex>
+#include <string>
+
+#include "hilog_common.h"
+#include "hilog_shm_ring.h"
+
+namespace OHOS {
+namespace HiviewDFX {
+/*
+ * Logging process side of the shared memory transport. The ring is sent to hilogd without
+ * waiting for the answer, logs go to the socket until hilogd has taken the ring. If hilogd
+ * isn't there or goes away, registration is tried again later with a growing delay.
+ */
+class HilogInputShmClient {
+public:
+    HilogInputShmClient() : m_socketName(INPUT_SHM_SOCKET_NAME) {}
+    /* For test servers listening on another socket */
+    explicit HilogInputShmClient(const std::string& socketName) : m_socketName(socketName) {}
+    ~HilogInputShmClient();
+    HilogInputShmClient(const HilogInputShmClient&) = delete;
+    HilogInputShmClient& operator=(const HilogInputShmClient&) = delete;
+
+    /* Returns negative value if the record couldn't be put into the ring,
+     * caller is expected to fall back to the socket transport then */
+    int WriteLogMessage(HilogMsg *header, const char *tag, uint16_t tagLen, const char *fmt, uint16_t fmtLen);
+    /* Rings given up while they were in use, records in them may not have been read */
+    uint32_t GetWriteLosses() const
+    {
+        return m_writeLosses.load(std::memory_order_relaxed);
+    }
+
+private:
+    enum class State {
+        UNREGISTERED,
+        PENDING,
+        REGISTERED,
+        FAILED
+    };
+
+    bool IsRingUsable();
+    int StartRegistration();
+    void CheckRegistration();
+    void Fail();
+    void Unregister();
+    bool IsServerGone() const;
+    void WakeUpServer();
+    static void PrepareFork();
+    static void ParentAfterFork();
+    static void ChildAfterFork();
+
+    const std::string m_socketName;
+    std::mutex m_ringMtx;
+    State m_state = State::UNREGISTERED;
+    int64_t m_deadlineMs = 0; /* PENDING: when to give up waiting, FAILED: when to try again */
+    int64_t m_retryDelayMs = 0;
+    int m_eventFd = -1;
+    int m_registrationFd = -1;
+    HilogShmRingHeader *m_ring = nullptr;
+    char *m_ringData = nullptr;
+    std::atomic<uint32_t> m_writeLosses {0};
+};
+} // namespace HiviewDFX
+} // namespace OHOS
+
+extern "C" int HilogShmWriteLogMessage(HilogMsg *header, const char *tag, uint16_t tagLen, const char *fmt,
+    uint16_t fmtLen);
+extern "C" uint32_t HilogShmGetWriteLosses();
+#endif /* HILOG_INPUT_SHM_CLIENT_H */
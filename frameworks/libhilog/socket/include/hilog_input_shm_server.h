@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2022 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HILOG_INPUT_SHM_SERVER_H
+#define HILOG_INPUT_SHM_SERVER_H
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "dgram_socket_server.h"
+#include "hilog_shm_ring.h"
+#include "seq_packet_socket_server.h"
+
+namespace OHOS {
+namespace HiviewDFX {
+/*
+ * hilogd side of the shared memory transport. Accepts ring registrations on
+ * INPUT_SHM_SOCKET_NAME socket and drains registered rings when their eventfd fires.
+ * Registrations are read when they arrive, a slow client never stalls draining.
+ * Each visit of a ring drains one batch, rings with records left are visited in turns,
+ * so a client which never stops writing doesn't starve the others.
+ * Drained records are handed over in batches the same way as received datagrams,
+ * credentials of every record are the ones of the registering peer.
+ */
+class HilogInputShmServer {
+public:
+    using BatchHandlingFunc = std::function<void(std::vector<DgramPacket>& packets)>;
+
+    explicit HilogInputShmServer(BatchHandlingFunc batchHandler);
+    /* For test servers listening on another socket */
+    HilogInputShmServer(const std::string& socketName, BatchHandlingFunc batchHandler);
+    ~HilogInputShmServer();
+
+    int Init();
+    bool RunServingThread();
+    void StopServingThread();
+
+private:
+    struct Ring {
+        int registrationFd = -1;
+        int eventFd = -1;
+        HilogShmRingHeader *header = nullptr;
+        const char *data = nullptr;
+        ucred cred = {0};
+    };
+
+    enum class DrainResult {
+        EMPTY,
+        MORE,
+        INVALID
+    };
+
+    struct PendingRegistration {
+        ucred cred;
+        int64_t deadlineMs;
+    };
+
+    void ServingThread();
+    void OnConnection();
+    void OnRegistration(int fd);
+    void RemovePending(int fd);
+    void RemoveStalePending();
+    void BeatHeartbeat();
+    DrainResult DrainRing(Ring& ring, size_t maxBatches);
+    void DrainBusyRings();
+    void RemoveRing(int fd);
+
+    SeqPacketSocketServer m_registrationServer;
+    BatchHandlingFunc m_batchHandler;
+    int m_epollFd = -1;
+    std::map<int, std::shared_ptr<Ring>> m_rings; /* both eventfd and registration fd map to the ring */
+    std::map<int, PendingRegistration> m_pending; /* connections which haven't sent their ring yet */
+    std::set<int> m_busyRings; /* eventfds of rings which had records left after their last visit */
+    uint32_t m_heartbeat = 0;
+    std::vector<char> m_recordSlab;
+    std::vector<DgramPacket> m_packets;
+    std::thread m_serverThread;
+    std::atomic_bool m_stopServer;
+};
+} // namespace HiviewDFX
+} // namespace OHOS
+#endif /* HILOG_INPUT_SHM_SERVER_H */
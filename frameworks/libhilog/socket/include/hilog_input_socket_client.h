@@ -16,6 +16,12 @@
 #ifndef HILOG_INPUT_SOCKET_CLIENT_H
 #define HILOG_INPUT_SOCKET_CLIENT_H
 
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
 #include "hilog_common.h"
 #include "dgram_socket_client.h"
 
@@ -24,12 +30,49 @@ namespace HiviewDFX {
 class HilogInputSocketClient : DgramSocketClient {
 public:
     HilogInputSocketClient() : DgramSocketClient(INPUT_SOCKET_NAME, SOCK_NONBLOCK | SOCK_CLOEXEC) {}
+    /* For test and benchmark servers listening on another socket */
+    explicit HilogInputSocketClient(const std::string& socketName)
+        : DgramSocketClient(socketName, SOCK_NONBLOCK | SOCK_CLOEXEC) {}
     int WriteLogMessage(HilogMsg *header, const char *tag, uint16_t tagLen, const char *fmt, uint16_t fmtLen);
-    ~HilogInputSocketClient() = default;
+    void SetBatching(bool enable);
+    void FlushBatch();
+    /* Batches which couldn't be sent, their records were accepted and are lost */
+    uint32_t GetWriteLosses() const
+    {
+        return m_writeLosses.load(std::memory_order_relaxed);
+    }
+    ~HilogInputSocketClient();
+
+private:
+    int AppendToBatch(const HilogMsg *header, const char *tag, uint16_t tagLen, const char *fmt, uint16_t fmtLen);
+    bool CopyToBatchLocked(const HilogMsg *header, const char *tag, uint16_t tagLen, const char *fmt,
+        uint16_t fmtLen);
+    void AppendDropNoticeLocked(const HilogMsg *header);
+    int SendBatchLocked();
+    void FlushLoop();
+    static void PrepareFork();
+    static void ParentAfterFork();
+    static void ChildAfterFork();
+
+    /* Opt-in batching: records are appended back-to-back into one packet which is sent
+     * when full, on a short timer, or right away for ERROR and FATAL records. Records of
+     * batches which couldn't be sent are counted and told in front of the next batch. */
+    std::atomic_bool m_batching {false};
+    bool m_stopFlush = false;
+    size_t m_batchLen = 0;
+    uint32_t m_batchRecords = 0;
+    uint32_t m_batchDropped = 0;
+    std::atomic<uint32_t> m_writeLosses {0};
+    char m_batchBuf[MAX_SOCKET_PACKET_LEN];
+    std::mutex m_batchMtx;
+    std::condition_variable m_batchCv;
+    std::unique_ptr<std::thread> m_flushThread;
 };
 } // namespace HiviewDFX
 } // namespace OHOS
 
 extern "C" int HilogWriteLogMessage(HilogMsg *header, const char *tag, uint16_t tagLen, const char *fmt,
     uint16_t fmtLen);
+/* Grows whenever records which HilogWriteLogMessage accepted were lost, by any transport */
+extern "C" uint32_t HilogGetWriteLosses();
 #endif /* HILOG_INPUT_SOCKET_CLIENT_H */
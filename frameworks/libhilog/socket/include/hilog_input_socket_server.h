@@ -23,8 +23,6 @@
 
 namespace OHOS {
 namespace HiviewDFX {
-#define MAX_SOCKET_PACKET_LEN 4096
-
 class HilogInputSocketServer : public DgramSocketServer {
 public:
 
@@ -33,6 +31,7 @@ public:
 #else
     using HandlingFunc = std::function<void(const ucred& credential, std::vector<char>& data)>;
 #endif
+    using BatchHandlingFunc = std::function<void(std::vector<DgramPacket>& packets)>;
     enum class ServerThreadState {
         JUST_STARTED,
         ALREADY_STARTED,
@@ -44,6 +43,17 @@ public:
         m_packetHandler(_packetHandler), m_stopServer(false)
         {}
 
+    explicit HilogInputSocketServer(BatchHandlingFunc _batchHandler)
+        : DgramSocketServer(INPUT_SOCKET_NAME, MAX_SOCKET_PACKET_LEN),
+        m_batchHandler(_batchHandler), m_stopServer(false)
+        {}
+
+    /* For test and benchmark servers listening on another socket */
+    HilogInputSocketServer(const std::string& socketName, BatchHandlingFunc _batchHandler)
+        : DgramSocketServer(socketName, MAX_SOCKET_PACKET_LEN),
+        m_batchHandler(_batchHandler), m_stopServer(false)
+        {}
+
     ~HilogInputSocketServer();
 
     ServerThreadState RunServingThread();
@@ -51,8 +61,10 @@ public:
 
 private:
     void ServingThread();
+    void BatchServingThread();
 
     HandlingFunc m_packetHandler = nullptr;
+    BatchHandlingFunc m_batchHandler = nullptr;
     std::thread m_serverThread;
     std::atomic_bool m_stopServer;
 };
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2022 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HILOG_SHM_RING_H
+#define HILOG_SHM_RING_H
+
+#include <atomic>
+#include <cstdint>
+#include <ctime>
+
+#include "hilog_common.h"
+
+#define INPUT_SHM_SOCKET_NAME "hilogInputShm"
+
+namespace OHOS {
+namespace HiviewDFX {
+/*
+ * Layout of the shared memory ring used by the shared memory log transport.
+ * The ring is created by a logging process (memfd), registered at hilogd together with
+ * an eventfd over INPUT_SHM_SOCKET_NAME socket and then drained by hilogd.
+ * Records are HilogMsg packets aligned to SHM_RECORD_ALIGN. A record with len == 0 tells
+ * the reader to continue from the ring start. Positions are free running byte counters.
+ * Threads of the logging process serialize among themselves, so the ring has a single
+ * producer and a single consumer.
+ * hilogd stamps the ring with a heartbeat while it drains it and clears it when it lets the
+ * ring go, so writers find out about a dead hilogd without a system call for every log.
+ */
+constexpr uint32_t SHM_RING_MAGIC = 0x484c5352; /* "HLSR" */
+constexpr uint32_t SHM_RING_VERSION = 2;
+constexpr uint32_t SHM_RING_DATA_SIZE = 64 * 1024; /* must be power of 2 */
+constexpr uint32_t SHM_RECORD_ALIGN = 8;
+constexpr size_t SHM_FD_COUNT = 2; /* registration passes the ring memfd and the eventfd */
+constexpr int SHM_REGISTER_TIMEOUT_MS = 100;
+constexpr uint32_t SHM_HEARTBEAT_TIMEOUT_SEC = 3; /* hilogd beats at least every second when alive */
+
+struct HilogShmRingHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t dataSize;
+    std::atomic<uint32_t> consumerWaiting; /* hilogd wants an eventfd signal for new data */
+    std::atomic<uint32_t> heartbeat; /* CLOCK_MONOTONIC seconds of hilogd (at least 1), 0 if it is gone */
+    alignas(64) std::atomic<uint64_t> writePos; /* updated by producer only */
+    alignas(64) std::atomic<uint64_t> readPos; /* updated by hilogd only */
+};
+
+struct HilogShmRegisterMsg {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t mapSize;
+};
+
+constexpr size_t SHM_RING_DATA_OFFSET = (sizeof(HilogShmRingHeader) + 63) & ~static_cast<size_t>(63);
+constexpr size_t SHM_RING_MAP_SIZE = SHM_RING_DATA_OFFSET + SHM_RING_DATA_SIZE;
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared ring needs address free atomics");
+
+/* Heartbeat hilogd stamps now, a coarse clock is enough and costs no system call */
+inline uint32_t ShmHeartbeatNow()
+{
+    timespec ts = {0};
+    (void)clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    uint32_t sec = static_cast<uint32_t>(ts.tv_sec);
+    return (sec == 0) ? 1 : sec;
+}
+} // namespace HiviewDFX
+} // namespace OHOS
+#endif /* HILOG_SHM_RING_H */
@@ -35,9 +35,14 @@ public:
     int Init();
     int Recv(void *buffer, unsigned int bufferLen, int flags = MSG_PEEK);
     int RecvMsg(struct msghdr *hdr, int flags = 0);
+    int RecvMMsg(struct mmsghdr *hdrs, unsigned int count, int flags = MSG_WAITFORONE);
     int Listen(unsigned int backlog);
     int Poll(short inEvent, short& outEvent, const std::chrono::milliseconds& timeout);
     int Accept();
+    int GetHandler() const
+    {
+        return socketHandler;
+    }
 private:
     int socketHandler;
     uint32_t socketType;
@@ -76,6 +76,11 @@ int SocketServer::RecvMsg(struct msghdr *hdr, int flags)
     return recvmsg(socketHandler, hdr, flags);
 }
 
+int SocketServer::RecvMMsg(struct mmsghdr *hdrs, unsigned int count, int flags)
+{
+    return TEMP_FAILURE_RETRY(recvmmsg(socketHandler, hdrs, count, flags, nullptr));
+}
+
 int SocketServer::Listen(unsigned int backlog)
 {
     return listen(socketHandler, backlog);
@@ -47,56 +47,95 @@ int ColorFromLevel(uint16_t level)
             return HILOG_COLOR_DEFAULT;
     }
 }
+
+constexpr uint32_t SECONDS_SHOWFORMAT_MASK = (1 << EPOCH_SHOWFORMAT) | (1 << MONOTONIC_SHOWFORMAT) |
+    (1 << YEAR_SHOWFORMAT) | (1 << ZONE_SHOWFORMAT);
+constexpr size_t MAX_SECONDS_TEXT_LEN = 32;
+constexpr size_t NSEC_DIGITS = 9;
+constexpr size_t USEC_DIGITS = 6;
+constexpr size_t MSEC_DIGITS = 3;
+constexpr unsigned long DECIMAL_BASE = 10;
+
+/* Seconds part of the time formatted last by the thread, consecutive logs mostly share it */
+struct SecondsText {
+    bool valid = false;
+    time_t sec = 0;
+    uint32_t format = 0;
+    size_t len = 0;
+    char text[MAX_SECONDS_TEXT_LEN] = {0};
+};
+thread_local SecondsText g_secondsText;
+
+size_t FormatSeconds(char* buffer, size_t bufLen, time_t now, uint32_t secondsFormat)
+{
+    if (secondsFormat & ((1 << EPOCH_SHOWFORMAT) | (1 << MONOTONIC_SHOWFORMAT))) {
+        int ret = snprintf_s(buffer, bufLen, bufLen - 1,
+            (secondsFormat & (1 << MONOTONIC_SHOWFORMAT)) ? "%6lld" : "%9lld", (long long)now);
+        return (ret > 0) ? ret : 0;
+    }
+    struct tm tmLocal;
+    if (localtime_r(&now, &tmLocal) == nullptr) {
+        return 0;
+    }
+    if (secondsFormat & (1 << ZONE_SHOWFORMAT)) {
+        return strftime(buffer, bufLen, "%z %m-%d %H:%M:%S", &tmLocal);
+    }
+    if (secondsFormat & (1 << YEAR_SHOWFORMAT)) {
+        return strftime(buffer, bufLen, "%Y-%m-%d %H:%M:%S", &tmLocal);
+    }
+    return strftime(buffer, bufLen, "%m-%d %H:%M:%S", &tmLocal);
+}
+
+/* Appends '.' and value zero padded to digits, nothing if it doesn't fit */
+size_t AppendFraction(char* buffer, size_t bufLen, unsigned long value, size_t digits)
+{
+    if (digits + 2 > bufLen) { // 2 : '.' and '\0'
+        return 0;
+    }
+    unsigned long rest = value;
+    buffer[0] = '.';
+    for (size_t i = digits; i > 0; i--) {
+        buffer[i] = static_cast<char>('0' + rest % DECIMAL_BASE);
+        rest /= DECIMAL_BASE;
+    }
+    if (rest != 0) {
+        // Values out of range, e.g. a whole second before epoch, are printed in full
+        int ret = snprintf_s(buffer, bufLen, bufLen - 1, ".%lu", value);
+        return (ret > 0) ? ret : 0;
+    }
+    buffer[digits + 1] = '\0';
+    return digits + 1;
+}
 } // anoymous namespace
 
 int HilogShowTimeBuffer(char* buffer, int bufLen, uint32_t showFormat,
     const HilogShowFormatBuffer& contentOut)
 {
+    if (buffer == nullptr || bufLen <= 0) {
+        return 0;
+    }
     time_t now = contentOut.tv_sec;
     unsigned long nsecTime = contentOut.tv_nsec;
-    size_t timeLen = 0;
-    int ret = 0;
     nsecTime = (now < 0) ? (NSEC - nsecTime) : nsecTime;
-    if ((showFormat & (1 << EPOCH_SHOWFORMAT)) || (showFormat & (1 << MONOTONIC_SHOWFORMAT))) {
-        if ((bufLen - 1) > 0) {
-            ret = snprintf_s(buffer, bufLen, bufLen - 1,
-                (showFormat & (1 << MONOTONIC_SHOWFORMAT)) ? "%6lld" : "%9lld", (long long)now);
-        }
-        timeLen += ((ret > 0) ? ret : 0);
-    } else {
-        struct tm tmLocal;
-        if (localtime_r(&now, &tmLocal) == nullptr) {
-            return 0;
-        }
-        timeLen = strftime(buffer, bufLen, "%m-%d %H:%M:%S", &tmLocal);
-        timeLen = strlen(buffer);
-        if (showFormat & (1 << YEAR_SHOWFORMAT)) {
-            timeLen = strftime(buffer, bufLen, "%Y-%m-%d %H:%M:%S", &tmLocal);
-            timeLen = strlen(buffer);
-        }
-        if (showFormat & (1 << ZONE_SHOWFORMAT)) {
-            timeLen = strftime(buffer, bufLen, "%z %m-%d %H:%M:%S", &tmLocal);
-            timeLen = strlen(buffer);
-        }
+    SecondsText& seconds = g_secondsText;
+    uint32_t secondsFormat = showFormat & SECONDS_SHOWFORMAT_MASK;
+    if (!seconds.valid || seconds.sec != now || seconds.format != secondsFormat) {
+        seconds.len = FormatSeconds(seconds.text, sizeof(seconds.text), now, secondsFormat);
+        seconds.sec = now;
+        seconds.format = secondsFormat;
+        seconds.valid = true;
+    }
+    size_t timeLen = seconds.len;
+    if (timeLen == 0 || memcpy_s(buffer, bufLen, seconds.text, timeLen + 1) != 0) {
+        buffer[0] = '\0';
+        return 0;
     }
     if (showFormat & (1 << TIME_NSEC_SHOWFORMAT)) {
-        if ((bufLen - timeLen - 1) > 0) {
-            ret = snprintf_s(buffer + timeLen, bufLen - timeLen, bufLen - timeLen - 1,
-                ".%09lu", nsecTime);
-        }
-        timeLen += ((ret > 0) ? ret : 0);
+        timeLen += AppendFraction(buffer + timeLen, bufLen - timeLen, nsecTime, NSEC_DIGITS);
     } else if (showFormat & (1 << TIME_USEC_SHOWFORMAT)) {
-        if ((bufLen - timeLen - 1) > 0) {
-            ret = snprintf_s(buffer + timeLen, bufLen - timeLen, bufLen - timeLen - 1,
-                ".%06llu", nsecTime / NS2US);
-        }
-        timeLen += ((ret > 0) ? ret : 0);
+        timeLen += AppendFraction(buffer + timeLen, bufLen - timeLen, nsecTime / NS2US, USEC_DIGITS);
     } else {
-        if ((bufLen - timeLen - 1) > 0) {
-            ret = snprintf_s(buffer + timeLen, bufLen - timeLen, bufLen - timeLen - 1,
-                ".%03llu", nsecTime / NS2MS);
-        }
-        timeLen += ((ret > 0) ? ret : 0);
+        timeLen += AppendFraction(buffer + timeLen, bufLen - timeLen, nsecTime / NS2MS, MSEC_DIGITS);
     }
     return timeLen;
 }
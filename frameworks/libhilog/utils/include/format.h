@@ -20,6 +20,7 @@
 #include "hilog_msg.h"
 namespace OHOS {
 namespace HiviewDFX {
+int HilogShowTimeBuffer(char* buffer, int bufLen, uint32_t showFormat, const HilogShowFormatBuffer& contentOut);
 void HilogShowBuffer(char* buffer, int bufLen, const HilogShowFormatBuffer& contentOut, uint32_t showFormat);
 } // namespace HiviewDFX
 } // namespace OHOS
@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2022 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LOG_BINARY_H
+#define LOG_BINARY_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "hilog/log_cpp_format.h"
+
+namespace OHOS {
+namespace HiviewDFX {
+/*
+ * Content of HILOG_MSG_VERSION_FORMAT and HILOG_MSG_VERSION_BINARY records starts with this header.
+ * A format record carries the format string after it, a binary record carries one encoded
+ * argument per conversion of the registered format:
+ *   kind byte (HiLogFmtArgKind or BINARY_ARG_PRIVATE) followed by
+ *   - varint for integers, characters and pointers, signed values zigzag encoded
+ *   - 8 bytes double for floating values
+ *   - varint length and bytes including '\0' for strings
+ *   - nothing for private arguments, they are masked before leaving the process
+ * Both contents end with '\0' like text logs.
+ */
+using HilogBinaryHeader = struct __attribute__((__packed__)) {
+    uint64_t session; /* identifies formats registered by one process */
+    uint16_t formatIndex;
+    uint8_t argCount;
+};
+
+constexpr uint8_t BINARY_ARG_PRIVATE = 0x80;
+/* Upper half of a session is the pid of the process, hilogd checks it against the sender */
+constexpr unsigned int BINARY_SESSION_PID_SHIFT = 32;
+constexpr size_t MAX_BINARY_ARGS = 64;
+/* hilogd keeps this much of the formats of one process, libhilog logs as text beyond it */
+constexpr size_t BINARY_MAX_FORMATS_PER_PID = 2048;
+constexpr size_t BINARY_MAX_FORMAT_BYTES_PER_PID = 256 * 1024;
+
+/* What a format takes of the limits above */
+inline size_t BinaryFormatBytes(size_t fmtLen, size_t pieceCount)
+{
+    return fmtLen + pieceCount * sizeof(HiLogFmtPiece);
+}
+
+/* Formats parsed pieces as text, masked arguments (if any) are printed as <private> */
+int FormatPieces(char *buf, size_t bufLen, const char *fmt, const HiLogFmtPiece *pieces, size_t pieceCount,
+    const HiLogFmtArg *args, bool priv, const bool *masked = nullptr);
+
+/* Return content length without the ending '\0', -1 if it doesn't fit into buf */
+int EncodeBinaryFormat(char *buf, size_t bufLen, uint64_t session, uint16_t formatIndex, const char *fmt);
+int EncodeBinaryArgs(char *buf, size_t bufLen, uint64_t session, uint16_t formatIndex, const HiLogFmtPiece *pieces,
+    size_t pieceCount, const HiLogFmtArg *args, bool priv);
+
+bool DecodeBinaryHeader(const char *content, size_t len, HilogBinaryHeader &header);
+/* Strings of decoded args point into content, args and masked hold MAX_BINARY_ARGS entries */
+bool DecodeBinaryArgs(const char *content, size_t len, const HiLogFmtPiece *pieces, size_t pieceCount,
+    HiLogFmtArg *args, bool *masked);
+
+/*
+ * Formats a process registered with hilogd. A call site keeps its format id, the session tells whether
+ * the format has to be sent before a record uses it: once for a new call site, then again under the
+ * same index whenever hilogd may have lost it (new session after fork, hilogd restarted, writes lost
+ * on the way). Call sites beyond the limits of hilogd log as text instead of being refused by it.
+ */
+class BinaryFormatSession {
+public:
+    enum class Use {
+        TEXT,
+        SEND_FORMAT, /* send the format, then store sentId into the format id of the call site */
+        BINARY,
+    };
+
+    explicit BinaryFormatSession(uint64_t id) : m_id(id) {}
+    uint64_t GetId() const
+    {
+        return m_id.load(std::memory_order_relaxed);
+    }
+    /* Formats of the old session aren't known for the new one */
+    void Renew(uint64_t id);
+    /* hilogdEpoch is published by hilogd when it starts, writeLosses counts writes which were lost */
+    void Update(uint32_t hilogdEpoch, uint32_t writeLosses);
+    Use Acquire(std::atomic<uint32_t> &formatId, size_t fmtLen, size_t pieceCount, uint16_t &index,
+        uint32_t &sentId);
+
+private:
+    void BumpEpoch();
+
+    std::atomic<uint64_t> m_id;
+    std::atomic<uint16_t> m_epoch {1};
+    std::atomic<uint64_t> m_seen {0};
+    std::atomic<uint32_t> m_nextIndex {1};
+    std::atomic<size_t> m_bytes {0};
+};
+} // namespace HiviewDFX
+} // namespace OHOS
+#endif /* LOG_BINARY_H */
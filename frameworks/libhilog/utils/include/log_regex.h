@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2022 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LOG_REGEX_H
+#define LOG_REGEX_H
+
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace OHOS {
+namespace HiviewDFX {
+/*
+ * ECMAScript regex searched in log content, compiled once for all logs.
+ * The pattern runs on a DFA built lazily from its NFA, so every byte of content is looked at once
+ * and no pattern can backtrack. Only the regular part of ECMAScript is taken, patterns with back
+ * references, lookaheads, word boundaries, ... or beyond the limits aren't valid.
+ * Search() extends the DFA, so one object serves one thread.
+ */
+class LogRegex {
+public:
+    static constexpr size_t DEFAULT_MAX_INSTS = 8192;
+    static constexpr size_t DEFAULT_MAX_STATES = 512; // 512 : about 512KB of transitions, then they are built again
+
+    explicit LogRegex(const std::string& pattern, size_t maxInsts = DEFAULT_MAX_INSTS,
+        size_t maxStates = DEFAULT_MAX_STATES);
+
+    /* False for an invalid regex */
+    bool Search(const char* text, size_t len);
+    bool IsValid() const
+    {
+        return m_valid;
+    }
+
+private:
+    using CharSet = std::bitset<256>; // 256 : all values of a byte
+
+    enum class Op : uint8_t {
+        CHAR, /* byte in m_sets[arg], then next */
+        SPLIT, /* both next and arg */
+        BOL, /* only at begin of content */
+        EOL, /* only at end of content */
+        MATCH,
+    };
+    struct Inst {
+        Op op;
+        uint32_t next;
+        uint32_t arg;
+    };
+
+    struct Node;
+    using NodePtr = std::unique_ptr<Node>;
+    class Parser;
+
+    struct DfaState {
+        std::vector<uint32_t> pcs; /* sorted CHAR, EOL and MATCH instructions */
+        bool match = false;
+        int8_t matchAtEnd = -1; /* -1 until it's needed */
+    };
+    static constexpr size_t DFA_ALPHABET = 256; // 256 : all values of a byte
+
+    bool Compile(const std::string& pattern);
+    uint32_t Emit(const Node& node, uint32_t next);
+    uint32_t AddInst(Op op, uint32_t next, uint32_t arg);
+    void AddClosure(uint32_t pc, bool atBegin, bool atEnd, std::vector<uint32_t>& pcs, std::vector<bool>& seen) const;
+    int32_t AddState(std::vector<uint32_t>& pcs);
+    int32_t Step(int32_t state, uint8_t c);
+    bool MatchAtEnd(int32_t state, bool atBegin);
+
+    size_t m_maxInsts;
+    size_t m_maxStates;
+    bool m_valid = false;
+    std::vector<Inst> m_prog;
+    std::vector<CharSet> m_sets;
+    uint32_t m_start = 0;
+    std::vector<DfaState> m_states;
+    std::vector<int32_t> m_transitions; /* DFA_ALPHABET per state, state id or UNKNOWN or TO_MATCH */
+    std::map<std::vector<uint32_t>, int32_t> m_stateIds;
+    int32_t m_beginState = -1;
+};
+} // namespace HiviewDFX
+} // namespace OHOS
+#endif
@@ -0,0 +1,493 @@
+/*
+ * Copyright (c) 2022 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "log_binary.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <securec.h>
+
+#include "hilog_common.h"
+
+namespace OHOS {
+namespace HiviewDFX {
+namespace {
+constexpr char PRIVATE_TEXT[] = "<private>";
+constexpr char NULL_TEXT[] = "(null)";
+constexpr size_t MAX_VARINT_LEN = 10; // 10 : 7 bits per byte of 64 bit value
+constexpr uint8_t VARINT_MASK = 0x7f;
+constexpr uint8_t VARINT_MORE = 0x80;
+constexpr unsigned int VARINT_SHIFT = 7;
+constexpr unsigned int SIGN_SHIFT = 63;
+constexpr uint32_t FORMAT_ID_TEXT = UINT32_MAX; /* format of the call site can't be sent */
+constexpr unsigned int FORMAT_EPOCH_SHIFT = 16;
+constexpr uint32_t FORMAT_INDEX_MASK = 0xffff;
+constexpr unsigned int SEEN_EPOCH_SHIFT = 32;
+
+class LogTextWriter {
+public:
+    LogTextWriter(char *buf, size_t bufLen) : m_begin(buf), m_pos(buf), m_end(buf + bufLen - 1) {}
+
+    void Append(const char *text, size_t len)
+    {
+        size_t copyLen = std::min(len, Remaining());
+        if (copyLen > 0 && memcpy_s(m_pos, Remaining(), text, copyLen) == EOK) {
+            m_pos += copyLen;
+        }
+    }
+
+    void AppendString(const char *str)
+    {
+        if (str == nullptr) {
+            str = NULL_TEXT;
+        }
+        Append(str, strnlen(str, Remaining()));
+    }
+
+    void AppendUnsigned(unsigned long long value, char conv)
+    {
+        static constexpr char lowerDigits[] = "0123456789abcdef";
+        static constexpr char upperDigits[] = "0123456789ABCDEF";
+        static constexpr int maxDigits = 24; // 24 : octal digits of 64 bit value with some room
+        const char *digits = (conv == 'X') ? upperDigits : lowerDigits;
+        unsigned int base = (conv == 'x' || conv == 'X') ? 16 : ((conv == 'o') ? 8 : 10); // 16, 8, 10 : bases
+        char text[maxDigits];
+        char *begin = text + maxDigits;
+        do {
+            *--begin = digits[value % base];
+            value /= base;
+        } while (value != 0);
+        Append(begin, text + maxDigits - begin);
+    }
+
+    /* Anything with flags, width or precision and floats go through snprintf_s with own conversion */
+    void AppendGeneric(const char *spec, size_t specLen, const char *lengthMod, char conv, const HiLogFmtArg &arg,
+        uint8_t argKind)
+    {
+        static constexpr size_t maxFormatLen = 32;
+        char format[maxFormatLen] = {0};
+        if (Remaining() == 0 || snprintf_s(format, maxFormatLen, maxFormatLen - 1, "%%%.*s%s%c",
+            static_cast<int>(specLen), spec, lengthMod, conv) < 0) {
+            return;
+        }
+#ifdef __clang__
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wformat-nonliteral"
+#elif __GNUC__
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-nonliteral"
+#endif
+        size_t count = Remaining();
+        switch (argKind) {
+            case HILOG_FMT_ARG_SIGNED: (void)snprintf_s(m_pos, count + 1, count, format, arg.i); break;
+            case HILOG_FMT_ARG_UNSIGNED: (void)snprintf_s(m_pos, count + 1, count, format, arg.u); break;
+            case HILOG_FMT_ARG_CHAR: (void)snprintf_s(m_pos, count + 1, count, format, static_cast<int>(arg.i)); break;
+            case HILOG_FMT_ARG_STRING: (void)snprintf_s(m_pos, count + 1, count, format, arg.s); break;
+            case HILOG_FMT_ARG_POINTER: (void)snprintf_s(m_pos, count + 1, count, format, arg.p); break;
+            case HILOG_FMT_ARG_DOUBLE: (void)snprintf_s(m_pos, count + 1, count, format, arg.d); break;
+            case HILOG_FMT_ARG_LONG_DOUBLE: (void)snprintf_s(m_pos, count + 1, count, format, arg.ld); break;
+            default: break;
+        }
+#ifdef __clang__
+#pragma clang diagnostic pop
+#elif __GNUC__
+#pragma GCC diagnostic pop
+#endif
+        m_pos += strnlen(m_pos, count);
+    }
+
+    int Finish()
+    {
+        *m_pos = '\0';
+        return static_cast<int>(m_pos - m_begin);
+    }
+
+private:
+    size_t Remaining() const
+    {
+        return m_end - m_pos;
+    }
+
+    char *m_begin;
+    char *m_pos;
+    char *m_end;
+};
+
+void FormatPiece(LogTextWriter &writer, const char *fmt, const HiLogFmtPiece &piece, const HiLogFmtArg &arg)
+{
+    if (piece.specLen == 0) {
+        switch (piece.argKind) {
+            case HILOG_FMT_ARG_SIGNED:
+                if (arg.i < 0) {
+                    writer.Append("-", 1);
+                    writer.AppendUnsigned(0ULL - static_cast<unsigned long long>(arg.i), piece.conv);
+                } else {
+                    writer.AppendUnsigned(static_cast<unsigned long long>(arg.i), piece.conv);
+                }
+                return;
+            case HILOG_FMT_ARG_UNSIGNED:
+                writer.AppendUnsigned(arg.u, piece.conv);
+                return;
+            case HILOG_FMT_ARG_CHAR: {
+                char ch = static_cast<char>(arg.i);
+                writer.Append(&ch, 1);
+                return;
+            }
+            case HILOG_FMT_ARG_STRING:
+                writer.AppendString(arg.s);
+                return;
+            default:
+                break;
+        }
+    }
+    const char *lengthMod = "";
+    if (piece.argKind == HILOG_FMT_ARG_SIGNED || piece.argKind == HILOG_FMT_ARG_UNSIGNED) {
+        lengthMod = "ll";
+    } else if (piece.argKind == HILOG_FMT_ARG_LONG_DOUBLE) {
+        lengthMod = "L";
+    }
+    writer.AppendGeneric(fmt + piece.specBegin, piece.specLen, lengthMod, piece.conv, arg, piece.argKind);
+}
+
+/* Writes binary content, one byte stays reserved for the ending '\0' */
+class BinaryWriter {
+public:
+    BinaryWriter(char *buf, size_t bufLen) : m_begin(buf), m_pos(buf), m_end(buf + bufLen - 1) {}
+
+    void Put(const void *data, size_t len)
+    {
+        if (!m_good || len > static_cast<size_t>(m_end - m_pos) || memcpy_s(m_pos, m_end - m_pos, data, len) != EOK) {
+            m_good = false;
+            return;
+        }
+        m_pos += len;
+    }
+
+    void PutByte(uint8_t value)
+    {
+        Put(&value, sizeof(value));
+    }
+
+    void PutVarint(uint64_t value)
+    {
+        uint8_t bytes[MAX_VARINT_LEN];
+        size_t count = 0;
+        do {
+            bytes[count] = static_cast<uint8_t>(value & VARINT_MASK);
+            value >>= VARINT_SHIFT;
+            bytes[count++] |= (value != 0) ? VARINT_MORE : 0;
+        } while (value != 0);
+        Put(bytes, count);
+    }
+
+    int Finish()
+    {
+        if (!m_good) {
+            return -1;
+        }
+        *m_pos = '\0';
+        return static_cast<int>(m_pos - m_begin);
+    }
+
+private:
+    char *m_begin;
+    char *m_pos;
+    char *m_end;
+    bool m_good = true;
+};
+
+class BinaryReader {
+public:
+    BinaryReader(const char *data, size_t len) : m_pos(data), m_end(data + len) {}
+
+    bool Get(void *data, size_t len)
+    {
+        if (len > Remaining() || memcpy_s(data, len, m_pos, len) != EOK) {
+            return false;
+        }
+        m_pos += len;
+        return true;
+    }
+
+    bool GetVarint(uint64_t &value)
+    {
+        value = 0;
+        for (size_t i = 0; i < MAX_VARINT_LEN && m_pos < m_end; i++) {
+            uint8_t byte = static_cast<uint8_t>(*m_pos++);
+            value |= static_cast<uint64_t>(byte & VARINT_MASK) << (VARINT_SHIFT * i);
+            if ((byte & VARINT_MORE) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /* Returns the string in place, it must end with '\0' within its length */
+    const char *GetString()
+    {
+        uint64_t len = 0;
+        if (!GetVarint(len) || len == 0 || len > Remaining() || m_pos[len - 1] != '\0') {
+            return nullptr;
+        }
+        const char *str = m_pos;
+        m_pos += len;
+        return str;
+    }
+
+private:
+    size_t Remaining() const
+    {
+        return m_end - m_pos;
+    }
+
+    const char *m_pos;
+    const char *m_end;
+};
+
+inline uint64_t ZigZag(long long value)
+{
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> SIGN_SHIFT);
+}
+
+inline long long UnZigZag(uint64_t value)
+{
+    return static_cast<long long>((value >> 1) ^ (0 - (value & 1)));
+}
+} // namespace
+
+int FormatPieces(char *buf, size_t bufLen, const char *fmt, const HiLogFmtPiece *pieces, size_t pieceCount,
+    const HiLogFmtArg *args, bool priv, const bool *masked)
+{
+    LogTextWriter writer(buf, bufLen);
+    size_t argIndex = 0;
+    for (size_t i = 0; i < pieceCount; i++) {
+        const HiLogFmtPiece &piece = pieces[i];
+        writer.Append(fmt + piece.litBegin, piece.litLen);
+        if (piece.conv == '\0') {
+            continue;
+        }
+        bool hidden = (priv && piece.isPrivate) || (masked != nullptr && masked[argIndex]);
+        const HiLogFmtArg &arg = args[argIndex++];
+        if (hidden) {
+            writer.Append(PRIVATE_TEXT, sizeof(PRIVATE_TEXT) - 1);
+        } else {
+            FormatPiece(writer, fmt, piece, arg);
+        }
+    }
+    return writer.Finish();
+}
+
+int EncodeBinaryFormat(char *buf, size_t bufLen, uint64_t session, uint16_t formatIndex, const char *fmt)
+{
+    HilogBinaryHeader header = {session, formatIndex, 0};
+    BinaryWriter writer(buf, bufLen);
+    writer.Put(&header, sizeof(header));
+    writer.Put(fmt, strnlen(fmt, bufLen));
+    return writer.Finish();
+}
+
+int EncodeBinaryArgs(char *buf, size_t bufLen, uint64_t session, uint16_t formatIndex, const HiLogFmtPiece *pieces,
+    size_t pieceCount, const HiLogFmtArg *args, bool priv)
+{
+    size_t argCount = std::count_if(pieces, pieces + pieceCount,
+        [](const HiLogFmtPiece &piece) { return piece.conv != '\0'; });
+    if (argCount > MAX_BINARY_ARGS) {
+        return -1;
+    }
+    HilogBinaryHeader header = {session, formatIndex, static_cast<uint8_t>(argCount)};
+    BinaryWriter writer(buf, bufLen);
+    writer.Put(&header, sizeof(header));
+    size_t argIndex = 0;
+    for (size_t i = 0; i < pieceCount; i++) {
+        const HiLogFmtPiece &piece = pieces[i];
+        if (piece.conv == '\0') {
+            continue;
+        }
+        const HiLogFmtArg &arg = args[argIndex++];
+        if (priv && piece.isPrivate) {
+            writer.PutByte(BINARY_ARG_PRIVATE);
+            continue;
+        }
+        writer.PutByte(piece.argKind);
+        switch (piece.argKind) {
+            case HILOG_FMT_ARG_SIGNED:
+                writer.PutVarint(ZigZag(arg.i));
+                break;
+            case HILOG_FMT_ARG_UNSIGNED:
+                writer.PutVarint(arg.u);
+                break;
+            case HILOG_FMT_ARG_CHAR:
+                writer.PutVarint(static_cast<uint64_t>(arg.i));
+                break;
+            case HILOG_FMT_ARG_POINTER:
+                writer.PutVarint(reinterpret_cast<uintptr_t>(arg.p));
+                break;
+            case HILOG_FMT_ARG_DOUBLE:
+            case HILOG_FMT_ARG_LONG_DOUBLE: {
+                /* long double is narrowed, readers print it with the precision of double */
+                double value = (piece.argKind == HILOG_FMT_ARG_DOUBLE) ? arg.d : static_cast<double>(arg.ld);
+                writer.Put(&value, sizeof(value));
+                break;
+            }
+            case HILOG_FMT_ARG_STRING: {
+                const char *str = (arg.s != nullptr) ? arg.s : NULL_TEXT;
+                size_t len = strnlen(str, bufLen);
+                writer.PutVarint(len + 1);
+                writer.Put(str, len);
+                writer.PutByte('\0');
+                break;
+            }
+            default:
+                return -1;
+        }
+    }
+    return writer.Finish();
+}
+
+bool DecodeBinaryHeader(const char *content, size_t len, HilogBinaryHeader &header)
+{
+    BinaryReader reader(content, len);
+    return reader.Get(&header, sizeof(header));
+}
+
+bool DecodeBinaryArgs(const char *content, size_t len, const HiLogFmtPiece *pieces, size_t pieceCount,
+    HiLogFmtArg *args, bool *masked)
+{
+    BinaryReader reader(content, len);
+    HilogBinaryHeader header;
+    if (!reader.Get(&header, sizeof(header))) {
+        return false;
+    }
+    size_t argIndex = 0;
+    for (size_t i = 0; i < pieceCount; i++) {
+        const HiLogFmtPiece &piece = pieces[i];
+        if (piece.conv == '\0') {
+            continue;
+        }
+        uint8_t kind = 0;
+        if (argIndex >= header.argCount || argIndex >= MAX_BINARY_ARGS || !reader.Get(&kind, sizeof(kind))) {
+            return false;
+        }
+        HiLogFmtArg &arg = args[argIndex];
+        masked[argIndex++] = (kind == BINARY_ARG_PRIVATE);
+        arg.u = 0;
+        if (kind == BINARY_ARG_PRIVATE) {
+            continue;
+        }
+        if (kind != piece.argKind) {
+            return false;
+        }
+        uint64_t value = 0;
+        double number = 0;
+        bool good = true;
+        switch (kind) {
+            case HILOG_FMT_ARG_SIGNED:
+                good = reader.GetVarint(value);
+                arg.i = UnZigZag(value);
+                break;
+            case HILOG_FMT_ARG_UNSIGNED:
+                good = reader.GetVarint(value);
+                arg.u = value;
+                break;
+            case HILOG_FMT_ARG_CHAR:
+                good = reader.GetVarint(value);
+                arg.i = static_cast<long long>(value);
+                break;
+            case HILOG_FMT_ARG_POINTER:
+                good = reader.GetVarint(value);
+                arg.p = reinterpret_cast<const void *>(static_cast<uintptr_t>(value));
+                break;
+            case HILOG_FMT_ARG_DOUBLE:
+                good = reader.Get(&number, sizeof(number));
+                arg.d = number;
+                break;
+            case HILOG_FMT_ARG_LONG_DOUBLE:
+                good = reader.Get(&number, sizeof(number));
+                arg.ld = number;
+                break;
+            case HILOG_FMT_ARG_STRING:
+                arg.s = reader.GetString();
+                good = (arg.s != nullptr);
+                break;
+            default:
+                good = false;
+                break;
+        }
+        if (!good) {
+            return false;
+        }
+    }
+    return argIndex == header.argCount;
+}
+
+void BinaryFormatSession::Renew(uint64_t id)
+{
+    // Indexes go on, they stay unique in the new session when call sites of the old one send again
+    m_id.store(id, std::memory_order_relaxed);
+    BumpEpoch();
+}
+
+void BinaryFormatSession::Update(uint32_t hilogdEpoch, uint32_t writeLosses)
+{
+    uint64_t seen = (static_cast<uint64_t>(hilogdEpoch) << SEEN_EPOCH_SHIFT) | writeLosses;
+    if (m_seen.load(std::memory_order_relaxed) != seen && m_seen.exchange(seen, std::memory_order_relaxed) != seen) {
+        BumpEpoch();
+    }
+}
+
+void BinaryFormatSession::BumpEpoch()
+{
+    // Epoch 0 marks call sites which took an index but didn't send their format yet
+    if (static_cast<uint16_t>(m_epoch.fetch_add(1, std::memory_order_release) + 1) == 0) {
+        m_epoch.fetch_add(1, std::memory_order_release);
+    }
+}
+
+BinaryFormatSession::Use BinaryFormatSession::Acquire(std::atomic<uint32_t> &formatId, size_t fmtLen,
+    size_t pieceCount, uint16_t &index, uint32_t &sentId)
+{
+    uint32_t id = formatId.load(std::memory_order_acquire);
+    if (id == FORMAT_ID_TEXT) {
+        return Use::TEXT;
+    }
+    // Epoch is taken before the format is sent, a later change makes the call site send it once more
+    uint16_t epoch = m_epoch.load(std::memory_order_acquire);
+    if (id != 0) {
+        index = static_cast<uint16_t>(id & FORMAT_INDEX_MASK);
+        sentId = (static_cast<uint32_t>(epoch) << FORMAT_EPOCH_SHIFT) | index;
+        return ((id >> FORMAT_EPOCH_SHIFT) == epoch) ? Use::BINARY : Use::SEND_FORMAT;
+    }
+    size_t bytes = BinaryFormatBytes(fmtLen, pieceCount);
+    if (fmtLen >= MAX_LOG_LEN - sizeof(HilogBinaryHeader) ||
+        m_nextIndex.load(std::memory_order_relaxed) > BINARY_MAX_FORMATS_PER_PID) {
+        formatId.store(FORMAT_ID_TEXT, std::memory_order_release);
+        return Use::TEXT;
+    }
+    /* Racing threads may both take an index, any of them works and both count like at hilogd */
+    uint32_t newIndex = m_nextIndex.fetch_add(1, std::memory_order_relaxed);
+    if (newIndex > BINARY_MAX_FORMATS_PER_PID ||
+        m_bytes.fetch_add(bytes, std::memory_order_relaxed) + bytes > BINARY_MAX_FORMAT_BYTES_PER_PID) {
+        formatId.store(FORMAT_ID_TEXT, std::memory_order_release);
+        return Use::TEXT;
+    }
+    index = static_cast<uint16_t>(newIndex);
+    // The index stays with the call site even if sending its format fails
+    formatId.store(index, std::memory_order_release);
+    sentId = (static_cast<uint32_t>(epoch) << FORMAT_EPOCH_SHIFT) | index;
+    return Use::SEND_FORMAT;
+}
+} // namespace HiviewDFX
+} // namespace OHOS
@@ -0,0 +1,571 @@
+/*
+ * Copyright (c) 2022 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+
+#include "log_regex.h"
+
+namespace OHOS {
+namespace HiviewDFX {
+using namespace std;
+
+static constexpr uint32_t MAX_REPEAT = 1000;
+static constexpr uint32_t MAX_NESTING = 64;
+static constexpr uint32_t INFINITE = UINT32_MAX;
+static constexpr int HEX = 16;
+static constexpr int32_t UNKNOWN = -1;
+static constexpr int32_t TO_MATCH = -2; /* transition into a match state, the search is over */
+
+struct LogRegex::Node {
+    enum Type { SET, CONCAT, ALT, REPEAT, BOL, EOL } type;
+    uint32_t set = 0;
+    uint32_t min = 0;
+    uint32_t max = 0;
+    vector<NodePtr> children;
+
+    explicit Node(Type nodeType) : type(nodeType) {}
+};
+
+/* Recursive descent over the regular part of ECMAScript, fails on anything else */
+class LogRegex::Parser {
+public:
+    Parser(const string& pattern, vector<CharSet>& sets) : m_pattern(pattern), m_sets(sets) {}
+
+    NodePtr Parse()
+    {
+        NodePtr node = ParseAlt(0);
+        return (node && m_pos == m_pattern.size()) ? move(node) : nullptr;
+    }
+
+private:
+    bool AtEnd() const
+    {
+        return m_pos >= m_pattern.size();
+    }
+
+    char Peek(size_t ahead = 0) const
+    {
+        return (m_pos + ahead < m_pattern.size()) ? m_pattern[m_pos + ahead] : '\0';
+    }
+
+    NodePtr NewSet(const CharSet& set)
+    {
+        NodePtr node = make_unique<Node>(Node::SET);
+        node->set = m_sets.size();
+        m_sets.push_back(set);
+        return node;
+    }
+
+    NodePtr ParseAlt(uint32_t depth)
+    {
+        if (depth > MAX_NESTING) {
+            return nullptr;
+        }
+        NodePtr alt = make_unique<Node>(Node::ALT);
+        while (true) {
+            NodePtr concat = ParseConcat(depth);
+            if (!concat) {
+                return nullptr;
+            }
+            alt->children.push_back(move(concat));
+            if (Peek() != '|') {
+                break;
+            }
+            m_pos++;
+        }
+        return (alt->children.size() == 1) ? move(alt->children[0]) : move(alt);
+    }
+
+    NodePtr ParseConcat(uint32_t depth)
+    {
+        NodePtr concat = make_unique<Node>(Node::CONCAT);
+        while (!AtEnd() && Peek() != '|' && Peek() != ')') {
+            NodePtr node = ParseRepeat(depth);
+            if (!node) {
+                return nullptr;
+            }
+            concat->children.push_back(move(node));
+        }
+        return concat;
+    }
+
+    NodePtr ParseRepeat(uint32_t depth)
+    {
+        NodePtr atom = ParseAtom(depth);
+        if (!atom) {
+            return nullptr;
+        }
+        uint32_t min = 1;
+        uint32_t max = 1;
+        switch (Peek()) {
+            case '*':
+                min = 0;
+                max = INFINITE;
+                m_pos++;
+                break;
+            case '+':
+                max = INFINITE;
+                m_pos++;
+                break;
+            case '?':
+                min = 0;
+                m_pos++;
+                break;
+            case '{':
+                if (!ParseCount(min, max)) {
+                    return nullptr;
+                }
+                break;
+            default:
+                return atom;
+        }
+        if (atom->type == Node::BOL || atom->type == Node::EOL) {
+            return nullptr;
+        }
+        if (Peek() == '?') { // lazy, matches the same
+            m_pos++;
+        }
+        char c = Peek();
+        if (c == '*' || c == '+' || c == '?' || c == '{') {
+            return nullptr;
+        }
+        NodePtr repeat = make_unique<Node>(Node::REPEAT);
+        repeat->min = min;
+        repeat->max = max;
+        repeat->children.push_back(move(atom));
+        return repeat;
+    }
+
+    bool ParseNumber(uint32_t& value)
+    {
+        size_t start = m_pos;
+        value = 0;
+        while (isdigit(static_cast<unsigned char>(Peek()))) {
+            value = value * 10 + static_cast<uint32_t>(Peek() - '0'); // 10 : decimal
+            if (value > MAX_REPEAT) {
+                return false;
+            }
+            m_pos++;
+        }
+        return m_pos != start;
+    }
+
+    bool ParseCount(uint32_t& min, uint32_t& max)
+    {
+        m_pos++;
+        if (!ParseNumber(min)) {
+            return false;
+        }
+        max = min;
+        if (Peek() == ',') {
+            m_pos++;
+            max = INFINITE;
+            if (Peek() != '}' && !ParseNumber(max)) {
+                return false;
+            }
+        }
+        if (Peek() != '}' || max < min) {
+            return false;
+        }
+        m_pos++;
+        return true;
+    }
+
+    NodePtr ParseAtom(uint32_t depth)
+    {
+        char c = Peek();
+        CharSet set;
+        switch (c) {
+            case '(':
+                return ParseGroup(depth);
+            case '[':
+                return ParseClass(set) ? NewSet(set) : nullptr;
+            case '.':
+                m_pos++;
+                set.set();
+                set.reset('\n');
+                set.reset('\r');
+                return NewSet(set);
+            case '^':
+                m_pos++;
+                return make_unique<Node>(Node::BOL);
+            case '$':
+                m_pos++;
+                return make_unique<Node>(Node::EOL);
+            case '\\': {
+                int single = -1;
+                return ParseEscape(set, false, single) ? NewSet(set) : nullptr;
+            }
+            case '*':
+            case '+':
+            case '?':
+            case '{':
+                return nullptr;
+            default:
+                m_pos++;
+                set.set(static_cast<unsigned char>(c));
+                return NewSet(set);
+        }
+    }
+
+    NodePtr ParseGroup(uint32_t depth)
+    {
+        m_pos++;
+        if (Peek() == '?') {
+            if (Peek(1) != ':') {
+                return nullptr;
+            }
+            m_pos += 2; // 2 : "?:"
+        }
+        NodePtr node = ParseAlt(depth + 1);
+        if (!node || Peek() != ')') {
+            return nullptr;
+        }
+        m_pos++;
+        return node;
+    }
+
+    /* Escape at m_pos goes into set, single is the character if it stands for one, -1 otherwise */
+    bool ParseEscape(CharSet& set, bool inClass, int& single)
+    {
+        m_pos++;
+        if (AtEnd()) {
+            return false;
+        }
+        char c = m_pattern[m_pos++];
+        single = -1;
+        CharSet classSet;
+        switch (c) {
+            case 'd':
+            case 'D':
+            case 'w':
+            case 'W':
+            case 's':
+            case 'S':
+                for (int i = 0; i < static_cast<int>(classSet.size()); i++) {
+                    char ch = static_cast<char>(i);
+                    bool in = (c == 'd' || c == 'D') ? (ch >= '0' && ch <= '9') :
+                        (c == 'w' || c == 'W') ? (isalnum(i) || ch == '_') : (isspace(i) != 0);
+                    classSet.set(i, in);
+                }
+                set |= isupper(static_cast<unsigned char>(c)) ? ~classSet : classSet;
+                return true;
+            case 'n':
+                single = '\n';
+                break;
+            case 't':
+                single = '\t';
+                break;
+            case 'r':
+                single = '\r';
+                break;
+            case 'f':
+                single = '\f';
+                break;
+            case 'v':
+                single = '\v';
+                break;
+            case 'x':
+                if (!isxdigit(static_cast<unsigned char>(Peek())) || !isxdigit(static_cast<unsigned char>(Peek(1)))) {
+                    return false;
+                }
+                single = static_cast<int>(strtoul(m_pattern.substr(m_pos, 2).c_str(), nullptr, HEX)); // 2 : hex digits
+                m_pos += 2; // 2 : two hex digits
+                break;
+            default:
+                // Back references and word boundaries aren't regular, control and unicode escapes aren't taken
+                if (isalnum(static_cast<unsigned char>(c)) || (inClass && c == 'b')) {
+                    return false;
+                }
+                single = static_cast<unsigned char>(c);
+                break;
+        }
+        set.set(single);
+        return true;
+    }
+
+    /* One character or escape of a class, single as of ParseEscape() */
+    bool ParseClassAtom(CharSet& set, int& single)
+    {
+        char c = Peek();
+        if (c == '\\') {
+            return ParseEscape(set, true, single);
+        }
+        if (c == '[' && (Peek(1) == ':' || Peek(1) == '.' || Peek(1) == '=')) {
+            return false; // character classes of the locale
+        }
+        m_pos++;
+        single = static_cast<unsigned char>(c);
+        set.set(single);
+        return true;
+    }
+
+    bool ParseClass(CharSet& set)
+    {
+        static constexpr int maxRangeChar = 0x7f; // 0x7f : ranges of signed chars compare oddly
+        m_pos++;
+        bool negate = (Peek() == '^');
+        if (negate) {
+            m_pos++;
+        }
+        bool afterRange = false;
+        while (!AtEnd() && Peek() != ']') {
+            if (afterRange && Peek() == '-' && Peek(1) != ']') {
+                return false;
+            }
+            int lo = -1;
+            if (!ParseClassAtom(set, lo)) {
+                return false;
+            }
+            afterRange = false;
+            if (Peek() != '-' || Peek(1) == ']' || Peek(1) == '\0') {
+                continue;
+            }
+            m_pos++;
+            int hi = -1;
+            CharSet hiSet;
+            if (lo < 0 || !ParseClassAtom(hiSet, hi) || hi < lo || hi > maxRangeChar) {
+                return false;
+            }
+            for (int ch = lo; ch <= hi; ch++) {
+                set.set(ch);
+            }
+            afterRange = true;
+        }
+        if (AtEnd()) {
+            return false;
+        }
+        m_pos++;
+        if (negate) {
+            set.flip();
+        }
+        return true;
+    }
+
+    const string& m_pattern;
+    vector<CharSet>& m_sets;
+    size_t m_pos = 0;
+};
+
+LogRegex::LogRegex(const string& pattern, size_t maxInsts, size_t maxStates)
+    : m_maxInsts(maxInsts), m_maxStates(std::max(maxStates, static_cast<size_t>(1)))
+{
+    m_valid = Compile(pattern);
+    if (!m_valid) {
+        m_prog.clear();
+        m_sets.clear();
+    }
+}
+
+bool LogRegex::Compile(const string& pattern)
+{
+    NodePtr root = Parser(pattern, m_sets).Parse();
+    if (!root) {
+        return false;
+    }
+    uint32_t match = AddInst(Op::MATCH, 0, 0);
+    m_start = Emit(*root, match);
+    return m_prog.size() <= m_maxInsts;
+}
+
+uint32_t LogRegex::AddInst(Op op, uint32_t next, uint32_t arg)
+{
+    // Instructions past the limit aren't kept, Compile() gives up then
+    if (m_prog.size() > m_maxInsts) {
+        return 0;
+    }
+    m_prog.push_back({op, next, arg});
+    return m_prog.size() - 1;
+}
+
+/* Emits code matching node which continues at next, returns its entry */
+uint32_t LogRegex::Emit(const Node& node, uint32_t next)
+{
+    switch (node.type) {
+        case Node::SET:
+            return AddInst(Op::CHAR, next, node.set);
+        case Node::BOL:
+            return AddInst(Op::BOL, next, 0);
+        case Node::EOL:
+            return AddInst(Op::EOL, next, 0);
+        case Node::CONCAT:
+            for (auto it = node.children.rbegin(); it != node.children.rend(); ++it) {
+                next = Emit(**it, next);
+            }
+            return next;
+        case Node::ALT: {
+            uint32_t entry = Emit(*node.children.back(), next);
+            for (size_t i = node.children.size() - 1; i-- > 0;) {
+                entry = AddInst(Op::SPLIT, Emit(*node.children[i], next), entry);
+            }
+            return entry;
+        }
+        case Node::REPEAT: {
+            const Node& child = *node.children[0];
+            uint32_t entry = next;
+            if (node.max == INFINITE) {
+                entry = AddInst(Op::SPLIT, 0, next);
+                uint32_t body = Emit(child, entry);
+                if (entry < m_prog.size()) {
+                    m_prog[entry].next = body;
+                }
+            } else {
+                for (uint32_t i = node.min; i < node.max && m_prog.size() <= m_maxInsts; i++) {
+                    entry = AddInst(Op::SPLIT, Emit(child, entry), next);
+                }
+            }
+            for (uint32_t i = 0; i < node.min && m_prog.size() <= m_maxInsts; i++) {
+                entry = Emit(child, entry);
+            }
+            return entry;
+        }
+        default:
+            return next;
+    }
+}
+
+void LogRegex::AddClosure(uint32_t pc, bool atBegin, bool atEnd, vector<uint32_t>& pcs, vector<bool>& seen) const
+{
+    vector<uint32_t> stack = {pc};
+    while (!stack.empty()) {
+        pc = stack.back();
+        stack.pop_back();
+        if (seen[pc]) {
+            continue;
+        }
+        seen[pc] = true;
+        const Inst& inst = m_prog[pc];
+        switch (inst.op) {
+            case Op::SPLIT:
+                stack.push_back(inst.arg);
+                stack.push_back(inst.next);
+                break;
+            case Op::BOL:
+                if (atBegin) {
+                    stack.push_back(inst.next);
+                }
+                break;
+            case Op::EOL:
+                if (atEnd) {
+                    stack.push_back(inst.next);
+                } else {
+                    pcs.push_back(pc); // decided once the end is reached
+                }
+                break;
+            default:
+                pcs.push_back(pc);
+                break;
+        }
+    }
+}
+
+int32_t LogRegex::AddState(vector<uint32_t>& pcs)
+{
+    sort(pcs.begin(), pcs.end());
+    auto it = m_stateIds.find(pcs);
+    if (it != m_stateIds.end()) {
+        return it->second;
+    }
+    DfaState state;
+    state.match = any_of(pcs.begin(), pcs.end(), [this](uint32_t pc) { return m_prog[pc].op == Op::MATCH; });
+    state.pcs = pcs;
+    m_states.push_back(move(state));
+    m_transitions.resize(m_states.size() * DFA_ALPHABET, UNKNOWN);
+    int32_t id = static_cast<int32_t>(m_states.size() - 1);
+    m_stateIds.emplace(move(pcs), id);
+    return id;
+}
+
+/* Builds the transition which isn't known yet */
+int32_t LogRegex::Step(int32_t state, uint8_t c)
+{
+    if (m_states.size() >= m_maxStates) {
+        vector<uint32_t> pcs = move(m_states[state].pcs);
+        m_states.clear();
+        m_transitions.clear();
+        m_stateIds.clear();
+        m_beginState = -1;
+        state = AddState(pcs);
+    }
+    vector<uint32_t> pcs;
+    vector<bool> seen(m_prog.size(), false);
+    for (uint32_t pc : m_states[state].pcs) {
+        const Inst& inst = m_prog[pc];
+        if (inst.op == Op::CHAR && m_sets[inst.arg].test(c)) {
+            AddClosure(inst.next, false, false, pcs, seen);
+        }
+    }
+    // Search, a match may start at any byte
+    AddClosure(m_start, false, false, pcs, seen);
+    int32_t next = AddState(pcs);
+    m_transitions[state * DFA_ALPHABET + c] = m_states[next].match ? TO_MATCH : next;
+    return next;
+}
+
+bool LogRegex::MatchAtEnd(int32_t state, bool atBegin)
+{
+    DfaState& dfaState = m_states[state];
+    if (!atBegin && dfaState.matchAtEnd >= 0) {
+        return dfaState.matchAtEnd != 0;
+    }
+    vector<uint32_t> pcs;
+    vector<bool> seen(m_prog.size(), false);
+    for (uint32_t pc : dfaState.pcs) {
+        if (m_prog[pc].op == Op::EOL) {
+            AddClosure(m_prog[pc].next, atBegin, true, pcs, seen);
+        }
+    }
+    bool match = any_of(pcs.begin(), pcs.end(), [this](uint32_t pc) { return m_prog[pc].op == Op::MATCH; });
+    if (!atBegin) {
+        dfaState.matchAtEnd = match ? 1 : 0;
+    }
+    return match;
+}
+
+bool LogRegex::Search(const char* text, size_t len)
+{
+    if (!m_valid) {
+        return false;
+    }
+    if (m_beginState < 0) {
+        vector<uint32_t> pcs;
+        vector<bool> seen(m_prog.size(), false);
+        AddClosure(m_start, true, false, pcs, seen);
+        m_beginState = AddState(pcs);
+    }
+    int32_t state = m_beginState;
+    if (m_states[state].match) {
+        return true;
+    }
+    for (size_t i = 0; i < len; i++) {
+        uint8_t c = static_cast<uint8_t>(text[i]);
+        int32_t next = m_transitions[state * DFA_ALPHABET + c];
+        if (next >= 0) {
+            state = next;
+            continue;
+        } else if (next == TO_MATCH) {
+            return true;
+        }
+        state = Step(state, c);
+        if (m_states[state].match) {
+            return true;
+        }
+    }
+    return MatchAtEnd(state, len == 0);
+}
+} // namespace HiviewDFX
+} // namespace OHOS
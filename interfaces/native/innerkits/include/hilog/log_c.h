@@ -70,6 +70,12 @@ int HiLogPrint(LogType type, LogLevel level, unsigned int domain, const char *ta
 
 bool HiLogIsLoggable(unsigned int domain, const char *tag, LogLevel level);
 
+/*
+ * Logs of this process are sent to hilogd in batches, several in one packet, and at most 20 ms late.
+ * ERROR and FATAL logs are sent right away. The parameter hilog.batch.on turns it on for every process.
+ */
+void HiLogSetWriteBatching(bool enable);
+
 #ifdef __cplusplus
 }
 #endif
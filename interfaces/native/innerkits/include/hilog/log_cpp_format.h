@@ -0,0 +1,392 @@
+/*
+ * Copyright (c) 2022 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HIVIEWDFX_HILOG_CPP_FORMAT_H
+#define HIVIEWDFX_HILOG_CPP_FORMAT_H
+
+/*
+ * HILOG_CPP_* macros with literal formats parsed while compiling, see the end of this file.
+ * They need C++17, nothing is declared for older C++ which keeps using log_cpp.h only.
+ */
+#if defined(__cplusplus) && __cplusplus >= 201703L
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+#include "hilog/log_cpp.h"
+
+/*
+ * Format string pieces produced at compile time by HILOG_CPP_* macros.
+ * Every piece is a literal text followed by at most one conversion, offsets point into
+ * the format string the pieces were parsed from.
+ */
+enum HiLogFmtArgKind : uint8_t {
+    HILOG_FMT_ARG_NONE = 0,
+    HILOG_FMT_ARG_SIGNED,
+    HILOG_FMT_ARG_UNSIGNED,
+    HILOG_FMT_ARG_CHAR,
+    HILOG_FMT_ARG_STRING,
+    HILOG_FMT_ARG_POINTER,
+    HILOG_FMT_ARG_DOUBLE,
+    HILOG_FMT_ARG_LONG_DOUBLE,
+};
+
+enum HiLogFmtLength : uint8_t {
+    HILOG_FMT_LEN_NONE = 0,
+    HILOG_FMT_LEN_HH,
+    HILOG_FMT_LEN_H,
+    HILOG_FMT_LEN_L,
+    HILOG_FMT_LEN_LL,
+    HILOG_FMT_LEN_J,
+    HILOG_FMT_LEN_Z,
+    HILOG_FMT_LEN_T,
+    HILOG_FMT_LEN_BIG_L,
+};
+
+struct HiLogFmtPiece {
+    uint16_t litBegin = 0;
+    uint16_t litLen = 0;
+    uint16_t specBegin = 0; /* flags, width and precision, without "%" and privacy flag */
+    uint16_t specLen = 0;
+    char conv = '\0'; /* '\0' if the piece is literal text only */
+    uint8_t argKind = HILOG_FMT_ARG_NONE;
+    uint8_t length = HILOG_FMT_LEN_NONE;
+    bool isPrivate = true;
+};
+
+union HiLogFmtArg {
+    long long i;
+    unsigned long long u;
+    double d;
+    long double ld;
+    const char *s;
+    const void *p;
+};
+
+/*
+ * formatId is a per call site slot, zero initialized, where libhilog keeps the format registered
+ * for binary logs (hilog.binary.on). It may be null, the log is then always formatted as text.
+ */
+extern "C" int HiLogPrintFormatted(LogType type, LogLevel level, unsigned int domain, const char *tag,
+    const char *fmt, const HiLogFmtPiece *pieces, size_t pieceCount, const HiLogFmtArg *args,
+    std::atomic<uint32_t> *formatId);
+
+namespace OHOS {
+namespace HiviewDFX {
+namespace HiLogFormat {
+constexpr size_t MAX_FORMAT_LEN = UINT16_MAX;
+
+enum class ParseResult {
+    PIECE,
+    END,
+    UNSUPPORTED
+};
+
+constexpr bool StartsWith(const char *str, const char *prefix)
+{
+    for (; *prefix != '\0'; str++, prefix++) {
+        if (*str != *prefix) {
+            return false;
+        }
+    }
+    return true;
+}
+
+constexpr bool IsSpecChar(char ch)
+{
+    return (ch >= '0' && ch <= '9') || ch == '-' || ch == '+' || ch == ' ' || ch == '#' || ch == '.';
+}
+
+constexpr uint8_t ParseLength(const char *fmt, size_t &pos)
+{
+    switch (fmt[pos]) {
+        case 'h':
+            pos++;
+            return (fmt[pos] == 'h') ? (pos++, HILOG_FMT_LEN_HH) : HILOG_FMT_LEN_H;
+        case 'l':
+            pos++;
+            return (fmt[pos] == 'l') ? (pos++, HILOG_FMT_LEN_LL) : HILOG_FMT_LEN_L;
+        case 'j':
+            pos++;
+            return HILOG_FMT_LEN_J;
+        case 'z':
+            pos++;
+            return HILOG_FMT_LEN_Z;
+        case 't':
+            pos++;
+            return HILOG_FMT_LEN_T;
+        case 'L':
+            pos++;
+            return HILOG_FMT_LEN_BIG_L;
+        default:
+            return HILOG_FMT_LEN_NONE;
+    }
+}
+
+constexpr uint8_t ArgKindOf(char conv, uint8_t length)
+{
+    switch (conv) {
+        case 'd':
+        case 'i':
+            return HILOG_FMT_ARG_SIGNED;
+        case 'u':
+        case 'o':
+        case 'x':
+        case 'X':
+            return HILOG_FMT_ARG_UNSIGNED;
+        case 'c':
+            return (length == HILOG_FMT_LEN_NONE) ? HILOG_FMT_ARG_CHAR : HILOG_FMT_ARG_NONE;
+        case 's':
+            return (length == HILOG_FMT_LEN_NONE) ? HILOG_FMT_ARG_STRING : HILOG_FMT_ARG_NONE;
+        case 'p':
+            return HILOG_FMT_ARG_POINTER;
+        case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+            return (length == HILOG_FMT_LEN_BIG_L) ? HILOG_FMT_ARG_LONG_DOUBLE : HILOG_FMT_ARG_DOUBLE;
+        default: /* %n, wide characters and anything unknown */
+            return HILOG_FMT_ARG_NONE;
+    }
+}
+
+/* Same privacy rules as vsnprintfp_s: arguments are private unless marked with {public} */
+constexpr ParseResult NextPiece(const char *fmt, size_t &pos, HiLogFmtPiece &piece)
+{
+    piece = HiLogFmtPiece();
+    piece.litBegin = static_cast<uint16_t>(pos);
+    while (fmt[pos] != '\0' && fmt[pos] != '%') {
+        pos++;
+    }
+    piece.litLen = static_cast<uint16_t>(pos - piece.litBegin);
+    if (fmt[pos] == '\0') {
+        return (piece.litLen > 0) ? ParseResult::PIECE : ParseResult::END;
+    }
+    pos++;
+    if (fmt[pos] == '%') {
+        piece.litLen++; /* keep the first '%' as text */
+        pos++;
+        return ParseResult::PIECE;
+    }
+    if (fmt[pos] == '{') {
+        if (StartsWith(fmt + pos, "{public}")) {
+            piece.isPrivate = false;
+            pos += sizeof("{public}") - 1;
+        } else if (StartsWith(fmt + pos, "{private}")) {
+            pos += sizeof("{private}") - 1;
+        } else {
+            return ParseResult::UNSUPPORTED;
+        }
+    }
+    piece.specBegin = static_cast<uint16_t>(pos);
+    while (IsSpecChar(fmt[pos])) {
+        pos++;
+    }
+    piece.specLen = static_cast<uint16_t>(pos - piece.specBegin);
+    piece.length = ParseLength(fmt, pos);
+    piece.conv = fmt[pos];
+    piece.argKind = ArgKindOf(piece.conv, piece.length);
+    if (piece.argKind == HILOG_FMT_ARG_NONE) {
+        return ParseResult::UNSUPPORTED;
+    }
+    pos++;
+    return ParseResult::PIECE;
+}
+
+struct Summary {
+    size_t pieceCount = 0;
+    size_t argCount = 0;
+    bool supported = true;
+};
+
+constexpr Summary Scan(const char *fmt)
+{
+    Summary summary;
+    size_t pos = 0;
+    HiLogFmtPiece piece;
+    ParseResult result = ParseResult::END;
+    while ((result = NextPiece(fmt, pos, piece)) == ParseResult::PIECE) {
+        summary.pieceCount++;
+        summary.argCount += (piece.conv != '\0') ? 1 : 0;
+        if (pos > MAX_FORMAT_LEN) {
+            result = ParseResult::UNSUPPORTED;
+            break;
+        }
+    }
+    summary.supported = (result != ParseResult::UNSUPPORTED);
+    return summary;
+}
+
+template<size_t PieceCount, size_t ArgCount>
+struct Table {
+    HiLogFmtPiece pieces[PieceCount > 0 ? PieceCount : 1] = {};
+    size_t argPiece[ArgCount > 0 ? ArgCount : 1] = {}; /* index of the piece consuming the argument */
+};
+
+template<size_t PieceCount, size_t ArgCount>
+constexpr Table<PieceCount, ArgCount> Parse(const char *fmt)
+{
+    Table<PieceCount, ArgCount> table;
+    size_t pos = 0;
+    size_t arg = 0;
+    for (size_t i = 0; i < PieceCount; i++) {
+        NextPiece(fmt, pos, table.pieces[i]);
+        if (table.pieces[i].conv != '\0') {
+            table.argPiece[arg++] = i;
+        }
+    }
+    return table;
+}
+
+template<typename T, typename Arg = std::decay_t<T>>
+constexpr bool IS_SCALAR_ARG = std::is_arithmetic<Arg>::value || std::is_enum<Arg>::value ||
+    std::is_pointer<Arg>::value || std::is_null_pointer<Arg>::value;
+
+/* Integer type printf reads for the length modifier, the signedness doesn't matter */
+template<uint8_t Length>
+using IntOfLength = std::conditional_t<Length == HILOG_FMT_LEN_L, long,
+    std::conditional_t<Length == HILOG_FMT_LEN_LL, long long,
+    std::conditional_t<Length == HILOG_FMT_LEN_J, intmax_t,
+    std::conditional_t<Length == HILOG_FMT_LEN_Z, size_t,
+    std::conditional_t<Length == HILOG_FMT_LEN_T, ptrdiff_t, int>>>>>; /* hh and h take a promoted int */
+
+/*
+ * Whether an argument of type T may be printed by the conversion, roughly what -Wformat accepts:
+ * integers no wider than the length modifier, floating numbers, C strings and pointers.
+ */
+template<uint8_t Kind, uint8_t Length, typename T>
+constexpr bool ArgMatches()
+{
+    using Arg = std::decay_t<T>;
+    if constexpr (Kind == HILOG_FMT_ARG_SIGNED || Kind == HILOG_FMT_ARG_UNSIGNED || Kind == HILOG_FMT_ARG_CHAR) {
+        return (std::is_integral<Arg>::value || std::is_enum<Arg>::value) &&
+            sizeof(Arg) <= sizeof(IntOfLength<Length>);
+    } else if constexpr (Kind == HILOG_FMT_ARG_STRING) {
+        return std::is_convertible<T, const char *>::value;
+    } else if constexpr (Kind == HILOG_FMT_ARG_POINTER) {
+        return std::is_pointer<Arg>::value || std::is_null_pointer<Arg>::value;
+    } else if constexpr (Kind == HILOG_FMT_ARG_DOUBLE) {
+        return std::is_floating_point<Arg>::value && !std::is_same<Arg, long double>::value;
+    } else {
+        return std::is_same<Arg, long double>::value;
+    }
+}
+
+/* Applies the length modifier the same way printf reads the argument */
+template<uint8_t Length, typename T>
+constexpr long long ToSigned(const T &value)
+{
+    switch (Length) {
+        case HILOG_FMT_LEN_HH: return static_cast<signed char>(value);
+        case HILOG_FMT_LEN_H: return static_cast<short>(value);
+        case HILOG_FMT_LEN_L: return static_cast<long>(value);
+        case HILOG_FMT_LEN_LL: return static_cast<long long>(value);
+        case HILOG_FMT_LEN_J: return static_cast<intmax_t>(value);
+        case HILOG_FMT_LEN_Z: return static_cast<std::make_signed_t<size_t>>(value);
+        case HILOG_FMT_LEN_T: return static_cast<ptrdiff_t>(value);
+        default: return static_cast<int>(value);
+    }
+}
+
+template<uint8_t Length, typename T>
+constexpr unsigned long long ToUnsigned(const T &value)
+{
+    switch (Length) {
+        case HILOG_FMT_LEN_HH: return static_cast<unsigned char>(value);
+        case HILOG_FMT_LEN_H: return static_cast<unsigned short>(value);
+        case HILOG_FMT_LEN_L: return static_cast<unsigned long>(value);
+        case HILOG_FMT_LEN_LL: return static_cast<unsigned long long>(value);
+        case HILOG_FMT_LEN_J: return static_cast<uintmax_t>(value);
+        case HILOG_FMT_LEN_Z: return static_cast<size_t>(value);
+        case HILOG_FMT_LEN_T: return static_cast<std::make_unsigned_t<ptrdiff_t>>(value);
+        default: return static_cast<unsigned int>(value);
+    }
+}
+
+template<uint8_t Kind, uint8_t Length, typename T>
+HiLogFmtArg MakeArg(const T &value)
+{
+    HiLogFmtArg arg = {0};
+    if constexpr (!ArgMatches<Kind, Length, T>()) {
+        static_assert(ArgMatches<Kind, Length, T>(), "HiLog argument doesn't match the conversion of its format");
+    } else if constexpr (Kind == HILOG_FMT_ARG_SIGNED) {
+        arg.i = ToSigned<Length>(value);
+    } else if constexpr (Kind == HILOG_FMT_ARG_UNSIGNED) {
+        arg.u = ToUnsigned<Length>(value);
+    } else if constexpr (Kind == HILOG_FMT_ARG_CHAR) {
+        arg.i = static_cast<unsigned char>(static_cast<int>(value));
+    } else if constexpr (Kind == HILOG_FMT_ARG_STRING) {
+        arg.s = value;
+    } else if constexpr (Kind == HILOG_FMT_ARG_POINTER) {
+        arg.p = static_cast<const void *>(value);
+    } else if constexpr (Kind == HILOG_FMT_ARG_DOUBLE) {
+        arg.d = static_cast<double>(value);
+    } else {
+        arg.ld = value;
+    }
+    return arg;
+}
+
+/* Calls func(std::integral_constant<size_t, I>(), args[I]) for every argument */
+template<typename Func, size_t... I, typename... Args>
+void ForEachArg(Func &&func, std::index_sequence<I...>, const Args&... args)
+{
+    (func(std::integral_constant<size_t, I>(), args), ...);
+}
+
+/*
+ * Backend of HILOG_CPP_* macros. The format is parsed once at compile time, at run time the
+ * arguments are only converted to the kinds the format asks for. Formats the parser doesn't
+ * handle (e.g. "*" width or %n) are printed by HiLogPrint as usual.
+ */
+template<typename FmtProvider, typename... Args>
+int PrintLiteral(const HiLogLabel &label, LogLevel level, FmtProvider fmtProvider, const Args&... args)
+{
+    constexpr const char *fmt = fmtProvider();
+    constexpr Summary summary = Scan(fmt);
+    static_assert((IS_SCALAR_ARG<Args> && ...), "HiLog arguments must be numbers or pointers");
+    if constexpr (!summary.supported) {
+        return ::HiLogPrint(label.type, level, label.domain, label.tag, fmt, args...);
+    } else {
+        static_assert(summary.argCount == sizeof...(Args), "HiLog format doesn't match number of arguments");
+        static constexpr auto table = Parse<summary.pieceCount, summary.argCount>(fmt);
+        static std::atomic<uint32_t> formatId {0};
+        HiLogFmtArg argv[sizeof...(Args) > 0 ? sizeof...(Args) : 1];
+        ForEachArg([&argv](auto index, const auto &value) {
+            constexpr size_t i = decltype(index)::value;
+            constexpr HiLogFmtPiece piece = table.pieces[table.argPiece[i]];
+            argv[i] = MakeArg<piece.argKind, piece.length>(value);
+        }, std::index_sequence_for<Args...>(), args...);
+        return ::HiLogPrintFormatted(label.type, level, label.domain, label.tag, fmt, table.pieces,
+            summary.pieceCount, argv, &formatId);
+    }
+}
+} // namespace HiLogFormat
+} // namespace HiviewDFX
+} // namespace OHOS
+
+/*
+ * Format string of these macros must be a string literal, it is parsed while compiling.
+ * HiLog::Info and others remain for formats known only at run time.
+ */
+#define HILOG_CPP_PRINT(label, level, fmt, ...) \
+    (::OHOS::HiviewDFX::HiLogFormat::PrintLiteral((label), (level), []() { return "" fmt; }, ##__VA_ARGS__))
+
+#define HILOG_CPP_DEBUG(label, fmt, ...) HILOG_CPP_PRINT(label, LOG_DEBUG, fmt, ##__VA_ARGS__)
+#define HILOG_CPP_INFO(label, fmt, ...) HILOG_CPP_PRINT(label, LOG_INFO, fmt, ##__VA_ARGS__)
+#define HILOG_CPP_WARN(label, fmt, ...) HILOG_CPP_PRINT(label, LOG_WARN, fmt, ##__VA_ARGS__)
+#define HILOG_CPP_ERROR(label, fmt, ...) HILOG_CPP_PRINT(label, LOG_ERROR, fmt, ##__VA_ARGS__)
+#define HILOG_CPP_FATAL(label, fmt, ...) HILOG_CPP_PRINT(label, LOG_FATAL, fmt, ##__VA_ARGS__)
+#endif // __cplusplus >= 201703L
+#endif // HIVIEWDFX_HILOG_CPP_FORMAT_H
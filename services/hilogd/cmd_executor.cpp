@@ -12,13 +12,16 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
  */
-#include <algorithm>
+#include <array>
+#include <cerrno>
 #include <cstring>
+#include <fcntl.h>
 #include <iostream>
 #include <memory>
 #include <mutex>
 #include <thread>
-#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <sys/prctl.h>
 #include <sys/stat.h>
 #include <unistd.h>
@@ -32,23 +35,49 @@
 namespace OHOS {
 namespace HiviewDFX {
 static const int MAX_CLIENT_CONNECTIONS = 100;
+static constexpr int QUERY_WORKER_COUNT = 2;
+static constexpr int EPOLL_TIMEOUT_MS = 3000;
+static constexpr int MAX_EPOLL_EVENTS = 32;
+/* Epoll data of a client is its id shifted left, the lowest bit tells its wakeup eventfd from its socket */
+static constexpr uint64_t LISTEN_EVENT_ID = UINT64_MAX;
+static constexpr uint64_t WAKEUP_EVENT_BIT = 1;
 
-CmdExecutor::~CmdExecutor()
-{
-    std::lock_guard<std::mutex> lg(m_clientAccess);
-    for (auto& client : m_clients) {
-        client->m_stopThread.store(true);
+struct CmdExecutor::Client {
+    ~Client()
+    {
+        // No wakeup may come after the eventfd is closed, the controller unregisters from the buffer first
+        controller.reset();
+        if (wakeupFd >= 0) {
+            close(wakeupFd);
+        }
     }
-    for (auto& client : m_clients) {
-        if (client->m_clientThread.joinable()) {
-            client->m_clientThread.join();
+
+    void Wakeup()
+    {
+        if (!wakeupPending.exchange(true)) {
+            (void)eventfd_write(wakeupFd, 1);
         }
     }
+
+    uint64_t id = 0;
+    int socketFd = -1;
+    int wakeupFd = -1;
+    std::atomic<bool> wakeupPending {false};
+    std::mutex access; /* events of one client are handled by one worker at a time */
+    bool closed = false;
+    std::unique_ptr<ServiceController> controller;
+};
+
+CmdExecutor::~CmdExecutor()
+{
+    StopWorkers();
+    std::lock_guard<std::mutex> lg(m_clientAccess);
+    m_clients.clear();
 }
 
 void CmdExecutor::MainLoop()
 {
-    SeqPacketSocketServer cmdServer(CONTROL_SOCKET_NAME, MAX_CLIENT_CONNECTIONS);
+    SeqPacketSocketServer cmdServer(m_socketName, MAX_CLIENT_CONNECTIONS);
     if (cmdServer.Init() < 0) {
         std::cerr << "Failed to init control socket ! \n";
         return;
@@ -60,100 +89,209 @@ void CmdExecutor::MainLoop()
         PrintErrorno(listeningStatus);
         return;
     }
+    m_epollFd = epoll_create1(EPOLL_CLOEXEC);
+    epoll_event listenEvent = {0};
+    listenEvent.events = EPOLLIN;
+    listenEvent.data.u64 = LISTEN_EVENT_ID;
+    if (m_epollFd < 0 || epoll_ctl(m_epollFd, EPOLL_CTL_ADD, cmdServer.GetHandler(), &listenEvent) < 0) {
+        std::cerr << "Control socket epoll failed: ";
+        PrintErrorno(errno);
+        return;
+    }
     std::cout << "Server started to listen !\n";
 
-    using namespace std::chrono_literals;
-    for (;;) {
-        const auto maxtime = 3000ms;
-        short outEvent = 0;
-        auto pollResult = cmdServer.Poll(POLLIN, outEvent, maxtime);
-        if (pollResult == 0) { // poll == 0 means timeout
-            CleanFinishedClients();
-            continue;
-        } else if (pollResult < 0) {
+    {
+        std::lock_guard<std::mutex> lg(m_eventAccess);
+        m_stopWorkers = false;
+    }
+    for (int i = 0; i < QUERY_WORKER_COUNT; i++) {
+        m_workers.emplace_back(&CmdExecutor::WorkerLoop, this);
+    }
+    std::array<epoll_event, MAX_EPOLL_EVENTS> events;
+    while (!m_stopLoop.load()) {
+        int count = TEMP_FAILURE_RETRY(epoll_wait(m_epollFd, events.data(), events.size(), EPOLL_TIMEOUT_MS));
+        if (count < 0) {
             std::cerr << "Socket polling error: ";
             PrintErrorno(errno);
             break;
-        } else if (pollResult != 1 || outEvent != POLLIN) {
-            std::cerr << "Wrong poll result data."
-                         " Result: " << pollResult <<
-                         " OutEvent: " << outEvent << "\n";
-            break;
         }
-
-        int acceptResult = cmdServer.Accept();
-        if (acceptResult > 0) {
-            int acceptedSockedFd = acceptResult;
-            std::unique_ptr<Socket> handler = std::make_unique<Socket>(SOCK_SEQPACKET);
-            if (handler != nullptr) {
-                handler->setHandler(acceptedSockedFd);
-                OnAcceptedConnection(std::move(handler));
+        for (int i = 0; i < count; i++) {
+            if (events[i].data.u64 != LISTEN_EVENT_ID) {
+                OnClientEvent(events[i].data.u64, events[i].events);
+                continue;
+            }
+            int acceptResult = cmdServer.Accept();
+            if (acceptResult > 0) {
+                OnAcceptedConnection(acceptResult);
+            } else {
+                std::cerr << "Socket accept failed: ";
+                PrintErrorno(errno);
             }
-        } else {
-            std::cerr << "Socket accept failed: ";
-            PrintErrorno(errno);
-            break;
         }
     }
+
+    StopWorkers();
+    {
+        std::lock_guard<std::mutex> lg(m_clientAccess);
+        m_clients.clear();
+    }
+    close(m_epollFd);
+    m_epollFd = -1;
+}
+
+void CmdExecutor::Stop()
+{
+    m_stopLoop.store(true);
 }
 
-void CmdExecutor::OnAcceptedConnection(std::unique_ptr<Socket> handler)
+void CmdExecutor::OnAcceptedConnection(int socketFd)
 {
+    std::unique_ptr<Socket> handler = std::make_unique<Socket>(SOCK_SEQPACKET);
+    if (handler == nullptr) {
+        close(socketFd);
+        return;
+    }
+    handler->setHandler(socketFd);
     std::lock_guard<std::mutex> lg(m_clientAccess);
-    auto newVal = std::make_unique<ClientThread>();
-    if (newVal != nullptr) {
-        newVal->m_stopThread.store(false);
-        newVal->m_clientThread = std::thread(&CmdExecutor::ClientEventLoop, this, std::move(handler));
-        m_clients.push_back(std::move(newVal));
+    if (m_clients.size() >= static_cast<size_t>(MAX_CLIENT_CONNECTIONS)) {
+        std::cerr << "Too many control socket clients\n";
+        return;
     }
+    auto client = std::make_shared<Client>();
+    int flags = fcntl(socketFd, F_GETFL);
+    client->id = m_nextClientId++;
+    client->socketFd = socketFd;
+    client->wakeupFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (flags < 0 || fcntl(socketFd, F_SETFL, static_cast<unsigned int>(flags) | O_NONBLOCK) < 0 ||
+        client->wakeupFd < 0) {
+        std::cerr << "Failed to set up control socket client: ";
+        PrintErrorno(errno);
+        return;
+    }
+    Client* rawClient = client.get();
+    client->controller = std::make_unique<ServiceController>(std::move(handler), m_hilogBuffer,
+        [rawClient]() { rawClient->Wakeup(); });
+
+    epoll_event socketEvent = {0};
+    socketEvent.events = EPOLLIN | EPOLLONESHOT;
+    socketEvent.data.u64 = client->id << 1;
+    epoll_event wakeupEvent = {0};
+    wakeupEvent.events = EPOLLIN | EPOLLONESHOT;
+    wakeupEvent.data.u64 = (client->id << 1) | WAKEUP_EVENT_BIT;
+    if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, socketFd, &socketEvent) < 0 ||
+        epoll_ctl(m_epollFd, EPOLL_CTL_ADD, client->wakeupFd, &wakeupEvent) < 0) {
+        std::cerr << "Failed to poll control socket client: ";
+        PrintErrorno(errno);
+        (void)epoll_ctl(m_epollFd, EPOLL_CTL_DEL, socketFd, nullptr);
+        return;
+    }
+    m_clients.emplace(client->id, client);
 }
 
-void CmdExecutor::ClientEventLoop(std::unique_ptr<Socket> handler)
+void CmdExecutor::OnClientEvent(uint64_t eventId, uint32_t events)
 {
-    decltype(m_clients)::iterator clientInfoIt;
+    ClientEvent event;
     {
         std::lock_guard<std::mutex> lg(m_clientAccess);
-        clientInfoIt = std::find_if(m_clients.begin(), m_clients.end(),
-            [](const std::unique_ptr<ClientThread>& ct) {
-                return ct->m_clientThread.get_id() == std::this_thread::get_id();
-            });
+        auto it = m_clients.find(eventId >> 1);
+        if (it == m_clients.end()) {
+            return;
+        }
+        event.client = it->second;
     }
-    if (clientInfoIt == m_clients.end()) {
-        std::cerr << "Failed to find client\n";
-        return;
+    event.wakeup = (eventId & WAKEUP_EVENT_BIT) != 0;
+    event.events = events;
+    {
+        std::lock_guard<std::mutex> lg(m_eventAccess);
+        m_events.push_back(std::move(event));
     }
+    m_eventCv.notify_one();
+}
 
+void CmdExecutor::WorkerLoop()
+{
     prctl(PR_SET_NAME, "hilogd.query");
-    ServiceController serviceCtrl(std::move(handler), m_hilogBuffer);
-    serviceCtrl.CommunicationLoop((*clientInfoIt)->m_stopThread);
+    for (;;) {
+        ClientEvent event;
+        {
+            std::unique_lock<std::mutex> ul(m_eventAccess);
+            m_eventCv.wait(ul, [this]() { return m_stopWorkers || !m_events.empty(); });
+            if (m_stopWorkers) {
+                return;
+            }
+            event = std::move(m_events.front());
+            m_events.pop_front();
+        }
+        HandleClientEvent(event);
+    }
+}
+
+void CmdExecutor::HandleClientEvent(const ClientEvent& event)
+{
+    Client& client = *event.client;
+    std::lock_guard<std::mutex> lg(client.access);
+    if (client.closed) {
+        return;
+    }
+    ServiceController& controller = *client.controller;
+    bool keep = true;
+    if (event.wakeup) {
+        eventfd_t value = 0;
+        (void)eventfd_read(client.wakeupFd, &value);
+        client.wakeupPending.store(false);
+        keep = controller.OnNewData();
+    } else {
+        if ((event.events & EPOLLOUT) != 0) {
+            keep = controller.OnWritable();
+        }
+        if (keep && (event.events & EPOLLIN) != 0) {
+            keep = controller.OnRequest();
+        } else if ((event.events & (EPOLLERR | EPOLLHUP)) != 0) {
+            keep = false;
+        }
+    }
+    if (!keep || !ArmClient(client, event.wakeup)) {
+        client.closed = true;
+        RemoveClient(client);
+    }
+}
 
-    std::lock_guard<std::mutex> ul(m_finishedClientAccess);
-    m_finishedClients.push_back(std::this_thread::get_id());
+bool CmdExecutor::ArmClient(const Client& client, bool wakeup)
+{
+    epoll_event event = {0};
+    if (wakeup) {
+        event.events = EPOLLIN | EPOLLONESHOT;
+        event.data.u64 = (client.id << 1) | WAKEUP_EVENT_BIT;
+        return epoll_ctl(m_epollFd, EPOLL_CTL_MOD, client.wakeupFd, &event) == 0;
+    }
+    // Requests wait while a response is stuck, so they are answered in order
+    event.events = (client.controller->HasPendingOutput() ? EPOLLOUT : EPOLLIN) | EPOLLONESHOT;
+    event.data.u64 = client.id << 1;
+    return epoll_ctl(m_epollFd, EPOLL_CTL_MOD, client.socketFd, &event) == 0;
+}
+
+void CmdExecutor::RemoveClient(const Client& client)
+{
+    (void)epoll_ctl(m_epollFd, EPOLL_CTL_DEL, client.socketFd, nullptr);
+    (void)epoll_ctl(m_epollFd, EPOLL_CTL_DEL, client.wakeupFd, nullptr);
+    std::lock_guard<std::mutex> lg(m_clientAccess);
+    m_clients.erase(client.id);
 }
 
-void CmdExecutor::CleanFinishedClients()
+void CmdExecutor::StopWorkers()
 {
-    std::list<std::thread> threadsToJoin;
     {
-        // select clients to clean up - pick threads that we have to be sure are ended
-        std::scoped_lock sl(m_finishedClientAccess, m_clientAccess);
-        for (auto threadId : m_finishedClients) {
-            auto clientInfoIt = std::find_if(m_clients.begin(), m_clients.end(),
-                [&threadId](const std::unique_ptr<ClientThread>& ct) {
-                    return ct->m_clientThread.get_id() == threadId;
-                });
-            if (clientInfoIt != m_clients.end()) {
-                threadsToJoin.push_back(std::move((*clientInfoIt)->m_clientThread));
-                m_clients.erase(clientInfoIt);
-            }
-        }
-        m_finishedClients.clear();
+        std::lock_guard<std::mutex> lg(m_eventAccess);
+        m_stopWorkers = true;
+        m_events.clear();
     }
-    for (auto& thread : threadsToJoin) {
-        if (thread.joinable()) {
-            thread.join();
+    m_eventCv.notify_all();
+    for (auto& worker : m_workers) {
+        if (worker.joinable()) {
+            worker.join();
         }
     }
+    m_workers.clear();
 }
 } // namespace HiviewDFX
 } // namespace OHOS
@@ -16,36 +16,64 @@
 #ifndef CMD_EXECUTOR_H
 #define CMD_EXECUTOR_H
 
-#include <list>
-#include <memory>
 #include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
 #include <thread>
+#include <vector>
 
 #include <socket.h>
 #include "log_buffer.h"
 
 namespace OHOS {
 namespace HiviewDFX {
-struct ClientThread {
-    std::thread m_clientThread;
-    std::atomic<bool> m_stopThread;
-};
-
+/*
+ * Serves all control socket clients from one epoll loop. Ready clients are handed to a small
+ * worker pool, a client is handled by one worker at a time. Streaming clients are woken by
+ * their own eventfd when HilogBuffer gets new logs, and a client which doesn't read its
+ * responses is not polled for requests nor new logs until its socket has room again.
+ */
 class CmdExecutor {
 public:
-    explicit CmdExecutor(HilogBuffer& buffer) : m_hilogBuffer(buffer) {}
+    explicit CmdExecutor(HilogBuffer& buffer, const std::string& socketName = CONTROL_SOCKET_NAME)
+        : m_hilogBuffer(buffer), m_socketName(socketName) {}
     ~CmdExecutor();
     void MainLoop();
+    /* MainLoop returns at its next poll timeout, clients are dropped when it returns */
+    void Stop();
 private:
-    void OnAcceptedConnection(std::unique_ptr<Socket> handler);
-    void ClientEventLoop(std::unique_ptr<Socket> handler);
-    void CleanFinishedClients();
+    struct Client;
+    struct ClientEvent {
+        std::shared_ptr<Client> client;
+        bool wakeup = false;
+        uint32_t events = 0;
+    };
+
+    void OnAcceptedConnection(int socketFd);
+    void OnClientEvent(uint64_t eventId, uint32_t events);
+    void WorkerLoop();
+    void HandleClientEvent(const ClientEvent& event);
+    bool ArmClient(const Client& client, bool wakeup);
+    void RemoveClient(const Client& client);
+    void StopWorkers();
 
     HilogBuffer& m_hilogBuffer;
-    std::list<std::unique_ptr<ClientThread>> m_clients;
+    std::string m_socketName;
+    std::atomic<bool> m_stopLoop {false};
+    int m_epollFd = -1;
+    uint64_t m_nextClientId = 0;
+    std::map<uint64_t, std::shared_ptr<Client>> m_clients;
     std::mutex m_clientAccess;
-    std::vector<std::thread::id> m_finishedClients;
-    std::mutex m_finishedClientAccess;
+    std::deque<ClientEvent> m_events;
+    std::mutex m_eventAccess;
+    std::condition_variable m_eventCv;
+    bool m_stopWorkers = false;
+    std::vector<std::thread> m_workers;
 };
 } // namespace HiviewDFX
 } // namespace OHOS
@@ -16,16 +16,36 @@
 #ifndef KMSG_PARSER_H
 #define KMSG_PARSER_H
 
-#include "log_collector.h"
-#include "log_msg_wrapper.h"
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include "hilog_common.h"
+#include "hilog_msg.h"
 
 namespace OHOS {
 namespace HiviewDFX {
+/*
+ * Turns /dev/kmsg records ("<prio>,<seq>,<usec>,<flags>;<text>") into hilog messages in a single pass.
+ * A "[pid=<n>]" in the text becomes the pid, the first other text in square brackets becomes the tag.
+ */
 class KmsgParser {
 public:
     using BootTp = std::chrono::time_point<std::chrono::system_clock, std::chrono::nanoseconds>;
-    static std::optional<HilogMsgWrapper> ParseKmsg(const std::vector<char>& kmsgBuffer);
+    /* The message is valid till the next call, nullptr if the record can't be turned into one */
+    const HilogMsg* ParseKmsg(const char* kmsg, size_t len);
     static BootTp BootTime();
+
+private:
+    BootTp LogTime(uint64_t timestamp);
+
+    std::array<char, MAX_TAG_LEN + MAX_LOG_LEN> m_text; /* text without the pid */
+    std::array<char, sizeof(HilogMsg) + MAX_TAG_LEN + MAX_LOG_LEN> m_msgBuffer;
+    /* Boot time moves only with wall clock adjustments, it's taken again when kmsg time moves on */
+    BootTp m_bootTime;
+    uint64_t m_bootTimeTaken = 0;
+    bool m_bootTimeValid = false;
 };
 } // namespace HiviewDFX
 } // namespace OHOS
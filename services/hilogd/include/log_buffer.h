@@ -16,21 +16,24 @@
 #ifndef LOG_BUFFER_H
 #define LOG_BUFFER_H
 
+#include <array>
+#include <atomic>
 #include <cstdint>
 #include <functional>
-#include <list>
 #include <map>
 #include <memory>
 #include <shared_mutex>
 
 #include "log_data.h"
 #include "log_filter.h"
+#include "log_format_registry.h"
+#include "log_ring_buffer.h"
+#include "log_tag_table.h"
 
 namespace OHOS {
 namespace HiviewDFX {
 class HilogBuffer {
 public:
-    using LogMsgContainer = std::list<HilogData>;
     using ReaderId = uintptr_t;
     using OnFound = std::function<void(const HilogData&)>;
 
@@ -38,9 +41,21 @@ public:
     ~HilogBuffer();
 
     size_t Insert(const HilogMsg& msg);
-    bool Query(const LogFilterExt& filter, const ReaderId& id, OnFound onFound);
+    size_t Insert(const HilogMsg* const msgs[], size_t count);
+    /* Logs inserted from endOrder on are left for later queries, see GetEndOrder() */
+    bool Query(const CompiledLogFilter& filter, const ReaderId& id, OnFound onFound,
+        uint64_t endOrder = UINT64_MAX);
+    /* Insertion order of the next log */
+    uint64_t GetEndOrder();
+    /* Filter tags are resolved against the tags of this buffer */
+    CompiledLogFilter CompileFilter(const LogFilterExt& filter);
 
-    ReaderId CreateBufReader(std::function<void()> onNewDataCallback);
+    /*
+     * onNewDataCallback is called once, then not again until the reader drained the buffer (Query returned false).
+     * A reader which doesn't need every log at once is woken up only after wakeupLines new logs, it has to poll
+     * with a timeout of its own to bound the latency.
+     */
+    ReaderId CreateBufReader(std::function<void()> onNewDataCallback, uint32_t wakeupLines = 1);
     void RemoveBufReader(const ReaderId& id);
 
     int32_t Delete(uint16_t logType);
@@ -53,32 +68,30 @@ public:
     int32_t GetStatisticInfoByDomain(uint32_t domain, uint64_t& printLen, uint64_t& cacheLen, int32_t& dropped);
     int32_t ClearStatisticInfoByLog(uint16_t logType);
     int32_t ClearStatisticInfoByDomain(uint32_t domain);
-
-    static bool LogMatchFilter(const LogFilterExt& filter, const HilogData& logData);
+    /* Logs lost before they got into the buffer */
+    void CountDropped(uint16_t logType, uint32_t domain, uint64_t count);
 
 private:
     struct BufferReader {
-        LogMsgContainer::iterator m_pos;
-        LogMsgContainer* m_msgList = nullptr;
-        uint32_t skipped;
+        std::array<LogRingBuffer::Cursor, LOG_TYPE_MAX> m_cursors;
+        uint16_t m_types = 0; /* log types the cursors were positioned for */
+        uint64_t skipped;
         std::function<void()> m_onNewDataCallback;
+        uint32_t m_wakeupLines = 1;
+        std::atomic<uint32_t> m_unnotifiedLines {0};
+        std::atomic<bool> m_wakeupPending {false}; /* woken up and not yet drained */
     };
 
     void UpdateStatistics(const HilogData& logData);
-
-    enum class DeleteReason {
-        BUFF_OVERFLOW,
-        CMD_CLEAR
-    };
-    void OnDeleteItem(LogMsgContainer::iterator itemPos, DeleteReason reason);
-    void OnPushBackedItem(LogMsgContainer& msgList);
-    void OnNewItem(LogMsgContainer& msgList);
+    HilogData ToLogData(const HilogMsg& msg, LogTagTable::TagId tagId) const;
+    size_t InsertLocked(const HilogMsg& msg);
+    void OnNewItem(uint16_t types, uint32_t lines);
     std::shared_ptr<BufferReader> GetReader(const ReaderId& id);
 
-    size_t size;
-    size_t sizeByType[LOG_TYPE_MAX];
-    LogMsgContainer hilogDataList;
-    LogMsgContainer hilogKlogList;
+    LogRingBuffer m_rings[LOG_TYPE_MAX];
+    LogFormatRegistry m_formats; /* formats of binary logs, rendered as text on query */
+    LogTagTable m_tags; /* records keep ids of interned tags */
+    uint64_t m_order = 0; /* insertion order shared by all rings to merge them on query */
     std::shared_mutex hilogBufferMutex;
     std::map<uint32_t, uint64_t> cacheLenByDomain;
     std::map<uint32_t, uint64_t> printLenByDomain;
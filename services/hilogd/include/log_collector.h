@@ -17,14 +17,14 @@
 #define LOG_COLLECTOR_H
 #include <list>
 
-#include "log_buffer.h"
+#include "log_ingest_queue.h"
 #include "hilog_input_socket_server.h"
 
 namespace OHOS {
 namespace HiviewDFX {
 class LogCollector {
 public:
-    explicit LogCollector(HilogBuffer& buffer) : m_hilogBuffer(buffer) {}
+    explicit LogCollector(LogIngestQueue& queue) : m_ingestQueue(queue) {}
     void InsertDropInfo(const HilogMsg &msg, int droppedCount);
     size_t InsertLogToBuffer(const HilogMsg& msg);
 #ifndef __RECV_MSG_WITH_UCRED_
@@ -32,9 +32,12 @@ public:
 #else
     void onDataRecv(const ucred& cred, std::vector<char>& data);
 #endif
+    void onBatchRecv(std::vector<DgramPacket>& packets);
     ~LogCollector() = default;
 private:
-    HilogBuffer& m_hilogBuffer;
+    void HandleMsg(HilogMsg& msg);
+
+    LogIngestQueue& m_ingestQueue;
 };
 } // namespace HiviewDFX
 } // namespace OHOS
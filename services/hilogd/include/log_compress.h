@@ -18,6 +18,7 @@
 
 #include "hilog_common.h"
 #include <iostream>
+#include <vector>
 #ifdef USING_ZSTD_COMPRESS
 #define ZSTD_STATIC_LINKING_ONLY
 #include "include/common.h"
@@ -32,11 +33,20 @@ using LogPersisterBuffer = struct {
     uint32_t offset;
 };
 
+/*
+ * A compressor streams all logs of one rotated file. Compress appends a flushed piece of the stream,
+ * so whatever is written already can be decompressed, Finish appends the end of the stream and the
+ * next Compress starts the stream of the next file. On error the stream starts over.
+ */
 class LogCompress {
 public:
     LogCompress() = default;
     virtual ~LogCompress() = default;
     virtual int Compress(const LogPersisterBuffer &inBuffer, LogPersisterBuffer &compressBuffer) = 0;
+    virtual int Finish(LogPersisterBuffer &compressBuffer)
+    {
+        return 0;
+    }
 };
 
 class NoneCompress : public LogCompress {
@@ -46,24 +56,48 @@ public:
 
 class ZlibCompress : public LogCompress {
 public:
+    explicit ZlibCompress(int level = Z_DEFAULT_COMPRESSION);
+    ~ZlibCompress() override;
     int Compress(const LogPersisterBuffer &inBuffer, LogPersisterBuffer &compressBuffer) override;
+    int Finish(LogPersisterBuffer &compressBuffer) override;
 private:
-    static const uint16_t CHUNK = 16384;
-    char buffIn[CHUNK] = {0};
-    char buffOut[CHUNK] = {0};
+    int Deflate(const LogPersisterBuffer *inBuffer, LogPersisterBuffer &compressBuffer, int flush);
 
     z_stream cStream;
+    bool m_inited = false;
+    bool m_streaming = false; /* stream has data which isn't finished yet */
 };
 
+/*
+ * Dictionary trained on typical logs of the product, optional. Frames compressed with it carry its ID
+ * in their header and need it to be decompressed: zstd -d -D /system/etc/hilog_zstd.dict
+ */
+static constexpr const char* ZSTD_DICTIONARY_PATH = "/system/etc/hilog_zstd.dict";
+static constexpr size_t MAX_ZSTD_DICTIONARY_SIZE = 1024 * 1024;
+
+/* Empty if there is no usable dictionary */
+std::vector<char> LoadZstdDictionary(const char *path = ZSTD_DICTIONARY_PATH);
+
 class ZstdCompress : public LogCompress {
 public:
+    /* Levels are ZSTD_minCLevel() .. ZSTD_maxCLevel(), an empty dictionary is not used */
+    explicit ZstdCompress(int level = 1, const std::vector<char> &dictionary = {});
+    ~ZstdCompress() override;
     int Compress(const LogPersisterBuffer &inBuffer, LogPersisterBuffer &compressBuffer) override;
+    int Finish(LogPersisterBuffer &compressBuffer) override;
+    /* 0 if compressing without a dictionary */
+    uint32_t GetDictId() const
+    {
+        return m_dictId;
+    }
 private:
+    uint32_t m_dictId = 0;
 #ifdef USING_ZSTD_COMPRESS
-    static const uint16_t CHUNK = 16384;
-    char buffIn[CHUNK] = {0};
-    char buffOut[CHUNK] = {0};
-    ZSTD_CCtx* cctx;
+    int CompressStream(const LogPersisterBuffer *inBuffer, LogPersisterBuffer &compressBuffer,
+        ZSTD_EndDirective mode);
+
+    ZSTD_CCtx* cctx = nullptr;
+    bool m_streaming = false; /* stream has data which isn't finished yet */
 #endif
 };
 } // namespace HiviewDFX
@@ -25,6 +25,10 @@
 
 namespace OHOS {
 namespace HiviewDFX {
+/*
+ * Read-only view of a log record kept in HilogBuffer. It doesn't own tag and content,
+ * they point straight into the buffer storage and stay valid only within Query() callback.
+ */
 struct HilogData {
     uint16_t len; /* tag length plus fmt length include '\0' */
     uint16_t version : 3;
@@ -36,57 +40,22 @@ struct HilogData {
     uint32_t pid;
     uint32_t tid;
     uint32_t domain;
-    char* tag;
-    char* content;
-    void init(const char *mtag, uint16_t mtagLen, const char *mfmt, size_t mfmtLen)
-    {
-        if (unlikely(mtagLen > MAX_TAG_LEN || mtagLen == 0 || mfmtLen > MAX_LOG_LEN || mfmtLen <= 0)) {
-            return;
-        }
+    const char* tag;
+    const char* content;
 
-        len = mtagLen + mfmtLen;
-        char* tmp = new (std::nothrow) char[len];
-        if (unlikely(tmp == nullptr)) {
-            return;
-        }
-        tag = tmp;
-        content = tmp + mtagLen;
-        if (strncpy_s(tag, mtagLen + 1, mtag, mtagLen - 1)) {
-            return;
-        }
-        if (strncpy_s(content, mfmtLen + 1, mfmt, mfmtLen - 1)) {
-            return;
-        }
-    };
-    void deinit()
-    {
-        delete []tag;
-        tag = nullptr;
-        content = nullptr;
-    }
     HilogData() : len(0), tag(nullptr), content(nullptr) {}
     explicit HilogData(const HilogMsg& msg)
-        : len(0), version(msg.version), type(msg.type), level(msg.level), tag_len(msg.tag_len),
-        tv_sec(msg.tv_sec), tv_nsec(msg.tv_nsec), pid(msg.pid), tid(msg.tid), domain(msg.domain),
-        tag(nullptr), content(nullptr)
+        : len(msg.len - sizeof(HilogMsg)), version(msg.version), type(msg.type), level(msg.level),
+        tag_len(msg.tag_len), tv_sec(msg.tv_sec), tv_nsec(msg.tv_nsec), pid(msg.pid), tid(msg.tid),
+        domain(msg.domain), tag(msg.tag), content(CONTENT_PTR((&msg)))
     {
-        init(msg.tag, msg.tag_len, CONTENT_PTR((&msg)), CONTENT_LEN((&msg)));
     }
-    HilogData(const HilogData&) = delete;
-    HilogData& operator=(const HilogData&) = delete;
-
-    HilogData(HilogData&& cpy)
-    {
-        if (memcpy_s(this, sizeof(HilogData), &cpy, sizeof(HilogData)) != 0) {
-            std::cerr << "HilogData memcpy_s call failed.\n";
-        }
-        cpy.tag = nullptr;
-        cpy.content = nullptr;
-    }
-
-    ~HilogData()
+    /* For records which don't keep the tag next to the content */
+    HilogData(const HilogMsg& msg, const char* recordTag, uint16_t recordTagLen, const char* recordContent)
+        : len(recordTagLen + CONTENT_LEN((&msg))), version(msg.version), type(msg.type), level(msg.level),
+        tag_len(recordTagLen), tv_sec(msg.tv_sec), tv_nsec(msg.tv_nsec), pid(msg.pid), tid(msg.tid),
+        domain(msg.domain), tag(recordTag), content(recordContent)
     {
-        deinit();
     }
 };
 } // namespace HiviewDFX
@@ -16,10 +16,17 @@
 #ifndef LOG_FILTER_H
 #define LOG_FILTER_H
 
+#include <cstddef>
 #include <cstdint>
+#include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "log_data.h"
+#include "log_regex.h"
+#include "log_tag_table.h"
+
 namespace OHOS {
 namespace HiviewDFX {
 struct LogFilter {
@@ -32,6 +39,59 @@ struct LogFilter {
 struct LogFilterExt {
     LogFilter inclusions;
     LogFilter exclusions;
+    std::string content; /* ECMAScript regex searched in the content, empty matches everything */
+};
+
+/*
+ * LogFilterExt flattened for matching many records: types and levels are bitmasks, pids and
+ * domains small sorted arrays and tags are ids of LogTagTable. Strings are compared only for
+ * records whose tag didn't fit into the table. Compile it once when the filter changes,
+ * not for every Query().
+ * The content regex runs only on content which has the longest text every match must contain,
+ * found by memmem. A regex which is nothing but text isn't run at all. Content regexes run on
+ * LogRegex, those it doesn't take are left to the reader.
+ */
+class CompiledLogFilter {
+public:
+    CompiledLogFilter() = default;
+    CompiledLogFilter(const LogFilterExt& filter, LogTagTable& tagTable);
+
+    uint16_t GetTypes() const
+    {
+        return m_inclusions.types;
+    }
+    bool Match(const HilogData& logData, LogTagTable::TagId tagId) const;
+    /* Checked after Match(), binary logs have to be formatted first */
+    bool MatchContent(const HilogData& logData) const;
+    /* False also for a content regex which isn't taken */
+    bool HasContentFilter() const
+    {
+        return m_hasContent;
+    }
+
+private:
+    struct Rules {
+        uint16_t types = 0;
+        uint16_t levels = 0;
+        std::vector<uint32_t> pids;
+        std::vector<uint32_t> strictDomains; /* full domain, 0xdxxxxxx */
+        std::vector<uint32_t> fuzzyDomains;  /* domain without module bits, 0xdxxxx */
+        bool hasDomains = false; /* set even if none of the domains is valid */
+        std::vector<std::pair<LogTagTable::TagId, std::string>> tags; /* sorted by id */
+    };
+
+    static void CompileRules(const LogFilter& filter, LogTagTable& tagTable, Rules& rules);
+    static bool MatchDomain(const Rules& rules, uint32_t domain);
+    static bool MatchTag(const Rules& rules, const char* tag, LogTagTable::TagId tagId);
+
+    void CompileContent(const std::string& pattern);
+
+    Rules m_inclusions;
+    Rules m_exclusions;
+    bool m_hasContent = false;
+    std::string m_contentLiteral;
+    /* Null if the literal is the whole pattern. Search() extends its DFA, a filter serves one reader */
+    std::shared_ptr<LogRegex> m_contentRegex;
 };
 } // namespace HiviewDFX
 } // namespace OHOS
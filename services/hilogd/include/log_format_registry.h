@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2022 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LOG_FORMAT_REGISTRY_H
+#define LOG_FORMAT_REGISTRY_H
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "hilog_common.h"
+#include "log_binary.h"
+#include "log_data.h"
+
+namespace OHOS {
+namespace HiviewDFX {
+/*
+ * Formats registered by HILOG_MSG_VERSION_FORMAT records, binary records stored in HilogBuffer
+ * are rendered as text with them when read. Formats belong to the pid the kernel reported for the
+ * sender, which has to be the pid in the session, and a process can only hold a part of the registry.
+ * A process sends a format again when it can't tell whether it arrived, the same format under the same
+ * index is accepted. Formats of a live process are never dropped: when the registry is full, formats
+ * of exited processes are, and a new session of a pid replaces the old one when the pid is at its limit.
+ * The class is not thread safe, HilogBuffer serializes access with its own lock.
+ */
+class LogFormatRegistry {
+public:
+    /* Big enough for a tag followed by log text */
+    static constexpr size_t RENDER_BUF_LEN = MAX_TAG_LEN + MAX_LOG_LEN;
+
+    using AliveChecker = std::function<bool(uint32_t pid)>;
+    LogFormatRegistry();
+    /* For test, processes are alive as the checker tells */
+    explicit LogFormatRegistry(AliveChecker isAlive);
+
+    bool Register(const HilogMsg& msg);
+    /* Makes text view of binary data, tag and content of text point into buf */
+    void Render(const HilogData& data, char* buf, size_t bufLen, HilogData& text) const;
+
+private:
+    using Key = std::tuple<uint32_t, uint64_t, uint16_t>; /* pid, session, format index */
+    struct Format {
+        std::string fmt;
+        std::vector<HiLogFmtPiece> pieces;
+    };
+
+    struct PidUsage {
+        size_t count = 0;
+        size_t bytes = 0;
+    };
+
+    void DropFormats(uint32_t pid, uint64_t keptSession);
+    void ReclaimExited();
+
+    AliveChecker m_isAlive;
+    std::map<Key, Format> m_formats;
+    std::unordered_map<uint32_t, PidUsage> m_usageByPid;
+    size_t m_bytes = 0;
+    size_t m_reclaimCount; /* look for exited processes when the registry grows beyond these */
+    size_t m_reclaimBytes;
+};
+} // namespace HiviewDFX
+} // namespace OHOS
+#endif /* LOG_FORMAT_REGISTRY_H */
@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2022 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LOG_INGEST_QUEUE_H
+#define LOG_INGEST_QUEUE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "log_buffer.h"
+
+namespace OHOS {
+namespace HiviewDFX {
+/*
+ * Bounded multi-producer single-consumer staging queue in front of HilogBuffer.
+ * Producers (input socket server, kmsg reader, drop info) copy a message into a free
+ * slot and never wait for HilogBuffer locks. The commit thread takes ready slots in
+ * batches and publishes every batch into HilogBuffer with a single lock acquisition.
+ * When the queue is full the producer waits for the commit thread to free slots, so it
+ * stops reading its socket and the logs wait in the socket buffer like before. Messages
+ * posted once the queue is stopped are dropped and counted, the commit thread reports the
+ * count as a log and in the statistics of HilogBuffer with its next batch.
+ */
+class LogIngestQueue {
+public:
+    explicit LogIngestQueue(HilogBuffer& buffer);
+    ~LogIngestQueue();
+    LogIngestQueue(const LogIngestQueue&) = delete;
+    LogIngestQueue& operator=(const LogIngestQueue&) = delete;
+
+    void Start();
+    void Stop();
+    bool Post(const HilogMsg& msg);
+    uint64_t GetDropped() const
+    {
+        return m_dropped.load(std::memory_order_relaxed);
+    }
+
+private:
+    static constexpr size_t SLOT_DATA_SIZE = sizeof(HilogMsg) + MAX_TAG_LEN + MAX_LOG_LEN;
+    struct Slot {
+        std::atomic<uint64_t> seq;
+        char data[SLOT_DATA_SIZE];
+    };
+    struct DropInfo {
+        uint64_t count;
+        /* of the last dropped message */
+        uint16_t level;
+        uint32_t pid;
+        uint32_t tid;
+    };
+
+    void CommitLoop();
+    size_t CollectReady(const HilogMsg* batch[], size_t& batchSize);
+    void Release(size_t count);
+    void WaitForData();
+    void WakeUp();
+    void WaitForSpace(uint64_t pos);
+    void WakeUpProducers();
+    void CountDropped(const HilogMsg& msg);
+    void ReportDropped();
+
+    HilogBuffer& m_hilogBuffer;
+    std::unique_ptr<Slot[]> m_slots;
+    alignas(64) std::atomic<uint64_t> m_enqueuePos;
+    alignas(64) uint64_t m_dequeuePos = 0; /* owned by the commit thread */
+    std::atomic<uint64_t> m_dropped;
+    std::atomic<bool> m_hasUnreported;
+    std::mutex m_dropMtx;
+    std::map<uint64_t, DropInfo> m_unreported; /* key is log type << 32 | domain */
+    std::atomic<bool> m_consumerWaiting;
+    std::atomic<uint32_t> m_producersWaiting;
+    std::mutex m_spaceMtx;
+    std::condition_variable m_spaceCv;
+    std::atomic<bool> m_stop;
+    std::mutex m_wakeMtx;
+    std::condition_variable m_wakeCv;
+    std::thread m_commitThread;
+};
+} // namespace HiviewDFX
+} // namespace OHOS
+#endif
@@ -16,14 +16,17 @@
 #ifndef LOG_KMSG_H
 #define LOG_KMSG_H
 
-#include "log_buffer.h"
+#include <array>
+#include <cstdio>
+
+#include "log_ingest_queue.h"
 #include "kmsg_parser.h"
 
 namespace OHOS {
 namespace HiviewDFX {
 class LogKmsg {
 public:
-    explicit LogKmsg(HilogBuffer& hilogBuffer) : hilogBuffer(hilogBuffer) {}
+    explicit LogKmsg(LogIngestQueue& ingestQueue) : ingestQueue(ingestQueue) {}
     ~LogKmsg();
     ssize_t LinuxReadOneKmsg(KmsgParser& parser);
     int LinuxReadAllKmsg();
@@ -31,7 +34,8 @@ public:
     void Start();
 private:
     int kmsgCtl = -1;
-    HilogBuffer& hilogBuffer;
+    LogIngestQueue& ingestQueue;
+    std::array<char, BUFSIZ> kmsgBuffer; /* /dev/kmsg gives one record per read, the buffer is reused */
 };
 } // namespace HiviewDFX
 } // namespace OHOS
@@ -19,8 +19,10 @@
 #include <pthread.h>
 #include <zlib.h>
 
+#include <array>
 #include <condition_variable>
 #include <chrono>
+#include <deque>
 #include <fstream>
 #include <iostream>
 #include <list>
@@ -36,6 +38,17 @@
 
 namespace OHOS {
 namespace HiviewDFX {
+constexpr uint32_t PERSISTER_PLAIN_SEGMENTS = 2;
+
+/*
+ * Mapped auxiliary file, logs which aren't compressed and written yet survive a restart in it.
+ * The active segment is filled while the others wait for compression, older ones first.
+ */
+using PersisterPlainFile = struct {
+    LogPersisterBuffer segments[PERSISTER_PLAIN_SEGMENTS];
+    uint32_t active;
+};
+
 class LogPersister : public std::enable_shared_from_this<LogPersister> {
 public:
     using InitData = std::variant<LogPersistStartMsg, PersistRecoveryInfo>;
@@ -45,7 +58,7 @@ public:
     ~LogPersister();
 
     static int Kill(uint32_t id);
-    static int Query(uint16_t logType, std::list<LogPersistQueryResult> &results);
+    static int Query(uint16_t logType, std::list<LogPersistQueryResultExt> &results);
 
     int Init(const InitData& initData);
     int Deinit();
@@ -53,7 +66,7 @@ public:
     void Start();
     void Stop();
 
-    void FillInfo(LogPersistQueryResult &response);
+    void FillInfo(LogPersistQueryResultExt &response);
 
 private:
     struct BaseData {
@@ -61,6 +74,7 @@ private:
         std::string logPath;
         uint32_t logFileSizeLimit;
         uint16_t compressAlg;
+        uint32_t dictId;
         uint32_t maxLogFileNum;
         std::chrono::seconds newLogTimeout;
     };
@@ -75,19 +89,23 @@ private:
     void NotifyNewLogAvailable();
 
     int ReceiveLogLoop();
+    void OutputLoop();
+    void SealActiveSegment();
+    void WriteUnwrittenLogs();
 
     int InitCompression();
     int InitFileRotator(const InitData& initData);
     int WriteLogData(const HilogData& logData);
-    bool WriteUncompressedLogs(std::list<std::string>& formatedTextLogs);
-    void WriteCompressedLogs();
+    void CompressAndWrite(LogPersisterBuffer& plainSegment);
+    void WriteCompressedLogs(LogPersisterBuffer& plainSegment);
+    void FinishLogFile();
 
     int PrepareUncompressedFile(const std::string& parentPath, bool restore);
 
     BaseData m_baseData = {0};
 
     std::string m_plainLogFilePath;
-    LogPersisterBuffer *m_mappedPlainLogFile;
+    PersisterPlainFile *m_mappedPlainLogFile;
     uint32_t m_plainLogSize = 0;
     std::unique_ptr<LogCompress> m_compressor;
     std::unique_ptr<LogPersisterBuffer> m_compressBuffer;
@@ -96,12 +114,21 @@ private:
     std::mutex m_receiveLogCvMtx;
     std::condition_variable m_receiveLogCv;
 
+    /* Full plain segments go to hilogd.pst_out thread, reading logs never waits for compression nor disk */
+    std::mutex m_outputMtx;
+    std::condition_variable m_outputCv;
+    std::deque<uint32_t> m_sealedSegments;
+    std::array<bool, PERSISTER_PLAIN_SEGMENTS> m_segmentSealed = {false};
+    bool m_stopOutput = false;
+    std::unique_ptr<LogPersisterBuffer> m_unwrittenLogs; /* lines which didn't fit into the active segment */
+
     volatile bool m_stopThread = false;
     std::thread m_persisterThread;
 
     HilogBuffer &m_hilogBuffer;
     HilogBuffer::ReaderId m_bufReader;
     LogFilterExt m_filters;
+    CompiledLogFilter m_compiledFilter;
 
     std::mutex m_initMtx;
     volatile bool m_inited = false;
@@ -110,7 +137,11 @@ private:
     static std::list<std::shared_ptr<LogPersister>> s_logPersisters;
 };
 
-std::list<std::string> LogDataToFormatedStrings(HilogData *data);
+/*
+ * Formats the log straight into buf, one "<time> <pid> <tid> <level> <domain>/<tag>: <text>" line for every
+ * line of the content, empty lines are skipped. Returns the length written or -1 if it doesn't fit into buf.
+ */
+int FormatLogLines(const HilogData& logData, char *buf, size_t bufLen);
 } // namespace HiviewDFX
 } // namespace OHOS
 #endif
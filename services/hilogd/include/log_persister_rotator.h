@@ -24,16 +24,30 @@
 #include "log_filter.h"
 namespace OHOS {
 namespace HiviewDFX {
+/* Info files written before PersistRecoveryInfo had a version, they are migrated on restore */
+using PersistRecoveryInfoV0 = struct {
+    uint32_t index;
+    uint16_t types;
+    uint8_t levels;
+    LogPersistStartMsg msg;
+};
+
+static constexpr uint32_t PERSIST_INFO_VERSION = 1;
+
 using PersistRecoveryInfo = struct {
     uint32_t index;
     uint16_t types;
     uint8_t levels;
     LogPersistStartMsg msg;
+    uint32_t version; /* PERSIST_INFO_VERSION */
+    uint32_t dictId; /* zstd dictionary of the files, 0 if none */
 };
 
 static constexpr const char* AUXILLARY_PERSISTER_PREFIX = "persisterInfo_";
 
 uint64_t GenerateHash(const PersistRecoveryInfo &info);
+/* Reads the info file of a persist job in any version, false if it is broken */
+bool ReadRecoveryInfo(const std::string& path, PersistRecoveryInfo& info);
 
 class LogPersisterRotator {
 public:
@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2022 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LOG_RING_BUFFER_H
+#define LOG_RING_BUFFER_H
+
+#include <cstdint>
+#include <memory>
+
+#include "hilog_common.h"
+#include "log_tag_table.h"
+
+namespace OHOS {
+namespace HiviewDFX {
+/*
+ * Preallocated byte ring which keeps HilogMsg records of one log type back-to-back.
+ * Eviction of the oldest record is a head advance. Readers never hold pointers into
+ * the ring between calls, they keep a Cursor (record sequence number + byte offset)
+ * which is validated against the current head on every Read(). A record whose tag is interned
+ * in LogTagTable keeps only the tag id, its content follows the HilogMsg header directly.
+ * The class is not thread safe, HilogBuffer serializes access with its own lock.
+ */
+class LogRingBuffer {
+public:
+    using Seq = uint64_t;
+
+    struct Cursor {
+        Seq seq = 0;
+        size_t offset = 0;
+        uint32_t generation = 0;
+    };
+
+    LogRingBuffer() = default;
+    ~LogRingBuffer() = default;
+    LogRingBuffer(const LogRingBuffer&) = delete;
+    LogRingBuffer& operator=(const LogRingBuffer&) = delete;
+
+    void SetCapacity(size_t capacity);
+    /* tagId of LogTagTable::INVALID_TAG_ID keeps the tag inline */
+    bool Push(const HilogMsg& msg, uint64_t order, LogTagTable::TagId tagId);
+    size_t Clear();
+
+    Cursor Begin() const;
+    const HilogMsg* Read(Cursor& cursor, uint64_t& order, LogTagTable::TagId& tagId, uint64_t& missed) const;
+    void Next(Cursor& cursor) const;
+
+    bool Empty() const
+    {
+        return m_headSeq == m_tailSeq;
+    }
+
+private:
+    struct RecordHeader {
+        uint32_t size;  /* whole record size including this header, 0 marks wrap to the ring start */
+        uint32_t seq;   /* lower bits of the record sequence number, used to validate cursors */
+        uint64_t order; /* insertion order among all rings of HilogBuffer */
+        uint32_t tagId; /* LogTagTable id of the record tag */
+    };
+
+    bool IsWrapPoint(size_t offset) const;
+    bool IsRecordAt(size_t offset, Seq seq) const;
+    RecordHeader* HeaderAt(size_t offset) const;
+    void EvictOldest();
+    bool Reserve(size_t recordSize);
+    void Relocate(Cursor& cursor) const;
+
+    std::unique_ptr<char[]> m_data;
+    size_t m_capacity = 0;
+    size_t m_head = 0;
+    size_t m_tail = 0;
+    size_t m_used = 0;
+    Seq m_headSeq = 0;
+    Seq m_tailSeq = 0;
+    Seq m_overflowSeq = 0; /* records below this sequence were lost because of overflow */
+    uint32_t m_generation = 0;
+};
+} // namespace HiviewDFX
+} // namespace OHOS
+#endif
@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2022 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LOG_TAG_TABLE_H
+#define LOG_TAG_TABLE_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include "hilog_common.h"
+
+namespace OHOS {
+namespace HiviewDFX {
+/*
+ * Dictionary of every tag hilogd has seen. Buffered records keep a tag id instead of the tag,
+ * filters compare ids. Entries are never removed, so strings returned by GetTag() stay valid
+ * for the whole daemon life. Intern() and Find() may be called from any thread, GetTag() is
+ * lock free and safe for every id handed out before.
+ */
+class LogTagTable {
+public:
+    using TagId = uint32_t;
+    static constexpr TagId INVALID_TAG_ID = UINT32_MAX;
+    static constexpr size_t MAX_TAG_IDS = 65535;
+
+    LogTagTable() = default;
+    ~LogTagTable() = default;
+    LogTagTable(const LogTagTable&) = delete;
+    LogTagTable& operator=(const LogTagTable&) = delete;
+
+    /* Returns INVALID_TAG_ID when the table is full, tag is read up to '\0' or maxLen */
+    TagId Intern(const char* tag, size_t maxLen);
+    TagId Find(const char* tag, size_t maxLen);
+    const char* GetTag(TagId id) const;
+
+private:
+    static constexpr size_t CHUNK_BITS = 8;
+    static constexpr size_t CHUNK_SIZE = 1 << CHUNK_BITS;
+    static constexpr size_t MAX_CHUNKS = (MAX_TAG_IDS + CHUNK_SIZE - 1) / CHUNK_SIZE;
+
+    struct Chunk {
+        char tags[CHUNK_SIZE][MAX_TAG_LEN];
+    };
+
+    TagId FindLocked(const char* tag, size_t len, uint32_t hash) const;
+
+    std::mutex m_mutex;
+    std::unordered_multimap<uint32_t, TagId> m_index; /* tag hash to ids */
+    std::array<std::unique_ptr<Chunk>, MAX_CHUNKS> m_chunkStorage;
+    std::array<std::atomic<Chunk*>, MAX_CHUNKS> m_chunks {};
+    TagId m_count = 0;
+};
+} // namespace HiviewDFX
+} // namespace OHOS
+#endif /* LOG_TAG_TABLE_H */
@@ -18,10 +18,10 @@
 
 #include <array>
 #include <atomic>
-#include <condition_variable>
+#include <functional>
 #include <future>
 #include <memory>
-#include <mutex>
+#include <vector>
 
 #include <hilog_common.h>
 #include <socket.h>
@@ -35,16 +35,27 @@ public:
     static constexpr int MAX_DATA_LEN = 2048;
     using PacketBuf = std::array<char, MAX_DATA_LEN>;
 
-    ServiceController(std::unique_ptr<Socket> communicationSocket, HilogBuffer& buffer);
+    /*
+     * The socket is non blocking and served by CmdExecutor's reactor, onNewData is called from
+     * HilogBuffer when a streaming client has new logs to send. Handlers return false when the
+     * client has to be dropped.
+     */
+    ServiceController(std::unique_ptr<Socket> communicationSocket, HilogBuffer& buffer,
+        std::function<void()> onNewData);
     ~ServiceController();
 
-    void CommunicationLoop(std::atomic<bool>& stopLoop);
+    bool OnRequest();
+    bool OnWritable();
+    bool OnNewData();
+    /* A response didn't fit into the socket, requests and logs wait until it is sent */
+    bool HasPendingOutput() const;
 
 private:
     void SetFilters(const PacketBuf& rawData);
 
     void HandleLogQueryRequest();
-    void HandleNextRequest(const PacketBuf& rawData, std::atomic<bool>& stopLoop);
+    bool HandleNextRequest(const PacketBuf& rawData);
+    bool StreamLogs();
 
     // persist storage
     void HandlePersistStartRequest(const PacketBuf& rawData);
@@ -63,16 +74,26 @@ private:
     int WriteData(LogQueryResponse& rsp, OptCRef<HilogData> pData);
     int WriteV(const iovec* vec, size_t len);
     int WriteLogQueryRespond(unsigned int sendId, uint32_t respondCmd, OptCRef<HilogData> pData);
+    int RespondLog(unsigned int sendId, uint32_t respondCmd, OptCRef<HilogData> pData);
+    int FlushLogResponses();
+    int SendPendingOutput();
+    bool CanBatchMore() const;
     void NotifyForNewData();
 
     std::unique_ptr<Socket> m_communicationSocket;
     HilogBuffer& m_hilogBuffer;
     HilogBuffer::ReaderId m_bufReader;
-
-    std::condition_variable m_notifyNewDataCv;
-    std::mutex m_notifyNewDataMtx;
+    std::function<void()> m_onNewData;
+    std::atomic<bool> m_streaming {false}; /* NEXT_REQUEST accepted, new logs are pushed to the client */
 
     LogFilterExt m_filters;
+    CompiledLogFilter m_compiledFilter;
+
+    uint8_t m_queryVersion = LOG_QUERY_VERSION_SINGLE;
+    std::vector<char> m_batch; /* pending batch response, header included */
+    size_t m_batchLen = 0;
+    std::vector<char> m_pending; /* response the socket had no room for */
+    size_t m_pendingLen = 0;
 };
 
 int RestorePersistJobs(HilogBuffer& _buffer);
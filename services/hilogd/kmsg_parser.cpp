@@ -16,26 +16,22 @@
 #include "kmsg_parser.h"
 #include "hilog/log.h"
 
-#include <cstdlib>
-#include <cinttypes>
-#include <iostream>
-#include <string>
-#include <thread>
-#include <chrono>
-#include <fstream>
-#include <regex>
-#include <sys/time.h>
-#include <unistd.h>
-#include <fcntl.h>
-#include <sys/types.h>
+#include <cctype>
+#include <cstring>
+#include <ctime>
 #include <string_view>
 
+#include <securec.h>
+
 namespace OHOS {
 namespace HiviewDFX {
 using namespace std::chrono;
 using namespace std::literals;
 
-constexpr int  DEC = 10;
+constexpr int DEC = 10;
+constexpr uint64_t BOOT_TIME_REFRESH_US = 1000000; // 1000000 : kmsg time moving a second on
+constexpr auto DEFAULT_TAG = "kmsg"sv;
+constexpr auto PID_PREFIX = "[pid="sv;
 
 // Avoid name collision between sys/syslog.h and our log_c.h
 #undef LOG_FATAL
@@ -54,43 +50,79 @@ using Priority = enum {
     PV6
 };
 
-static void ParseHeader(std::string& str, uint16_t* level, uint64_t* timestamp)
+static bool ParseNumber(const char*& pos, const char* end, uint64_t& value)
 {
-    static const std::string pattern = "(\\d+),(\\d+),(\\d+),(\\S);";
-    static const std::regex express(pattern);
-    std::match_results<std::string::iterator> res;
-    if (std::regex_search(str.begin(), str.end(), res, express)) {
-        *level = strtoul(res[1].str().c_str(), nullptr, DEC);
-        *timestamp = strtoumax(res[3].str().c_str(), nullptr, DEC);
-        str.erase(res.position(), res.length());
+    const char* begin = pos;
+    value = 0;
+    while (pos < end && *pos >= '0' && *pos <= '9') {
+        value = value * DEC + static_cast<uint64_t>(*pos - '0');
+        pos++;
     }
+    return pos != begin;
 }
 
-// Parse pid if exists
-static uint32_t ParsePid(std::string& str)
+// Header is "<prio>,<seq>,<usec>,<flags>;", text starts after it. Without header the text is the whole record
+static const char* ParseHeader(const char* pos, const char* end, uint16_t& level, uint64_t& timestamp)
 {
-    static const std::string pattern = "\\[pid=(\\d+)\\]";
-    static const std::regex express(pattern);
-    std::match_results<std::string::iterator> res;
-    if (std::regex_search(str.begin(), str.end(), res, express)) {
-        uint32_t ret = strtoumax(res[1].str().c_str(), nullptr, DEC);
-        str.erase(res.position(), res.length());
-        return ret;
+    const char* text = pos;
+    uint64_t prio = 0;
+    uint64_t seq = 0;
+    uint64_t usec = 0;
+    if (!ParseNumber(pos, end, prio) || pos == end || *pos++ != ',' ||
+        !ParseNumber(pos, end, seq) || pos == end || *pos++ != ',' ||
+        !ParseNumber(pos, end, usec) || pos == end || *pos++ != ',') {
+        return text;
+    }
+    if (pos == end || isspace(static_cast<unsigned char>(*pos))) {
+        return text;
+    }
+    pos++;
+    // Fields added by newer kernels, e.g. ",caller=T1", are skipped
+    if (pos != end && *pos == ',') {
+        pos = static_cast<const char*>(memchr(pos, ';', end - pos));
+        if (pos == nullptr) {
+            return text;
+        }
+    }
+    if (pos == end || *pos != ';') {
+        return text;
     }
-    return 0;
+    level = static_cast<uint16_t>(prio);
+    timestamp = usec;
+    return pos + 1;
 }
 
-static std::string ParseTag(std::string& str)
+// Pid is in text like: [pid=xxx]
+static bool FindPid(std::string_view text, size_t& pos, size_t& len, uint32_t& pid)
 {
-    static const std::string pattern = "\\[.*?\\]";
-    static const std::regex express(pattern);
-    std::match_results<std::string::iterator> res;
-    if (std::regex_search(str.begin(), str.end(), res, express)) {
-        std::string ret = res[0].str();
-        str.erase(res.position(), res.length());
-        return ret;
+    for (size_t start = text.find(PID_PREFIX); start != std::string_view::npos;
+        start = text.find(PID_PREFIX, start + 1)) {
+        const char* numBegin = text.data() + start + PID_PREFIX.size();
+        const char* numEnd = numBegin;
+        uint64_t value = 0;
+        if (ParseNumber(numEnd, text.data() + text.size(), value) &&
+            numEnd != text.data() + text.size() && *numEnd == ']') {
+            pos = start;
+            len = static_cast<size_t>(numEnd - text.data()) + 1 - start; // 1 : ']'
+            pid = static_cast<uint32_t>(value);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Tag is the shortest text in square brackets on one line, brackets included
+static bool FindTag(std::string_view text, size_t& pos, size_t& len)
+{
+    for (size_t start = text.find('['); start != std::string_view::npos; start = text.find('[', start + 1)) {
+        size_t close = text.find_first_of("]\n\r", start + 1);
+        if (close != std::string_view::npos && text[close] == ']') {
+            pos = start;
+            len = close + 1 - start;
+            return true;
+        }
     }
-    return {};
+    return false;
 }
 
 // Log levels are different in syslog.h and hilog log_c.h
@@ -137,54 +169,72 @@ KmsgParser::BootTp KmsgParser::BootTime()
     auto boottime = current - uptime;
     return boottime;
 }
-std::optional<HilogMsgWrapper> KmsgParser::ParseKmsg(const std::vector<char>& kmsgBuffer)
+
+KmsgParser::BootTp KmsgParser::LogTime(uint64_t timestamp)
+{
+    uint64_t moved = (timestamp > m_bootTimeTaken) ? (timestamp - m_bootTimeTaken) : (m_bootTimeTaken - timestamp);
+    if (!m_bootTimeValid || moved >= BOOT_TIME_REFRESH_US) {
+        m_bootTime = BootTime();
+        m_bootTimeTaken = timestamp;
+        m_bootTimeValid = true;
+    }
+    return m_bootTime + microseconds{timestamp};
+}
+
+const HilogMsg* KmsgParser::ParseKmsg(const char* kmsg, size_t len)
 {
-    std::string kmsgStr(kmsgBuffer.data());
-    std::vector<char> mtag(MAX_TAG_LEN, '\0');
+    const char* end = kmsg + strnlen(kmsg, len);
     uint16_t mLevel = 0;
     uint64_t timestamp = 0;
-    ParseHeader(kmsgStr, &mLevel, &timestamp);
-    // Parses pid if exists. Pid in kmsg content is like: [pid=xxx,...]
-    uint32_t mpid = ParsePid(kmsgStr);
+    const char* begin = ParseHeader(kmsg, end, mLevel, timestamp);
+    std::string_view text(begin, static_cast<size_t>(end - begin));
+    uint32_t mpid = 0;
+    size_t pidPos = 0;
+    size_t pidLen = 0;
+    if (FindPid(text, pidPos, pidLen, mpid)) {
+        // Text around the pid joins, so the tag is searched in what is left
+        size_t textLen = text.size() - pidLen;
+        if (textLen >= m_text.size() || memcpy_s(m_text.data(), m_text.size(), text.data(), pidPos) != 0 ||
+            memcpy_s(m_text.data() + pidPos, m_text.size() - pidPos, text.data() + pidPos + pidLen,
+            textLen - pidPos) != 0) {
+            return nullptr;
+        }
+        text = std::string_view(m_text.data(), textLen);
+    }
     // If there are some other content wrapped in square brackets "[]", parse it as tag
     // Otherwise, use default tag  "kmsg"
+    std::string_view tag = DEFAULT_TAG;
+    size_t tagPos = 0;
     size_t tagLen = 0;
-    std::string tagStr = ParseTag(kmsgStr);
-    if (!tagStr.empty()) {
-        tagLen = tagStr.size();
-        if (strncpy_s(mtag.data(), MAX_TAG_LEN - 1, tagStr.c_str(), tagStr.size()) != 0) {
-            return {};
-        }
-    } else {
-        constexpr auto defaultTag = "kmsg"sv;
-        tagLen = defaultTag.size();
-        if (strncpy_s(mtag.data(), MAX_TAG_LEN - 1, defaultTag.data(), defaultTag.size()) != 0) {
-            return {};
-        }
+    if (FindTag(text, tagPos, tagLen)) {
+        tag = text.substr(tagPos, tagLen);
     }
-    // Now build HilogMsg and insert it into buffer
-    auto len = kmsgStr.size() + 1;
-    auto msgLen = sizeof(HilogMsg) + tagLen + len + 1;
-    HilogMsgWrapper msgWrap((std::vector<char>(msgLen, '\0')));
-    HilogMsg& msg = msgWrap.GetHilogMsg();
-    msg.len = msgLen;
-    msg.tag_len = tagLen + 1;
+    size_t contentLen = text.size() - tagLen;
+    if (tag.size() >= MAX_TAG_LEN - 1 || contentLen >= MAX_LOG_LEN) {
+        return nullptr;
+    }
+    // Now build HilogMsg, it's copied into the buffer by the caller
+    HilogMsg& msg = *reinterpret_cast<HilogMsg*>(m_msgBuffer.data());
+    (void)memset_s(&msg, sizeof(HilogMsg), 0, sizeof(HilogMsg));
+    msg.len = sizeof(HilogMsg) + tag.size() + 1 + contentLen + 1; // 1 : '\0' of tag and content
+    msg.tag_len = tag.size() + 1;
     msg.type = LOG_KMSG;
     msg.domain = 0xdfffffff;
     msg.level = KmsgLevelMap(mLevel);
-    time_point<system_clock, nanoseconds> logtime = BootTime() + microseconds{timestamp};
-    struct timespec logts = TimepointToTimespec(logtime);
+    struct timespec logts = TimepointToTimespec(LogTime(timestamp));
     msg.tv_sec = static_cast<uint32_t>(logts.tv_sec);
     msg.tv_nsec = static_cast<uint32_t>(logts.tv_nsec);
     msg.pid = mpid;
     msg.tid = mpid;
-    if (strncpy_s(msg.tag, tagLen + 1, mtag.data(), tagLen) != 0) {
-        return {};
-    }
-    if (strncpy_s(CONTENT_PTR((&msg)), MAX_LOG_LEN, kmsgStr.c_str(), len) != 0) {
-        return {};
+    char* content = CONTENT_PTR((&msg));
+    if (memcpy_s(msg.tag, MAX_TAG_LEN, tag.data(), tag.size()) != 0 ||
+        memcpy_s(content, MAX_LOG_LEN, text.data(), tagPos) != 0 ||
+        memcpy_s(content + tagPos, MAX_LOG_LEN - tagPos, text.data() + tagPos + tagLen, contentLen - tagPos) != 0) {
+        return nullptr;
     }
-    return msgWrap;
+    msg.tag[tag.size()] = '\0';
+    content[contentLen] = '\0';
+    return &msg;
 }
 } // namespace HiviewDFX
 } // namespace OHOS
@@ -13,6 +13,7 @@
  * limitations under the License.
  */
 
+#include <algorithm>
 #include <cstring>
 #include <thread>
 #include <vector>
@@ -30,11 +31,7 @@ namespace OHOS {
 namespace HiviewDFX {
 using namespace std;
 
-static const float DROP_RATIO = 0.05;
 static size_t g_maxBufferSizeByType[LOG_TYPE_MAX] = {262144, 262144, 262144, 262144, 262144};
-const int DOMAIN_STRICT_MASK = 0xd000000;
-const int DOMAIN_FUZZY_MASK = 0xdffff;
-const int DOMAIN_MODULE_BITS = 8;
 
 static int GenerateHilogMsgInside(HilogMsg& hilogMsg, const string& msg, uint16_t logType)
 {
@@ -66,9 +63,8 @@ static int GenerateHilogMsgInside(HilogMsg& hilogMsg, const string& msg, uint16_
 
 HilogBuffer::HilogBuffer()
 {
-    size = 0;
     for (int i = 0; i < LOG_TYPE_MAX; i++) {
-        sizeByType[i] = 0;
+        m_rings[i].SetCapacity(g_maxBufferSizeByType[i]);
         cacheLenByType[i] = 0;
         printLenByType[i] = 0;
         droppedByType[i] = 0;
@@ -113,103 +109,182 @@ HilogBuffer::~HilogBuffer() {}
 
 size_t HilogBuffer::Insert(const HilogMsg& msg)
 {
-    size_t elemSize = CONTENT_LEN((&msg)); /* include '\0' */
-
-    if (unlikely(msg.tag_len > MAX_TAG_LEN || msg.tag_len == 0 || elemSize > MAX_LOG_LEN || elemSize <= 0)) {
+    size_t elemSize = 0;
+    {
+        std::unique_lock<decltype(hilogBufferMutex)> lock(hilogBufferMutex);
+        elemSize = InsertLocked(msg);
+    }
+    if (elemSize == 0) {
         return 0;
     }
 
-    LogMsgContainer &msgList = (msg.type == LOG_KMSG) ? hilogKlogList : hilogDataList;
-    HilogData msgAsData(msg);
+    // Notify readers about new element added
+    OnNewItem(0b01 << msg.type, 1);
+    return elemSize;
+}
+
+size_t HilogBuffer::Insert(const HilogMsg* const msgs[], size_t count)
+{
+    size_t sum = 0;
+    uint16_t types = 0;
+    uint32_t lines = 0;
     {
         std::unique_lock<decltype(hilogBufferMutex)> lock(hilogBufferMutex);
-
-        // Delete old entries when full
-        if (elemSize + sizeByType[msg.type] >= g_maxBufferSizeByType[msg.type]) {
-            // Drop 5% of maximum log when full
-            std::list<HilogData>::iterator it = msgList.begin();
-            while (sizeByType[msg.type] > g_maxBufferSizeByType[msg.type] * (1 - DROP_RATIO) &&
-                it != msgList.end()) {
-                if ((*it).type != msg.type) {    // Only remove old logs of the same type
-                    ++it;
-                    continue;
-                }
-                OnDeleteItem(it, DeleteReason::BUFF_OVERFLOW);
-                size_t cLen = it->len - it->tag_len;
-                size -= cLen;
-                sizeByType[(*it).type] -= cLen;
-                it = msgList.erase(it);
-            }
-
-            // Re-confirm if enough elements has been removed
-            if (sizeByType[msg.type] >= g_maxBufferSizeByType[msg.type]) {
-                std::cout << "Failed to clean old logs." << std::endl;
+        for (size_t i = 0; i < count; i++) {
+            size_t elemSize = InsertLocked(*msgs[i]);
+            if (elemSize > 0) {
+                sum += elemSize;
+                types |= (0b01 << msgs[i]->type);
+                lines++;
             }
         }
+    }
+
+    // Readers are notified once per batch
+    if (types != 0) {
+        OnNewItem(types, lines);
+    }
+    return sum;
+}
 
-        // Append new log into HilogBuffer
-        msgList.push_back(std::move(msgAsData));
-        OnPushBackedItem(msgList);
+size_t HilogBuffer::InsertLocked(const HilogMsg& msg)
+{
+    size_t elemSize = CONTENT_LEN((&msg)); /* include '\0' */
+
+    if (unlikely(msg.tag_len > MAX_TAG_LEN || msg.tag_len == 0 || elemSize > MAX_LOG_LEN || elemSize <= 0)) {
+        return 0;
     }
 
-    // Update current size of HilogBuffer
-    size += elemSize;
-    sizeByType[msg.type] += elemSize;
+    if (unlikely(msg.type >= LOG_TYPE_MAX)) {
+        return 0;
+    }
+
+    // Format registrations aren't logs, binary logs refer to them
+    if (msg.version == HILOG_MSG_VERSION_FORMAT) {
+        (void)m_formats.Register(msg);
+        return 0;
+    }
+
+    // Append new log into its ring, the oldest entries are evicted when full
+    if (!m_rings[msg.type].Push(msg, m_order, m_tags.Intern(msg.tag, msg.tag_len))) {
+        std::cout << "Failed to insert log into buffer." << std::endl;
+        return 0;
+    }
+    ++m_order;
+
     cacheLenByType[msg.type] += elemSize;
     if (cacheLenByDomain.count(msg.domain) == 0) {
         cacheLenByDomain.insert(pair<uint32_t, uint64_t>(msg.domain, elemSize));
     } else {
         cacheLenByDomain[msg.domain] += elemSize;
     }
-
-    // Notify readers about new element added
-    OnNewItem(msgList);
     return elemSize;
 }
 
-bool HilogBuffer::Query(const LogFilterExt& filter, const ReaderId& id, OnFound onFound)
+bool HilogBuffer::Query(const CompiledLogFilter& filter, const ReaderId& id, OnFound onFound, uint64_t endOrder)
 {
     auto reader = GetReader(id);
     if (!reader) {
         std::cerr << "Reader not registered!\n";
         return false;
     }
-    uint16_t qTypes = filter.inclusions.types;
-    LogMsgContainer &msgList = (qTypes == (0b01 << LOG_KMSG)) ? hilogKlogList : hilogDataList;
+    uint16_t qTypes = filter.GetTypes();
 
     std::shared_lock<decltype(hilogBufferMutex)> lock(hilogBufferMutex);
 
-    if (reader->m_msgList != &msgList) {
-        reader->m_msgList = &msgList;
-        reader->m_pos = msgList.begin();
+    if (reader->m_types != qTypes) {
+        reader->m_types = qTypes;
+        for (uint16_t i = 0; i < LOG_TYPE_MAX; i++) {
+            reader->m_cursors[i] = m_rings[i].Begin();
+        }
     }
 
-    if (reader->skipped) {
-        const string msg = "========Slow reader missed log lines: ";
-        const string tmpStr = msg + to_string(reader->skipped);
-        std::vector<char> buf(MAX_LOG_LEN, 0);
-        HilogMsg *headMsg = reinterpret_cast<HilogMsg *>(buf.data());
-        if (GenerateHilogMsgInside(*headMsg, tmpStr, LOG_CORE) == RET_SUCCESS) {
-            const HilogData logData(*headMsg);
-            if (onFound) {
-                onFound(logData);
-                reader->skipped = 0;
+    while (true) {
+        // Merge requested rings by insertion order, the oldest record goes first
+        const HilogMsg* found = nullptr;
+        uint16_t foundType = 0;
+        uint64_t foundOrder = UINT64_MAX;
+        LogTagTable::TagId foundTagId = LogTagTable::INVALID_TAG_ID;
+        for (uint16_t i = 0; i < LOG_TYPE_MAX; i++) {
+            if ((qTypes & (0b01 << i)) == 0) {
+                continue;
+            }
+            uint64_t order = 0;
+            LogTagTable::TagId tagId = LogTagTable::INVALID_TAG_ID;
+            const HilogMsg* msg = m_rings[i].Read(reader->m_cursors[i], order, tagId, reader->skipped);
+            if (msg != nullptr && order < foundOrder) {
+                found = msg;
+                foundType = i;
+                foundOrder = order;
+                foundTagId = tagId;
             }
         }
-    }
 
-    while (reader->m_pos != msgList.end()) {
-        const HilogData& logData = *reader->m_pos;
-        reader->m_pos++;
-        if (LogMatchFilter(filter, logData)) {
-            UpdateStatistics(logData);
+        if (reader->skipped) {
+            const string msg = "========Slow reader missed log lines: ";
+            const string tmpStr = msg + to_string(reader->skipped);
+            std::vector<char> buf(MAX_LOG_LEN, 0);
+            HilogMsg *headMsg = reinterpret_cast<HilogMsg *>(buf.data());
+            if (GenerateHilogMsgInside(*headMsg, tmpStr, LOG_CORE) == RET_SUCCESS) {
+                const HilogData logData(*headMsg);
+                if (onFound) {
+                    onFound(logData);
+                    reader->skipped = 0;
+                }
+            }
+        }
+
+        if (found != nullptr && foundOrder >= endOrder) {
+            // Reader isn't drained, its wakeup state stays
+            return false;
+        }
+        if (found == nullptr) {
+            // Still under the lock, so logs inserted from now on wake the reader up again
+            reader->m_unnotifiedLines.store(0, std::memory_order_relaxed);
+            reader->m_wakeupPending.store(false);
+            return false;
+        }
+        m_rings[foundType].Next(reader->m_cursors[foundType]);
+        const HilogData logData = ToLogData(*found, foundTagId);
+        if (filter.Match(logData, foundTagId)) {
+            // Binary logs are formatted only now, readers get text
+            char rendered[LogFormatRegistry::RENDER_BUF_LEN];
+            HilogData textData;
+            if (logData.version == HILOG_MSG_VERSION_BINARY) {
+                m_formats.Render(logData, rendered, sizeof(rendered), textData);
+            }
+            const HilogData& outData = (logData.version == HILOG_MSG_VERSION_BINARY) ? textData : logData;
+            if (filter.HasContentFilter() && !filter.MatchContent(outData)) {
+                continue;
+            }
+            UpdateStatistics(outData);
             if (onFound) {
-                onFound(logData);
+                onFound(outData);
             }
             return true;
         }
     }
-    return false;
+}
+
+uint64_t HilogBuffer::GetEndOrder()
+{
+    std::shared_lock<decltype(hilogBufferMutex)> lock(hilogBufferMutex);
+    return m_order;
+}
+
+HilogData HilogBuffer::ToLogData(const HilogMsg& msg, LogTagTable::TagId tagId) const
+{
+    if (tagId == LogTagTable::INVALID_TAG_ID) {
+        return HilogData(msg);
+    }
+    // Content of a record with interned tag starts where the tag would be
+    const char* tag = m_tags.GetTag(tagId);
+    return HilogData(msg, tag, static_cast<uint16_t>(strlen(tag) + 1), msg.tag);
+}
+
+CompiledLogFilter HilogBuffer::CompileFilter(const LogFilterExt& filter)
+{
+    return CompiledLogFilter(filter, m_tags);
 }
 
 void HilogBuffer::UpdateStatistics(const HilogData& logData)
@@ -225,40 +300,21 @@ void HilogBuffer::UpdateStatistics(const HilogData& logData)
 
 int32_t HilogBuffer::Delete(uint16_t logType)
 {
-    std::list<HilogData> &msgList = (logType == (0b01 << LOG_KMSG)) ? hilogKlogList : hilogDataList;
     if (logType >= LOG_TYPE_MAX) {
         return ERR_LOG_TYPE_INVALID;
     }
-    size_t sum = 0;
     std::unique_lock<decltype(hilogBufferMutex)> lock(hilogBufferMutex);
-    std::list<HilogData>::iterator it = msgList.begin();
-
-    // Delete logs corresponding to queryCondition
-    while (it != msgList.end()) {
-        // Only remove old logs of the same type
-        if ((*it).type != logType) {
-            ++it;
-            continue;
-        }
-        // Delete corresponding logs
-        OnDeleteItem(it, DeleteReason::CMD_CLEAR);
-
-        size_t cLen = it->len - it->tag_len;
-        sum += cLen;
-        sizeByType[(*it).type] -= cLen;
-        size -= cLen;
-        it = msgList.erase(it);
-    }
-    return sum;
+    return m_rings[logType].Clear();
 }
 
-HilogBuffer::ReaderId HilogBuffer::CreateBufReader(std::function<void()> onNewDataCallback)
+HilogBuffer::ReaderId HilogBuffer::CreateBufReader(std::function<void()> onNewDataCallback, uint32_t wakeupLines)
 {
     std::unique_lock<decltype(m_logReaderMtx)> lock(m_logReaderMtx);
     auto reader = std::make_shared<BufferReader>();
     if (reader != nullptr) {
         reader->skipped = 0;
         reader->m_onNewDataCallback = onNewDataCallback;
+        reader->m_wakeupLines = std::max(wakeupLines, 1u);
     }
     ReaderId id = reinterpret_cast<ReaderId>(reader.get());
     m_logReaders.insert(std::make_pair(id, reader));
@@ -274,35 +330,22 @@ void HilogBuffer::RemoveBufReader(const ReaderId& id)
     }
 }
 
-void HilogBuffer::OnDeleteItem(LogMsgContainer::iterator itemPos, DeleteReason reason)
+void HilogBuffer::OnNewItem(uint16_t types, uint32_t lines)
 {
     std::shared_lock<decltype(m_logReaderMtx)> lock(m_logReaderMtx);
     for (auto& [id, readerPtr] : m_logReaders) {
-        if (readerPtr->m_pos == itemPos) {
-            readerPtr->m_pos = std::next(itemPos);
-            if (reason == DeleteReason::BUFF_OVERFLOW) {
-                readerPtr->skipped++;
-            }
+        BufferReader& reader = *readerPtr;
+        if ((reader.m_types & types) == 0 || !reader.m_onNewDataCallback ||
+            reader.m_wakeupPending.load(std::memory_order_relaxed)) {
+            continue;
         }
-    }
-}
-
-void HilogBuffer::OnPushBackedItem(LogMsgContainer& msgList)
-{
-    std::shared_lock<decltype(m_logReaderMtx)> lock(m_logReaderMtx);
-    for (auto& [id, readerPtr] : m_logReaders) {
-        if (readerPtr->m_pos == msgList.end()) {
-            readerPtr->m_pos = std::prev(msgList.end());
+        if (reader.m_wakeupLines > 1 &&
+            reader.m_unnotifiedLines.fetch_add(lines, std::memory_order_relaxed) + lines < reader.m_wakeupLines) {
+            continue;
         }
-    }
-}
-
-void HilogBuffer::OnNewItem(LogMsgContainer& msgList)
-{
-    std::shared_lock<decltype(m_logReaderMtx)> lock(m_logReaderMtx);
-    for (auto& [id, readerPtr] : m_logReaders) {
-        if (readerPtr->m_msgList == &msgList && readerPtr->m_onNewDataCallback) {
-            readerPtr->m_onNewDataCallback();
+        if (!reader.m_wakeupPending.exchange(true)) {
+            reader.m_unnotifiedLines.store(0, std::memory_order_relaxed);
+            reader.m_onNewDataCallback();
         }
     }
 }
@@ -336,6 +379,7 @@ int32_t HilogBuffer::SetBuffLen(uint16_t logType, uint64_t buffSize)
     }
     std::unique_lock<decltype(hilogBufferMutex)> lock(hilogBufferMutex);
     g_maxBufferSizeByType[logType] = buffSize;
+    m_rings[logType].SetCapacity(buffSize);
     return buffSize;
 }
 
@@ -346,7 +390,7 @@ int32_t HilogBuffer::GetStatisticInfoByLog(uint16_t logType, uint64_t& printLen,
     }
     printLen = printLenByType[logType];
     cacheLen = cacheLenByType[logType];
-    dropped = GetDroppedByType(logType);
+    dropped = GetDroppedByType(logType) + static_cast<int32_t>(droppedByType[logType]);
     return 0;
 }
 
@@ -355,10 +399,20 @@ int32_t HilogBuffer::GetStatisticInfoByDomain(uint32_t domain, uint64_t& printLe
 {
     printLen = printLenByDomain[domain];
     cacheLen = cacheLenByDomain[domain];
-    dropped = GetDroppedByDomain(domain);
+    dropped = GetDroppedByDomain(domain) + static_cast<int32_t>(droppedByDomain[domain]);
     return 0;
 }
 
+void HilogBuffer::CountDropped(uint16_t logType, uint32_t domain, uint64_t count)
+{
+    if (logType >= LOG_TYPE_MAX) {
+        return;
+    }
+    std::unique_lock<decltype(hilogBufferMutex)> lock(hilogBufferMutex);
+    droppedByType[logType] += count;
+    droppedByDomain[domain] += count;
+}
+
 int32_t HilogBuffer::ClearStatisticInfoByLog(uint16_t logType)
 {
     if (logType >= LOG_TYPE_MAX) {
@@ -379,64 +433,5 @@ int32_t HilogBuffer::ClearStatisticInfoByDomain(uint32_t domain)
     droppedByDomain[domain] = 0;
     return 0;
 }
-
-bool HilogBuffer::LogMatchFilter(const LogFilterExt& filter, const HilogData& logData)
-{
-    /* domain patterns:
-     * strict mode: 0xdxxxxxx   (full)
-     * fuzzy mode: 0xdxxxx      (using last 2 digits of full domain as mask)
-     */
-    // inclusions
-    if (((static_cast<uint8_t>((0b01 << (logData.type)) & (filter.inclusions.types)) == 0) ||
-        (static_cast<uint8_t>((0b01 << (logData.level)) & (filter.inclusions.levels)) == 0)))
-        return false;
-
-    if (!filter.inclusions.pids.empty()) {
-        auto it = std::find(filter.inclusions.pids.begin(), filter.inclusions.pids.end(), logData.pid);
-        if (it == filter.inclusions.pids.end())
-            return false;
-    }
-    if (!filter.inclusions.domains.empty()) {
-        auto it = std::find_if(filter.inclusions.domains.begin(), filter.inclusions.domains.end(),
-            [&] (uint32_t domain) {
-                return ((domain >= DOMAIN_STRICT_MASK && domain == logData.domain) ||
-                    (domain <= DOMAIN_FUZZY_MASK && domain == (logData.domain >> DOMAIN_MODULE_BITS)));
-            });
-        if (it == filter.inclusions.domains.end())
-            return false;
-    }
-    if (!filter.inclusions.tags.empty()) {
-        auto it = std::find(filter.inclusions.tags.begin(), filter.inclusions.tags.end(), logData.tag);
-        if (it == filter.inclusions.tags.end())
-            return false;
-    }
-
-    // exclusion
-    if (!filter.exclusions.pids.empty()) {
-        auto it = std::find(filter.exclusions.pids.begin(), filter.exclusions.pids.end(), logData.pid);
-        if (it != filter.exclusions.pids.end())
-            return false;
-    }
-
-    if (!filter.exclusions.domains.empty()) {
-        auto it = std::find_if(filter.exclusions.domains.begin(), filter.exclusions.domains.end(),
-            [&] (uint32_t domain) {
-                return ((domain >= DOMAIN_STRICT_MASK && domain == logData.domain) ||
-                    (domain <= DOMAIN_FUZZY_MASK && domain == (logData.domain >> DOMAIN_MODULE_BITS)));
-            });
-        if (it != filter.exclusions.domains.end())
-            return false;
-    }
-    if (!filter.exclusions.tags.empty()) {
-        auto it = std::find(filter.exclusions.tags.begin(), filter.exclusions.tags.end(), logData.tag);
-        if (it != filter.exclusions.tags.end())
-            return false;
-    }
-    if ((static_cast<uint8_t>((0b01 << (logData.type)) & (filter.exclusions.types)) != 0) ||
-        (static_cast<uint8_t>((0b01 << (logData.level)) & (filter.exclusions.levels)) != 0)) {
-        return false;
-    }
-    return true;
-}
 } // namespace HiviewDFX
 } // namespace OHOS
@@ -37,7 +37,7 @@ void LogCollector::InsertDropInfo(const HilogMsg &msg, int droppedCount)
     HilogMsg *dropMsg = reinterpret_cast<HilogMsg *>(buffer.data());
     if (dropMsg != nullptr) {
         dropMsg->len     = buffer.size();
-        dropMsg->version = msg.version;
+        dropMsg->version = HILOG_MSG_VERSION_TEXT;
         dropMsg->type    = msg.type;
         dropMsg->level   = msg.level;
         dropMsg->tag_len = tag.size();
@@ -76,6 +76,37 @@ void LogCollector::onDataRecv(const ucred& cred, std::vector<char>& data)
 #ifdef __RECV_MSG_WITH_UCRED_
     msg->pid = cred.pid;
 #endif
+    HandleMsg(*msg);
+}
+
+void LogCollector::onBatchRecv(std::vector<DgramPacket>& packets)
+{
+    for (DgramPacket& packet : packets) {
+        // Batching clients put several records back-to-back into one packet
+        size_t offset = 0;
+        while (packet.len - offset >= sizeof(HilogMsg)) {
+            HilogMsg *msg = reinterpret_cast<HilogMsg *>(packet.data + offset);
+            if (msg->len < sizeof(HilogMsg) || msg->len > packet.len - offset) {
+                std::cerr << "Internal error - malformed record in received packet\n";
+                break;
+            }
+            offset += msg->len;
+#ifdef __RECV_MSG_WITH_UCRED_
+            msg->pid = packet.cred.pid;
+#endif
+            HandleMsg(*msg);
+        }
+    }
+}
+
+void LogCollector::HandleMsg(HilogMsg& hilogMsg)
+{
+    HilogMsg *msg = &hilogMsg;
+    // Format registrations of binary logs must never be dropped
+    if (msg->version == HILOG_MSG_VERSION_FORMAT) {
+        InsertLogToBuffer(*msg);
+        return;
+    }
     // Domain flow control
     int ret = FlowCtrlDomain(msg);
     if (ret < 0) {
@@ -93,7 +124,8 @@ size_t LogCollector::InsertLogToBuffer(const HilogMsg& msg)
     if (msg.type >= LOG_TYPE_MAX) {
         return ERR_LOG_TYPE_INVALID;
     }
-    return m_hilogBuffer.Insert(msg);
+    // Message is committed into HilogBuffer asynchronously by the ingest queue
+    return m_ingestQueue.Post(msg) ? CONTENT_LEN((&msg)) : 0;
 }
 } // namespace HiviewDFX
 } // namespace OHOS
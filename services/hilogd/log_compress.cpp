@@ -17,7 +17,7 @@
 #include <iostream>
 #include <cstring>
 #include <cstdlib>
-#include <vector>
+#include <fstream>
 
 #include <securec.h>
 
@@ -34,133 +34,174 @@ int NoneCompress::Compress(const LogPersisterBuffer &inBuffer, LogPersisterBuffe
     return 0;
 }
 
-int ZlibCompress::Compress(const LogPersisterBuffer &inBuffer, LogPersisterBuffer &compressedBuffer)
+ZlibCompress::ZlibCompress(int level)
 {
     cStream.zalloc = Z_NULL;
     cStream.zfree = Z_NULL;
     cStream.opaque = Z_NULL;
-    if (deflateInit2(&cStream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, MAX_WBITS + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
-        return -1;
+    // 16 : gzip wrapper, 8 : default memory level
+    m_inited = deflateInit2(&cStream, level, Z_DEFLATED, MAX_WBITS + 16, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+    if (!m_inited) {
+        std::cerr << "deflateInit2() failed!\n";
+    }
+}
+
+ZlibCompress::~ZlibCompress()
+{
+    if (m_inited) {
+        (void)deflateEnd(&cStream);
     }
-    uint32_t zdlen = deflateBound(&cStream, inBuffer.offset);
-    std::vector<char> zdataBuf(zdlen, 0);
-    char* zdata = zdataBuf.data();
-    if (zdata == nullptr) {
-        std::cerr << "no enough memory!\n";
+}
+
+int ZlibCompress::Deflate(const LogPersisterBuffer *inBuffer, LogPersisterBuffer &compressedBuffer, int flush)
+{
+    if (!m_inited || compressedBuffer.offset > MAX_PERSISTER_BUFFER_SIZE) {
         return -1;
     }
-    size_t const toRead = CHUNK;
-    size_t src_pos = 0;
-    size_t dst_pos = 0;
-    size_t read = inBuffer.offset;
-    int flush = 0;
-    do {
-        bool flag = read - src_pos < toRead;
-        if (flag) {
-            (void)memset_s(buffIn, CHUNK, 0, CHUNK);
-            if (memmove_s(buffIn, CHUNK, inBuffer.content + src_pos, read - src_pos) != 0) {
-                return -1;
-            }
-            cStream.avail_in = read - src_pos;
-            src_pos += read - src_pos;
-        } else {
-            (void)memset_s(buffIn, CHUNK, 0, CHUNK);
-            if (memmove_s(buffIn, CHUNK, inBuffer.content + src_pos, toRead) != 0) {
-                return -1;
-            }
-            src_pos += toRead;
-            cStream.avail_in = toRead;
-        }
-        flush = flag ? Z_FINISH : Z_NO_FLUSH;
-        cStream.next_in = reinterpret_cast<Bytef*>(buffIn);
-        /* run deflate() on input until output buffer not full, finish
-           compression if all of source has been read in */
-        do {
-            cStream.avail_out = CHUNK;
-            cStream.next_out = reinterpret_cast<Bytef*>(buffOut);
-            if (deflate(&cStream, flush) == Z_STREAM_ERROR) {
-                return -1;
-            }
-            unsigned have = CHUNK - cStream.avail_out;
-            if (memmove_s(zdata + dst_pos, zdlen - dst_pos, buffOut, have) != 0) {
-                return -1;
-            }
-            dst_pos += have;
-            if (unlikely(zdlen < dst_pos)) { // zdataBuf is not long enough, shoudn't happen
-                return -1;
-            }
-        } while (cStream.avail_out == 0);
-    } while (flush != Z_FINISH);
-    /* clean up and return */
-    (void)deflateEnd(&cStream);
-    if (memcpy_s(compressedBuffer.content + compressedBuffer.offset,
-        MAX_PERSISTER_BUFFER_SIZE - compressedBuffer.offset, zdata, dst_pos) != 0) {
+    cStream.next_in = (inBuffer == nullptr) ? Z_NULL :
+        reinterpret_cast<Bytef*>(const_cast<char*>(inBuffer->content));
+    cStream.avail_in = (inBuffer == nullptr) ? 0 : inBuffer->offset;
+    cStream.next_out = reinterpret_cast<Bytef*>(compressedBuffer.content + compressedBuffer.offset);
+    cStream.avail_out = MAX_PERSISTER_BUFFER_SIZE - compressedBuffer.offset;
+    int ret = deflate(&cStream, flush);
+    compressedBuffer.offset = MAX_PERSISTER_BUFFER_SIZE - cStream.avail_out;
+    // Output is complete only if deflate didn't run out of room
+    bool done = (flush == Z_FINISH) ? (ret == Z_STREAM_END) : (ret == Z_OK && cStream.avail_out != 0);
+    if (!done || cStream.avail_in != 0) {
+        (void)deflateReset(&cStream);
+        m_streaming = false;
         return -1;
     }
-    compressedBuffer.offset += dst_pos;
     return 0;
 }
 
-int ZstdCompress::Compress(const LogPersisterBuffer &inBuffer, LogPersisterBuffer &compressedBuffer)
+int ZlibCompress::Compress(const LogPersisterBuffer &inBuffer, LogPersisterBuffer &compressedBuffer)
 {
+    if (inBuffer.offset == 0) {
+        return 0;
+    }
+    m_streaming = true;
+    return Deflate(&inBuffer, compressedBuffer, Z_SYNC_FLUSH);
+}
+
+int ZlibCompress::Finish(LogPersisterBuffer &compressedBuffer)
+{
+    if (!m_streaming) {
+        return 0;
+    }
+    int ret = Deflate(nullptr, compressedBuffer, Z_FINISH);
+    m_streaming = false;
+    if (ret == 0) {
+        (void)deflateReset(&cStream);
+    }
+    return ret;
+}
+
+std::vector<char> LoadZstdDictionary(const char *path)
+{
+    std::vector<char> dictionary;
 #ifdef USING_ZSTD_COMPRESS
-    uint32_t zdlen = ZSTD_CStreamOutSize();
-    std::vector<char> zdataBuf(zdlen, 0);
-    char* zdata = zdataBuf.data();
-    if (zdata == nullptr) {
-        std::cerr << "no enough memory!\n";
-        return -1;
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        return dictionary;
     }
-    ZSTD_EndDirective mode;
-    int compressionlevel = 1;
+    std::streamoff size = file.tellg();
+    if (size <= 0 || size > static_cast<std::streamoff>(MAX_ZSTD_DICTIONARY_SIZE)) {
+        std::cerr << "Invalid zstd dictionary size: " << size << "\n";
+        return dictionary;
+    }
+    dictionary.resize(static_cast<size_t>(size));
+    file.seekg(0);
+    if (!file.read(dictionary.data(), size)) {
+        std::cerr << "Failed to read zstd dictionary " << path << "\n";
+        dictionary.clear();
+    }
+#endif
+    return dictionary;
+}
+
+ZstdCompress::ZstdCompress(int level, const std::vector<char> &dictionary)
+{
+#ifdef USING_ZSTD_COMPRESS
     cctx = ZSTD_createCCtx();
     if (cctx == nullptr) {
         std::cerr << "ZSTD_createCCtx() failed!\n";
+        return;
+    }
+    ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel, level);
+    // 1 : write dictionary ID into frame headers, decompressors pick the dictionary by it
+    ZSTD_CCtx_setParameter(cctx, ZSTD_c_dictIDFlag, 1);
+    if (dictionary.empty()) {
+        return;
+    }
+    if (ZSTD_isError(ZSTD_CCtx_loadDictionary(cctx, dictionary.data(), dictionary.size()))) {
+        std::cerr << "ZSTD_CCtx_loadDictionary() failed!\n";
+        return;
+    }
+    m_dictId = ZSTD_getDictID_fromDict(dictionary.data(), dictionary.size());
+#endif
+}
+
+ZstdCompress::~ZstdCompress()
+{
+#ifdef USING_ZSTD_COMPRESS
+    ZSTD_freeCCtx(cctx);
+#endif
+}
+
+#ifdef USING_ZSTD_COMPRESS
+int ZstdCompress::CompressStream(const LogPersisterBuffer *inBuffer, LogPersisterBuffer &compressedBuffer,
+    ZSTD_EndDirective mode)
+{
+    if (cctx == nullptr || compressedBuffer.offset > MAX_PERSISTER_BUFFER_SIZE) {
         return -1;
     }
-    ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel, compressionlevel);
-    size_t const toRead = CHUNK;
-    auto src_pos = 0;
-    auto dst_pos = 0;
-    size_t read = inBuffer.offset;
-    ZSTD_inBuffer input;
+    ZSTD_inBuffer input = {nullptr, 0, 0};
+    if (inBuffer != nullptr) {
+        input = {inBuffer->content, inBuffer->offset, 0};
+    }
+    ZSTD_outBuffer output = {compressedBuffer.content + compressedBuffer.offset,
+        MAX_PERSISTER_BUFFER_SIZE - compressedBuffer.offset, 0};
+    size_t remaining = 0;
     do {
-        bool flag = read - src_pos < toRead;
-        if (flag) {
-            (void)memset_s(buffIn, CHUNK, 0, CHUNK);
-            if (memmove_s(buffIn, CHUNK, inBuffer.content + src_pos, read - src_pos) != 0) {
-                return -1;
-            }
-            input = {buffIn, read - src_pos, 0};
-            src_pos += read - src_pos;
-        } else {
-            (void)memset_s(buffIn, CHUNK, 0, CHUNK);
-            if (memmove_s(buffIn, CHUNK, inBuffer.content + src_pos, toRead) != 0) {
-                return -1;
-            }
-            input = {buffIn, toRead, 0};
-            src_pos += toRead;
-        }
-        mode = flag ? ZSTD_e_end : ZSTD_e_continue;
-        int finished;
-        do {
-            ZSTD_outBuffer output = {buffOut, CHUNK, 0};
-            size_t const remaining = ZSTD_compressStream2(cctx, &output, &input, mode);
-            if (memmove_s(zdata + dst_pos, zdlen, reinterpret_cast<Bytef*>(buffOut), output.pos) != 0) {
-                return -1;
-            }
-            dst_pos += output.pos;
-            finished = flag ? (remaining == 0) : (input.pos == input.size);
-        } while (!finished);
-    } while (mode != ZSTD_e_end);
-    ZSTD_freeCCtx(cctx);
-    if (memcpy_s(compressedBuffer.content + compressedBuffer.offset,
-        MAX_PERSISTER_BUFFER_SIZE - compressedBuffer.offset, zdata, dst_pos) != 0) {
+        remaining = ZSTD_compressStream2(cctx, &output, &input, mode);
+    } while (!ZSTD_isError(remaining) && remaining != 0 && output.pos < output.size);
+    compressedBuffer.offset += output.pos;
+    if (ZSTD_isError(remaining) || remaining != 0 || input.pos != input.size) {
+        // Parameters and dictionary stay, the next frame starts from scratch
+        ZSTD_CCtx_reset(cctx, ZSTD_reset_session_only);
+        m_streaming = false;
         return -1;
     }
-    compressedBuffer.offset += dst_pos;
+    return 0;
+}
+#endif // #ifdef USING_ZSTD_COMPRESS
+
+int ZstdCompress::Compress(const LogPersisterBuffer &inBuffer, LogPersisterBuffer &compressedBuffer)
+{
+#ifdef USING_ZSTD_COMPRESS
+    if (inBuffer.offset == 0) {
+        return 0;
+    }
+    m_streaming = true;
+    return CompressStream(&inBuffer, compressedBuffer, ZSTD_e_flush);
+#else
+    return 0;
 #endif // #ifdef USING_ZSTD_COMPRESS
+}
+
+int ZstdCompress::Finish(LogPersisterBuffer &compressedBuffer)
+{
+#ifdef USING_ZSTD_COMPRESS
+    if (!m_streaming) {
+        return 0;
+    }
+    int ret = CompressStream(nullptr, compressedBuffer, ZSTD_e_end);
+    m_streaming = false;
+    return ret;
+#else
     return 0;
+#endif // #ifdef USING_ZSTD_COMPRESS
 }
 } // namespace HiviewDFX
 } // namespace OHOS
@@ -0,0 +1,280 @@
+/*
+ * Copyright (c) 2022 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+#include "log_filter.h"
+
+namespace OHOS {
+namespace HiviewDFX {
+static constexpr uint32_t DOMAIN_STRICT_MASK = 0xd000000;
+static constexpr uint32_t DOMAIN_FUZZY_MASK = 0xdffff;
+static constexpr uint32_t DOMAIN_MODULE_BITS = 8;
+static constexpr size_t MAX_CONTENT_REGEX_INSTS = 512;
+static constexpr size_t MAX_CONTENT_REGEX_STATES = 64; // 64 : 64KB of transitions for every query
+
+// Length of the escape sequence starting with the backslash at pos
+static size_t EscapeLen(const std::string& pattern, size_t pos)
+{
+    static constexpr size_t controlLen = 3; // 3 : \cX
+    static constexpr size_t hexLen = 4; // 4 : \xHH
+    static constexpr size_t unicodeLen = 6; // 6 : \uHHHH
+    size_t len = 2; // 2 : backslash and the escaped character
+    if (pos + 1 < pattern.size()) {
+        switch (pattern[pos + 1]) {
+            case 'c':
+                len = controlLen;
+                break;
+            case 'x':
+                len = hexLen;
+                break;
+            case 'u':
+                len = unicodeLen;
+                break;
+            default: // back reference
+                if (isdigit(static_cast<unsigned char>(pattern[pos + 1]))) {
+                    while (pos + len < pattern.size() && isdigit(static_cast<unsigned char>(pattern[pos + len]))) {
+                        len++;
+                    }
+                }
+                break;
+        }
+    }
+    return std::min(len, pattern.size() - pos);
+}
+
+// Skips a bracket expression or a group starting at pos, returns position of its end
+static size_t SkipNested(const std::string& pattern, size_t pos)
+{
+    int depth = 0;
+    bool inClass = false;
+    for (size_t i = pos; i < pattern.size(); i++) {
+        char c = pattern[i];
+        if (c == '\\') {
+            i += EscapeLen(pattern, i) - 1;
+        } else if (inClass) {
+            inClass = (c != ']');
+        } else if (c == '[') {
+            inClass = true; // unlike POSIX, "[]" is an empty class
+        } else if (c == '(') {
+            depth++;
+        } else if (c == ')') {
+            depth--;
+        }
+        if (!inClass && depth <= 0) {
+            return i;
+        }
+    }
+    return pattern.size();
+}
+
+// Longest text every match of the ECMAScript pattern contains, isLiteral if the pattern is that text only
+static std::string RequiredLiteral(const std::string& pattern, bool& isLiteral)
+{
+    std::string best;
+    std::string run;
+    auto endRun = [&best, &run]() {
+        if (run.size() > best.size()) {
+            best = run;
+        }
+        run.clear();
+    };
+    isLiteral = true;
+    for (size_t i = 0; i < pattern.size(); i++) {
+        char c = pattern[i];
+        switch (c) {
+            case '|': // alternatives have nothing in common
+                isLiteral = false;
+                return {};
+            case '*':
+            case '?':
+            case '{': // preceding character may be missing
+                isLiteral = false;
+                if (!run.empty()) {
+                    run.pop_back();
+                }
+                endRun();
+                if (c == '{') {
+                    size_t close = pattern.find('}', i);
+                    i = (close == std::string::npos) ? pattern.size() : close;
+                }
+                break;
+            case '+':
+                isLiteral = false;
+                endRun();
+                break;
+            case '\\':
+                // Escaped punctuation is the character itself, anything else is a class or an assertion
+                if (i + 1 < pattern.size() && ispunct(static_cast<unsigned char>(pattern[i + 1]))) {
+                    run += pattern[++i];
+                } else {
+                    isLiteral = false;
+                    endRun();
+                    i += EscapeLen(pattern, i) - 1;
+                }
+                break;
+            case '[':
+            case '(':
+                isLiteral = false;
+                endRun();
+                i = SkipNested(pattern, i);
+                break;
+            case '.':
+            case '^':
+            case '$':
+            case ')':
+                isLiteral = false;
+                endRun();
+                break;
+            default:
+                run += c;
+                break;
+        }
+    }
+    endRun();
+    return best;
+}
+
+CompiledLogFilter::CompiledLogFilter(const LogFilterExt& filter, LogTagTable& tagTable)
+{
+    CompileRules(filter.inclusions, tagTable, m_inclusions);
+    CompileRules(filter.exclusions, tagTable, m_exclusions);
+    CompileContent(filter.content);
+}
+
+void CompiledLogFilter::CompileContent(const std::string& pattern)
+{
+    if (pattern.empty()) {
+        return;
+    }
+    // Bounded per log line, Query() runs it under the buffer lock
+    auto regex = std::make_shared<LogRegex>(pattern, MAX_CONTENT_REGEX_INSTS, MAX_CONTENT_REGEX_STATES);
+    if (!regex->IsValid()) {
+        return;
+    }
+    bool isLiteral = false;
+    m_contentLiteral = RequiredLiteral(pattern, isLiteral);
+    if (!isLiteral) {
+        m_contentRegex = std::move(regex);
+    }
+    m_hasContent = true;
+}
+
+void CompiledLogFilter::CompileRules(const LogFilter& filter, LogTagTable& tagTable, Rules& rules)
+{
+    rules.types = filter.types;
+    rules.levels = filter.levels;
+
+    rules.pids = filter.pids;
+    std::sort(rules.pids.begin(), rules.pids.end());
+
+    /* domain patterns:
+     * strict mode: 0xdxxxxxx   (full)
+     * fuzzy mode: 0xdxxxx      (using last 2 digits of full domain as mask)
+     * anything else never matches
+     */
+    for (uint32_t domain : filter.domains) {
+        if (domain >= DOMAIN_STRICT_MASK) {
+            rules.strictDomains.push_back(domain);
+        } else if (domain <= DOMAIN_FUZZY_MASK) {
+            rules.fuzzyDomains.push_back(domain);
+        }
+    }
+    std::sort(rules.strictDomains.begin(), rules.strictDomains.end());
+    std::sort(rules.fuzzyDomains.begin(), rules.fuzzyDomains.end());
+    rules.hasDomains = !filter.domains.empty();
+
+    // Tags not logged yet are interned too, so their records get the same ids later
+    for (const std::string& tag : filter.tags) {
+        LogTagTable::TagId id = (tag.size() < MAX_TAG_LEN) ? tagTable.Intern(tag.c_str(), tag.size()) :
+            LogTagTable::INVALID_TAG_ID;
+        rules.tags.emplace_back(id, tag);
+    }
+    std::sort(rules.tags.begin(), rules.tags.end());
+}
+
+bool CompiledLogFilter::MatchDomain(const Rules& rules, uint32_t domain)
+{
+    return std::binary_search(rules.strictDomains.begin(), rules.strictDomains.end(), domain) ||
+        std::binary_search(rules.fuzzyDomains.begin(), rules.fuzzyDomains.end(), domain >> DOMAIN_MODULE_BITS);
+}
+
+bool CompiledLogFilter::MatchTag(const Rules& rules, const char* tag, LogTagTable::TagId tagId)
+{
+    if (tagId != LogTagTable::INVALID_TAG_ID) {
+        auto it = std::lower_bound(rules.tags.begin(), rules.tags.end(), tagId,
+            [](const std::pair<LogTagTable::TagId, std::string>& entry, LogTagTable::TagId id) {
+                return entry.first < id;
+            });
+        return it != rules.tags.end() && it->first == tagId;
+    }
+    return std::any_of(rules.tags.begin(), rules.tags.end(),
+        [tag](const std::pair<LogTagTable::TagId, std::string>& entry) { return entry.second == tag; });
+}
+
+bool CompiledLogFilter::Match(const HilogData& logData, LogTagTable::TagId tagId) const
+{
+    const uint16_t typeBit = static_cast<uint16_t>(0b01 << logData.type);
+    const uint16_t levelBit = static_cast<uint16_t>(0b01 << logData.level);
+
+    // inclusions
+    if ((typeBit & m_inclusions.types) == 0 || (levelBit & m_inclusions.levels) == 0) {
+        return false;
+    }
+    if (!m_inclusions.pids.empty() &&
+        !std::binary_search(m_inclusions.pids.begin(), m_inclusions.pids.end(), logData.pid)) {
+        return false;
+    }
+    if (m_inclusions.hasDomains && !MatchDomain(m_inclusions, logData.domain)) {
+        return false;
+    }
+    if (!m_inclusions.tags.empty() && !MatchTag(m_inclusions, logData.tag, tagId)) {
+        return false;
+    }
+
+    // exclusions
+    if ((typeBit & m_exclusions.types) != 0 || (levelBit & m_exclusions.levels) != 0) {
+        return false;
+    }
+    if (!m_exclusions.pids.empty() &&
+        std::binary_search(m_exclusions.pids.begin(), m_exclusions.pids.end(), logData.pid)) {
+        return false;
+    }
+    if (m_exclusions.hasDomains && MatchDomain(m_exclusions, logData.domain)) {
+        return false;
+    }
+    if (!m_exclusions.tags.empty() && MatchTag(m_exclusions, logData.tag, tagId)) {
+        return false;
+    }
+    return true;
+}
+
+bool CompiledLogFilter::MatchContent(const HilogData& logData) const
+{
+    if (!m_hasContent) {
+        return true;
+    }
+    const char* content = logData.content;
+    size_t len = (logData.len > logData.tag_len) ? strnlen(content, logData.len - logData.tag_len) : 0;
+    if (!m_contentLiteral.empty() &&
+        memmem(content, len, m_contentLiteral.data(), m_contentLiteral.size()) == nullptr) {
+        return false;
+    }
+    return !m_contentRegex || m_contentRegex->Search(content, len);
+}
+} // namespace HiviewDFX
+} // namespace OHOS
@@ -0,0 +1,184 @@
+/*
+ * Copyright (c) 2022 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "log_format_registry.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cinttypes>
+#include <csignal>
+#include <cstring>
+#include <securec.h>
+
+namespace OHOS {
+namespace HiviewDFX {
+using namespace std;
+
+/* Formats of live processes are kept beyond these, they bound the formats of exited ones */
+static constexpr size_t MAX_FORMATS = 8192;
+static constexpr size_t MAX_FORMAT_BYTES = 1UL << 20; /* 1MB for format strings and their pieces */
+static constexpr size_t RECLAIM_SLACK_DIVISOR = 8; /* 8 : grow by an eighth before looking for exited ones again */
+static constexpr uint64_t NO_SESSION = 0; /* sessions start with a pid, which is never 0 */
+
+static bool IsProcessAlive(uint32_t pid)
+{
+    // No permission to signal means the process exists
+    return kill(static_cast<pid_t>(pid), 0) == 0 || errno != ESRCH;
+}
+
+LogFormatRegistry::LogFormatRegistry() : LogFormatRegistry(IsProcessAlive) {}
+
+LogFormatRegistry::LogFormatRegistry(AliveChecker isAlive)
+    : m_isAlive(isAlive), m_reclaimCount(MAX_FORMATS), m_reclaimBytes(MAX_FORMAT_BYTES)
+{
+}
+
+bool LogFormatRegistry::Register(const HilogMsg& msg)
+{
+    size_t contentLen = CONTENT_LEN((&msg));
+    const char* content = CONTENT_PTR((&msg));
+    HilogBinaryHeader header;
+    if (contentLen <= sizeof(header) || content[contentLen - 1] != '\0' ||
+        !DecodeBinaryHeader(content, contentLen, header)) {
+        return false;
+    }
+    // Registrations skip flow control, a process can't register for another one or take the whole registry
+    if ((header.session >> BINARY_SESSION_PID_SHIFT) != msg.pid) {
+        return false;
+    }
+    Key key(msg.pid, static_cast<uint64_t>(header.session), static_cast<uint16_t>(header.formatIndex));
+    Format format;
+    format.fmt.assign(content + sizeof(header), strnlen(content + sizeof(header), contentLen - sizeof(header)));
+    auto registered = m_formats.find(key);
+    if (registered != m_formats.end()) {
+        // Sent again by a process which couldn't tell whether we got it, an index never changes its format
+        return registered->second.fmt == format.fmt;
+    }
+
+    // Formats come from other processes, parse them again instead of trusting anything but the text
+    size_t pos = 0;
+    HiLogFmtPiece piece;
+    HiLogFormat::ParseResult result = HiLogFormat::ParseResult::END;
+    while ((result = HiLogFormat::NextPiece(format.fmt.c_str(), pos, piece)) == HiLogFormat::ParseResult::PIECE) {
+        format.pieces.push_back(piece);
+    }
+    if (result == HiLogFormat::ParseResult::UNSUPPORTED) {
+        return false;
+    }
+
+    size_t bytes = BinaryFormatBytes(format.fmt.size(), format.pieces.size());
+    uint32_t pid = msg.pid;
+    auto isFull = [this, pid, bytes]() {
+        auto usage = m_usageByPid.find(pid);
+        return usage != m_usageByPid.end() && (usage->second.count >= BINARY_MAX_FORMATS_PER_PID ||
+            usage->second.bytes + bytes > BINARY_MAX_FORMAT_BYTES_PER_PID);
+    };
+    if (isFull()) {
+        // Only one process owns a pid, formats of an older session belong to a process which is gone
+        DropFormats(pid, header.session);
+        if (isFull()) {
+            return false;
+        }
+    }
+    m_formats.emplace(key, std::move(format));
+    PidUsage& usage = m_usageByPid[pid];
+    usage.count++;
+    usage.bytes += bytes;
+    m_bytes += bytes;
+    if (m_formats.size() > m_reclaimCount || m_bytes > m_reclaimBytes) {
+        ReclaimExited();
+    }
+    return true;
+}
+
+void LogFormatRegistry::DropFormats(uint32_t pid, uint64_t keptSession)
+{
+    auto usage = m_usageByPid.find(pid);
+    if (usage == m_usageByPid.end()) {
+        return;
+    }
+    auto it = m_formats.lower_bound(Key(pid, 0, 0));
+    while (it != m_formats.end() && std::get<0>(it->first) == pid) {
+        if (std::get<1>(it->first) == keptSession) {
+            ++it;
+            continue;
+        }
+        size_t bytes = BinaryFormatBytes(it->second.fmt.size(), it->second.pieces.size());
+        usage->second.count--;
+        usage->second.bytes -= bytes;
+        m_bytes -= bytes;
+        it = m_formats.erase(it);
+    }
+    if (usage->second.count == 0) {
+        m_usageByPid.erase(usage);
+    }
+}
+
+void LogFormatRegistry::ReclaimExited()
+{
+    vector<uint32_t> exited;
+    for (const auto& usage : m_usageByPid) {
+        if (!m_isAlive(usage.first)) {
+            exited.push_back(usage.first);
+        }
+    }
+    for (uint32_t pid : exited) {
+        DropFormats(pid, NO_SESSION);
+    }
+    // Live processes may keep the registry above the limits, don't look at every registration then
+    m_reclaimCount = max(MAX_FORMATS, m_formats.size() + m_formats.size() / RECLAIM_SLACK_DIVISOR);
+    m_reclaimBytes = max(MAX_FORMAT_BYTES, m_bytes + m_bytes / RECLAIM_SLACK_DIVISOR);
+}
+
+void LogFormatRegistry::Render(const HilogData& data, char* buf, size_t bufLen, HilogData& text) const
+{
+    text = data;
+    text.version = HILOG_MSG_VERSION_TEXT;
+    text.tag = buf;
+    if (bufLen <= data.tag_len || memcpy_s(buf, bufLen, data.tag, data.tag_len) != EOK) {
+        text.tag_len = 0;
+        text.len = 0;
+        text.content = buf;
+        buf[0] = '\0';
+        return;
+    }
+    char* textBuf = buf + data.tag_len;
+    size_t textBufLen = bufLen - data.tag_len;
+    size_t contentLen = data.len - data.tag_len;
+    text.content = textBuf;
+
+    HilogBinaryHeader header;
+    HiLogFmtArg args[MAX_BINARY_ARGS];
+    bool masked[MAX_BINARY_ARGS] = {false};
+    int len = -1;
+    if (DecodeBinaryHeader(data.content, contentLen, header)) {
+        Key key(data.pid, static_cast<uint64_t>(header.session), static_cast<uint16_t>(header.formatIndex));
+        auto it = m_formats.find(key);
+        if (it == m_formats.end()) {
+            len = snprintf_s(textBuf, textBufLen, textBufLen - 1, "<binary log, format %" PRIx64 ":%u is unknown>",
+                header.session, header.formatIndex);
+        } else if (DecodeBinaryArgs(data.content, contentLen, it->second.pieces.data(), it->second.pieces.size(),
+            args, masked)) {
+            len = FormatPieces(textBuf, textBufLen, it->second.fmt.c_str(), it->second.pieces.data(),
+                it->second.pieces.size(), args, false, masked);
+        }
+    }
+    if (len < 0) {
+        len = snprintf_s(textBuf, textBufLen, textBufLen - 1, "<malformed binary log>");
+    }
+    text.len = data.tag_len + ((len > 0) ? len : 0) + 1;
+}
+} // namespace HiviewDFX
+} // namespace OHOS
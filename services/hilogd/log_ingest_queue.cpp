@@ -0,0 +1,262 @@
+/*
+ * Copyright (c) 2022 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <ctime>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <sys/prctl.h>
+
+#include <securec.h>
+
+#include "log_ingest_queue.h"
+
+namespace OHOS {
+namespace HiviewDFX {
+static constexpr size_t QUEUE_SLOTS = 256; /* must be power of 2, 256 : about 280KB of slots */
+static constexpr size_t QUEUE_MASK = QUEUE_SLOTS - 1;
+static constexpr size_t COMMIT_BATCH_SIZE = 128;
+static constexpr uint32_t DROP_KEY_TYPE_SHIFT = 32;
+
+LogIngestQueue::LogIngestQueue(HilogBuffer& buffer)
+    : m_hilogBuffer(buffer), m_enqueuePos(0), m_dropped(0), m_hasUnreported(false), m_consumerWaiting(false),
+    m_producersWaiting(0), m_stop(false)
+{
+    // Slot data isn't zero-filled, it is written before it is published
+    m_slots.reset(new Slot[QUEUE_SLOTS]);
+    for (size_t i = 0; i < QUEUE_SLOTS; i++) {
+        m_slots[i].seq.store(i, std::memory_order_relaxed);
+    }
+}
+
+LogIngestQueue::~LogIngestQueue()
+{
+    Stop();
+}
+
+void LogIngestQueue::Start()
+{
+    if (m_commitThread.joinable()) {
+        return;
+    }
+    m_stop.store(false);
+    m_commitThread = std::thread(&LogIngestQueue::CommitLoop, this);
+}
+
+void LogIngestQueue::Stop()
+{
+    m_stop.store(true);
+    {
+        std::lock_guard<decltype(m_wakeMtx)> lock(m_wakeMtx);
+        m_wakeCv.notify_one();
+    }
+    {
+        std::lock_guard<decltype(m_spaceMtx)> lock(m_spaceMtx);
+        m_spaceCv.notify_all();
+    }
+    if (m_commitThread.joinable()) {
+        m_commitThread.join();
+    }
+}
+
+bool LogIngestQueue::Post(const HilogMsg& msg)
+{
+    if (unlikely(msg.len < sizeof(HilogMsg) || msg.len > SLOT_DATA_SIZE)) {
+        return false;
+    }
+
+    // Claim a free slot, see D. Vyukov's bounded MPMC queue
+    Slot* slot = nullptr;
+    uint64_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+    while (true) {
+        slot = &m_slots[pos & QUEUE_MASK];
+        uint64_t seq = slot->seq.load(std::memory_order_acquire);
+        int64_t diff = static_cast<int64_t>(seq) - static_cast<int64_t>(pos);
+        if (diff == 0) {
+            if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            if (m_stop.load()) {
+                CountDropped(msg);
+                return false;
+            }
+            // Commit thread is behind, what isn't received yet waits in the socket buffer meanwhile
+            WaitForSpace(pos);
+            pos = m_enqueuePos.load(std::memory_order_relaxed);
+        } else {
+            pos = m_enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    if (memcpy_s(slot->data, sizeof(slot->data), &msg, msg.len) != 0) {
+        // Slot is claimed already and must be published, commit thread skips the empty message
+        reinterpret_cast<HilogMsg*>(slot->data)->len = 0;
+    }
+    slot->seq.store(pos + 1, std::memory_order_release);
+    WakeUp();
+    return true;
+}
+
+void LogIngestQueue::CountDropped(const HilogMsg& msg)
+{
+    m_dropped.fetch_add(1, std::memory_order_relaxed);
+    if (msg.type >= LOG_TYPE_MAX) {
+        return;
+    }
+    uint64_t key = (static_cast<uint64_t>(msg.type) << DROP_KEY_TYPE_SHIFT) | msg.domain;
+    std::lock_guard<decltype(m_dropMtx)> lock(m_dropMtx);
+    DropInfo& info = m_unreported[key];
+    info.count++;
+    info.level = msg.level;
+    info.pid = msg.pid;
+    info.tid = msg.tid;
+    m_hasUnreported.store(true, std::memory_order_relaxed);
+}
+
+void LogIngestQueue::ReportDropped()
+{
+    std::map<uint64_t, DropInfo> unreported;
+    {
+        std::lock_guard<decltype(m_dropMtx)> lock(m_dropMtx);
+        unreported.swap(m_unreported);
+        m_hasUnreported.store(false, std::memory_order_relaxed);
+    }
+    constexpr auto tag = std::string_view("LOGLIMITD");
+    struct timespec ts = {0};
+    (void)clock_gettime(CLOCK_REALTIME, &ts);
+    for (const auto& [key, info] : unreported) {
+        std::string dropLog = std::to_string(info.count) + " line(s) dropped, hilogd is busy!";
+        std::vector<char> buffer(sizeof(HilogMsg) + tag.size() + 1 + dropLog.size() + 1, '\0');
+        HilogMsg* dropMsg = reinterpret_cast<HilogMsg*>(buffer.data());
+        dropMsg->len = buffer.size();
+        dropMsg->version = HILOG_MSG_VERSION_TEXT;
+        dropMsg->type = static_cast<uint16_t>(key >> DROP_KEY_TYPE_SHIFT);
+        dropMsg->level = info.level;
+        dropMsg->tag_len = tag.size() + 1;
+        dropMsg->tv_sec = static_cast<uint32_t>(ts.tv_sec);
+        dropMsg->tv_nsec = static_cast<uint32_t>(ts.tv_nsec);
+        dropMsg->pid = info.pid;
+        dropMsg->tid = info.tid;
+        dropMsg->domain = static_cast<uint32_t>(key);
+        if (memcpy_s(dropMsg->tag, buffer.size() - sizeof(HilogMsg), tag.data(), tag.size()) != 0 ||
+            memcpy_s(dropMsg->tag + dropMsg->tag_len, dropLog.size() + 1, dropLog.c_str(), dropLog.size()) != 0) {
+            std::cerr << "Can't copy drop info of ingest queue\n";
+            continue;
+        }
+        (void)m_hilogBuffer.Insert(*dropMsg);
+        m_hilogBuffer.CountDropped(dropMsg->type, dropMsg->domain, info.count);
+    }
+}
+
+void LogIngestQueue::WakeUp()
+{
+    // Pairs with the fence in WaitForData(), either the consumer sees the new slot
+    // or we see it is going to sleep
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_consumerWaiting.load(std::memory_order_relaxed)) {
+        std::lock_guard<decltype(m_wakeMtx)> lock(m_wakeMtx);
+        m_wakeCv.notify_one();
+    }
+}
+
+void LogIngestQueue::WaitForSpace(uint64_t pos)
+{
+    std::unique_lock<decltype(m_spaceMtx)> lock(m_spaceMtx);
+    m_producersWaiting.fetch_add(1, std::memory_order_relaxed);
+    // Pairs with the fence in WakeUpProducers()
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const Slot& slot = m_slots[pos & QUEUE_MASK];
+    if (static_cast<int64_t>(slot.seq.load(std::memory_order_acquire)) < static_cast<int64_t>(pos) &&
+        !m_stop.load()) {
+        m_spaceCv.wait(lock);
+    }
+    m_producersWaiting.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void LogIngestQueue::WakeUpProducers()
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_producersWaiting.load(std::memory_order_relaxed) != 0) {
+        std::lock_guard<decltype(m_spaceMtx)> lock(m_spaceMtx);
+        m_spaceCv.notify_all();
+    }
+}
+
+void LogIngestQueue::WaitForData()
+{
+    std::unique_lock<decltype(m_wakeMtx)> lock(m_wakeMtx);
+    m_consumerWaiting.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const Slot& slot = m_slots[m_dequeuePos & QUEUE_MASK];
+    if (slot.seq.load(std::memory_order_acquire) != m_dequeuePos + 1 && !m_stop.load()) {
+        m_wakeCv.wait(lock);
+    }
+    m_consumerWaiting.store(false, std::memory_order_relaxed);
+}
+
+size_t LogIngestQueue::CollectReady(const HilogMsg* batch[], size_t& batchSize)
+{
+    batchSize = 0;
+    for (size_t i = 0; i < COMMIT_BATCH_SIZE; i++) {
+        uint64_t pos = m_dequeuePos + i;
+        Slot& slot = m_slots[pos & QUEUE_MASK];
+        if (slot.seq.load(std::memory_order_acquire) != pos + 1) {
+            return i;
+        }
+        const HilogMsg* msg = reinterpret_cast<const HilogMsg*>(slot.data);
+        if (msg->len != 0) {
+            batch[batchSize++] = msg;
+        }
+    }
+    return COMMIT_BATCH_SIZE;
+}
+
+void LogIngestQueue::Release(size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        uint64_t pos = m_dequeuePos + i;
+        m_slots[pos & QUEUE_MASK].seq.store(pos + QUEUE_SLOTS, std::memory_order_release);
+    }
+    m_dequeuePos += count;
+    WakeUpProducers();
+}
+
+void LogIngestQueue::CommitLoop()
+{
+    prctl(PR_SET_NAME, "hilogd.commit");
+    const HilogMsg* batch[COMMIT_BATCH_SIZE];
+    while (true) {
+        size_t batchSize = 0;
+        size_t count = CollectReady(batch, batchSize);
+        if (count == 0) {
+            if (m_stop.load()) {
+                break;
+            }
+            WaitForData();
+            continue;
+        }
+        if (batchSize > 0) {
+            (void)m_hilogBuffer.Insert(batch, batchSize);
+        }
+        Release(count);
+        if (m_hasUnreported.load(std::memory_order_relaxed)) {
+            ReportDropped();
+        }
+    }
+}
+} // namespace HiviewDFX
+} // namespace OHOS
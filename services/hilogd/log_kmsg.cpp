@@ -36,18 +36,15 @@ using namespace std;
 
 ssize_t LogKmsg::LinuxReadOneKmsg(KmsgParser& parser)
 {
-    std::vector<char> kmsgBuffer(BUFSIZ, '\0');
     ssize_t size = -1;
     do {
-        size = read(kmsgCtl, kmsgBuffer.data(), BUFSIZ - 1);
+        size = read(kmsgCtl, kmsgBuffer.data(), kmsgBuffer.size() - 1);
     } while (size < 0 && errno == EPIPE);
     if (size > 0) {
-        std::optional<HilogMsgWrapper> msgWrap = parser.ParseKmsg(kmsgBuffer);
-        if (msgWrap.has_value()) {
-            size_t result = hilogBuffer.Insert(msgWrap->GetHilogMsg());
-            if (result <= 0) {
-                return result;
-            }
+        kmsgBuffer[size] = '\0';
+        const HilogMsg* msg = parser.ParseKmsg(kmsgBuffer.data(), static_cast<size_t>(size));
+        if (msg != nullptr && !ingestQueue.Post(*msg)) {
+            return 0;
         }
     }
     return size;
@@ -48,6 +48,12 @@ namespace HiviewDFX {
 static constexpr int DEFAULT_LOG_LEVEL = (1 << LOG_DEBUG) | (1 << LOG_INFO)
     | (1 << LOG_WARN) | (1 << LOG_ERROR) | (1 << LOG_FATAL);
 static constexpr int SLEEP_TIME = 5;
+/* Persisters are woken up for this many new logs, SLEEP_TIME bounds the latency when logs are few */
+static constexpr uint32_t WAKEUP_LINES = 64;
+/* A trained dictionary makes up for the ratio of higher levels at this speed */
+static constexpr int ZSTD_LEVEL = 1;
+// 128 : time, pid, tid, level, domain and the longest tag of a formatted line
+static constexpr size_t MAX_LINE_PREFIX_LEN = 128;
 
 static bool isEmptyThread(const std::thread& th)
 {
@@ -69,7 +75,7 @@ std::shared_ptr<LogPersister> LogPersister::CreateLogPersister(HilogBuffer &buff
 LogPersister::LogPersister(HilogBuffer &buffer) : m_hilogBuffer(buffer)
 {
     m_mappedPlainLogFile = nullptr;
-    m_bufReader = m_hilogBuffer.CreateBufReader([this]() { NotifyNewLogAvailable(); });
+    m_bufReader = m_hilogBuffer.CreateBufReader([this]() { NotifyNewLogAvailable(); }, WAKEUP_LINES);
 }
 
 LogPersister::~LogPersister()
@@ -91,9 +97,12 @@ int LogPersister::InitCompression()
         case COMPRESS_TYPE_ZLIB:
             m_compressor = std::make_unique<ZlibCompress>();
             break;
-        case COMPRESS_TYPE_ZSTD:
-            m_compressor = std::make_unique<ZstdCompress>();
+        case COMPRESS_TYPE_ZSTD: {
+            auto zstdCompressor = std::make_unique<ZstdCompress>(ZSTD_LEVEL, LoadZstdDictionary());
+            m_baseData.dictId = zstdCompressor->GetDictId();
+            m_compressor = std::move(zstdCompressor);
             break;
+        }
         default:
             break;
     }
@@ -132,7 +141,11 @@ int LogPersister::InitFileRotator(const InitData& initData)
     } else if (std::holds_alternative<PersistRecoveryInfo>(initData)) {
         info = std::get<PersistRecoveryInfo>(initData);
         restore = true;
+        if (info.dictId != m_baseData.dictId) {
+            std::cout << "Zstd dictionary changed from " << info.dictId << " to " << m_baseData.dictId << "\n";
+        }
     }
+    info.dictId = m_baseData.dictId;
     return m_fileRotator->Init(info, restore);
 }
 
@@ -154,6 +167,7 @@ int LogPersister::Init(const InitData& initData)
 
         m_filters.inclusions.types = msg.logType;
         m_filters.inclusions.levels = DEFAULT_LOG_LEVEL;
+        m_compiledFilter = m_hilogBuffer.CompileFilter(m_filters);
     };
 
     bool restore = false;
@@ -214,7 +228,7 @@ int LogPersister::Deinit()
 
     Stop();
 
-    munmap(m_mappedPlainLogFile, MAX_PERSISTER_BUFFER_SIZE);
+    munmap(m_mappedPlainLogFile, sizeof(PersisterPlainFile));
     std::cout << "Removing unmapped plain log file: " << m_plainLogFilePath << "\n";
     if (remove(m_plainLogFilePath.c_str())) {
         std::cerr << "File: " << m_plainLogFilePath << " can't be removed. ";
@@ -229,6 +243,7 @@ int LogPersister::Deinit()
 
 int LogPersister::PrepareUncompressedFile(const std::string& parentPath, bool restore)
 {
+    m_unwrittenLogs = std::make_unique<LogPersisterBuffer>();
     std::string fileName = std::string(".") + AUXILLARY_PERSISTER_PREFIX + std::to_string(m_baseData.id);
     m_plainLogFilePath = parentPath + "/" + fileName;
     FILE* plainTextFile = fopen(m_plainLogFilePath.c_str(), restore ? "r+" : "w+");
@@ -239,12 +254,14 @@ int LogPersister::PrepareUncompressedFile(const std::string& parentPath, bool re
         return ERR_LOG_PERSIST_FILE_OPEN_FAIL;
     }
 
-    if (!restore) {
-        ftruncate(fileno(plainTextFile), sizeof(LogPersisterBuffer));
+    // A file of one segment only is left by a version without segments, it restores as segment 0
+    struct stat st = {0};
+    if (!restore || (fstat(fileno(plainTextFile), &st) == 0 && static_cast<size_t>(st.st_size) < sizeof(PersisterPlainFile))) {
+        ftruncate(fileno(plainTextFile), sizeof(PersisterPlainFile));
         fflush(plainTextFile);
         fsync(fileno(plainTextFile));
     }
-    m_mappedPlainLogFile = reinterpret_cast<LogPersisterBuffer*>(mmap(nullptr, sizeof(LogPersisterBuffer),
+    m_mappedPlainLogFile = reinterpret_cast<PersisterPlainFile*>(mmap(nullptr, sizeof(PersisterPlainFile),
         PROT_READ | PROT_WRITE, MAP_SHARED, fileno(plainTextFile), 0));
     if (fclose(plainTextFile)) {
         std::cerr << "File: " << plainTextFile << " can't be closed. ";
@@ -256,18 +273,26 @@ int LogPersister::PrepareUncompressedFile(const std::string& parentPath, bool re
         return RET_FAIL;
     }
     if (restore) {
+        if (m_mappedPlainLogFile->active >= PERSISTER_PLAIN_SEGMENTS) {
+            m_mappedPlainLogFile->active = 0;
+        }
+        // try to store previous uncompressed logs, the active segment is the newest
+        for (uint32_t i = 1; i <= PERSISTER_PLAIN_SEGMENTS; i++) {
+            LogPersisterBuffer& segment =
+                m_mappedPlainLogFile->segments[(m_mappedPlainLogFile->active + i) % PERSISTER_PLAIN_SEGMENTS];
 #ifdef DEBUG
-        std::cout << __PRETTY_FUNCTION__ << " Recovered persister, Offset=" << m_mappedPlainLogFile->offset << "\n";
+            std::cout << __PRETTY_FUNCTION__ << " Recovered persister, Offset=" << segment.offset << "\n";
 #endif
-        // try to store previous uncompressed logs
-        auto compressionResult = m_compressor->Compress(*m_mappedPlainLogFile, *m_compressBuffer);
-        if (compressionResult != 0) {
-            std::cerr << __PRETTY_FUNCTION__ << " Compression error. Result:" << compressionResult << "\n";
-            return RET_FAIL;
+            if (segment.offset > MAX_PERSISTER_BUFFER_SIZE) {
+                segment.offset = 0;
+            }
+            CompressAndWrite(segment);
         }
-        WriteCompressedLogs();
     } else {
-        m_mappedPlainLogFile->offset = 0;
+        for (auto& segment : m_mappedPlainLogFile->segments) {
+            segment.offset = 0;
+        }
+        m_mappedPlainLogFile->active = 0;
     }
     return 0;
 }
@@ -277,118 +302,173 @@ void LogPersister::NotifyNewLogAvailable()
     m_receiveLogCv.notify_one();
 }
 
-std::list<std::string> LogDataToFormatedStrings(const HilogData& logData)
+int FormatLogLines(const HilogData& logData, char *buf, size_t bufLen)
 {
-    std::list<std::string> resultLogLines;
-    std::array<char, MAX_LOG_LEN*2> tempBuffer = {0};
-    HilogShowFormatBuffer showBuffer;
-    showBuffer.level = logData.level;
-    showBuffer.pid = logData.pid;
-    showBuffer.tid = logData.tid;
-    showBuffer.domain = logData.domain;
+    HilogShowFormatBuffer showBuffer = {0};
     showBuffer.tv_sec = logData.tv_sec;
     showBuffer.tv_nsec = logData.tv_nsec;
-
-    std::vector<char> dataCopy(logData.len, 0);
-    if (dataCopy.data() == nullptr) {
-        return resultLogLines;
-    }
-    if (memcpy_s(dataCopy.data(), logData.len, logData.tag, logData.len)) {
-        return resultLogLines;
-    }
-    showBuffer.data = dataCopy.data();
-    // Below code replace 'new line' character with 'zero' to simulate
-    // continuation of very long log message with tag prefix at the begining of every line.
-    // e.g.  "This is very \n long line \n for sure!!!"
-    // This will be changed into:
-    //   <formated meta data> <tag info> This is very
-    //   <formated meta data> <tag info> long line
-    //   <formated meta data> <tag info> for sure!!!
-    size_t newLineOffset = logData.tag_len;
-    char *msgBegin = dataCopy.data() + newLineOffset;
-    char *currenMsgPos = msgBegin;
-    while (*currenMsgPos != 0) {
-        if (*currenMsgPos == '\n') {
-            if (currenMsgPos != msgBegin) {
-                *currenMsgPos = 0;
-                showBuffer.tag_len = newLineOffset;
-                HilogShowBuffer(tempBuffer.data(), tempBuffer.size(), showBuffer, OFF_SHOWFORMAT);
-                resultLogLines.push_back(tempBuffer.data());
-                newLineOffset += currenMsgPos - msgBegin + 1;
-            } else {
-                newLineOffset++;
+    // Prefix is the same for all lines of the log, it's formatted once
+    std::array<char, MAX_LINE_PREFIX_LEN> prefix;
+    int prefixLen = HilogShowTimeBuffer(prefix.data(), prefix.size(), OFF_SHOWFORMAT, showBuffer);
+    int tagLen = (logData.tag_len == 0) ? 0 : static_cast<int>(strnlen(logData.tag, logData.tag_len));
+    int ret = snprintf_s(prefix.data() + prefixLen, prefix.size() - prefixLen, prefix.size() - prefixLen - 1,
+        " %5d %5d %s %05x/%.*s: ", /* PID TID Level Domain/Tag: */
+        logData.pid, logData.tid, LogLevel2ShortStr(logData.level).c_str(),
+        logData.domain & 0xFFFFF, tagLen, logData.tag);
+    if (ret < 0) {
+        return -1;
+    }
+    prefixLen += ret;
+
+    // Every line of a multi-line log gets the prefix, e.g. "This is very \n long line" becomes
+    //   <prefix>This is very
+    //   <prefix> long line
+    size_t contentLen = (logData.len > logData.tag_len) ? (logData.len - logData.tag_len) : 0;
+    const char *pos = logData.content;
+    const char *end = pos + strnlen(pos, contentLen);
+    size_t written = 0;
+    while (pos < end) {
+        const char *lineEnd = static_cast<const char*>(memchr(pos, '\n', end - pos));
+        if (lineEnd == nullptr) {
+            lineEnd = end;
+        }
+        size_t lineLen = static_cast<size_t>(lineEnd - pos);
+        if (lineLen != 0) {
+            if (written + prefixLen + lineLen + 1 > bufLen) { // 1 : new line character
+                return -1;
             }
-            msgBegin = currenMsgPos + 1;
+            if (memcpy_s(buf + written, bufLen - written, prefix.data(), prefixLen) != 0 ||
+                memcpy_s(buf + written + prefixLen, bufLen - written - prefixLen, pos, lineLen) != 0) {
+                return -1;
+            }
+            written += prefixLen + lineLen;
+            buf[written++] = '\n';
         }
-        currenMsgPos++;
+        pos = lineEnd + 1;
+    }
+    return static_cast<int>(written);
+}
+
+int LogPersister::WriteLogData(const HilogData& logData)
+{
+    // Firstly gather uncompressed logs in auxiliary file
+    LogPersisterBuffer& plainSegment = m_mappedPlainLogFile->segments[m_mappedPlainLogFile->active];
+    int len = FormatLogLines(logData, plainSegment.content + plainSegment.offset,
+        MAX_PERSISTER_BUFFER_SIZE - plainSegment.offset);
+    if (len >= 0) {
+        plainSegment.offset += static_cast<uint32_t>(len);
+        return 0;
     }
-    if (currenMsgPos != msgBegin) {
-        showBuffer.tag_len = newLineOffset;
-        HilogShowBuffer(tempBuffer.data(), tempBuffer.size(), showBuffer, OFF_SHOWFORMAT);
-        resultLogLines.push_back(tempBuffer.data());
+    // HilogBuffer is locked now, the full segment is handed over to compression after the query
+    len = FormatLogLines(logData, m_unwrittenLogs->content + m_unwrittenLogs->offset,
+        MAX_PERSISTER_BUFFER_SIZE - m_unwrittenLogs->offset);
+    if (len < 0) {
+        return RET_FAIL;
     }
-    return resultLogLines;
+    m_unwrittenLogs->offset += static_cast<uint32_t>(len);
+    return 0;
 }
 
-bool LogPersister::WriteUncompressedLogs(std::list<std::string>& formatedTextLogs)
+void LogPersister::WriteUnwrittenLogs()
 {
-    while (!formatedTextLogs.empty()) {
-        std::string logLine = formatedTextLogs.front();
-        uint16_t size = logLine.length() + 1; // we want to add new line character
-        uint32_t origOffset = m_mappedPlainLogFile->offset;
-        if (m_mappedPlainLogFile->offset + size > MAX_PERSISTER_BUFFER_SIZE)
-            return false;
+    if (m_unwrittenLogs->offset == 0) {
+        return;
+    }
+    SealActiveSegment();
+    // The active segment is empty now, unwritten logs are never more than a segment
+    LogPersisterBuffer& plainSegment = m_mappedPlainLogFile->segments[m_mappedPlainLogFile->active];
+    if (memcpy_s(plainSegment.content, MAX_PERSISTER_BUFFER_SIZE, m_unwrittenLogs->content,
+        m_unwrittenLogs->offset) != 0) {
+        std::cerr << __PRETTY_FUNCTION__ << " Can't write new log data!\n";
+    } else {
+        plainSegment.offset = m_unwrittenLogs->offset;
+    }
+    m_unwrittenLogs->offset = 0;
+}
 
-        char* currentContentPos = m_mappedPlainLogFile->content + m_mappedPlainLogFile->offset;
-        uint32_t remainingSpace = MAX_PERSISTER_BUFFER_SIZE - m_mappedPlainLogFile->offset;
-        int r = memcpy_s(currentContentPos, remainingSpace, logLine.c_str(), logLine.length());
-        if (r != 0) {
-            std::cerr << __PRETTY_FUNCTION__ << " Can't copy part of memory!\n";
-            m_mappedPlainLogFile->offset = origOffset;
-            return true;
-        }
-        formatedTextLogs.pop_front();
-        m_mappedPlainLogFile->offset += logLine.length();
-        m_mappedPlainLogFile->content[m_mappedPlainLogFile->offset] = '\n';
-        m_mappedPlainLogFile->offset += 1;
+void LogPersister::SealActiveSegment()
+{
+    uint32_t active = m_mappedPlainLogFile->active;
+    if (m_mappedPlainLogFile->segments[active].offset == 0) {
+        return;
     }
-    return true;
+    uint32_t next = (active + 1) % PERSISTER_PLAIN_SEGMENTS;
+    std::unique_lock<decltype(m_outputMtx)> lock(m_outputMtx);
+    // Only waits when output is a whole segment behind
+    m_outputCv.wait(lock, [this, next]() { return !m_segmentSealed[next]; });
+    m_segmentSealed[active] = true;
+    m_sealedSegments.push_back(active);
+    m_mappedPlainLogFile->active = next;
+    m_outputCv.notify_all();
 }
 
-int LogPersister::WriteLogData(const HilogData& logData)
+void LogPersister::OutputLoop()
 {
-    std::list<std::string> formatedTextLogs = LogDataToFormatedStrings(logData);
+    prctl(PR_SET_NAME, "hilogd.pst_out");
+    for (;;) {
+        uint32_t segment = 0;
+        {
+            std::unique_lock<decltype(m_outputMtx)> lock(m_outputMtx);
+            m_outputCv.wait(lock, [this]() { return m_stopOutput || !m_sealedSegments.empty(); });
+            if (m_sealedSegments.empty()) {
+                return;
+            }
+            segment = m_sealedSegments.front();
+        }
+        // The segment stays in the auxiliary file until its logs are written
+        CompressAndWrite(m_mappedPlainLogFile->segments[segment]);
+        {
+            std::lock_guard<decltype(m_outputMtx)> lock(m_outputMtx);
+            m_sealedSegments.pop_front();
+            m_segmentSealed[segment] = false;
+        }
+        m_outputCv.notify_all();
+    }
+}
 
-    // Firstly gather uncompressed logs in auxiliary file
-    if (WriteUncompressedLogs(formatedTextLogs))
-        return 0;
-    // Try to compress auxiliary file
-    auto compressionResult = m_compressor->Compress(*m_mappedPlainLogFile, *m_compressBuffer);
+void LogPersister::CompressAndWrite(LogPersisterBuffer& plainSegment)
+{
+    if (plainSegment.offset == 0) {
+        return;
+    }
+    auto compressionResult = m_compressor->Compress(plainSegment, *m_compressBuffer);
     if (compressionResult != 0) {
-        std::cerr <<  __PRETTY_FUNCTION__ << " Compression error. Result:" << compressionResult << "\n";
-        return RET_FAIL;
+        std::cerr << __PRETTY_FUNCTION__ << " Compression error. Result:" << compressionResult << "\n";
+        m_compressBuffer->offset = 0;
+        plainSegment.offset = 0;
+        // The compressor dropped its broken stream, a new one can't follow it in the same file
+        m_plainLogSize = 0;
+        FinishLogFile();
+        return;
     }
     // Write compressed buffor and clear counters
-    WriteCompressedLogs();
-    // Try again write data that wasn't written at the beginning
-    // If again fail then these logs are skipped
-    return WriteUncompressedLogs(formatedTextLogs) ? 0 : RET_FAIL;
+    WriteCompressedLogs(plainSegment);
 }
 
-inline void LogPersister::WriteCompressedLogs()
+inline void LogPersister::WriteCompressedLogs(LogPersisterBuffer& plainSegment)
 {
-    if (m_mappedPlainLogFile->offset == 0)
+    if (plainSegment.offset == 0)
         return;
     m_fileRotator->Input(m_compressBuffer->content, m_compressBuffer->offset);
-    m_plainLogSize += m_mappedPlainLogFile->offset;
+    m_plainLogSize += plainSegment.offset;
     std::cout << __PRETTY_FUNCTION__ <<  " Stored plain log bytes: " << m_plainLogSize
         << " from: " << m_baseData.logFileSizeLimit << "\n";
+    m_compressBuffer->offset = 0;
+    plainSegment.offset = 0;
     if (m_plainLogSize >= m_baseData.logFileSizeLimit) {
         m_plainLogSize = 0;
-        m_fileRotator->FinishInput();
+        FinishLogFile();
+    }
+}
+
+void LogPersister::FinishLogFile()
+{
+    // One compressed stream per file, its end goes into the file being finished
+    if (m_compressor->Finish(*m_compressBuffer) == 0 && m_compressBuffer->offset > 0) {
+        m_fileRotator->Input(m_compressBuffer->content, m_compressBuffer->offset);
     }
     m_compressBuffer->offset = 0;
-    m_mappedPlainLogFile->offset = 0;
+    m_fileRotator->FinishInput();
 }
 
 void LogPersister::Start()
@@ -412,28 +492,47 @@ int LogPersister::ReceiveLogLoop()
 {
     prctl(PR_SET_NAME, "hilogd.pst");
     std::cout << __PRETTY_FUNCTION__ << " " << std::this_thread::get_id() << "\n";
+    {
+        std::lock_guard<decltype(m_outputMtx)> lock(m_outputMtx);
+        m_stopOutput = false;
+    }
+    std::thread outputThread(&LogPersister::OutputLoop, this);
+    auto writeLog = [this](const HilogData& logData) {
+        if (WriteLogData(logData)) {
+            std::cerr << __PRETTY_FUNCTION__ << " Can't write new log data!\n";
+        }
+    };
     for (;;) {
         if (m_stopThread) {
             break;
         }
 
-        auto result = m_hilogBuffer.Query(m_filters, m_bufReader, [this](const HilogData& logData) {
-            if (WriteLogData(logData)) {
-                std::cerr << __PRETTY_FUNCTION__ << " Can't write new log data!\n";
-            }
-        });
+        WriteUnwrittenLogs();
+        auto result = m_hilogBuffer.Query(m_compiledFilter, m_bufReader, writeLog);
 
         if (!result) {
             std::unique_lock<decltype(m_receiveLogCvMtx)> lk(m_receiveLogCvMtx);
             m_receiveLogCv.wait_for(lk, m_baseData.newLogTimeout);
         }
     }
-    WriteCompressedLogs();
-    m_fileRotator->FinishInput();
+    // Logs below the wakeup threshold are still in the buffer. Only those inserted until now are written,
+    // under steady ingest the buffer is never drained and Kill would wait forever
+    uint64_t endOrder = m_hilogBuffer.GetEndOrder();
+    do {
+        WriteUnwrittenLogs();
+    } while (m_hilogBuffer.Query(m_compiledFilter, m_bufReader, writeLog, endOrder));
+    SealActiveSegment();
+    {
+        std::lock_guard<decltype(m_outputMtx)> lock(m_outputMtx);
+        m_stopOutput = true;
+    }
+    m_outputCv.notify_all();
+    outputThread.join();
+    FinishLogFile();
     return 0;
 }
 
-int LogPersister::Query(uint16_t logType, std::list<LogPersistQueryResult> &results)
+int LogPersister::Query(uint16_t logType, std::list<LogPersistQueryResultExt> &results)
 {
     std::lock_guard<decltype(s_logPersistersMtx)> guard(s_logPersistersMtx);
     std::cout << __PRETTY_FUNCTION__ << " Persister.Query: logType " << logType << "\n";
@@ -441,8 +540,8 @@ int LogPersister::Query(uint16_t logType, std::list<LogPersistQueryResult> &resu
         uint16_t currentType = logPersister->m_filters.inclusions.types;
         std::cout << __PRETTY_FUNCTION__ << " Persister.Query: (*it)->queryCondition.types " << currentType << "\n";
         if (currentType & logType) {
-            LogPersistQueryResult response;
-            response.logType = currentType;
+            LogPersistQueryResultExt response = {{0}};
+            response.info.logType = currentType;
             logPersister->FillInfo(response);
             results.push_back(response);
         }
@@ -450,15 +549,16 @@ int LogPersister::Query(uint16_t logType, std::list<LogPersistQueryResult> &resu
     return 0;
 }
 
-void LogPersister::FillInfo(LogPersistQueryResult &response)
+void LogPersister::FillInfo(LogPersistQueryResultExt &response)
 {
-    response.jobId = m_baseData.id;
-    if (strcpy_s(response.filePath, FILE_PATH_MAX_LEN, m_baseData.logPath.c_str())) {
+    response.info.jobId = m_baseData.id;
+    if (strcpy_s(response.info.filePath, FILE_PATH_MAX_LEN, m_baseData.logPath.c_str())) {
         return;
     }
-    response.compressAlg = m_baseData.compressAlg;
-    response.fileSize = m_baseData.logFileSizeLimit;
-    response.fileNum = m_baseData.maxLogFileNum;
+    response.info.compressAlg = m_baseData.compressAlg;
+    response.info.fileSize = m_baseData.logFileSizeLimit;
+    response.info.fileNum = m_baseData.maxLogFileNum;
+    response.dictId = m_baseData.dictId;
 }
 
 int LogPersister::Kill(uint32_t id)
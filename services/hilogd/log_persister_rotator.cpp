@@ -22,18 +22,18 @@
 #include <sys/stat.h>
 #include <sys/time.h>
 #include <unistd.h>
+#include <vector>
 
 constexpr uint8_t MAX_TIME_BUF_SIZE = 32;
 constexpr uint8_t MAX_LOG_INDEX_LEN = 4;
 
 namespace OHOS {
 namespace HiviewDFX {
-uint64_t GenerateHash(const PersistRecoveryInfo &info)
+static uint64_t GenerateHash(const char *p, size_t len)
 {
     uint64_t ret {BASIS};
-    const char *p = reinterpret_cast<char*>(const_cast<PersistRecoveryInfo*>(&info));
     unsigned long i = 0;
-    while (i < sizeof(PersistRecoveryInfo)) {
+    while (i < len) {
         ret ^= *(p + i);
         ret *= PRIME;
         i++;
@@ -41,6 +41,48 @@ uint64_t GenerateHash(const PersistRecoveryInfo &info)
     return ret;
 }
 
+uint64_t GenerateHash(const PersistRecoveryInfo &info)
+{
+    return GenerateHash(reinterpret_cast<const char*>(&info), sizeof(PersistRecoveryInfo));
+}
+
+bool ReadRecoveryInfo(const std::string& path, PersistRecoveryInfo& info)
+{
+    static_assert(sizeof(PersistRecoveryInfoV0) < sizeof(PersistRecoveryInfo), "info file versions have one size");
+    FILE* infile = fopen(path.c_str(), "r");
+    if (infile == nullptr) {
+        std::cerr << "Error opening recovery info file!\n";
+        return false;
+    }
+    // The file is the info followed by its hash, its size tells the version
+    std::vector<char> data(sizeof(PersistRecoveryInfo) + sizeof(uint64_t) + 1);
+    size_t size = fread(data.data(), 1, data.size(), infile);
+    fclose(infile);
+    uint64_t hashSum = 0;
+    if (size == sizeof(PersistRecoveryInfoV0) + sizeof(hashSum)) {
+        PersistRecoveryInfoV0 infoV0;
+        (void)memcpy_s(&infoV0, sizeof(infoV0), data.data(), sizeof(infoV0));
+        (void)memcpy_s(&hashSum, sizeof(hashSum), data.data() + sizeof(infoV0), sizeof(hashSum));
+        if (GenerateHash(reinterpret_cast<const char*>(&infoV0), sizeof(infoV0)) != hashSum) {
+            return false;
+        }
+        info = {0};
+        info.index = infoV0.index;
+        info.types = infoV0.types;
+        info.levels = infoV0.levels;
+        info.msg = infoV0.msg;
+        info.version = PERSIST_INFO_VERSION;
+        info.dictId = 0;
+        return true;
+    }
+    if (size != sizeof(PersistRecoveryInfo) + sizeof(hashSum)) {
+        return false;
+    }
+    (void)memcpy_s(&info, sizeof(info), data.data(), sizeof(info));
+    (void)memcpy_s(&hashSum, sizeof(hashSum), data.data() + sizeof(info), sizeof(hashSum));
+    return GenerateHash(info) == hashSum && info.version == PERSIST_INFO_VERSION;
+}
+
 std::string GetFileNameIndex(const int index)
 {
     char res[MAX_LOG_INDEX_LEN];
@@ -81,6 +123,7 @@ int LogPersisterRotator::Init(const PersistRecoveryInfo& info, bool restore)
     }
 
     m_info = info;
+    m_info.version = PERSIST_INFO_VERSION;
     SetFileIndex(m_info.index, restore);
     UpdateRotateNumber();
     return RET_SUCCESS;
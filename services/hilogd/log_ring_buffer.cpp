@@ -0,0 +1,287 @@
+/*
+ * Copyright (c) 2022 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <new>
+
+#include <securec.h>
+
+#include "log_ring_buffer.h"
+
+namespace OHOS {
+namespace HiviewDFX {
+static constexpr size_t RECORD_ALIGN = 8;
+
+static constexpr size_t AlignUp(size_t size)
+{
+    return (size + RECORD_ALIGN - 1) & ~(RECORD_ALIGN - 1);
+}
+
+void LogRingBuffer::SetCapacity(size_t capacity)
+{
+    capacity -= capacity % RECORD_ALIGN;
+    if (capacity == m_capacity) {
+        return;
+    }
+    if (!m_data) {
+        // Nothing stored yet, storage is allocated by the first Push()
+        m_capacity = capacity;
+        return;
+    }
+    std::unique_ptr<char[]> data(new (std::nothrow) char[capacity]);
+    if (!data) {
+        std::cerr << "Not enough memory to resize log ring buffer!\n";
+        return;
+    }
+
+    // Drop the oldest records which don't fit into the new ring
+    size_t liveSize = 0;
+    size_t pos = m_head;
+    for (Seq seq = m_headSeq; seq < m_tailSeq; ++seq) {
+        if (IsWrapPoint(pos)) {
+            pos = 0;
+        }
+        liveSize += HeaderAt(pos)->size;
+        pos += HeaderAt(pos)->size;
+    }
+    while (liveSize > capacity) {
+        if (!IsWrapPoint(m_head)) {
+            liveSize -= HeaderAt(m_head)->size;
+        }
+        EvictOldest();
+    }
+
+    // Repack the remaining records from the beginning of the new ring
+    size_t offset = 0;
+    pos = m_head;
+    for (Seq seq = m_headSeq; seq < m_tailSeq; ++seq) {
+        if (IsWrapPoint(pos)) {
+            pos = 0;
+        }
+        uint32_t size = HeaderAt(pos)->size;
+        if (memcpy_s(data.get() + offset, capacity - offset, m_data.get() + pos, size) != 0) {
+            std::cerr << "Can't repack log ring buffer!\n";
+            return;
+        }
+        offset += size;
+        pos += size;
+    }
+    m_data = std::move(data);
+    m_capacity = capacity;
+    m_head = 0;
+    m_used = offset;
+    m_tail = (offset == capacity) ? 0 : offset;
+    ++m_generation; // offsets kept by readers are not valid anymore
+}
+
+bool LogRingBuffer::Push(const HilogMsg& msg, uint64_t order, LogTagTable::TagId tagId)
+{
+    // Interned tag isn't stored, content follows the HilogMsg header right away
+    const bool tagInline = (tagId == LogTagTable::INVALID_TAG_ID);
+    size_t storedLen = tagInline ? msg.len : (msg.len - msg.tag_len);
+    size_t recordSize = AlignUp(sizeof(RecordHeader) + storedLen);
+    if (unlikely(recordSize > m_capacity)) {
+        return false;
+    }
+    if (unlikely(!m_data)) {
+        m_data.reset(new (std::nothrow) char[m_capacity]);
+        if (!m_data) {
+            std::cerr << "Not enough memory for log ring buffer!\n";
+            return false;
+        }
+    }
+    if (!Reserve(recordSize)) {
+        return false;
+    }
+
+    RecordHeader* header = HeaderAt(m_tail);
+    header->size = static_cast<uint32_t>(recordSize);
+    header->seq = static_cast<uint32_t>(m_tailSeq);
+    header->order = order;
+    header->tagId = tagId;
+    char* body = reinterpret_cast<char*>(header + 1);
+    size_t bodyLen = m_capacity - m_tail - sizeof(RecordHeader);
+    if (tagInline) {
+        if (memcpy_s(body, bodyLen, &msg, msg.len) != 0) {
+            return false;
+        }
+    } else if (memcpy_s(body, bodyLen, &msg, sizeof(HilogMsg)) != 0 ||
+        memcpy_s(body + sizeof(HilogMsg), bodyLen - sizeof(HilogMsg), CONTENT_PTR((&msg)), CONTENT_LEN((&msg))) != 0) {
+        return false;
+    }
+    // Tag and content are read as C strings later on, make sure both are terminated
+    HilogMsg* stored = reinterpret_cast<HilogMsg*>(body);
+    if (tagInline) {
+        stored->tag[stored->tag_len - 1] = '\0';
+    }
+    body[storedLen - 1] = '\0';
+
+    m_tail += recordSize;
+    if (m_tail == m_capacity) {
+        m_tail = 0;
+    }
+    m_used += recordSize;
+    ++m_tailSeq;
+    return true;
+}
+
+size_t LogRingBuffer::Clear()
+{
+    size_t contentSize = 0;
+    size_t pos = m_head;
+    for (Seq seq = m_headSeq; seq < m_tailSeq; ++seq) {
+        if (IsWrapPoint(pos)) {
+            pos = 0;
+        }
+        const HilogMsg* msg = reinterpret_cast<const HilogMsg*>(HeaderAt(pos) + 1);
+        contentSize += msg->len - sizeof(HilogMsg) - msg->tag_len;
+        pos += HeaderAt(pos)->size;
+    }
+    // Tail offset is kept, so cursors of readers waiting at the end stay valid
+    m_head = m_tail;
+    m_used = 0;
+    m_headSeq = m_tailSeq;
+    return contentSize;
+}
+
+LogRingBuffer::Cursor LogRingBuffer::Begin() const
+{
+    Cursor cursor;
+    cursor.seq = m_headSeq;
+    cursor.offset = m_head;
+    cursor.generation = m_generation;
+    return cursor;
+}
+
+const HilogMsg* LogRingBuffer::Read(Cursor& cursor, uint64_t& order, LogTagTable::TagId& tagId,
+    uint64_t& missed) const
+{
+    if (cursor.seq < m_headSeq) {
+        Seq lostSeq = std::min(m_overflowSeq, m_headSeq);
+        if (lostSeq > cursor.seq) {
+            missed += lostSeq - cursor.seq;
+        }
+        cursor = Begin();
+    } else if (cursor.generation != m_generation) {
+        Relocate(cursor);
+    }
+    if (cursor.seq >= m_tailSeq) {
+        return nullptr;
+    }
+    if (!IsRecordAt(cursor.offset, cursor.seq)) {
+        // Cursor stopped at the end of the ring and the record was placed at its start,
+        // the wrap marker behind the cursor may already be overwritten by newer records
+        cursor.offset = 0;
+        if (!IsRecordAt(cursor.offset, cursor.seq)) {
+            Relocate(cursor);
+        }
+    }
+    const RecordHeader* header = HeaderAt(cursor.offset);
+    order = header->order;
+    tagId = header->tagId;
+    return reinterpret_cast<const HilogMsg*>(header + 1);
+}
+
+void LogRingBuffer::Next(Cursor& cursor) const
+{
+    cursor.offset += HeaderAt(cursor.offset)->size;
+    if (cursor.offset == m_capacity) {
+        cursor.offset = 0;
+    }
+    ++cursor.seq;
+}
+
+bool LogRingBuffer::IsWrapPoint(size_t offset) const
+{
+    return (m_capacity - offset < sizeof(RecordHeader)) || (HeaderAt(offset)->size == 0);
+}
+
+bool LogRingBuffer::IsRecordAt(size_t offset, Seq seq) const
+{
+    if (m_capacity - offset < sizeof(RecordHeader)) {
+        return false;
+    }
+    const RecordHeader* header = HeaderAt(offset);
+    return header->size != 0 && header->seq == static_cast<uint32_t>(seq);
+}
+
+LogRingBuffer::RecordHeader* LogRingBuffer::HeaderAt(size_t offset) const
+{
+    return reinterpret_cast<RecordHeader*>(m_data.get() + offset);
+}
+
+void LogRingBuffer::EvictOldest()
+{
+    if (IsWrapPoint(m_head)) {
+        m_used -= m_capacity - m_head;
+        m_head = 0;
+        return;
+    }
+    uint32_t size = HeaderAt(m_head)->size;
+    m_head += size;
+    if (m_head == m_capacity) {
+        m_head = 0;
+    }
+    m_used -= size;
+    ++m_headSeq;
+    m_overflowSeq = m_headSeq;
+}
+
+bool LogRingBuffer::Reserve(size_t recordSize)
+{
+    for (;;) {
+        if (m_tail > m_head || m_used == 0) {
+            // Free space is [tail, capacity) and [0, head)
+            size_t spaceToEnd = m_capacity - m_tail;
+            if (spaceToEnd >= recordSize) {
+                return true;
+            }
+            if (spaceToEnd >= sizeof(RecordHeader)) {
+                HeaderAt(m_tail)->size = 0;
+            }
+            m_used += spaceToEnd;
+            m_tail = 0;
+            continue;
+        }
+        // Free space is [tail, head)
+        if (m_head - m_tail >= recordSize) {
+            return true;
+        }
+        if (m_used == 0) {
+            return false;
+        }
+        EvictOldest();
+    }
+}
+
+void LogRingBuffer::Relocate(Cursor& cursor) const
+{
+    size_t pos = m_head;
+    for (Seq seq = m_headSeq; seq < cursor.seq; ++seq) {
+        if (IsWrapPoint(pos)) {
+            pos = 0;
+        }
+        pos += HeaderAt(pos)->size;
+        if (pos == m_capacity) {
+            pos = 0;
+        }
+    }
+    cursor.offset = pos;
+    cursor.generation = m_generation;
+}
+} // namespace HiviewDFX
+} // namespace OHOS
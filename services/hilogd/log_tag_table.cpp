@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2022 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <new>
+
+#include <securec.h>
+
+#include "log_tag_table.h"
+
+namespace OHOS {
+namespace HiviewDFX {
+static constexpr uint32_t FNV_BASIS = 2166136261U;
+static constexpr uint32_t FNV_PRIME = 16777619U;
+
+static size_t TagLength(const char* tag, size_t maxLen)
+{
+    // One byte of the entry is kept for '\0'
+    return strnlen(tag, std::min(maxLen, static_cast<size_t>(MAX_TAG_LEN - 1)));
+}
+
+static uint32_t HashTag(const char* tag, size_t len)
+{
+    uint32_t hash = FNV_BASIS;
+    for (size_t i = 0; i < len; ++i) {
+        hash = (hash ^ static_cast<uint8_t>(tag[i])) * FNV_PRIME;
+    }
+    return hash;
+}
+
+LogTagTable::TagId LogTagTable::Intern(const char* tag, size_t maxLen)
+{
+    size_t len = TagLength(tag, maxLen);
+    uint32_t hash = HashTag(tag, len);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    TagId id = FindLocked(tag, len, hash);
+    if (id != INVALID_TAG_ID || m_count >= MAX_TAG_IDS) {
+        return id;
+    }
+
+    id = m_count;
+    size_t chunkIndex = id >> CHUNK_BITS;
+    if (!m_chunkStorage[chunkIndex]) {
+        m_chunkStorage[chunkIndex].reset(new (std::nothrow) Chunk());
+        if (!m_chunkStorage[chunkIndex]) {
+            std::cerr << "Not enough memory for tag table!\n";
+            return INVALID_TAG_ID;
+        }
+        m_chunks[chunkIndex].store(m_chunkStorage[chunkIndex].get(), std::memory_order_release);
+    }
+    char* entry = m_chunkStorage[chunkIndex]->tags[id & (CHUNK_SIZE - 1)];
+    if (memcpy_s(entry, MAX_TAG_LEN, tag, len) != EOK) {
+        return INVALID_TAG_ID;
+    }
+    entry[len] = '\0';
+    m_index.emplace(hash, id);
+    ++m_count;
+    return id;
+}
+
+LogTagTable::TagId LogTagTable::Find(const char* tag, size_t maxLen)
+{
+    size_t len = TagLength(tag, maxLen);
+    uint32_t hash = HashTag(tag, len);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return FindLocked(tag, len, hash);
+}
+
+LogTagTable::TagId LogTagTable::FindLocked(const char* tag, size_t len, uint32_t hash) const
+{
+    auto range = m_index.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it) {
+        const char* entry = m_chunkStorage[it->second >> CHUNK_BITS]->tags[it->second & (CHUNK_SIZE - 1)];
+        if (strncmp(entry, tag, len) == 0 && entry[len] == '\0') {
+            return it->second;
+        }
+    }
+    return INVALID_TAG_ID;
+}
+
+const char* LogTagTable::GetTag(TagId id) const
+{
+    if (id >= MAX_TAG_IDS) {
+        return "";
+    }
+    const Chunk* chunk = m_chunks[id >> CHUNK_BITS].load(std::memory_order_acquire);
+    return (chunk == nullptr) ? "" : chunk->tags[id & (CHUNK_SIZE - 1)];
+}
+} // namespace HiviewDFX
+} // namespace OHOS
@@ -14,6 +14,7 @@
  */
 
 #include <iostream>
+#include <mutex>
 #include <sys/stat.h>
 #include <sys/prctl.h>
 #include <thread>
@@ -23,6 +24,7 @@
 #include <chrono>
 #include <fcntl.h>
 
+#include <hilog_input_shm_server.h>
 #include <hilog_input_socket_server.h>
 #include <properties.h>
 #include <log_utils.h>
@@ -163,20 +165,24 @@ int HilogdEntry()
 
     InitDomainFlowCtrl();
 
-    // Start log_collector
-#ifndef __RECV_MSG_WITH_UCRED_
-    auto onDataReceive = [&hilogBuffer](std::vector<char>& data) {
-        static LogCollector logCollector(hilogBuffer);
-        logCollector.onDataRecv(data);
+    // Formats registered with an earlier hilogd are gone, clients which see the new epoch send them again
+    (void)SetBinaryEpoch(GetBinaryEpoch() + 1);
+
+    // Start commit stage which moves incoming logs into hilogBuffer
+    LogIngestQueue ingestQueue(hilogBuffer);
+    ingestQueue.Start();
+
+    // Start log_collector, packets are received in batches by recvmmsg() or drained from shared memory rings.
+    // Both transports feed the same collector, flow control state in it is not thread safe
+    std::mutex collectorMtx;
+    HilogInputSocketServer::BatchHandlingFunc onBatchReceive =
+        [&ingestQueue, &collectorMtx](std::vector<DgramPacket>& packets) {
+        static LogCollector logCollector(ingestQueue);
+        std::lock_guard<std::mutex> lock(collectorMtx);
+        logCollector.onBatchRecv(packets);
     };
-#else
-    auto onDataReceive = [&hilogBuffer](const ucred& cred, std::vector<char>& data) {
-        static LogCollector logCollector(hilogBuffer);
-        logCollector.onDataRecv(cred, data);
-    };
-#endif
 
-    HilogInputSocketServer incomingLogsServer(onDataReceive);
+    HilogInputSocketServer incomingLogsServer(onBatchReceive);
     if (incomingLogsServer.Init() < 0) {
 #ifdef DEBUG
         cout << "Failed to init input server socket ! ";
@@ -189,6 +195,16 @@ int HilogdEntry()
         incomingLogsServer.RunServingThread();
     }
 
+    HilogInputShmServer incomingShmServer(onBatchReceive);
+    if (incomingShmServer.Init() < 0) {
+#ifdef DEBUG
+        cout << "Failed to init shared memory input server socket ! ";
+        PrintErrorno(errno);
+#endif
+    } else {
+        incomingShmServer.RunServingThread();
+    }
+
     auto startupCheckTask = std::async(std::launch::async, [&hilogBuffer]() {
         prctl(PR_SET_NAME, "hilogd.pst_res");
         if (WaitingToDo(WAITING_DATA_MS, HILOG_FILE_DIR, WaitingDataMounted) == 0) {
@@ -196,9 +212,9 @@ int HilogdEntry()
             RestorePersistJobs(hilogBuffer);
         }
     });
-    auto kmsgTask = std::async(std::launch::async, [&hilogBuffer]() {
+    auto kmsgTask = std::async(std::launch::async, [&ingestQueue]() {
         prctl(PR_SET_NAME, "hilogd.rd_kmsg");
-        LogKmsg logKmsg(hilogBuffer);
+        LogKmsg logKmsg(ingestQueue);
         logKmsg.ReadAllKmsg();
     });
 
@@ -155,7 +155,7 @@ void ServiceController::HandlePersistStopRequest(const PacketBuf& rawData)
         return;
     }
     uint32_t msgNum = 0;
-    list<LogPersistQueryResult> resultList;
+    list<LogPersistQueryResultExt> resultList;
     LogPersister::Query(DEFAULT_LOG_TYPE, resultList);
     if (requestMsg && sizeof(LogPersistQueryMsg) <= request->msgHeader.msgLen) {
         if (requestMsg->jobId != JOB_ID_ALL) {
@@ -168,9 +168,9 @@ void ServiceController::HandlePersistStopRequest(const PacketBuf& rawData)
             }
         }  else {
             for (auto it = resultList.begin(); it != resultList.end(); ++it) {
-                int32_t rst = LogPersister::Kill((*it).jobId);
+                int32_t rst = LogPersister::Kill((*it).info.jobId);
                 if (respondMsg) {
-                    respondMsg->jobId = (*it).jobId;
+                    respondMsg->jobId = (*it).info.jobId;
                     respondMsg->result = (rst < 0) ? rst : RET_SUCCESS;
                     respondMsg++;
                     msgNum++;
@@ -190,8 +190,12 @@ void ServiceController::HandlePersistQueryRequest(const PacketBuf& rawData)
 
     PacketBuf respondRaw = {0};
     LogPersistQueryResponse* respond = reinterpret_cast<LogPersistQueryResponse*>(respondRaw.data());
-    LogPersistQueryResult* respondMsg = reinterpret_cast<LogPersistQueryResult*>(&respond->logPersistQueryRst);
+    char* respondMsg = reinterpret_cast<char*>(&respond->logPersistQueryRst);
 
+    // Older hilogtool reads results of the base version only
+    uint8_t version = std::min<uint8_t>(request->msgHeader.version, LOG_PERSIST_QUERY_VERSION_DICT);
+    size_t resultSize = (version == LOG_PERSIST_QUERY_VERSION_DICT) ? sizeof(LogPersistQueryResultExt)
+        : sizeof(LogPersistQueryResult);
     uint32_t recvMsgLen = 0;
     uint32_t respondMsgNum = 0;
 
@@ -200,32 +204,28 @@ void ServiceController::HandlePersistQueryRequest(const PacketBuf& rawData)
     }
 
     while (requestMsg && recvMsgLen + sizeof(LogPersistQueryMsg) <= request->msgHeader.msgLen) {
-        list<LogPersistQueryResult> resultList;
+        list<LogPersistQueryResultExt> resultList;
         std::cout << requestMsg->logType << endl;
         int32_t rst = LogPersister::Query(requestMsg->logType, resultList);
         for (auto it = resultList.begin(); it != resultList.end(); ++it) {
-            if ((respondMsgNum + 1) * sizeof(LogPersistQueryResult) + sizeof(MessageHeader) > respondRaw.size()) {
+            if ((respondMsgNum + 1) * resultSize + sizeof(MessageHeader) > respondRaw.size()) {
                 break;
             }
-            if (respondMsg) {
-                respondMsg->result = (rst < 0) ? rst : RET_SUCCESS;
-                respondMsg->jobId = (*it).jobId;
-                respondMsg->logType = (*it).logType;
-                respondMsg->compressAlg = (*it).compressAlg;
-                if (strcpy_s(respondMsg->filePath, FILE_PATH_MAX_LEN, (*it).filePath)) {
-                    return;
-                }
-                respondMsg->fileSize = (*it).fileSize;
-                respondMsg->fileNum = (*it).fileNum;
-                respondMsg++;
-                respondMsgNum++;
+            LogPersistQueryResultExt result = *it;
+            result.info.result = (rst < 0) ? rst : RET_SUCCESS;
+            if (memcpy_s(respondMsg, respondRaw.size() - sizeof(MessageHeader) - respondMsgNum * resultSize,
+                &result, resultSize) != EOK) {
+                return;
             }
+            respondMsg += resultSize;
+            respondMsgNum++;
         }
         requestMsg++;
         recvMsgLen += sizeof(LogPersistQueryMsg);
     }
-    uint16_t respondMsgSize = respondMsgNum * sizeof(LogPersistQueryResult);
+    uint16_t respondMsgSize = respondMsgNum * resultSize;
     SetMsgHead(respond->msgHeader, MC_RSP_LOG_PERSIST_QUERY, respondMsgSize);
+    respond->msgHeader.version = version;
     m_communicationSocket->Write(respondRaw.data(), respondMsgSize + sizeof(MessageHeader));
 }
 
@@ -380,9 +380,11 @@ void ServiceController::HandleBufferClearRequest(const PacketBuf& rawData)
 }
 
 
-ServiceController::ServiceController(std::unique_ptr<Socket> communicationSocket, HilogBuffer& buffer)
+ServiceController::ServiceController(std::unique_ptr<Socket> communicationSocket, HilogBuffer& buffer,
+    std::function<void()> onNewData)
     : m_communicationSocket(std::move(communicationSocket))
     , m_hilogBuffer(buffer)
+    , m_onNewData(onNewData)
 {
     m_bufReader = m_hilogBuffer.CreateBufReader([this]() { NotifyForNewData(); });
 }
@@ -390,61 +392,82 @@ ServiceController::ServiceController(std::unique_ptr<Socket> communicationSocket
 ServiceController::~ServiceController()
 {
     m_hilogBuffer.RemoveBufReader(m_bufReader);
-
-    m_notifyNewDataCv.notify_all();
 }
 
-void ServiceController::CommunicationLoop(std::atomic<bool>& stopLoop)
+bool ServiceController::OnRequest()
 {
-    std::cout << __PRETTY_FUNCTION__ << " Begin\n";
     if (!m_communicationSocket) {
         std::cerr << __PRETTY_FUNCTION__ << " Invalid socket handler!\n";
-        return;
+        return false;
     }
     PacketBuf rawDataBuffer = {0};
-    while (!stopLoop.load() && m_communicationSocket->Read(rawDataBuffer.data(), rawDataBuffer.size() - 1) > 0) {
-        MessageHeader *header = reinterpret_cast<MessageHeader *>(rawDataBuffer.data());
-        switch (header->msgType) {
-            case LOG_QUERY_REQUEST:
-                SetFilters(rawDataBuffer);
-                if (IsLogTypeForbidden(m_filters.inclusions.types)) {
-                    return;
-                }
-                HandleLogQueryRequest();
-                break;
-            case NEXT_REQUEST:
-                HandleNextRequest(rawDataBuffer, stopLoop);
-                break;
-            case MC_REQ_LOG_PERSIST_START:
-                HandlePersistStartRequest(rawDataBuffer);
-                break;
-            case MC_REQ_LOG_PERSIST_STOP:
-                HandlePersistStopRequest(rawDataBuffer);
-                break;
-            case MC_REQ_LOG_PERSIST_QUERY:
-                HandlePersistQueryRequest(rawDataBuffer);
-                break;
-            case MC_REQ_BUFFER_RESIZE:
-                HandleBufferResizeRequest(rawDataBuffer);
-                break;
-            case MC_REQ_BUFFER_SIZE:
-                HandleBufferSizeRequest(rawDataBuffer);
-                break;
-            case MC_REQ_STATISTIC_INFO_QUERY:
-                HandleInfoQueryRequest(rawDataBuffer);
-                break;
-            case MC_REQ_STATISTIC_INFO_CLEAR:
-                HandleInfoClearRequest(rawDataBuffer);
-                break;
-            case MC_REQ_LOG_CLEAR:
-                HandleBufferClearRequest(rawDataBuffer);
-                break;
-            default:
-                std::cout << __PRETTY_FUNCTION__ << " Unknown message. Skipped!\n";
-                break;
-        }
+    int len = m_communicationSocket->Read(rawDataBuffer.data(), rawDataBuffer.size() - 1);
+    if (len < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        return true;
+    } else if (len <= 0) {
+        return false;
     }
-    std::cout << __PRETTY_FUNCTION__ << " Done\n";
+    MessageHeader *header = reinterpret_cast<MessageHeader *>(rawDataBuffer.data());
+    switch (header->msgType) {
+        case LOG_QUERY_REQUEST:
+            m_queryVersion = std::min(header->version, static_cast<uint8_t>(LOG_QUERY_VERSION_CONTENT));
+            m_streaming.store(false);
+            SetFilters(rawDataBuffer);
+            if (IsLogTypeForbidden(m_filters.inclusions.types)) {
+                return false;
+            }
+            HandleLogQueryRequest();
+            break;
+        case NEXT_REQUEST:
+            return HandleNextRequest(rawDataBuffer);
+        case MC_REQ_LOG_PERSIST_START:
+            HandlePersistStartRequest(rawDataBuffer);
+            break;
+        case MC_REQ_LOG_PERSIST_STOP:
+            HandlePersistStopRequest(rawDataBuffer);
+            break;
+        case MC_REQ_LOG_PERSIST_QUERY:
+            HandlePersistQueryRequest(rawDataBuffer);
+            break;
+        case MC_REQ_BUFFER_RESIZE:
+            HandleBufferResizeRequest(rawDataBuffer);
+            break;
+        case MC_REQ_BUFFER_SIZE:
+            HandleBufferSizeRequest(rawDataBuffer);
+            break;
+        case MC_REQ_STATISTIC_INFO_QUERY:
+            HandleInfoQueryRequest(rawDataBuffer);
+            break;
+        case MC_REQ_STATISTIC_INFO_CLEAR:
+            HandleInfoClearRequest(rawDataBuffer);
+            break;
+        case MC_REQ_LOG_CLEAR:
+            HandleBufferClearRequest(rawDataBuffer);
+            break;
+        default:
+            std::cout << __PRETTY_FUNCTION__ << " Unknown message. Skipped!\n";
+            break;
+    }
+    return true;
+}
+
+bool ServiceController::OnWritable()
+{
+    if (SendPendingOutput() < 0) {
+        return false;
+    }
+    return HasPendingOutput() || StreamLogs();
+}
+
+bool ServiceController::OnNewData()
+{
+    // Logs of a stream go out behind the pending response, OnWritable carries on with them
+    return HasPendingOutput() || StreamLogs();
+}
+
+bool ServiceController::HasPendingOutput() const
+{
+    return m_pendingLen != 0;
 }
 
 void ServiceController::SetFilters(const PacketBuf& rawData)
@@ -479,70 +502,80 @@ void ServiceController::SetFilters(const PacketBuf& rawData)
     for (size_t i = 0; i < m_filters.exclusions.tags.size(); ++i) {
         m_filters.exclusions.tags[i] = qRstMsg.noTags[i];
     }
+    m_filters.content.clear();
+    if (m_queryVersion == LOG_QUERY_VERSION_CONTENT) {
+        m_filters.content.assign(qRstMsg.content, strnlen(qRstMsg.content, MAX_CONTENT_PATTERN_LEN));
+    }
+    m_compiledFilter = m_hilogBuffer.CompileFilter(m_filters);
+    // Client matches the content on its own if hilogd can't
+    if (m_queryVersion == LOG_QUERY_VERSION_CONTENT && !m_compiledFilter.HasContentFilter()) {
+        m_queryVersion = LOG_QUERY_VERSION_BATCH;
+    }
 }
 
 void ServiceController::HandleLogQueryRequest()
 {
-    auto result = m_hilogBuffer.Query(m_filters, m_bufReader, [this](const HilogData& logData) {
-        WriteLogQueryRespond(SENDIDA, LOG_QUERY_RESPONSE, logData);
-    });
-    if (!result) {
-        WriteLogQueryRespond(SENDIDN, LOG_QUERY_RESPONSE, std::nullopt);
+    int ret = 0;
+    bool result = false;
+    do {
+        result = m_hilogBuffer.Query(m_compiledFilter, m_bufReader, [this, &ret](const HilogData& logData) {
+            ret = RespondLog(SENDIDA, LOG_QUERY_RESPONSE, logData);
+        });
+    } while (result && ret >= 0 && CanBatchMore());
+    if (!result && ret >= 0) {
+        ret = RespondLog(SENDIDN, LOG_QUERY_RESPONSE, std::nullopt);
+    }
+    if (ret >= 0) {
+        (void)FlushLogResponses();
     }
 }
 
-void ServiceController::HandleNextRequest(const PacketBuf& rawData, std::atomic<bool>& stopLoop)
+bool ServiceController::HandleNextRequest(const PacketBuf& rawData)
 {
     const NextRequest& nRstMsg = *reinterpret_cast<const NextRequest*>(rawData.data());
     if (nRstMsg.sendId != SENDIDA) {
-        stopLoop.store(true);
-        return;
+        return false;
     }
-    
-    bool isNotified = true;
-    
-    for (;;) {
-        bool isStopped = stopLoop.load();
-        if (isStopped) {
-            return;
-        }
-        
-        if (isNotified) {
-            int ret = 0;
-            auto result = m_hilogBuffer.Query(m_filters, m_bufReader, [this, &ret](const HilogData& logData) {
-                ret = WriteLogQueryRespond(SENDIDA, NEXT_RESPONSE, logData);
+    m_streaming.store(true);
+    return StreamLogs();
+}
+
+bool ServiceController::StreamLogs()
+{
+    // A busy stream gives its worker back after some packets and continues at the next wakeup
+    static constexpr int maxPacketsPerTurn = 16;
+    if (!m_streaming.load()) {
+        return true;
+    }
+    for (int packets = 0; packets < maxPacketsPerTurn; packets++) {
+        int ret = 0;
+        bool result = false;
+        do {
+            result = m_hilogBuffer.Query(m_compiledFilter, m_bufReader, [this, &ret](const HilogData& logData) {
+                ret = RespondLog(SENDIDA, NEXT_RESPONSE, logData);
             });
-            if (ret < 0) {
-                break;
-            }
-            if (result) {
-                continue;
-            }
+        } while (result && ret >= 0 && CanBatchMore());
+        if (!result) {
+            // End of logs goes out together with the last logs of a batch
+            ret = (ret >= 0) ? RespondLog(SENDIDN, NEXT_RESPONSE, std::nullopt) : ret;
+            ret = (ret >= 0) ? FlushLogResponses() : ret;
+            return ret >= 0;
         }
-
-        int ret = WriteLogQueryRespond(SENDIDN, NEXT_RESPONSE, std::nullopt);
-        if (ret < 0) {
-            break;
+        if (ret < 0 || FlushLogResponses() < 0) {
+            std::cerr << "Client disconnect" << std::endl;
+            PrintErrorno(errno);
+            return false;
+        }
+        if (HasPendingOutput()) {
+            return true;
         }
-
-        std::unique_lock<decltype(m_notifyNewDataMtx)> ul(m_notifyNewDataMtx);
-        isNotified = (m_notifyNewDataCv.wait_for(ul, 1000ms) == std::cv_status::no_timeout);
     }
-    std::cerr << "Client disconnect" << std::endl;
-    PrintErrorno(errno);
-    stopLoop.store(true);
+    NotifyForNewData();
+    return true;
 }
 
-int ServiceController::WriteLogQueryRespond(unsigned int sendId, uint32_t respondCmd, OptCRef<HilogData> pData)
+static void FillDataMessage(HilogDataMessage& msg, unsigned int sendId, OptCRef<HilogData> pData)
 {
-    LogQueryResponse rsp;
-    MessageHeader& header = rsp.header;
-    HilogDataMessage& msg = rsp.data;
-
-    /* set header */
-    SetMsgHead(header, respondCmd, sizeof(rsp) + ((pData != std::nullopt) ? pData->get().len : 0));
-
-    /* set data */
     msg.sendId = sendId;
     if (pData != std::nullopt) {
         const HilogData& data = pData->get();
@@ -556,6 +589,98 @@ int ServiceController::WriteLogQueryRespond(unsigned int sendId, uint32_t respon
         msg.tv_sec = data.tv_sec;
         msg.tv_nsec = data.tv_nsec;
     }
+}
+
+int ServiceController::RespondLog(unsigned int sendId, uint32_t respondCmd, OptCRef<HilogData> pData)
+{
+    if (m_queryVersion == LOG_QUERY_VERSION_SINGLE) {
+        return WriteLogQueryRespond(sendId, respondCmd, pData);
+    }
+
+    size_t dataLen = (pData != std::nullopt) ? pData->get().len : 0;
+    size_t recordLen = sizeof(HilogDataMessage) + dataLen;
+    if (m_batchLen + recordLen > LOG_QUERY_BATCH_MAX_LEN) {
+        int ret = FlushLogResponses();
+        if (ret < 0) {
+            return ret;
+        }
+    }
+    if (m_batch.size() < LOG_QUERY_BATCH_MAX_LEN) {
+        m_batch.resize(LOG_QUERY_BATCH_MAX_LEN);
+    }
+    if (m_batchLen == 0) {
+        MessageHeader& header = *reinterpret_cast<MessageHeader*>(m_batch.data());
+        SetMsgHead(header, respondCmd, 0);
+        header.version = m_queryVersion;
+        m_batchLen = sizeof(MessageHeader);
+    }
+
+    /* The record is copied once, the batch is sent after HilogBuffer::Query drops its lock */
+    char* record = m_batch.data() + m_batchLen;
+    HilogDataMessage& msg = *reinterpret_cast<HilogDataMessage*>(record);
+    msg = {0};
+    FillDataMessage(msg, sendId, pData);
+    if (pData != std::nullopt) {
+        const HilogData& data = pData->get();
+        char* recordData = record + sizeof(msg);
+        size_t space = m_batch.size() - m_batchLen - sizeof(msg);
+        if (memcpy_s(recordData, space, data.tag, data.tag_len) != EOK ||
+            memcpy_s(recordData + data.tag_len, space - data.tag_len, data.content, data.len - data.tag_len) != EOK) {
+            return RET_FAIL;
+        }
+    }
+    m_batchLen += recordLen;
+    return RET_SUCCESS;
+}
+
+int ServiceController::FlushLogResponses()
+{
+    if (m_batchLen == 0) {
+        return RET_SUCCESS;
+    }
+    MessageHeader& header = *reinterpret_cast<MessageHeader*>(m_batch.data());
+    header.msgLen = static_cast<uint16_t>(m_batchLen - sizeof(MessageHeader));
+    int ret = m_communicationSocket->Write(m_batch.data(), m_batchLen);
+    if (ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) && !HasPendingOutput()) {
+        m_pending.swap(m_batch);
+        m_pendingLen = m_batchLen;
+        ret = static_cast<int>(m_batchLen);
+    }
+    m_batchLen = 0;
+    return ret;
+}
+
+int ServiceController::SendPendingOutput()
+{
+    if (!HasPendingOutput()) {
+        return RET_SUCCESS;
+    }
+    int ret = m_communicationSocket->Write(m_pending.data(), m_pendingLen);
+    if (ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        return RET_SUCCESS;
+    }
+    m_pendingLen = 0;
+    return ret;
+}
+
+bool ServiceController::CanBatchMore() const
+{
+    // Stop while the largest log still fits, so logs of a query are never split across request types
+    static constexpr size_t maxRecordLen = sizeof(HilogDataMessage) + MAX_TAG_LEN + MAX_LOG_LEN;
+    return m_queryVersion != LOG_QUERY_VERSION_SINGLE && m_batchLen + maxRecordLen <= LOG_QUERY_BATCH_MAX_LEN;
+}
+
+int ServiceController::WriteLogQueryRespond(unsigned int sendId, uint32_t respondCmd, OptCRef<HilogData> pData)
+{
+    LogQueryResponse rsp;
+    MessageHeader& header = rsp.header;
+    HilogDataMessage& msg = rsp.data;
+
+    /* set header */
+    SetMsgHead(header, respondCmd, sizeof(rsp) + ((pData != std::nullopt) ? pData->get().len : 0));
+
+    /* set data */
+    FillDataMessage(msg, sendId, pData);
 
     /* write into socket */
     return WriteData(rsp, pData);
@@ -570,9 +695,9 @@ int ServiceController::WriteData(LogQueryResponse& rsp, OptCRef<HilogData> pData
         return WriteV(vec, 1);
     }
     const HilogData& data = pData->get();
-    vec[1].iov_base = data.tag;
+    vec[1].iov_base = const_cast<char*>(data.tag);
     vec[1].iov_len = data.tag_len;
-    vec[2].iov_base = data.content;
+    vec[2].iov_base = const_cast<char*>(data.content);
     vec[2].iov_len = data.len - data.tag_len;
 
     return WriteV(vec, 3);
@@ -580,29 +705,35 @@ int ServiceController::WriteData(LogQueryResponse& rsp, OptCRef<HilogData> pData
 
 int ServiceController::WriteV(const iovec* vec, size_t len)
 {
-    static thread_local std::vector<char> dataBuf;
-
+    /*
+     * One writev is one packet on the SEQPACKET socket, tag and content are sent straight from buffer storage.
+     * Callers reply from inside HilogBuffer::Query, its lock keeps the record in place until writev returns.
+     */
+    int ret = m_communicationSocket->WriteV(vec, static_cast<unsigned int>(len));
+    if (ret >= 0 || (errno != EAGAIN && errno != EWOULDBLOCK) || HasPendingOutput()) {
+        return ret;
+    }
+    // The client is slow, keep the packet until the socket has room, the record may be gone by then
     size_t allSize = 0;
     for (size_t i = 0; i < len; ++i) {
         allSize += vec[i].iov_len;
     }
-
-    if (dataBuf.size() < allSize) {
-        dataBuf.resize(allSize);
+    if (m_pending.size() < allSize) {
+        m_pending.resize(allSize);
     }
-
-    uint32_t offset = 0;
-    for (uint32_t i = 0; i < len; ++i) {
-        auto src_address = reinterpret_cast<char*>(vec[i].iov_base);
-        std::copy(src_address, src_address + vec[i].iov_len, dataBuf.data() + offset);
-        offset += vec[i].iov_len;
+    for (size_t i = 0; i < len; ++i) {
+        auto srcAddress = reinterpret_cast<const char*>(vec[i].iov_base);
+        std::copy(srcAddress, srcAddress + vec[i].iov_len, m_pending.data() + m_pendingLen);
+        m_pendingLen += vec[i].iov_len;
     }
-    return m_communicationSocket->Write(dataBuf.data(), allSize);
+    return static_cast<int>(allSize);
 }
 
 void ServiceController::NotifyForNewData()
 {
-    m_notifyNewDataCv.notify_one();
+    if (m_streaming.load() && m_onNewData) {
+        m_onNewData();
+    }
 }
 
 int RestorePersistJobs(HilogBuffer& hilogBuffer)
@@ -617,19 +748,9 @@ int RestorePersistJobs(HilogBuffer& hilogBuffer)
             if (length >= INFO_SUFFIX && pPath.substr(length - INFO_SUFFIX, length) == ".info") {
                 if (pPath == "hilog.info") continue;
                 std::cout << __PRETTY_FUNCTION__ << " Found a persist job! Path: " << g_logPersisterDir + pPath << "\n";
-                FILE* infile = fopen((g_logPersisterDir + pPath).c_str(), "r");
-                if (infile == nullptr) {
-                    std::cerr << __PRETTY_FUNCTION__ << " Error opening recovery info file!\n";
-                    continue;
-                }
                 LogPersister::InitData initData = PersistRecoveryInfo();
                 auto& info = std::get<PersistRecoveryInfo>(initData);
-                fread(&info, sizeof(PersistRecoveryInfo), 1, infile);
-                uint64_t hashSum = 0L;
-                fread(&hashSum, sizeof(hashSum), 1, infile);
-                fclose(infile);
-                uint64_t hash = GenerateHash(info);
-                if (hash != hashSum) {
+                if (!ReadRecoveryInfo(g_logPersisterDir + pPath, info)) {
                     std::cout << __PRETTY_FUNCTION__ << " Info file checksum Failed!\n";
                     continue;
                 }
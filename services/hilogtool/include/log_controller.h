@@ -26,7 +26,7 @@
 
 namespace OHOS {
 namespace HiviewDFX {
-constexpr int RECV_BUF_LEN = MAX_LOG_LEN * 2;
+constexpr int RECV_BUF_LEN = LOG_QUERY_BATCH_MAX_LEN;
 
 void SetMsgHead(MessageHeader* msgHeader, const uint8_t msgCmd, const uint16_t msgLen);
 int MultiQuerySplit(const std::string& src, const char& delim, std::vector<std::string>& vec);
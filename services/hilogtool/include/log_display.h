@@ -25,7 +25,7 @@ namespace HiviewDFX {
 using namespace std;
 int32_t ControlCmdResult(const char* message);
 void HilogShowLog(uint32_t showFormat, HilogDataMessage* contentOut,
-    const HilogArgs* context, vector<string>& tailBuffer);
+    const HilogArgs* context, vector<string>& tailBuffer, bool contentMatched);
 } // namespace HiviewDFX
 } // namespace OHOS
 #endif
@@ -15,6 +15,7 @@
 #include <algorithm>
 #include <cstring>
 #include <cstdio>
+#include <functional>
 #include <iostream>
 #include <regex>
 #include <securec.h>
@@ -95,10 +96,39 @@ void LogQueryRequestOp(SeqPacketSocketClient& controller, const HilogArgs* conte
         }
     }
     SetMsgHead(&logQueryRequest.header, LOG_QUERY_REQUEST, sizeof(LogQueryRequest)-sizeof(MessageHeader));
-    logQueryRequest.header.version = 0;
+    logQueryRequest.header.version = LOG_QUERY_VERSION_BATCH;
+    // hilogd drops logs not matching the regex before sending them, longer ones are matched here
+    if (context->regexArgs != "" && strncpy_s(logQueryRequest.content, MAX_CONTENT_PATTERN_LEN,
+        context->regexArgs.c_str(), context->regexArgs.length()) == EOK) {
+        logQueryRequest.header.version = LOG_QUERY_VERSION_CONTENT;
+    }
     controller.WriteAll(reinterpret_cast<char*>(&logQueryRequest), sizeof(LogQueryRequest));
 }
 
+// Calls func for every log of a response until it returns false, hilogd older than batch
+// version sends one log per response. Returns false if func stopped it.
+static bool ForEachLogRecord(char* recvBuffer, uint32_t bufLen, const std::function<bool(HilogDataMessage*)>& func)
+{
+    LogQueryResponse* rsp = reinterpret_cast<LogQueryResponse*>(recvBuffer);
+    if (rsp->header.version < LOG_QUERY_VERSION_BATCH) {
+        return func(&rsp->data);
+    }
+    size_t end = std::min(static_cast<size_t>(bufLen), sizeof(MessageHeader) + rsp->header.msgLen);
+    size_t offset = sizeof(MessageHeader);
+    while (offset + sizeof(HilogDataMessage) <= end) {
+        HilogDataMessage* data = reinterpret_cast<HilogDataMessage*>(recvBuffer + offset);
+        size_t recordLen = sizeof(HilogDataMessage) + data->length;
+        if (offset + recordLen > end) {
+            break;
+        }
+        if (!func(data)) {
+            return false;
+        }
+        offset += recordLen;
+    }
+    return true;
+}
+
 void LogQueryResponseOp(SeqPacketSocketClient& controller, char* recvBuffer, uint32_t bufLen,
     const HilogArgs* context, uint32_t format)
 {
@@ -107,14 +137,35 @@ void LogQueryResponseOp(SeqPacketSocketClient& controller, char* recvBuffer, uin
     if (rsp == nullptr || context == nullptr) {
         return;
     }
-    HilogDataMessage* data = &(rsp->data);
-    if (data == nullptr) {
-        return;
-    }
-    if (data->sendId != SENDIDN) {
-        HilogShowLog(format, data, context, tailBuffer);
-    }
+    // hilogd answers with the content version only if it matches the regex itself
+    bool contentMatched = (rsp->header.version >= LOG_QUERY_VERSION_CONTENT);
+    ForEachLogRecord(recvBuffer, bufLen, [&](HilogDataMessage* data) {
+        if (data->sendId != SENDIDN) {
+            HilogShowLog(format, data, context, tailBuffer, contentMatched);
+        }
+        return true;
+    });
     NextRequestOp(controller, SENDIDA);
+    auto showNextLog = [&](HilogDataMessage* data) {
+        switch (data->sendId) {
+            case SENDIDN:
+                if (context->noBlockMode) {
+                    uint16_t i = context->tailLines;
+                    while (i-- && !tailBuffer.empty()) {
+                        cout << tailBuffer.back() << endl;
+                        tailBuffer.pop_back();
+                    }
+                    return false;
+                }
+                break;
+            case SENDIDA:
+                HilogShowLog(format, data, context, tailBuffer, contentMatched);
+                break;
+            default:
+                break;
+        }
+        return true;
+    };
     while(1) {
         std::fill_n(recvBuffer, bufLen, 0);
         if (controller.RecvMsg(recvBuffer, bufLen) == 0) {
@@ -123,24 +174,8 @@ void LogQueryResponseOp(SeqPacketSocketClient& controller, char* recvBuffer, uin
             break;
         }
 
-        if (rsp->header.msgType == NEXT_RESPONSE) {
-            switch (data->sendId) {
-                case SENDIDN:
-                    if (context->noBlockMode) {
-                        uint16_t i = context->tailLines;
-                        while (i-- && !tailBuffer.empty()) {
-                            cout << tailBuffer.back() << endl;
-                            tailBuffer.pop_back();
-                        }
-                        return;
-                    }
-                    break;
-                case SENDIDA:
-                    HilogShowLog(format, data, context, tailBuffer);
-                    break;
-                default:
-                    break;
-            }
+        if (rsp->header.msgType == NEXT_RESPONSE && !ForEachLogRecord(recvBuffer, bufLen, showNextLog)) {
+            return;
         }
     }
 }
@@ -365,6 +400,7 @@ int32_t LogPersistOp(SeqPacketSocketClient& controller, uint8_t msgCmd, LogPersi
 
             pLogPersistQueryMsg->logType = logType;
             SetMsgHead(&pLogPersistQueryReq->msgHeader, msgCmd, sizeof(LogPersistQueryMsg));
+            pLogPersistQueryReq->msgHeader.version = LOG_PERSIST_QUERY_VERSION_DICT;
             controller.WriteAll(msgToSend, sizeof(LogPersistQueryRequest));
             break;
         }
@@ -15,12 +15,14 @@
 
 #include <cstring>
 #include <iostream>
+#include <memory>
 #include <queue>
-#include <vector>
 #include <regex>
+#include <vector>
 
 #include <hilog/log.h>
 #include <format.h>
+#include <log_regex.h>
 #include <log_utils.h>
 #include <properties.h>
 
@@ -212,9 +214,12 @@ int32_t ControlCmdResult(const char* message)
             if (!pLogPersistQueryRsp) {
                 return RET_FAIL;
             }
-            LogPersistQueryResult* pLogPersistQueryRst =
-                (LogPersistQueryResult*)&pLogPersistQueryRsp->logPersistQueryRst;
-            while (pLogPersistQueryRst && resultLen < msgLen) {
+            /* hilogd which doesn't know the dictionary version answers with the base one */
+            bool hasDict = (pLogPersistQueryRsp->msgHeader.version == LOG_PERSIST_QUERY_VERSION_DICT);
+            size_t resultSize = hasDict ? sizeof(LogPersistQueryResultExt) : sizeof(LogPersistQueryResult);
+            char* pResult = (char*)&pLogPersistQueryRsp->logPersistQueryRst;
+            while (resultLen + resultSize <= msgLen) {
+                LogPersistQueryResult* pLogPersistQueryRst = (LogPersistQueryResult*)pResult;
                 if (pLogPersistQueryRst->result < 0) {
                     outputStr = "Persist task [logtype:";
                     outputStr += LogType2Str(pLogPersistQueryRst->logType);
@@ -226,6 +231,10 @@ int32_t ControlCmdResult(const char* message)
                     outputStr += ComboLogType2Str(pLogPersistQueryRst->logType);
                     outputStr += " ";
                     outputStr += CompressType2Str(pLogPersistQueryRst->compressAlg);
+                    uint32_t dictId = hasDict ? ((LogPersistQueryResultExt*)pResult)->dictId : 0;
+                    if (dictId != 0) {
+                        outputStr += "(dict:" + to_string(dictId) + ")";
+                    }
                     outputStr += " ";
                     outputStr += pLogPersistQueryRst->filePath;
                     outputStr += " ";
@@ -234,8 +243,8 @@ int32_t ControlCmdResult(const char* message)
                     outputStr += to_string(pLogPersistQueryRst->fileNum);
                     outputStr += "\n";
                 }
-                pLogPersistQueryRst++;
-                resultLen += sizeof(LogPersistQueryResult);
+                pResult += resultSize;
+                resultLen += resultSize;
             }
             break;
         }
@@ -247,21 +256,18 @@ int32_t ControlCmdResult(const char* message)
 }
 
 /*
- * Match the logs according to the regular expression
-*/
-bool HilogMatchByRegex(string context, string regExpArg)
+ * Match the logs according to the regular expression, it doesn't change and is compiled for the first log only.
+ * Patterns LogRegex doesn't take go to std::regex.
+ */
+static bool HilogMatchByRegex(const char* content, size_t len, const string& regExpArg)
 {
-    smatch regExpSmatch;
-    regex regExp(regExpArg);
-    if (regex_search(context, regExpSmatch, regExp)) {
-        return false;
-    } else {
-        return true;
-    }
+    static LogRegex regExp(regExpArg);
+    static const unique_ptr<regex> fallback = regExp.IsValid() ? nullptr : make_unique<regex>(regExpArg);
+    return fallback ? regex_search(content, content + len, *fallback) : regExp.Search(content, len);
 }
 
 void HilogShowLog(uint32_t showFormat, HilogDataMessage* data, const HilogArgs* context,
-    vector<string>& tailBuffer)
+    vector<string>& tailBuffer, bool contentMatched)
 {
     if (data->sendId == SENDIDN) {
         return;
@@ -281,9 +287,9 @@ void HilogShowLog(uint32_t showFormat, HilogDataMessage* data, const HilogArgs*
             exit(1);
         }
     }
-    if (context->regexArgs != "") {
-        string str = content;
-        if (HilogMatchByRegex(str, context->regexArgs)) {
+    if (context->regexArgs != "" && !contentMatched) {
+        size_t contentLen = (data->length > data->tag_len) ? strnlen(content, data->length - data->tag_len) : 0;
+        if (!HilogMatchByRegex(content, contentLen, context->regexArgs)) {
             return;
         }
     }
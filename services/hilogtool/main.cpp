@@ -95,7 +95,8 @@ constexpr char GUIDANCE_DESCRIPTION[] = "options include:\n"
     "  -m <compress algorithm>,--stream=<compress algorithm>\n"
     "                     none       log file without compressing\n"
     "                     zlib       compress log file by the zlib algorithm\n"
-    "                     zstd       compress log file by the zstd algorithm\n"
+    "                     zstd       compress log file by the zstd algorithm, with /system/etc/hilog_zstd.dict\n"
+    "                                if it exists, query shows its id, decompress by zstd -d -D <dictionary>\n"
     "  -v <format>, --format=<format> options:\n"
     "                     time       display local time.\n"
     "                     color      display colorful logs by log level.i.e. \x1B[38;5;231mVERBOSE\n"
@@ -0,0 +1,36 @@
+/*
+ * Copyright (c) 2022 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include "hilog_base/log_base.h"
+
+/* libhilog_base can't share a source file with hilog/log.h, both declare LogType */
+namespace {
+constexpr unsigned int BENCH_DOMAIN = 0xD002D00;
+constexpr char BENCH_TAG[] = "HiLogBenchLoud";
+constexpr int MAX_THREADS = 8;
+} // namespace
+
+/* Sends its logs to hilogd, libhilog_base doesn't allocate so allocations aren't counted */
+static void BM_BasePrint(benchmark::State& state)
+{
+    int i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(HiLogBasePrint(LOG_CORE, LOG_INFO, BENCH_DOMAIN, BENCH_TAG, "base %{public}d",
+            i++));
+    }
+}
+BENCHMARK(BM_BasePrint)->ThreadRange(1, MAX_THREADS);
@@ -0,0 +1,283 @@
+/*
+ * Copyright (c) 2022 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <cstdarg>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "format.h"
+#include "hilog/log.h"
+#include "hilog_common.h"
+#include "hilog_input_socket_client.h"
+#include "hilog_input_socket_server.h"
+#include "hilog_trace.h"
+#include "properties.h"
+#include "vsnprintf_s_p.h"
+
+/*
+ * Only C++ allocations are counted, they are what the client code can regress on.
+ * Every thread counts on its own, benchmark sums the counters of all threads.
+ */
+static thread_local uint64_t g_allocCount = 0;
+
+void *operator new(size_t size)
+{
+    g_allocCount++;
+    void *ptr = malloc(size == 0 ? 1 : size);
+    if (ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void operator delete(void *ptr) noexcept
+{
+    free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+    free(ptr);
+}
+
+using namespace OHOS::HiviewDFX;
+
+namespace {
+constexpr unsigned int BENCH_DOMAIN = 0xD002D00;
+constexpr char QUIET_TAG[] = "HiLogBenchQuiet"; /* its level filters out everything below ERROR */
+constexpr char LOUD_TAG[] = "HiLogBenchLoud";
+constexpr char STANDIN_SOCKET_NAME[] = "hilogBenchInput";
+constexpr int MAX_THREADS = 8;
+constexpr uint32_t CAPTURED_LOGS = 4096;
+constexpr uint32_t CAPTURED_LOGS_PER_SEC = 1000;
+
+class AllocCounter {
+public:
+    explicit AllocCounter(benchmark::State& state) : m_state(state), m_start(g_allocCount) {}
+
+    ~AllocCounter()
+    {
+        m_state.counters["allocs/op"] = benchmark::Counter(static_cast<double>(g_allocCount - m_start),
+            benchmark::Counter::kAvgIterations);
+    }
+
+private:
+    benchmark::State& m_state;
+    uint64_t m_start;
+};
+
+void SetUpLevels()
+{
+    static bool done = false;
+    if (!done) {
+        (void)SetTagLevel(QUIET_TAG, LOG_ERROR);
+        (void)SetTagLevel(LOUD_TAG, LOG_DEBUG);
+        done = true;
+    }
+}
+
+int FormatLog(char *buf, size_t bufLen, bool priv, const char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+#ifdef __clang__
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wformat-nonliteral"
+#elif __GNUC__
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-nonliteral"
+#endif
+    int ret = vsnprintfp_s(buf, bufLen, bufLen - 1, priv, fmt, ap);
+#ifdef __clang__
+#pragma clang diagnostic pop
+#elif __GNUC__
+#pragma GCC diagnostic pop
+#endif
+    va_end(ap);
+    return ret;
+}
+
+int FakeTraceId(uint64_t *chainId, uint32_t *flag, uint64_t *spanId, uint64_t *parentSpanId)
+{
+    *chainId = 0x1234567890abcdefULL; // 0x1234567890abcdef : any trace id
+    *flag = 0;
+    *spanId = 0x1111; // 0x1111 : any span id
+    *parentSpanId = 0x2222; // 0x2222 : any parent span id
+    return 0;
+}
+
+/* Logs like hilogtool and persisters get them from hilogd, CAPTURED_LOGS_PER_SEC in every second */
+const std::vector<HilogShowFormatBuffer>& CapturedLogs()
+{
+    static const std::string data = std::string(LOUD_TAG) + '\0' + "captured log line with a few words";
+    static std::vector<HilogShowFormatBuffer> logs;
+    if (logs.empty()) {
+        uint32_t nsecStep = NSEC / CAPTURED_LOGS_PER_SEC;
+        for (uint32_t i = 0; i < CAPTURED_LOGS; i++) {
+            HilogShowFormatBuffer log = {0};
+            log.level = LOG_INFO;
+            log.tag_len = sizeof(LOUD_TAG);
+            log.pid = 1234; // 1234 : any pid
+            log.tid = 1234 + i % 4; // 1234 : any pid, 4 : threads
+            log.domain = BENCH_DOMAIN;
+            log.tv_sec = 1650000000 + i / CAPTURED_LOGS_PER_SEC; // 1650000000 : any time
+            log.tv_nsec = (i % CAPTURED_LOGS_PER_SEC) * nsecStep;
+            log.data = data.c_str();
+            logs.push_back(log);
+        }
+    }
+    return logs;
+}
+
+/* Stand-in for hilogd which only counts received records */
+class StandInServer {
+public:
+    StandInServer()
+        : m_server(STANDIN_SOCKET_NAME, [this](std::vector<DgramPacket>& packets) {
+            m_packets.fetch_add(packets.size(), std::memory_order_relaxed);
+        })
+    {
+        m_running = (m_server.Init() >= 0 && m_server.RunServingThread() !=
+            HilogInputSocketServer::ServerThreadState::CAN_NOT_START);
+    }
+
+    bool IsRunning() const
+    {
+        return m_running;
+    }
+
+private:
+    HilogInputSocketServer m_server;
+    std::atomic<uint64_t> m_packets {0};
+    bool m_running = false;
+};
+} // namespace
+
+static void BM_IsLoggableDisabled(benchmark::State& state)
+{
+    SetUpLevels();
+    AllocCounter allocs(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(HiLogIsLoggable(BENCH_DOMAIN, QUIET_TAG, LOG_DEBUG));
+    }
+}
+BENCHMARK(BM_IsLoggableDisabled)->ThreadRange(1, MAX_THREADS);
+
+static void BM_PrintDisabled(benchmark::State& state)
+{
+    SetUpLevels();
+    AllocCounter allocs(state);
+    int i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(HiLogPrint(LOG_CORE, LOG_DEBUG, BENCH_DOMAIN, QUIET_TAG, "value %{public}d", i++));
+    }
+}
+BENCHMARK(BM_PrintDisabled)->ThreadRange(1, MAX_THREADS);
+
+#define FORMAT_BENCHMARK(name, priv, fmt, ...)                                             \
+    static void BM_Format##name(benchmark::State& state)                                   \
+    {                                                                                      \
+        char buf[MAX_LOG_LEN];                                                             \
+        AllocCounter allocs(state);                                                        \
+        for (auto _ : state) {                                                             \
+            benchmark::DoNotOptimize(FormatLog(buf, sizeof(buf), priv, fmt, __VA_ARGS__)); \
+        }                                                                                  \
+    }                                                                                      \
+    BENCHMARK(BM_Format##name)
+
+FORMAT_BENCHMARK(PublicInt, true, "count %{public}d of %{public}u", -12345, 67890u);
+FORMAT_BENCHMARK(PrivateInt, true, "count %d of %u", -12345, 67890u);
+FORMAT_BENCHMARK(PublicString, true, "name %{public}s at %{public}s", "hilog_benchmark", "/data/local/tmp");
+FORMAT_BENCHMARK(PrivateString, true, "name %s at %s", "hilog_benchmark", "/data/local/tmp");
+FORMAT_BENCHMARK(PublicFloat, true, "ratio %{public}.3f and %{public}e", 3.14159, 2.5e10);
+FORMAT_BENCHMARK(PrivateFloat, true, "ratio %.3f and %e", 3.14159, 2.5e10);
+FORMAT_BENCHMARK(Mixed, false, "pid %d tag %s value %.2f", 1234, "bench", 0.5);
+
+static void BM_ShowBuffer(benchmark::State& state)
+{
+    const std::vector<HilogShowFormatBuffer>& logs = CapturedLogs();
+    uint32_t showFormat = static_cast<uint32_t>(state.range(0));
+    char buf[MAX_LOG_LEN];
+    size_t i = 0;
+    AllocCounter allocs(state);
+    for (auto _ : state) {
+        HilogShowBuffer(buf, sizeof(buf), logs[i], showFormat);
+        benchmark::DoNotOptimize(buf);
+        i = (i + 1) % logs.size();
+    }
+}
+BENCHMARK(BM_ShowBuffer)->Arg(OFF_SHOWFORMAT)->Arg(1 << TIME_USEC_SHOWFORMAT)->Arg(1 << YEAR_SHOWFORMAT)
+    ->Arg(1 << EPOCH_SHOWFORMAT)->Arg((1 << COLOR_SHOWFORMAT) | (1 << TIME_NSEC_SHOWFORMAT)); // format of hilogtool -v
+
+/* Below cases send their logs to hilogd, flow control of the device applies */
+static void BM_PrintEnabled(benchmark::State& state)
+{
+    SetUpLevels();
+    AllocCounter allocs(state);
+    int i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(HiLogPrint(LOG_CORE, LOG_INFO, BENCH_DOMAIN, LOUD_TAG, "value %{public}d", i++));
+    }
+}
+BENCHMARK(BM_PrintEnabled)->ThreadRange(1, MAX_THREADS);
+
+static void BM_PrintWithTraceId(benchmark::State& state)
+{
+    SetUpLevels();
+    if (HiLogRegisterGetIdFun(FakeTraceId) != 0) {
+        state.SkipWithError("another trace id function is registered");
+        return;
+    }
+    {
+        AllocCounter allocs(state);
+        int i = 0;
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(HiLogPrint(LOG_CORE, LOG_INFO, BENCH_DOMAIN, LOUD_TAG, "traced %{public}d",
+                i++));
+        }
+    }
+    HiLogUnregisterGetIdFun(FakeTraceId);
+}
+BENCHMARK(BM_PrintWithTraceId);
+
+/* Socket send alone, a local server stands in for hilogd */
+static void BM_WriteLogMessageStandIn(benchmark::State& state)
+{
+    static StandInServer server;
+    static HilogInputSocketClient client(STANDIN_SOCKET_NAME);
+    if (!server.IsRunning()) {
+        state.SkipWithError("can't start stand-in server");
+        return;
+    }
+    std::string text(static_cast<size_t>(state.range(0)), 'x');
+    AllocCounter allocs(state);
+    for (auto _ : state) {
+        HilogMsg header = {0};
+        header.type = LOG_CORE;
+        header.level = LOG_INFO;
+        header.domain = BENCH_DOMAIN;
+        benchmark::DoNotOptimize(client.WriteLogMessage(&header, LOUD_TAG, sizeof(LOUD_TAG), text.c_str(),
+            text.size() + 1));
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(text.size() + 1));
+}
+BENCHMARK(BM_WriteLogMessageStandIn)->Arg(32)->Arg(256)->Arg(1000)->ThreadRange(1, MAX_THREADS); // bytes of log
+
+BENCHMARK_MAIN();
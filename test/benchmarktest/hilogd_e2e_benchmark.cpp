@@ -0,0 +1,598 @@
+/*
+ * Copyright (c) 2022 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * End to end benchmark of hilogd: a complete daemon pipeline (input socket server, LogCollector,
+ * LogIngestQueue, HilogBuffer, CmdExecutor and persisters) runs in this process on its own sockets,
+ * synthetic producers write to it and query clients read the logs back through the control socket.
+ * Every log carries the monotonic time it was sent at, readers measure send-to-read latency from it.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <dirent.h>
+#include <getopt.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <hilog_common.h>
+#include <hilog_input_socket_client.h>
+#include <hilog_input_socket_server.h>
+#include <hilog_msg.h>
+#include <seq_packet_socket_client.h>
+#include <securec.h>
+
+#include "cmd_executor.h"
+#include "log_buffer.h"
+#include "log_collector.h"
+#include "log_ingest_queue.h"
+#include "log_persister.h"
+
+using namespace OHOS::HiviewDFX;
+
+namespace {
+constexpr char INPUT_NAME_PREFIX[] = "hilogBenchE2EInput";
+constexpr char CONTROL_NAME_PREFIX[] = "hilogBenchE2EControl";
+constexpr char BENCH_TAG[] = "HiLogE2EBench";
+constexpr uint32_t BENCH_DOMAIN = 0xD002D00;
+constexpr uint32_t PERSISTER_JOB_ID_BASE = 0xE2E00;
+constexpr uint32_t PERSISTER_FILE_SIZE = 4 * 1024 * 1024; // 4 * 1024 * 1024 : 4MB for each file
+constexpr uint32_t PERSISTER_FILE_NUM = 10;
+constexpr int READER_TIMEOUT_MS = 200;
+constexpr uint64_t NSEC_PER_SEC = 1000000000ULL;
+constexpr int DRAIN_IDLE_MS = 1000;
+constexpr int DRAIN_MAX_MS = 10000;
+constexpr int RSS_SAMPLE_MS = 100;
+constexpr int PERCENT = 100;
+
+struct BenchConfig {
+    unsigned int producers = 4;
+    unsigned int rate = 0; /* lines per second of each producer, 0 means as fast as possible */
+    unsigned int lineSize = 128;
+    unsigned int readers = 1;
+    unsigned int persisters = 0;
+    uint16_t compressAlg = COMPRESS_TYPE_NONE;
+    unsigned int seconds = 10;
+    bool forkProducers = false;
+    uint8_t queryVersion = LOG_QUERY_VERSION_BATCH;
+    std::string content; /* regex query clients ask hilogd to match, e.g. "^0 " for logs of producer 0 */
+    std::string persistDir = "/data/local/tmp";
+};
+
+/* Plain data so forked producers can pass it back through a pipe */
+struct ProducerStats {
+    uint64_t sent;
+    uint64_t failed;
+};
+
+struct ReaderStats {
+    uint64_t received = 0;
+    std::vector<uint64_t> latencies;
+};
+
+uint64_t NowNs()
+{
+    timespec ts = {0};
+    (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * NSEC_PER_SEC + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+std::string UniqueName(const char *prefix)
+{
+    return std::string(prefix) + std::to_string(getpid());
+}
+
+void PrintUsage(const char *name)
+{
+    std::cout << "Usage: " << name << " [options]\n"
+        "  -p <num>   producers, default 4\n"
+        "  -r <num>   lines per second of each producer, 0 (default) means unlimited\n"
+        "  -s <num>   bytes of each line, default 128\n"
+        "  -q <num>   query clients attached through the control socket, default 1\n"
+        "  -w <num>   persisters, default 0\n"
+        "  -z <alg>   compression of persisters: none (default), zlib or zstd\n"
+        "  -o <dir>   directory of persisted files, default /data/local/tmp\n"
+        "  -d <sec>   duration of producing, default 10\n"
+        "  -f         producers are forked processes instead of threads\n"
+        "  -1         query clients read one log per response (LOG_QUERY_VERSION_SINGLE)\n"
+        "  -e <regex> query clients get only logs whose content matches, lines start with the producer\n";
+}
+
+bool ParseConfig(int argc, char *argv[], BenchConfig& config)
+{
+    int opt;
+    while ((opt = getopt(argc, argv, "p:r:s:q:w:z:o:d:f1e:h")) != -1) {
+        switch (opt) {
+            case 'p':
+                config.producers = static_cast<unsigned int>(strtoul(optarg, nullptr, 0));
+                break;
+            case 'r':
+                config.rate = static_cast<unsigned int>(strtoul(optarg, nullptr, 0));
+                break;
+            case 's':
+                config.lineSize = static_cast<unsigned int>(strtoul(optarg, nullptr, 0));
+                break;
+            case 'q':
+                config.readers = static_cast<unsigned int>(strtoul(optarg, nullptr, 0));
+                break;
+            case 'w':
+                config.persisters = static_cast<unsigned int>(strtoul(optarg, nullptr, 0));
+                break;
+            case 'z':
+                if (strcmp(optarg, "zlib") == 0) {
+                    config.compressAlg = COMPRESS_TYPE_ZLIB;
+                } else if (strcmp(optarg, "zstd") == 0) {
+                    config.compressAlg = COMPRESS_TYPE_ZSTD;
+                } else if (strcmp(optarg, "none") == 0) {
+                    config.compressAlg = COMPRESS_TYPE_NONE;
+                } else {
+                    return false;
+                }
+                break;
+            case 'o':
+                config.persistDir = optarg;
+                break;
+            case 'd':
+                config.seconds = static_cast<unsigned int>(strtoul(optarg, nullptr, 0));
+                break;
+            case 'f':
+                config.forkProducers = true;
+                break;
+            case '1':
+                config.queryVersion = LOG_QUERY_VERSION_SINGLE;
+                break;
+            case 'e':
+                config.content = optarg;
+                break;
+            default:
+                return false;
+        }
+    }
+    if (!config.content.empty() && config.queryVersion != LOG_QUERY_VERSION_SINGLE) {
+        config.queryVersion = LOG_QUERY_VERSION_CONTENT;
+    }
+    // 32 : room for the header of the line, see FillLine()
+    if (config.content.size() >= MAX_CONTENT_PATTERN_LEN || config.producers == 0 || config.seconds == 0 ||
+        config.lineSize < 32 || config.lineSize >= MAX_LOG_LEN) {
+        return false;
+    }
+    return true;
+}
+
+/* Line is "<producer> <sequence> <send time in ns> xxxx...", padded to the configured size */
+void FillLine(std::vector<char>& line, unsigned int producer, uint64_t seq)
+{
+    int ret = snprintf_s(line.data(), line.size(), line.size() - 1, "%u %" PRIu64 " %" PRIu64 " ",
+        producer, seq, NowNs());
+    if (ret > 0 && static_cast<size_t>(ret) < line.size() - 1) {
+        line[ret] = 'x';
+    }
+}
+
+ProducerStats RunProducer(const BenchConfig& config, const std::string& inputName, unsigned int id)
+{
+    ProducerStats stats = {0, 0};
+    HilogInputSocketClient client(inputName);
+    std::vector<char> line(config.lineSize, 'x');
+    line.back() = '\0';
+
+    const uint64_t start = NowNs();
+    const uint64_t end = start + config.seconds * NSEC_PER_SEC;
+    const uint64_t interval = (config.rate == 0) ? 0 : NSEC_PER_SEC / config.rate;
+    uint64_t next = start;
+    for (uint64_t seq = 0;; ++seq) {
+        uint64_t now = NowNs();
+        if (now >= end) {
+            break;
+        }
+        if (interval != 0) {
+            if (next > now) {
+                std::this_thread::sleep_for(std::chrono::nanoseconds(next - now));
+            }
+            next += interval;
+        }
+        FillLine(line, id, seq);
+        HilogMsg header = {0};
+        header.type = LOG_CORE;
+        header.level = LOG_INFO;
+        header.domain = BENCH_DOMAIN;
+        if (client.WriteLogMessage(&header, BENCH_TAG, sizeof(BENCH_TAG), line.data(), line.size()) < 0) {
+            stats.failed++; /* input socket is full */
+        } else {
+            stats.sent++;
+        }
+    }
+    return stats;
+}
+
+void CountLog(const HilogDataMessage& data, uint64_t now, ReaderStats& stats)
+{
+    if (data.sendId != SENDIDA || data.tag_len >= data.length) {
+        return;
+    }
+    const char *content = data.data + data.tag_len;
+    char *pos = nullptr;
+    (void)strtoul(content, &pos, 10); // 10 : decimal, producer id
+    (void)strtoull(pos, &pos, 10); // 10 : decimal, sequence
+    uint64_t sendTime = strtoull(pos, nullptr, 10); // 10 : decimal, send time
+    stats.received++;
+    if (sendTime != 0 && sendTime <= now) {
+        stats.latencies.push_back(now - sendTime);
+    }
+}
+
+/* hilogd only writes to a streaming reader when it has logs, readers wake up now and then to see if they are stopped */
+class ReaderSocket : public SeqPacketSocketClient {
+public:
+    using SeqPacketSocketClient::SeqPacketSocketClient;
+
+    int SetRecvTimeout(int timeoutMs)
+    {
+        timeval timeout = {timeoutMs / 1000, (timeoutMs % 1000) * 1000}; // 1000 : msec convert to sec and usec
+        return setsockopt(socketHandler, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    }
+};
+
+void RunReader(const BenchConfig& config, const std::string& controlName, const std::atomic<bool>& stop,
+    ReaderStats& stats)
+{
+    ReaderSocket client(controlName, 0);
+    if (client.Init() != CREATE_AND_CONNECTED || client.SetRecvTimeout(READER_TIMEOUT_MS) < 0) {
+        std::cerr << "Reader can't connect to " << controlName << "\n";
+        return;
+    }
+    LogQueryRequest request = {{0}};
+    request.header.version = config.queryVersion;
+    request.header.msgType = LOG_QUERY_REQUEST;
+    request.header.msgLen = sizeof(LogQueryRequest) - sizeof(MessageHeader);
+    request.levels = (0b01 << LOG_INFO);
+    request.types = (0b01 << LOG_CORE);
+    request.nTag = 1;
+    if (strcpy_s(request.tags[0], MAX_TAG_LEN, BENCH_TAG) != 0 ||
+        strcpy_s(request.content, MAX_CONTENT_PATTERN_LEN, config.content.c_str()) != 0) {
+        return;
+    }
+    client.WriteAll(reinterpret_cast<char*>(&request), sizeof(request));
+
+    NextRequest next = {{0}};
+    next.header.msgType = NEXT_REQUEST;
+    next.header.msgLen = sizeof(NextRequest) - sizeof(MessageHeader);
+    next.sendId = SENDIDA;
+    client.WriteAll(reinterpret_cast<char*>(&next), sizeof(next));
+
+    std::vector<char> buffer(LOG_QUERY_BATCH_MAX_LEN);
+    while (!stop.load()) {
+        int len = client.RecvMsg(buffer.data(), buffer.size());
+        if (len < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            continue;
+        } else if (len <= 0) {
+            break;
+        }
+        uint64_t now = NowNs();
+        const LogQueryResponse* rsp = reinterpret_cast<const LogQueryResponse*>(buffer.data());
+        if (rsp->header.version < LOG_QUERY_VERSION_BATCH) {
+            CountLog(rsp->data, now, stats);
+            continue;
+        }
+        size_t end = std::min(static_cast<size_t>(len), sizeof(MessageHeader) + rsp->header.msgLen);
+        for (size_t offset = sizeof(MessageHeader); offset + sizeof(HilogDataMessage) <= end;) {
+            const HilogDataMessage& data = *reinterpret_cast<const HilogDataMessage*>(buffer.data() + offset);
+            offset += sizeof(HilogDataMessage) + data.length;
+            if (offset > end) {
+                break;
+            }
+            CountLog(data, now, stats);
+        }
+    }
+}
+
+std::shared_ptr<LogPersister> StartPersister(HilogBuffer& buffer, const BenchConfig& config, unsigned int index)
+{
+    LogPersistStartMsg msg = {0};
+    msg.logType = (0b01 << LOG_CORE);
+    msg.compressAlg = config.compressAlg;
+    msg.fileSize = PERSISTER_FILE_SIZE;
+    msg.fileNum = PERSISTER_FILE_NUM;
+    msg.jobId = PERSISTER_JOB_ID_BASE + index;
+    std::string path = config.persistDir + "/hilog_e2e_bench" + std::to_string(index);
+    if (strcpy_s(msg.filePath, FILE_PATH_MAX_LEN, path.c_str()) != 0) {
+        return nullptr;
+    }
+    std::shared_ptr<LogPersister> persister = LogPersister::CreateLogPersister(buffer);
+    if (persister == nullptr) {
+        return nullptr;
+    }
+    int ret = persister->Init(msg);
+    if (ret != RET_SUCCESS) {
+        std::cerr << "Persister " << path << " init failed: " << ret << "\n";
+        return nullptr;
+    }
+    persister->Start();
+    return persister;
+}
+
+uint64_t PersistedBytes(const std::string& dir)
+{
+    uint64_t total = 0;
+    DIR *dp = opendir(dir.c_str());
+    if (dp == nullptr) {
+        return 0;
+    }
+    while (dirent *entry = readdir(dp)) {
+        if (strncmp(entry->d_name, "hilog_e2e_bench", strlen("hilog_e2e_bench")) != 0) {
+            continue;
+        }
+        struct stat st = {0};
+        if (stat((dir + "/" + entry->d_name).c_str(), &st) == 0) {
+            total += static_cast<uint64_t>(st.st_size);
+        }
+    }
+    closedir(dp);
+    return total;
+}
+
+/* Returns VmRSS and VmHWM of this process in kB */
+void ReadRss(uint64_t& rss, uint64_t& hwm)
+{
+    std::ifstream status("/proc/self/status");
+    std::string key;
+    while (status >> key) {
+        if (key == "VmRSS:") {
+            status >> rss;
+        } else if (key == "VmHWM:") {
+            status >> hwm;
+        }
+        status.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    }
+}
+
+class Producers {
+public:
+    Producers(const BenchConfig& config, const std::string& inputName) : m_config(config), m_inputName(inputName)
+    {
+        m_stats.resize(config.producers, {0, 0});
+    }
+
+    void Start()
+    {
+        for (unsigned int i = 0; i < m_config.producers; ++i) {
+            if (m_config.forkProducers) {
+                StartProcess(i);
+            } else {
+                m_threads.emplace_back([this, i]() { m_stats[i] = RunProducer(m_config, m_inputName, i); });
+            }
+        }
+    }
+
+    ProducerStats Join()
+    {
+        for (auto& thread : m_threads) {
+            thread.join();
+        }
+        for (auto& child : m_children) {
+            ProducerStats stats = {0, 0};
+            if (read(child.second, &stats, sizeof(stats)) == sizeof(stats)) {
+                m_stats.push_back(stats);
+            }
+            close(child.second);
+            (void)waitpid(child.first, nullptr, 0);
+        }
+        ProducerStats total = {0, 0};
+        for (const auto& stats : m_stats) {
+            total.sent += stats.sent;
+            total.failed += stats.failed;
+        }
+        return total;
+    }
+
+private:
+    void StartProcess(unsigned int id)
+    {
+        int fds[2]; // 2 : read and write end of the pipe
+        if (pipe(fds) != 0) {
+            return;
+        }
+        pid_t pid = fork();
+        if (pid == 0) {
+            close(fds[0]);
+            ProducerStats stats = RunProducer(m_config, m_inputName, id);
+            (void)write(fds[1], &stats, sizeof(stats));
+            _exit(0);
+        }
+        close(fds[1]);
+        if (pid < 0) {
+            close(fds[0]);
+            return;
+        }
+        m_children.emplace_back(pid, fds[0]);
+    }
+
+    const BenchConfig& m_config;
+    std::string m_inputName;
+    std::vector<ProducerStats> m_stats;
+    std::vector<std::thread> m_threads;
+    std::vector<std::pair<pid_t, int>> m_children;
+};
+
+uint64_t Percentile(const std::vector<uint64_t>& sorted, double percent)
+{
+    if (sorted.empty()) {
+        return 0;
+    }
+    size_t index = static_cast<size_t>(percent / PERCENT * (sorted.size() - 1));
+    return sorted[index];
+}
+
+void PrintLatency(std::vector<uint64_t>& latencies)
+{
+    std::sort(latencies.begin(), latencies.end());
+    constexpr double nsPerUs = 1000.0;
+    std::cout << "latency(us): samples " << latencies.size()
+        << " p50 " << Percentile(latencies, 50) / nsPerUs // 50 : median
+        << " p99 " << Percentile(latencies, 99) / nsPerUs // 99 : 99th percentile
+        << " p999 " << Percentile(latencies, 99.9) / nsPerUs // 99.9 : 99.9th percentile
+        << " max " << (latencies.empty() ? 0 : latencies.back()) / nsPerUs << "\n";
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    BenchConfig config;
+    if (!ParseConfig(argc, argv, config)) {
+        PrintUsage(argv[0]);
+        return RET_FAIL;
+    }
+    const std::string inputName = UniqueName(INPUT_NAME_PREFIX);
+    const std::string controlName = UniqueName(CONTROL_NAME_PREFIX);
+
+    // Same pipeline as HilogdEntry(), only sockets are private to this run
+    HilogBuffer hilogBuffer;
+    LogIngestQueue ingestQueue(hilogBuffer);
+    ingestQueue.Start();
+    LogCollector logCollector(ingestQueue);
+    std::mutex collectorMtx;
+    std::atomic<uint64_t> ingested {0};
+    HilogInputSocketServer incomingLogsServer(inputName,
+        [&logCollector, &collectorMtx, &ingested](std::vector<DgramPacket>& packets) {
+            ingested.fetch_add(packets.size(), std::memory_order_relaxed);
+            std::lock_guard<std::mutex> lock(collectorMtx);
+            logCollector.onBatchRecv(packets);
+        });
+    if (incomingLogsServer.Init() < 0 ||
+        incomingLogsServer.RunServingThread() == HilogInputSocketServer::ServerThreadState::CAN_NOT_START) {
+        std::cerr << "Can't start input server " << inputName << "\n";
+        return RET_FAIL;
+    }
+    CmdExecutor cmdExecutor(hilogBuffer, controlName);
+    std::thread cmdThread(&CmdExecutor::MainLoop, &cmdExecutor);
+
+    std::vector<std::shared_ptr<LogPersister>> persisters;
+    for (unsigned int i = 0; i < config.persisters; ++i) {
+        if (auto persister = StartPersister(hilogBuffer, config, i); persister != nullptr) {
+            persisters.push_back(persister);
+        }
+    }
+
+    std::atomic<bool> stopReaders {false};
+    std::vector<ReaderStats> readerStats(config.readers);
+    std::vector<std::thread> readers;
+    for (unsigned int i = 0; i < config.readers; ++i) {
+        readers.emplace_back(RunReader, std::cref(config), std::cref(controlName), std::cref(stopReaders),
+            std::ref(readerStats[i]));
+    }
+    // 100 : give readers time to connect before logs arrive
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    uint64_t rss = 0;
+    uint64_t hwm = 0;
+    ReadRss(rss, hwm);
+    const uint64_t baseRss = rss;
+    uint64_t peakRss = rss;
+
+    const uint64_t start = NowNs();
+    Producers producers(config, inputName);
+    producers.Start();
+    std::thread rssSampler([&]() {
+        const uint64_t end = start + config.seconds * NSEC_PER_SEC;
+        while (NowNs() < end) {
+            uint64_t sampleRss = 0;
+            uint64_t sampleHwm = 0;
+            ReadRss(sampleRss, sampleHwm);
+            peakRss = std::max(peakRss, sampleRss);
+            std::this_thread::sleep_for(std::chrono::milliseconds(RSS_SAMPLE_MS));
+        }
+    });
+    ProducerStats sent = producers.Join();
+    rssSampler.join();
+    const uint64_t produceEnd = NowNs();
+
+    // Let readers catch up, until nothing new arrives for a while
+    auto readTotal = [&readerStats]() {
+        uint64_t total = 0;
+        for (const auto& stats : readerStats) {
+            total += stats.received;
+        }
+        return total;
+    };
+    uint64_t lastRead = readTotal();
+    for (int waited = 0, idle = 0; waited < DRAIN_MAX_MS && idle < DRAIN_IDLE_MS; waited += RSS_SAMPLE_MS) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(RSS_SAMPLE_MS));
+        uint64_t nowRead = readTotal();
+        idle = (nowRead == lastRead) ? (idle + RSS_SAMPLE_MS) : 0;
+        lastRead = nowRead;
+    }
+    const uint64_t drainEnd = NowNs();
+    const uint64_t ingestedTotal = ingested.load();
+    ReadRss(rss, hwm);
+
+    stopReaders.store(true);
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    for (auto& persister : persisters) {
+        (void)persister->Deinit();
+    }
+    cmdExecutor.Stop();
+    cmdThread.join();
+
+    const double produceSec = static_cast<double>(produceEnd - start) / NSEC_PER_SEC;
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "config: producers " << config.producers << (config.forkProducers ? " (processes)" : " (threads)")
+        << " rate " << config.rate << " line " << config.lineSize << "B readers " << config.readers
+        << " persisters " << config.persisters << " duration " << config.seconds << "s query version "
+        << static_cast<unsigned int>(config.queryVersion) << "\n";
+    std::cout << "producers: sent " << sent.sent << " socket full " << sent.failed
+        << " (" << sent.sent / produceSec << " lines/s)\n";
+    std::cout << "hilogd: ingested " << ingestedTotal << " (" << ingestedTotal / produceSec << " lines/s)"
+        << " lost in socket " << (sent.sent > ingestedTotal ? sent.sent - ingestedTotal : 0)
+        << " dropped by ingest queue " << ingestQueue.GetDropped() << "\n";
+    std::vector<uint64_t> latencies;
+    for (unsigned int i = 0; i < config.readers; ++i) {
+        const ReaderStats& stats = readerStats[i];
+        std::cout << "reader " << i << ": received " << stats.received;
+        if (config.content.empty()) { // every sent log is expected
+            std::cout << " missed " << (sent.sent > stats.received ? sent.sent - stats.received : 0);
+        }
+        std::cout << "\n";
+        latencies.insert(latencies.end(), stats.latencies.begin(), stats.latencies.end());
+    }
+    PrintLatency(latencies);
+    if (!persisters.empty()) {
+        std::cout << "persisters: " << persisters.size() << " wrote " << PersistedBytes(config.persistDir)
+            << " bytes to " << config.persistDir << "\n";
+    }
+    std::cout << "rss(kB): start " << baseRss << " peak " << peakRss << " end " << rss << " hwm " << hwm
+        << " drain " << static_cast<double>(drainEnd - produceEnd) / NSEC_PER_SEC << "s\n";
+    return RET_SUCCESS;
+}
@@ -0,0 +1,191 @@
+/*
+ * Copyright (c) 2022 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <chrono>
+#include <cinttypes>
+#include <cstdlib>
+#include <cstring>
+#include <regex>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <securec.h>
+
+#include "hilog/log.h"
+#include "hilog_common.h"
+#include "kmsg_parser.h"
+
+using namespace OHOS::HiviewDFX;
+
+namespace {
+constexpr int DEC = 10;
+
+/* Records as read from /dev/kmsg of a device during boot, one record per read */
+const std::vector<std::string> KMSG_CORPUS = {
+    "6,339,5140900,-;NET: Registered protocol family 10\n",
+    "6,340,5173217,-;usb 1-1: new high-speed USB device number 2 using xhci_hcd\n SUBSYSTEM=usb\n DEVICE=c189:1\n",
+    "4,341,5200011,-;[drm:intel_dp_detect [i915]] DP-1: EDID checksum failed\n",
+    "3,342,5231180,-;[pid=812][hilogd] write failed: -11\n",
+    "6,343,5250000,c;[pid=1,cpu0,init] Service hilogd started\n",
+    "12,344,5260000,-;init: starting service 'hiview'...\n",
+    "7,345,5280000,-;dwc3 10e30000.dwc3: [pid=55] enter suspend, [link] state changed\n",
+    "6,346,5290000,-;mmc0: new HS400 Enhanced strobe MMC card at address 0001, "
+        "mmcblk0: mmc0:0001 KLUDG4UHDB-B2D1 116 GiB, mmcblk0boot0: mmc0:0001 partition 1 4.00 MiB, "
+        "mmcblk0boot1: mmc0:0001 partition 2 4.00 MiB, mmcblk0rpmb: mmc0:0001 partition 3 16.0 MiB\n",
+    "5,347,5300000,-;[a[pid=9]b] joined brackets\n",
+    "6,348,5310000,-;EXT4-fs (mmcblk0p12): mounted filesystem with ordered data mode. Opts: (null)\n",
+};
+
+/* Parser which was used before, kept as reference */
+void RegexParseHeader(std::string& str, uint16_t* level, uint64_t* timestamp)
+{
+    static const std::regex express("(\\d+),(\\d+),(\\d+),(\\S);");
+    std::match_results<std::string::iterator> res;
+    if (std::regex_search(str.begin(), str.end(), res, express)) {
+        *level = strtoul(res[1].str().c_str(), nullptr, DEC);
+        *timestamp = strtoumax(res[3].str().c_str(), nullptr, DEC);
+        str.erase(res.position(), res.length());
+    }
+}
+
+uint32_t RegexParsePid(std::string& str)
+{
+    static const std::regex express("\\[pid=(\\d+)\\]");
+    std::match_results<std::string::iterator> res;
+    if (std::regex_search(str.begin(), str.end(), res, express)) {
+        uint32_t ret = strtoumax(res[1].str().c_str(), nullptr, DEC);
+        str.erase(res.position(), res.length());
+        return ret;
+    }
+    return 0;
+}
+
+std::string RegexParseTag(std::string& str)
+{
+    static const std::regex express("\\[.*?\\]");
+    std::match_results<std::string::iterator> res;
+    if (std::regex_search(str.begin(), str.end(), res, express)) {
+        std::string ret = res[0].str();
+        str.erase(res.position(), res.length());
+        return ret;
+    }
+    return {};
+}
+
+uint16_t KmsgLevelMap(uint16_t prio)
+{
+    constexpr uint16_t fatalPrio = 2; // 0..2 : emerg, alert, crit
+    constexpr uint16_t errorPrio = 3;
+    constexpr uint16_t warnPrio = 5; // 4..5 : warning, notice
+    constexpr uint16_t infoPrio = 6;
+    if (prio <= fatalPrio) {
+        return LOG_FATAL;
+    } else if (prio == errorPrio) {
+        return LOG_ERROR;
+    } else if (prio <= warnPrio) {
+        return LOG_WARN;
+    } else if (prio == infoPrio) {
+        return LOG_INFO;
+    }
+    return LOG_DEBUG;
+}
+
+std::vector<char> RegexParseKmsg(const std::vector<char>& kmsgBuffer)
+{
+    std::string kmsgStr(kmsgBuffer.data());
+    uint16_t mLevel = 0;
+    uint64_t timestamp = 0;
+    RegexParseHeader(kmsgStr, &mLevel, &timestamp);
+    uint32_t mpid = RegexParsePid(kmsgStr);
+    std::string tagStr = RegexParseTag(kmsgStr);
+    if (tagStr.empty()) {
+        tagStr = "kmsg";
+    }
+    std::vector<char> mtag(MAX_TAG_LEN, '\0');
+    if (strncpy_s(mtag.data(), MAX_TAG_LEN - 1, tagStr.c_str(), tagStr.size()) != 0) {
+        return {};
+    }
+    auto len = kmsgStr.size() + 1;
+    auto msgLen = sizeof(HilogMsg) + tagStr.size() + len + 1;
+    std::vector<char> msgBuffer(msgLen, '\0');
+    HilogMsg& msg = *reinterpret_cast<HilogMsg*>(msgBuffer.data());
+    msg.len = msgLen;
+    msg.tag_len = tagStr.size() + 1;
+    msg.type = LOG_KMSG;
+    msg.level = KmsgLevelMap(mLevel);
+    auto logtime = KmsgParser::BootTime() + std::chrono::microseconds{timestamp};
+    msg.tv_sec = static_cast<uint32_t>(std::chrono::time_point_cast<std::chrono::seconds>(logtime)
+        .time_since_epoch().count());
+    msg.pid = mpid;
+    msg.tid = mpid;
+    if (strncpy_s(msg.tag, tagStr.size() + 1, tagStr.c_str(), tagStr.size()) != 0 ||
+        strncpy_s(CONTENT_PTR((&msg)), MAX_LOG_LEN, kmsgStr.c_str(), len) != 0) {
+        return {};
+    }
+    return msgBuffer;
+}
+
+bool SameAsRegex(KmsgParser& parser, const std::string& record)
+{
+    std::vector<char> buffer(record.begin(), record.end());
+    buffer.push_back('\0');
+    std::vector<char> expected = RegexParseKmsg(buffer);
+    const HilogMsg* msg = parser.ParseKmsg(record.c_str(), record.size());
+    if (expected.empty() || msg == nullptr) {
+        return expected.empty() && msg == nullptr;
+    }
+    const HilogMsg& ref = *reinterpret_cast<const HilogMsg*>(expected.data());
+    return ref.len == msg->len && ref.tag_len == msg->tag_len && ref.level == msg->level && ref.pid == msg->pid &&
+        strcmp(ref.tag, msg->tag) == 0 && strcmp(CONTENT_PTR((&ref)), CONTENT_PTR(msg)) == 0;
+}
+} // namespace
+
+static void BM_ParseKmsgRegex(benchmark::State& state)
+{
+    std::vector<std::vector<char>> records;
+    for (const std::string& record : KMSG_CORPUS) {
+        records.emplace_back(record.begin(), record.end());
+        records.back().push_back('\0');
+    }
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(RegexParseKmsg(records[i]));
+        i = (i + 1) % records.size();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ParseKmsgRegex);
+
+static void BM_ParseKmsg(benchmark::State& state)
+{
+    KmsgParser parser;
+    for (const std::string& record : KMSG_CORPUS) {
+        if (!SameAsRegex(parser, record)) {
+            state.SkipWithError(("parsed unlike the regex parser: " + record).c_str());
+            return;
+        }
+    }
+    size_t i = 0;
+    for (auto _ : state) {
+        const std::string& record = KMSG_CORPUS[i];
+        benchmark::DoNotOptimize(parser.ParseKmsg(record.c_str(), record.size()));
+        i = (i + 1) % KMSG_CORPUS.size();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ParseKmsg);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2022 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstring>
+#include <regex>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "log_regex.h"
+
+using namespace OHOS::HiviewDFX;
+
+namespace {
+/* Contents of a buffer dump, hilog -e looks at every one of them */
+const std::vector<std::string> LOG_CONTENTS = {
+    "PowerMgr: suspend ok, wakeup reason 0x12, took 35 ms",
+    "ProcessRequest: uri=/data/storage/el2/base/files/cache.db mode=rw flags=0x0",
+    "[ArkCompiler] GC finished, freed 1024 KB, heap 32 MB, pause 2 ms",
+    "WifiDevice: connection state changed 3 -> 4, rssi -57",
+    "Binder transaction failed, code 7, error -32",
+    "Input event: type 1 code 330 value 1 at 12345.678901",
+    "onForeground: bundle com.ohos.settings ability MainAbility",
+    "render_service: frame 18765 dropped, vsync late by 17 ms\nsecond line of the log",
+};
+
+const std::vector<std::string> PATTERNS = {
+    "failed",
+    "error -[0-9]+",
+    "^(PowerMgr|WifiDevice):",
+    "frame \\d+ dropped.*ms$",
+    "(a|b)*c(d|e)+f",
+};
+
+/* What hilogtool did before, the regex was built for every log */
+bool SearchRebuilt(const std::string& pattern, const char* content)
+{
+    std::string str = content;
+    std::smatch match;
+    std::regex regExp(pattern);
+    return std::regex_search(str, match, regExp);
+}
+
+bool SameAsStdRegex(LogRegex& logRegex, const std::string& pattern)
+{
+    for (const std::string& content : LOG_CONTENTS) {
+        if (logRegex.Search(content.c_str(), content.size()) != SearchRebuilt(pattern, content.c_str())) {
+            return false;
+        }
+    }
+    return true;
+}
+} // namespace
+
+static void BM_SearchRebuiltRegex(benchmark::State& state)
+{
+    const std::string& pattern = PATTERNS[state.range(0)];
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(SearchRebuilt(pattern, LOG_CONTENTS[i].c_str()));
+        i = (i + 1) % LOG_CONTENTS.size();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SearchRebuiltRegex)->DenseRange(0, PATTERNS.size() - 1);
+
+static void BM_SearchLogRegex(benchmark::State& state)
+{
+    const std::string& pattern = PATTERNS[state.range(0)];
+    LogRegex logRegex(pattern);
+    if (!logRegex.IsValid() || !SameAsStdRegex(logRegex, pattern)) {
+        state.SkipWithError(("not matched like std::regex: " + pattern).c_str());
+        return;
+    }
+    size_t i = 0;
+    for (auto _ : state) {
+        const std::string& content = LOG_CONTENTS[i];
+        benchmark::DoNotOptimize(logRegex.Search(content.c_str(), content.size()));
+        i = (i + 1) % LOG_CONTENTS.size();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SearchLogRegex)->DenseRange(0, PATTERNS.size() - 1);
+
+BENCHMARK_MAIN();
@@ -14,17 +14,22 @@
  */
 
 #include <array>
+#include <climits>
+#include <cstdint>
 #include <cstdlib>
 #include <ctime>
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include <unistd.h>
 
 #include <gtest/gtest.h>
 
 #include "hilog/log.h"
+#include "hilog/log_cpp_format.h"
 
 #undef LOG_DOMAIN
 #define LOG_DOMAIN 0xD002D00
@@ -38,6 +43,8 @@ namespace OHOS {
 namespace HiviewDFX {
 namespace HiLogTest {
 const HiLogLabel LABEL = { LOG_CORE, 0xD002D00, "HILOGTEST_CPP" };
+const HiLogLabel LABEL_REF = { LOG_CORE, 0xD002D00, "HILOGTEST_REF" };
+const HiLogLabel LABEL_LITERAL = { LOG_CORE, 0xD002D00, "HILOGTEST_LIT" };
 static constexpr unsigned int SOME_LOGS = 10;
 static constexpr unsigned int MORE_LOGS = 100;
 
@@ -88,6 +95,49 @@ static const std::array<LogMethodFunc, METHODS_NUMBER> LOG_CPP_METHODS = {
     },
 };
 
+static const std::array<LogMethodFunc, METHODS_NUMBER> LOG_CPP_LITERAL_METHODS = {
+    [] (const std::string &msg) {
+        HILOG_CPP_DEBUG(LABEL, "%{public}s", msg.c_str());
+    },
+    [] (const std::string &msg) {
+        HILOG_CPP_INFO(LABEL, "%{public}s", msg.c_str());
+    },
+    [] (const std::string &msg) {
+        HILOG_CPP_WARN(LABEL, "%{public}s", msg.c_str());
+    },
+    [] (const std::string &msg) {
+        HILOG_CPP_ERROR(LABEL, "%{public}s", msg.c_str());
+    },
+    [] (const std::string &msg) {
+        HILOG_CPP_FATAL(LABEL, "%{public}s", msg.c_str());
+    },
+};
+
+/* The same format and arguments printed by HiLog::Info and by HILOG_CPP_INFO, the marker goes first */
+using LiteralCase = std::pair<LogMethodFunc, LogMethodFunc>;
+#define LITERAL_CASE(fmt, ...) \
+    LiteralCase([] (const std::string &marker) { \
+        HiLog::Info(LABEL_REF, "%{public}s " fmt, marker.c_str(), ##__VA_ARGS__); \
+    }, [] (const std::string &marker) { \
+        HILOG_CPP_INFO(LABEL_LITERAL, "%{public}s " fmt, marker.c_str(), ##__VA_ARGS__); \
+    })
+
+static const std::vector<LiteralCase> LITERAL_CASES = {
+    LITERAL_CASE("%d %s %{private}u %{public}d", 1, "secret", 2U, 3),
+    LITERAL_CASE("%{public}hhd %{public}hhu %{public}hd", 300, 300, 70000),
+    LITERAL_CASE("%{public}lld %{public}llu %{public}ld", LLONG_MIN, ULLONG_MAX, -1L),
+    LITERAL_CASE("%{public}zu %{public}zd %{public}u", SIZE_MAX, static_cast<ssize_t>(-5), -1),
+    LITERAL_CASE("[%{public}5d|%{public}-5d|%{public}08x|%{public}#o|%{public}+d]", 42, 42, 0xbeef, 8, 7),
+    LITERAL_CASE("[%{public}10s|%{public}-10s|%{public}.3s|%{public}c]", "right", "left", "truncated", 'c'),
+    LITERAL_CASE("100%% %{public}d%%", 50),
+    LITERAL_CASE("%{public}f %{public}.2f %{public}e %{public}g %{public}Lf", 1.5, 3.14159, 1e-5, 2.5e10, 1.25L),
+    LITERAL_CASE("%{public}10.3f|%{public}-10.1e|", -2.5, 12345.678),
+    LITERAL_CASE("%{public}p %{public}s", nullptr, static_cast<const char *>(nullptr)),
+    // Not parsed at compile time, printed by HiLogPrint
+    LITERAL_CASE("[%{public}*d]", 6, 42),
+    LITERAL_CASE("%{public}-*.*f", 10, 2, 3.14159),
+};
+
 static std::string PopenToString(const std::string &command)
 {
     std::string str;
@@ -323,6 +373,132 @@ HWTEST_F(HiLogNDKTest, LogLossCheck_002, TestSize.Level1)
     HiLogWriteTest(INFO_METHOD, MORE_LOGS, LOG_CPP_METHODS);
 }
 
+/**
+ * @tc.name: Dfx_HiLogNDKTest_PrintDebugLog_003
+ * @tc.desc: Call HILOG_CPP_DEBUG to print logs.
+ * @tc.type: FUNC
+ */
+HWTEST_F(HiLogNDKTest, PrintDebugLog_003, TestSize.Level1)
+{
+    /**
+     * @tc.steps: step1. Call HILOG_CPP_DEBUG to print logs and call hilog to read it
+     * @tc.expected: step1. Logs can be printed only if hilog.debug is enabled.
+     */
+    HiLogWriteTest(DEBUG_METHOD, SOME_LOGS, LOG_CPP_LITERAL_METHODS);
+}
+
+/**
+ * @tc.name: Dfx_HiLogNDKTest_PrintInfoLog_003
+ * @tc.desc: Call HILOG_CPP_INFO to print logs.
+ * @tc.type: FUNC
+ */
+HWTEST_F(HiLogNDKTest, PrintInfoLog_003, TestSize.Level1)
+{
+    /**
+     * @tc.steps: step1. Call HILOG_CPP_INFO to print logs and call hilog to read it
+     * @tc.expected: step1. Logs printed without loss.
+     */
+    HiLogWriteTest(INFO_METHOD, SOME_LOGS, LOG_CPP_LITERAL_METHODS);
+}
+
+/**
+ * @tc.name: Dfx_HiLogNDKTest_PrintWarnLog_003
+ * @tc.desc: Call HILOG_CPP_WARN to print logs.
+ * @tc.type: FUNC
+ */
+HWTEST_F(HiLogNDKTest, PrintWarnLog_003, TestSize.Level1)
+{
+    /**
+     * @tc.steps: step1. Call HILOG_CPP_WARN to print logs and call hilog to read it
+     * @tc.expected: step1. Logs printed without loss.
+     */
+    HiLogWriteTest(WARN_METHOD, SOME_LOGS, LOG_CPP_LITERAL_METHODS);
+}
+
+/**
+ * @tc.name: Dfx_HiLogNDKTest_PrintErrorLog_003
+ * @tc.desc: Call HILOG_CPP_ERROR to print logs.
+ * @tc.type: FUNC
+ */
+HWTEST_F(HiLogNDKTest, PrintErrorLog_003, TestSize.Level1)
+{
+    /**
+     * @tc.steps: step1. Call HILOG_CPP_ERROR to print logs and call hilog to read it
+     * @tc.expected: step1. Logs printed without loss.
+     */
+    HiLogWriteTest(ERROR_METHOD, SOME_LOGS, LOG_CPP_LITERAL_METHODS);
+}
+
+/**
+ * @tc.name: Dfx_HiLogNDKTest_PrintFatalLog_003
+ * @tc.desc: Call HILOG_CPP_FATAL to print logs.
+ * @tc.type: FUNC
+ */
+HWTEST_F(HiLogNDKTest, PrintFatalLog_003, TestSize.Level1)
+{
+    /**
+     * @tc.steps: step1. Call HILOG_CPP_FATAL to print logs and call hilog to read it
+     * @tc.expected: step1. Logs printed without loss.
+     */
+    HiLogWriteTest(FATAL_METHOD, SOME_LOGS, LOG_CPP_LITERAL_METHODS);
+}
+
+/**
+ * @tc.name: Dfx_HiLogNDKTest_LogLossCheck_003
+ * @tc.desc: HILOG_CPP_INFO log loss rate must less than 10%
+ * @tc.type: FUNC
+ */
+HWTEST_F(HiLogNDKTest, LogLossCheck_003, TestSize.Level1)
+{
+    /**
+     * @tc.steps: step1. Call HILOG_CPP_INFO to print logs and call hilog to read it
+     * @tc.expected: step1. Calculate log loss rate and it should less than 10%
+     */
+    HiLogWriteTest(INFO_METHOD, MORE_LOGS, LOG_CPP_LITERAL_METHODS);
+}
+
+static std::string ContentOf(const std::string &logs, const HiLogLabel &label, const std::string &marker)
+{
+    const std::string prefix = std::string(label.tag) + ": " + marker + " ";
+    std::stringstream ss(logs);
+    std::string str;
+    while (!ss.eof()) {
+        getline(ss, str);
+        size_t pos = str.find(prefix);
+        if (pos != std::string::npos) {
+            return str.substr(pos + prefix.size());
+        }
+    }
+    return "";
+}
+
+/**
+ * @tc.name: Dfx_HiLogNDKTest_PrintLiteralFormat_001
+ * @tc.desc: HILOG_CPP_INFO prints the same text as HiLog::Info.
+ * @tc.type: FUNC
+ */
+HWTEST_F(HiLogNDKTest, PrintLiteralFormat_001, TestSize.Level1)
+{
+    /**
+     * @tc.steps: step1. Print every format by HiLog::Info and HILOG_CPP_INFO and call hilog to read them
+     * @tc.expected: step1. Private arguments, length modifiers, width, precision, floats and formats
+     *                      left to HiLogPrint give the same text.
+     */
+    std::string marker(RandomStringGenerator());
+    for (size_t i = 0; i < LITERAL_CASES.size(); ++i) {
+        LITERAL_CASES[i].first(marker + "#" + std::to_string(i));
+        LITERAL_CASES[i].second(marker + "#" + std::to_string(i));
+    }
+    usleep(1000); /* 1000: sleep 1 ms */
+    std::string logMsgs = PopenToString("/system/bin/hilog -x");
+    for (size_t i = 0; i < LITERAL_CASES.size(); ++i) {
+        std::string expected = ContentOf(logMsgs, LABEL_REF, marker + "#" + std::to_string(i));
+        std::string actual = ContentOf(logMsgs, LABEL_LITERAL, marker + "#" + std::to_string(i));
+        EXPECT_FALSE(expected.empty()) << i;
+        EXPECT_EQ(actual, expected) << i;
+    }
+}
+
 /**
  * @tc.name: Dfx_HiLogNDKTest_IsLoggable_001
  * @tc.desc: Check whether is loggable for each log level
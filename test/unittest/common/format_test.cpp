@@ -0,0 +1,197 @@
+/*
+ * Copyright (c) 2022 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "format.h"
+#include "hilog_common.h"
+#include "hilog_msg.h"
+
+using namespace testing::ext;
+using namespace OHOS::HiviewDFX;
+
+namespace {
+constexpr size_t TIME_BUF_LEN = 64;
+constexpr char GUARD = '#';
+
+const std::vector<uint32_t> SHOW_FORMAT_BITS = {
+    TIME_USEC_SHOWFORMAT, YEAR_SHOWFORMAT, ZONE_SHOWFORMAT,
+    EPOCH_SHOWFORMAT, MONOTONIC_SHOWFORMAT, TIME_NSEC_SHOWFORMAT,
+};
+
+/* tv_sec and tv_nsec pairs */
+const std::vector<std::pair<uint32_t, uint32_t>> TIMES = {
+    { 0, 0 },
+    { 1, 999999999 },
+    { 59, 999999 },
+    { 86399, 1000 },
+    { 1650000000, 123456789 },
+    { 1650000000, 0 },
+    { UINT32_MAX, 5 }, // largest tv_sec, would be negative as int32_t
+    { 1650000000, 1500000000 }, // nanoseconds out of range are printed in full
+};
+
+/* HilogShowTimeBuffer before the seconds were cached, one strftime for every log */
+int StrftimeShowTimeBuffer(char* buffer, int bufLen, uint32_t showFormat, const HilogShowFormatBuffer& contentOut)
+{
+    time_t now = contentOut.tv_sec;
+    unsigned long nsecTime = contentOut.tv_nsec;
+    int timeLen = 0;
+    nsecTime = (now < 0) ? (NSEC - nsecTime) : nsecTime;
+    if ((showFormat & (1 << EPOCH_SHOWFORMAT)) || (showFormat & (1 << MONOTONIC_SHOWFORMAT))) {
+        timeLen = snprintf(buffer, bufLen, (showFormat & (1 << MONOTONIC_SHOWFORMAT)) ? "%6lld" : "%9lld",
+            static_cast<long long>(now));
+    } else {
+        struct tm tmLocal;
+        if (localtime_r(&now, &tmLocal) == nullptr) {
+            return 0;
+        }
+        const char* format = "%m-%d %H:%M:%S";
+        if (showFormat & (1 << ZONE_SHOWFORMAT)) {
+            format = "%z %m-%d %H:%M:%S";
+        } else if (showFormat & (1 << YEAR_SHOWFORMAT)) {
+            format = "%Y-%m-%d %H:%M:%S";
+        }
+        timeLen = strftime(buffer, bufLen, format, &tmLocal);
+    }
+    if (showFormat & (1 << TIME_NSEC_SHOWFORMAT)) {
+        timeLen += snprintf(buffer + timeLen, bufLen - timeLen, ".%09lu", nsecTime);
+    } else if (showFormat & (1 << TIME_USEC_SHOWFORMAT)) {
+        timeLen += snprintf(buffer + timeLen, bufLen - timeLen, ".%06lu", nsecTime / NS2US);
+    } else {
+        timeLen += snprintf(buffer + timeLen, bufLen - timeLen, ".%03lu", nsecTime / NS2MS);
+    }
+    return timeLen;
+}
+
+class FormatTest : public testing::Test {
+public:
+    static void SetUpTestCase() {}
+    static void TearDownTestCase() {}
+    void SetUp() {}
+    void TearDown() {}
+
+protected:
+    static HilogShowFormatBuffer MakeContent(uint32_t sec, uint32_t nsec)
+    {
+        HilogShowFormatBuffer content = {0};
+        content.tv_sec = sec;
+        content.tv_nsec = nsec;
+        return content;
+    }
+
+    static std::vector<uint32_t> AllFormats()
+    {
+        std::vector<uint32_t> formats;
+        for (uint32_t mask = 0; mask < (1U << SHOW_FORMAT_BITS.size()); mask++) {
+            uint32_t format = 1 << TIME_SHOWFORMAT;
+            for (size_t i = 0; i < SHOW_FORMAT_BITS.size(); i++) {
+                format |= ((mask >> i) & 1) << SHOW_FORMAT_BITS[i];
+            }
+            formats.push_back(format);
+        }
+        return formats;
+    }
+
+    static void ExpectSameAsStrftime(uint32_t format, uint32_t sec, uint32_t nsec)
+    {
+        HilogShowFormatBuffer content = MakeContent(sec, nsec);
+        char expected[TIME_BUF_LEN] = {0};
+        char actual[TIME_BUF_LEN] = {0};
+        int expectedLen = StrftimeShowTimeBuffer(expected, sizeof(expected), format, content);
+        int actualLen = HilogShowTimeBuffer(actual, sizeof(actual), format, content);
+        EXPECT_STREQ(actual, expected) << "format " << format << " time " << sec << "." << nsec;
+        EXPECT_EQ(actualLen, expectedLen) << "format " << format << " time " << sec << "." << nsec;
+    }
+};
+
+HWTEST_F(FormatTest, AllFormats, TestSize.Level1)
+{
+    for (uint32_t format : AllFormats()) {
+        for (const auto& [sec, nsec] : TIMES) {
+            ExpectSameAsStrftime(format, sec, nsec);
+        }
+    }
+}
+
+HWTEST_F(FormatTest, SecondsRollover, TestSize.Level1)
+{
+    // The seconds text is kept between calls, it must change with the seconds and nothing else
+    const std::vector<std::pair<uint32_t, uint32_t>> sequence = {
+        { 1650000059, 999999999 }, { 1650000060, 0 }, { 1650000060, 1 }, { 1650000060, 999999999 },
+        { 1650003599, 500000000 }, { 1650003600, 0 }, { 1650000059, 0 }, { 1650000060, 0 },
+    };
+    for (uint32_t format : AllFormats()) {
+        for (const auto& [sec, nsec] : sequence) {
+            ExpectSameAsStrftime(format, sec, nsec);
+        }
+    }
+}
+
+HWTEST_F(FormatTest, FormatChangeInSecond, TestSize.Level1)
+{
+    std::vector<uint32_t> formats = AllFormats();
+    for (size_t i = 0; i < formats.size(); i++) {
+        ExpectSameAsStrftime(formats[i], 1650000000, i); // 1650000000 : the same second every time
+        ExpectSameAsStrftime(formats[formats.size() - 1 - i], 1650000000, i); // 1650000000 : the same second
+    }
+}
+
+HWTEST_F(FormatTest, Threads, TestSize.Level1)
+{
+    // Each thread keeps its own seconds text
+    std::vector<std::thread> threads;
+    std::vector<uint32_t> formats = AllFormats();
+    for (size_t t = 0; t < 4; t++) { // 4 : a few threads with different formats
+        threads.emplace_back([&formats, t]() {
+            for (uint32_t sec = 1650000000; sec < 1650000100; sec++) { // 100 : seconds in a row
+                ExpectSameAsStrftime(formats[(sec + t) % formats.size()], sec, sec);
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
+HWTEST_F(FormatTest, SmallBuffer, TestSize.Level1)
+{
+    HilogShowFormatBuffer content = MakeContent(1650000000, 123456789);
+    for (uint32_t format : AllFormats()) {
+        char full[TIME_BUF_LEN] = {0};
+        int fullLen = HilogShowTimeBuffer(full, sizeof(full), format, content);
+        for (int bufLen = 1; bufLen < fullLen + 2; bufLen++) { // 2 : '\0' and one more
+            char buf[TIME_BUF_LEN];
+            (void)memset(buf, GUARD, sizeof(buf));
+            int len = HilogShowTimeBuffer(buf, bufLen, format, content);
+            ASSERT_LT(len, bufLen) << format;
+            EXPECT_EQ(static_cast<size_t>(len), strlen(buf)) << format << " " << bufLen;
+            EXPECT_EQ(strncmp(buf, full, len), 0) << format << " " << bufLen;
+            EXPECT_EQ(buf[bufLen], GUARD) << format << " " << bufLen;
+        }
+    }
+    char buf[1] = { GUARD };
+    EXPECT_EQ(HilogShowTimeBuffer(buf, 0, 0, content), 0);
+    EXPECT_EQ(buf[0], GUARD);
+    EXPECT_EQ(HilogShowTimeBuffer(nullptr, TIME_BUF_LEN, 0, content), 0);
+}
+} // namespace
@@ -0,0 +1,210 @@
+/*
+ * Copyright (c) 2022 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+#include "hilog/log.h"
+#include "hilog_common.h"
+#include "hilog_input_shm_client.h"
+#include "hilog_input_shm_server.h"
+
+using namespace testing::ext;
+using namespace OHOS::HiviewDFX;
+
+namespace {
+constexpr char TEST_SOCKET_NAME[] = "hilogShmTestInput";
+constexpr char TAG[] = "ShmTest";
+constexpr char FLOOD_TAG[] = "ShmFlood";
+constexpr size_t RECORD_NUM = 10;
+constexpr auto WAIT_TIMEOUT = std::chrono::seconds(5);
+
+/* Stand-in for hilogd which keeps the content of every received record with TAG */
+class RecordingServer {
+public:
+    explicit RecordingServer(std::chrono::milliseconds batchDelay = std::chrono::milliseconds(0))
+        : m_server(TEST_SOCKET_NAME, [this, batchDelay](std::vector<DgramPacket>& packets) {
+            OnPackets(packets, batchDelay);
+        })
+    {
+        m_running = (m_server.Init() >= 0 && m_server.RunServingThread());
+    }
+
+    bool IsRunning() const
+    {
+        return m_running;
+    }
+
+    std::vector<std::string> Records()
+    {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        return m_records;
+    }
+
+private:
+    void OnPackets(std::vector<DgramPacket>& packets, std::chrono::milliseconds batchDelay)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mtx);
+            for (const DgramPacket& packet : packets) {
+                const HilogMsg *msg = reinterpret_cast<const HilogMsg *>(packet.data);
+                if (std::string(msg->tag) == TAG) {
+                    m_records.push_back(CONTENT_PTR(msg));
+                }
+            }
+        }
+        std::this_thread::sleep_for(batchDelay);
+    }
+
+    HilogInputShmServer m_server;
+    bool m_running = false;
+    std::mutex m_mtx;
+    std::vector<std::string> m_records;
+};
+
+int WriteLog(HilogInputShmClient& client, const char *tag, size_t tagLen, const std::string& content)
+{
+    HilogMsg header = {0};
+    header.type = LOG_CORE;
+    header.level = LOG_INFO;
+    header.pid = static_cast<uint32_t>(getpid());
+    header.tid = header.pid;
+    return client.WriteLogMessage(&header, tag, tagLen, content.c_str(), content.size() + 1);
+}
+
+/* Writes until the ring takes a record, the ring isn't used until hilogd has taken it */
+bool WriteUntilTaken(HilogInputShmClient& client, const std::string& content)
+{
+    auto deadline = std::chrono::steady_clock::now() + WAIT_TIMEOUT;
+    while (std::chrono::steady_clock::now() < deadline) {
+        if (WriteLog(client, TAG, sizeof(TAG), content) >= 0) {
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return false;
+}
+
+bool WaitForRecords(RecordingServer& server, size_t count)
+{
+    auto deadline = std::chrono::steady_clock::now() + WAIT_TIMEOUT;
+    while (std::chrono::steady_clock::now() < deadline) {
+        if (server.Records().size() >= count) {
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return false;
+}
+
+class HilogInputShmTest : public testing::Test {
+public:
+    static void SetUpTestCase() {}
+    static void TearDownTestCase() {}
+    void SetUp() {}
+    void TearDown() {}
+};
+
+HWTEST_F(HilogInputShmTest, RegisterWithoutBlocking, TestSize.Level1)
+{
+    RecordingServer server;
+    ASSERT_TRUE(server.IsRunning());
+    HilogInputShmClient client(TEST_SOCKET_NAME);
+    // First log sends the ring and goes to the socket, it doesn't wait for hilogd
+    auto start = std::chrono::steady_clock::now();
+    EXPECT_LT(WriteLog(client, TAG, sizeof(TAG), "first"), 0);
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(SHM_REGISTER_TIMEOUT_MS / 2));
+    ASSERT_TRUE(WriteUntilTaken(client, "record 0"));
+    for (size_t i = 1; i < RECORD_NUM; i++) {
+        ASSERT_GE(WriteLog(client, TAG, sizeof(TAG), "record " + std::to_string(i)), 0) << i;
+    }
+    ASSERT_TRUE(WaitForRecords(server, RECORD_NUM));
+    std::vector<std::string> records = server.Records();
+    for (size_t i = 0; i < RECORD_NUM; i++) {
+        EXPECT_EQ(records[i], "record " + std::to_string(i));
+    }
+}
+
+HWTEST_F(HilogInputShmTest, RetryWhenServerComesUp, TestSize.Level1)
+{
+    // Nobody listens yet
+    HilogInputShmClient client(TEST_SOCKET_NAME);
+    EXPECT_LT(WriteLog(client, TAG, sizeof(TAG), "lost"), 0);
+    RecordingServer server;
+    ASSERT_TRUE(server.IsRunning());
+    ASSERT_TRUE(WriteUntilTaken(client, "late"));
+    ASSERT_TRUE(WaitForRecords(server, 1));
+    EXPECT_EQ(server.Records()[0], "late");
+}
+
+HWTEST_F(HilogInputShmTest, RetryAfterServerRestart, TestSize.Level1)
+{
+    HilogInputShmClient client(TEST_SOCKET_NAME);
+    auto server = std::make_unique<RecordingServer>();
+    ASSERT_TRUE(server->IsRunning());
+    ASSERT_TRUE(WriteUntilTaken(client, "before"));
+    ASSERT_TRUE(WaitForRecords(*server, 1));
+
+    // Server lets the ring go, the client notices, counts the ring as lost and uses the socket
+    EXPECT_EQ(client.GetWriteLosses(), 0U);
+    server.reset();
+    EXPECT_LT(WriteLog(client, TAG, sizeof(TAG), "between"), 0);
+    EXPECT_EQ(client.GetWriteLosses(), 1U);
+
+    server = std::make_unique<RecordingServer>();
+    ASSERT_TRUE(server->IsRunning());
+    ASSERT_TRUE(WriteUntilTaken(client, "after"));
+    ASSERT_TRUE(WaitForRecords(*server, 1));
+    EXPECT_EQ(server->Records()[0], "after");
+}
+
+HWTEST_F(HilogInputShmTest, BusyRingDoesNotStarveOthers, TestSize.Level1)
+{
+    // Slow consumer, the flooding ring always has records left
+    RecordingServer server(std::chrono::milliseconds(1));
+    ASSERT_TRUE(server.IsRunning());
+    HilogInputShmClient flooder(TEST_SOCKET_NAME);
+    HilogInputShmClient quiet(TEST_SOCKET_NAME);
+    auto deadline = std::chrono::steady_clock::now() + WAIT_TIMEOUT;
+    while (WriteLog(flooder, FLOOD_TAG, sizeof(FLOOD_TAG), "flood") < 0 &&
+        std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    std::atomic_bool stop(false);
+    std::thread flood([&flooder, &stop]() {
+        const std::string content(MAX_LOG_LEN / 2, 'f'); // 2 : half of the longest log
+        while (!stop.load()) {
+            (void)WriteLog(flooder, FLOOD_TAG, sizeof(FLOOD_TAG), content);
+        }
+    });
+    bool taken = WriteUntilTaken(quiet, "record 0");
+    for (size_t i = 1; taken && i < RECORD_NUM; i++) {
+        EXPECT_GE(WriteLog(quiet, TAG, sizeof(TAG), "record " + std::to_string(i)), 0) << i;
+    }
+    bool received = taken && WaitForRecords(server, RECORD_NUM);
+    stop.store(true);
+    flood.join();
+    EXPECT_TRUE(taken);
+    EXPECT_TRUE(received);
+}
+} // namespace
@@ -0,0 +1,315 @@
+/*
+ * Copyright (c) 2022 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+#include "hilog_common.h"
+#include "hilog_input_socket_client.h"
+#include "hilog_input_socket_server.h"
+
+using namespace testing::ext;
+using namespace OHOS::HiviewDFX;
+
+namespace {
+constexpr char TEST_SOCKET_NAME[] = "hilogBatchTestInput";
+constexpr char TAG[] = "BatchTest";
+constexpr char DROP_TAG[] = "LOGLIMITP";
+constexpr uint32_t TEST_DOMAIN = 0xD002D00;
+constexpr size_t RECORD_NUM = 10;
+constexpr auto WAIT_TIMEOUT = std::chrono::seconds(2);
+
+struct Received {
+    size_t packet = 0;
+    uint16_t level = 0;
+    uint32_t pid = 0;
+    std::string tag;
+    std::string content;
+};
+
+/* Stand-in for hilogd which keeps every received record */
+class RecordingServer {
+public:
+    RecordingServer()
+        : m_server(TEST_SOCKET_NAME, [this](std::vector<DgramPacket>& packets) { OnPackets(packets); })
+    {
+        m_running = (m_server.Init() >= 0 && m_server.RunServingThread() !=
+            HilogInputSocketServer::ServerThreadState::CAN_NOT_START);
+    }
+
+    bool IsRunning() const
+    {
+        return m_running;
+    }
+
+    /* Records received so far, waits until there are at least count of them */
+    std::vector<Received> WaitFor(size_t count)
+    {
+        auto deadline = std::chrono::steady_clock::now() + WAIT_TIMEOUT;
+        while (std::chrono::steady_clock::now() < deadline) {
+            {
+                std::lock_guard<std::mutex> lock(m_mtx);
+                if (m_records.size() >= count) {
+                    break;
+                }
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        std::lock_guard<std::mutex> lock(m_mtx);
+        return m_records;
+    }
+
+private:
+    void OnPackets(std::vector<DgramPacket>& packets)
+    {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        for (const DgramPacket& packet : packets) {
+            size_t offset = 0;
+            while (packet.len - offset >= sizeof(HilogMsg)) {
+                const HilogMsg *msg = reinterpret_cast<const HilogMsg *>(packet.data + offset);
+                if (msg->len < sizeof(HilogMsg) || msg->len > packet.len - offset) {
+                    ADD_FAILURE() << "malformed record at " << offset;
+                    break;
+                }
+                Received record;
+                record.packet = m_packets;
+                record.level = msg->level;
+                record.pid = msg->pid;
+                record.tag = msg->tag;
+                record.content = CONTENT_PTR(msg);
+                m_records.push_back(record);
+                offset += msg->len;
+            }
+            m_packets++;
+        }
+    }
+
+    HilogInputSocketServer m_server;
+    bool m_running = false;
+    std::mutex m_mtx;
+    std::vector<Received> m_records;
+    size_t m_packets = 0;
+};
+
+int WriteLog(HilogInputSocketClient& client, uint16_t level, const std::string& content)
+{
+    HilogMsg header = {0};
+    header.type = LOG_CORE;
+    header.level = level;
+    header.pid = static_cast<uint32_t>(getpid());
+    header.tid = header.pid;
+    header.domain = TEST_DOMAIN;
+    return client.WriteLogMessage(&header, TAG, sizeof(TAG), content.c_str(), content.size() + 1);
+}
+
+std::string Content(size_t i)
+{
+    return "record " + std::to_string(i) + " " + std::string(i * 10, 'x'); // 10 : records of different lengths
+}
+
+/* Child writes with batching on and exits, the static client flushes when destroyed */
+void WriteAndExit()
+{
+    static HilogInputSocketClient client(TEST_SOCKET_NAME);
+    client.SetBatching(true);
+    for (size_t i = 0; i < RECORD_NUM; i++) {
+        (void)WriteLog(client, LOG_INFO, "child " + Content(i));
+    }
+    exit(0);
+}
+
+class HilogInputSocketClientTest : public testing::Test {
+public:
+    static void SetUpTestCase() {}
+    static void TearDownTestCase() {}
+    void SetUp()
+    {
+        m_server = std::make_unique<RecordingServer>();
+        ASSERT_TRUE(m_server->IsRunning());
+    }
+    void TearDown()
+    {
+        m_server.reset();
+    }
+
+protected:
+    std::unique_ptr<RecordingServer> m_server;
+};
+
+HWTEST_F(HilogInputSocketClientTest, BatchIntact, TestSize.Level1)
+{
+    HilogInputSocketClient client(TEST_SOCKET_NAME);
+    client.SetBatching(true);
+    for (size_t i = 0; i < RECORD_NUM; i++) {
+        ASSERT_GT(WriteLog(client, LOG_INFO, Content(i)), 0) << i;
+    }
+    client.FlushBatch();
+    std::vector<Received> records = m_server->WaitFor(RECORD_NUM);
+    ASSERT_EQ(records.size(), RECORD_NUM);
+    for (size_t i = 0; i < RECORD_NUM; i++) {
+        EXPECT_EQ(records[i].tag, TAG);
+        EXPECT_EQ(records[i].content, Content(i));
+        EXPECT_EQ(records[i].level, LOG_INFO);
+    }
+    // Several records share a packet
+    EXPECT_LT(records.back().packet, RECORD_NUM - 1);
+}
+
+HWTEST_F(HilogInputSocketClientTest, FullBatch, TestSize.Level1)
+{
+    // Longest records, three fit into a packet and the next one starts another packet
+    HilogInputSocketClient client(TEST_SOCKET_NAME);
+    client.SetBatching(true);
+    const std::string longest(MAX_LOG_LEN - 1, 'l');
+    const size_t perPacket = MAX_SOCKET_PACKET_LEN / (sizeof(HilogMsg) + sizeof(TAG) + MAX_LOG_LEN);
+    ASSERT_EQ(perPacket, 3U);
+    for (size_t i = 0; i < RECORD_NUM; i++) {
+        ASSERT_GT(WriteLog(client, LOG_INFO, longest), 0) << i;
+    }
+    client.FlushBatch();
+    std::vector<Received> records = m_server->WaitFor(RECORD_NUM);
+    ASSERT_EQ(records.size(), RECORD_NUM);
+    for (size_t i = 0; i < RECORD_NUM; i++) {
+        EXPECT_EQ(records[i].content, longest) << i;
+        EXPECT_EQ(records[i].packet, records[0].packet + i / perPacket) << i;
+    }
+}
+
+HWTEST_F(HilogInputSocketClientTest, FlushTimer, TestSize.Level1)
+{
+    HilogInputSocketClient client(TEST_SOCKET_NAME);
+    client.SetBatching(true);
+    ASSERT_GT(WriteLog(client, LOG_INFO, Content(1)), 0);
+    std::vector<Received> records = m_server->WaitFor(1);
+    ASSERT_EQ(records.size(), 1U);
+    EXPECT_EQ(records[0].content, Content(1));
+}
+
+HWTEST_F(HilogInputSocketClientTest, FlushWhenDisabled, TestSize.Level1)
+{
+    HilogInputSocketClient client(TEST_SOCKET_NAME);
+    client.SetBatching(true);
+    ASSERT_GT(WriteLog(client, LOG_INFO, Content(1)), 0);
+    ASSERT_GT(WriteLog(client, LOG_INFO, Content(2)), 0); // 2 : second record
+    client.SetBatching(false);
+    ASSERT_GT(WriteLog(client, LOG_INFO, Content(3)), 0); // 3 : sent without batching
+    std::vector<Received> records = m_server->WaitFor(3); // 3 : all records
+    ASSERT_EQ(records.size(), 3U);
+    EXPECT_EQ(records[0].content, Content(1));
+    EXPECT_EQ(records[1].content, Content(2));
+    EXPECT_EQ(records[2].content, Content(3)); // 3 : the record sent alone
+}
+
+HWTEST_F(HilogInputSocketClientTest, FlushOnFork, TestSize.Level1)
+{
+    HilogInputSocketClient client(TEST_SOCKET_NAME);
+    client.SetBatching(true);
+    for (size_t i = 0; i < RECORD_NUM; i++) {
+        ASSERT_GT(WriteLog(client, LOG_INFO, Content(i)), 0) << i;
+    }
+    pid_t pid = fork();
+    ASSERT_GE(pid, 0);
+    if (pid == 0) {
+        // Child starts with batching off and nothing pending, this record goes alone
+        (void)WriteLog(client, LOG_INFO, "child");
+        _exit(0);
+    }
+    int status = 0;
+    ASSERT_EQ(waitpid(pid, &status, 0), pid);
+    std::vector<Received> records = m_server->WaitFor(RECORD_NUM + 1);
+    ASSERT_EQ(records.size(), RECORD_NUM + 1);
+    // Pending records were sent before the fork, and only once
+    for (size_t i = 0; i < RECORD_NUM; i++) {
+        EXPECT_EQ(records[i].content, Content(i));
+    }
+    EXPECT_EQ(records[RECORD_NUM].content, "child");
+    client.SetBatching(false);
+    EXPECT_EQ(m_server->WaitFor(RECORD_NUM + 2).size(), RECORD_NUM + 1); // 2 : nothing more comes
+}
+
+HWTEST_F(HilogInputSocketClientTest, FlushOnExit, TestSize.Level1)
+{
+    pid_t pid = fork();
+    ASSERT_GE(pid, 0);
+    if (pid == 0) {
+        WriteAndExit();
+    }
+    int status = 0;
+    ASSERT_EQ(waitpid(pid, &status, 0), pid);
+    ASSERT_TRUE(WIFEXITED(status));
+    std::vector<Received> records = m_server->WaitFor(RECORD_NUM);
+    ASSERT_EQ(records.size(), RECORD_NUM);
+    for (size_t i = 0; i < RECORD_NUM; i++) {
+        EXPECT_EQ(records[i].content, "child " + Content(i));
+        EXPECT_EQ(records[i].pid, static_cast<uint32_t>(pid));
+    }
+}
+
+HWTEST_F(HilogInputSocketClientTest, DroppedBatchTold, TestSize.Level1)
+{
+    HilogInputSocketClient client(TEST_SOCKET_NAME);
+    client.SetBatching(true);
+    // Nobody listens, the batch is lost
+    m_server.reset();
+    for (size_t i = 0; i < 3; i++) { // 3 : lost records
+        ASSERT_GT(WriteLog(client, LOG_INFO, Content(i)), 0);
+    }
+    EXPECT_EQ(client.GetWriteLosses(), 0U);
+    client.FlushBatch();
+    // Binary log formats may have been in it, they are sent again
+    EXPECT_EQ(client.GetWriteLosses(), 1U);
+
+    m_server = std::make_unique<RecordingServer>();
+    ASSERT_TRUE(m_server->IsRunning());
+    ASSERT_GT(WriteLog(client, LOG_INFO, "after"), 0);
+    client.FlushBatch();
+    std::vector<Received> records = m_server->WaitFor(2); // 2 : the notice and the record
+    ASSERT_EQ(records.size(), 2U);
+    EXPECT_EQ(records[0].tag, DROP_TAG);
+    EXPECT_EQ(records[0].content, "3 line(s) dropped!");
+    EXPECT_EQ(records[0].level, LOG_WARN);
+    EXPECT_EQ(records[0].packet, records[1].packet);
+    EXPECT_EQ(records[1].content, "after");
+}
+
+HWTEST_F(HilogInputSocketClientTest, ErrorRecordNotCounted, TestSize.Level1)
+{
+    HilogInputSocketClient client(TEST_SOCKET_NAME);
+    client.SetBatching(true);
+    m_server.reset();
+    ASSERT_GT(WriteLog(client, LOG_INFO, Content(0)), 0);
+    ASSERT_GT(WriteLog(client, LOG_INFO, Content(1)), 0);
+    // Sent again alone after the batch failed, its loss goes to the caller and not into the notice
+    EXPECT_LT(WriteLog(client, LOG_ERROR, Content(2)), 0); // 2 : the error record
+
+    m_server = std::make_unique<RecordingServer>();
+    ASSERT_TRUE(m_server->IsRunning());
+    ASSERT_GT(WriteLog(client, LOG_INFO, "after"), 0);
+    client.FlushBatch();
+    std::vector<Received> records = m_server->WaitFor(2); // 2 : the notice and the record
+    ASSERT_EQ(records.size(), 2U);
+    EXPECT_EQ(records[0].content, "2 line(s) dropped!");
+    EXPECT_EQ(records[1].content, "after");
+}
+} // namespace
@@ -0,0 +1,247 @@
+/*
+ * Copyright (c) 2022 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <regex>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "hilog/log.h"
+#include "hilog_common.h"
+#include "kmsg_parser.h"
+
+using namespace testing::ext;
+using namespace OHOS::HiviewDFX;
+
+namespace {
+constexpr int DEC = 10;
+constexpr uint32_t KMSG_DOMAIN = 0xdfffffff;
+
+struct Parsed {
+    bool valid = false;
+    uint16_t level = 0;
+    uint32_t pid = 0;
+    std::string tag;
+    std::string content;
+};
+
+/* Regex parser hilogd used before, the single pass parser must give the same results */
+Parsed RegexParse(std::string str)
+{
+    static const std::regex header("(\\d+),(\\d+),(\\d+),(\\S);");
+    static const std::regex pid("\\[pid=(\\d+)\\]");
+    static const std::regex tag("\\[.*?\\]");
+    Parsed parsed;
+    uint64_t prio = 0;
+    std::smatch res;
+    if (std::regex_search(str, res, header)) {
+        prio = strtoull(res[1].str().c_str(), nullptr, DEC);
+        str.erase(res.position(), res.length());
+    }
+    if (std::regex_search(str, res, pid)) {
+        parsed.pid = strtoul(res[1].str().c_str(), nullptr, DEC);
+        str.erase(res.position(), res.length());
+    }
+    parsed.tag = "kmsg";
+    if (std::regex_search(str, res, tag)) {
+        parsed.tag = res[0].str();
+        str.erase(res.position(), res.length());
+    }
+    const uint16_t levels[] = { LOG_FATAL, LOG_FATAL, LOG_FATAL, LOG_ERROR, LOG_WARN, LOG_WARN, LOG_INFO };
+    parsed.level = (prio < sizeof(levels) / sizeof(levels[0])) ? levels[prio] : LOG_DEBUG;
+    parsed.content = str;
+    parsed.valid = parsed.tag.size() < MAX_TAG_LEN - 1 && str.size() < MAX_LOG_LEN;
+    return parsed;
+}
+
+class KmsgParserTest : public testing::Test {
+public:
+    static void SetUpTestCase() {}
+    static void TearDownTestCase() {}
+    void SetUp() {}
+    void TearDown() {}
+
+protected:
+    Parsed Parse(const std::string& record)
+    {
+        return Parse(record.c_str(), record.size());
+    }
+
+    Parsed Parse(const char* record, size_t len)
+    {
+        Parsed parsed;
+        const HilogMsg* msg = m_parser.ParseKmsg(record, len);
+        if (msg == nullptr) {
+            return parsed;
+        }
+        EXPECT_EQ(msg->type, LOG_KMSG);
+        EXPECT_EQ(msg->domain, KMSG_DOMAIN);
+        EXPECT_EQ(msg->tid, msg->pid);
+        EXPECT_EQ(msg->len, sizeof(HilogMsg) + msg->tag_len + strlen(CONTENT_PTR(msg)) + 1);
+        EXPECT_EQ(msg->tag_len, strlen(msg->tag) + 1);
+        parsed.valid = true;
+        parsed.level = msg->level;
+        parsed.pid = msg->pid;
+        parsed.tag = msg->tag;
+        parsed.content = CONTENT_PTR(msg);
+        m_lastSec = msg->tv_sec;
+        return parsed;
+    }
+
+    KmsgParser m_parser;
+    uint32_t m_lastSec = 0;
+};
+
+HWTEST_F(KmsgParserTest, Header, TestSize.Level1)
+{
+    Parsed parsed = Parse("3,342,5231180,-;write failed: -11\n");
+    ASSERT_TRUE(parsed.valid);
+    EXPECT_EQ(parsed.level, LOG_ERROR);
+    EXPECT_EQ(parsed.pid, 0U);
+    EXPECT_EQ(parsed.tag, "kmsg");
+    EXPECT_EQ(parsed.content, "write failed: -11\n");
+    // Kmsg time is from boot, 5231180 us
+    auto expected = KmsgParser::BootTime() + std::chrono::microseconds(5231180);
+    int64_t expectedSec = std::chrono::time_point_cast<std::chrono::seconds>(expected).time_since_epoch().count();
+    EXPECT_LE(std::llabs(static_cast<int64_t>(m_lastSec) - expectedSec), 1);
+}
+
+HWTEST_F(KmsgParserTest, Levels, TestSize.Level1)
+{
+    const std::vector<std::pair<std::string, uint16_t>> cases = {
+        { "0", LOG_FATAL }, { "2", LOG_FATAL }, { "3", LOG_ERROR }, { "4", LOG_WARN },
+        { "5", LOG_WARN }, { "6", LOG_INFO }, { "7", LOG_DEBUG }, { "12", LOG_DEBUG },
+    };
+    for (const auto& [prio, level] : cases) {
+        Parsed parsed = Parse(prio + ",1,100,-;text");
+        ASSERT_TRUE(parsed.valid) << prio;
+        EXPECT_EQ(parsed.level, level) << prio;
+        EXPECT_EQ(parsed.content, "text");
+    }
+}
+
+HWTEST_F(KmsgParserTest, HeaderFields, TestSize.Level1)
+{
+    // Newer kernels add fields behind the flags
+    Parsed parsed = Parse("6,343,5250000,-,caller=T1;Service started");
+    ASSERT_TRUE(parsed.valid);
+    EXPECT_EQ(parsed.level, LOG_INFO);
+    EXPECT_EQ(parsed.content, "Service started");
+
+    // Anything else isn't a header, the whole record is the text
+    const std::vector<std::string> noHeader = {
+        "plain text",
+        "6,343;text",
+        "6,343,5250000, ;text",
+        "6,343,5250000,-text",
+        "6,343,5250000,-,caller=T1 text",
+        "x6,343,5250000,-;text",
+    };
+    for (const std::string& record : noHeader) {
+        parsed = Parse(record);
+        ASSERT_TRUE(parsed.valid) << record;
+        EXPECT_EQ(parsed.content, record);
+    }
+}
+
+HWTEST_F(KmsgParserTest, PidAndTag, TestSize.Level1)
+{
+    Parsed parsed = Parse("3,342,5231180,-;[pid=812][hilogd] write failed\n");
+    ASSERT_TRUE(parsed.valid);
+    EXPECT_EQ(parsed.pid, 812U);
+    EXPECT_EQ(parsed.tag, "[hilogd]");
+    EXPECT_EQ(parsed.content, " write failed\n");
+
+    // Text around the pid joins before the tag is searched
+    parsed = Parse("5,347,5300000,-;[a[pid=9]b] joined brackets");
+    ASSERT_TRUE(parsed.valid);
+    EXPECT_EQ(parsed.pid, 9U);
+    EXPECT_EQ(parsed.tag, "[ab]");
+    EXPECT_EQ(parsed.content, " joined brackets");
+
+    // Not a pid, so it's the tag
+    parsed = Parse("6,1,1,-;[pid=x] [pid=] text");
+    ASSERT_TRUE(parsed.valid);
+    EXPECT_EQ(parsed.pid, 0U);
+    EXPECT_EQ(parsed.tag, "[pid=x]");
+    EXPECT_EQ(parsed.content, " [pid=] text");
+
+    // Only the first pid is taken
+    parsed = Parse("6,1,1,-;[pid=1] [pid=2] text");
+    ASSERT_TRUE(parsed.valid);
+    EXPECT_EQ(parsed.pid, 1U);
+    EXPECT_EQ(parsed.tag, "[pid=2]");
+
+    // Brackets don't pair across lines
+    parsed = Parse("6,1,1,-;[open\nclose] text [tag]");
+    ASSERT_TRUE(parsed.valid);
+    EXPECT_EQ(parsed.tag, "[tag]");
+    EXPECT_EQ(parsed.content, "[open\nclose] text ");
+}
+
+HWTEST_F(KmsgParserTest, Limits, TestSize.Level1)
+{
+    EXPECT_TRUE(Parse("6,1,1,-;[" + std::string(MAX_TAG_LEN - 4, 't') + "] text").valid); // 4 : brackets
+    EXPECT_FALSE(Parse("6,1,1,-;[" + std::string(MAX_TAG_LEN - 3, 't') + "] text").valid); // 3 : brackets
+    EXPECT_TRUE(Parse("6,1,1,-;" + std::string(MAX_LOG_LEN - 1, 'c')).valid);
+    EXPECT_FALSE(Parse("6,1,1,-;" + std::string(MAX_LOG_LEN, 'c')).valid);
+
+    // Record ends at the length even without '\0'
+    const char record[] = "6,1,1,-;[tag] text and more";
+    Parsed parsed = Parse(record, sizeof("6,1,1,-;[tag] text") - 1);
+    ASSERT_TRUE(parsed.valid);
+    EXPECT_EQ(parsed.tag, "[tag]");
+    EXPECT_EQ(parsed.content, " text");
+}
+
+HWTEST_F(KmsgParserTest, SameAsRegex, TestSize.Level1)
+{
+    const std::vector<std::string> records = {
+        "6,339,5140900,-;NET: Registered protocol family 10\n",
+        "6,340,5173217,-;usb 1-1: new high-speed USB device number 2 using xhci_hcd\n SUBSYSTEM=usb\n",
+        "4,341,5200011,-;[drm:intel_dp_detect [i915]] DP-1: EDID checksum failed\n",
+        "3,342,5231180,-;[pid=812][hilogd] write failed: -11\n",
+        "6,343,5250000,c;[pid=1,cpu0,init] Service hilogd started\n",
+        "12,344,5260000,-;init: starting service 'hiview'...\n",
+        "7,345,5280000,-;dwc3 10e30000.dwc3: [pid=55] enter suspend, [link] state changed\n",
+        "5,347,5300000,-;[a[pid=9]b] joined brackets\n",
+        "6,348,5310000,-;EXT4-fs (mmcblk0p12): mounted filesystem. Opts: (null)\n",
+        "plain text without header",
+        "6,1,1,-;",
+        "6,1,1,-;[]",
+        "6,1,1,-;[pid=1] [pid=2] text",
+        "6,1,1,-;[pid=x] [pid=] text",
+        "6,1,1,-;[open\nclose] text [tag]",
+        "6,1,1,-;[open\rclose] text",
+        "6,1,1,-;unclosed [bracket",
+        "6,1,1,-;[" + std::string(MAX_TAG_LEN, 't') + "] long tag",
+    };
+    for (const std::string& record : records) {
+        Parsed expected = RegexParse(record);
+        Parsed parsed = Parse(record);
+        ASSERT_EQ(parsed.valid, expected.valid) << record;
+        if (!expected.valid) {
+            continue;
+        }
+        EXPECT_EQ(parsed.level, expected.level) << record;
+        EXPECT_EQ(parsed.pid, expected.pid) << record;
+        EXPECT_EQ(parsed.tag, expected.tag) << record;
+        EXPECT_EQ(parsed.content, expected.content) << record;
+    }
+}
+} // namespace
@@ -0,0 +1,373 @@
+/*
+ * Copyright (c) 2022 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "hilog_common.h"
+#include "log_binary.h"
+
+using namespace testing::ext;
+using namespace OHOS::HiviewDFX;
+
+namespace {
+constexpr uint64_t TEST_SESSION = (1000ULL << BINARY_SESSION_PID_SHIFT) | 1;
+constexpr uint16_t TEST_INDEX = 7;
+constexpr size_t BUF_LEN = MAX_LOG_LEN;
+constexpr size_t ARG_COUNT_OFFSET = sizeof(uint64_t) + sizeof(uint16_t); // session and format index
+
+class LogBinaryTest : public testing::Test {
+public:
+    static void SetUpTestCase() {}
+    static void TearDownTestCase() {}
+    void SetUp() {}
+    void TearDown() {}
+
+protected:
+    static std::vector<HiLogFmtPiece> ParsePieces(const char* fmt)
+    {
+        std::vector<HiLogFmtPiece> pieces;
+        size_t pos = 0;
+        HiLogFmtPiece piece;
+        while (HiLogFormat::NextPiece(fmt, pos, piece) == HiLogFormat::ParseResult::PIECE) {
+            pieces.push_back(piece);
+        }
+        return pieces;
+    }
+
+    static std::string Encode(const char* fmt, const std::vector<HiLogFmtArg>& args, bool priv = false)
+    {
+        std::vector<HiLogFmtPiece> pieces = ParsePieces(fmt);
+        char buf[BUF_LEN];
+        int len = EncodeBinaryArgs(buf, sizeof(buf), TEST_SESSION, TEST_INDEX, pieces.data(), pieces.size(),
+            args.data(), priv);
+        EXPECT_GE(len, 0) << fmt;
+        return (len < 0) ? std::string() : std::string(buf, len);
+    }
+
+    /* Decodes and formats like hilogd does, false if the content is refused */
+    static bool Decode(const char* fmt, const std::string& content, std::string& text)
+    {
+        std::vector<HiLogFmtPiece> pieces = ParsePieces(fmt);
+        HiLogFmtArg args[MAX_BINARY_ARGS];
+        bool masked[MAX_BINARY_ARGS] = {false};
+        if (!DecodeBinaryArgs(content.data(), content.size(), pieces.data(), pieces.size(), args, masked)) {
+            return false;
+        }
+        char buf[BUF_LEN];
+        int len = FormatPieces(buf, sizeof(buf), fmt, pieces.data(), pieces.size(), args, false, masked);
+        text.assign(buf, (len > 0) ? len : 0);
+        return true;
+    }
+
+    static std::string RoundTrip(const char* fmt, const std::vector<HiLogFmtArg>& args, bool priv = false)
+    {
+        std::string text;
+        EXPECT_TRUE(Decode(fmt, Encode(fmt, args, priv), text)) << fmt;
+        return text;
+    }
+
+    static HiLogFmtArg Signed(long long value)
+    {
+        HiLogFmtArg arg;
+        arg.i = value;
+        return arg;
+    }
+
+    static HiLogFmtArg Unsigned(unsigned long long value)
+    {
+        HiLogFmtArg arg;
+        arg.u = value;
+        return arg;
+    }
+
+    static HiLogFmtArg Double(double value)
+    {
+        HiLogFmtArg arg;
+        arg.d = value;
+        return arg;
+    }
+
+    static HiLogFmtArg String(const char* value)
+    {
+        HiLogFmtArg arg;
+        arg.s = value;
+        return arg;
+    }
+
+    static HiLogFmtArg Pointer(const void* value)
+    {
+        HiLogFmtArg arg;
+        arg.p = value;
+        return arg;
+    }
+};
+
+HWTEST_F(LogBinaryTest, RoundTripIntegers, TestSize.Level1)
+{
+    EXPECT_EQ(RoundTrip("%{public}d %{public}d %{public}d %{public}d",
+        { Signed(0), Signed(-1), Signed(LLONG_MIN), Signed(LLONG_MAX) }),
+        std::to_string(0) + " -1 " + std::to_string(LLONG_MIN) + " " + std::to_string(LLONG_MAX));
+    EXPECT_EQ(RoundTrip("%{public}u %{public}x %{public}X %{public}o",
+        { Unsigned(ULLONG_MAX), Unsigned(0xabc), Unsigned(0xabc), Unsigned(8) }), // 8 : "10" in octal
+        std::to_string(ULLONG_MAX) + " abc ABC 10");
+    EXPECT_EQ(RoundTrip("%{public}c%{public}c", { Signed('o'), Signed('k') }), "ok");
+}
+
+HWTEST_F(LogBinaryTest, RoundTripLikeSnprintf, TestSize.Level1)
+{
+    int local = 0;
+    char expected[BUF_LEN];
+    (void)snprintf(expected, sizeof(expected), "[%5lld|%-5lld|%05llx|%.2f|%e|%-4s|%.2s|%p]", 42LL, -42LL,
+        0x2aULL, 3.14159, 1e10, "ab", "abcd", static_cast<void*>(&local));
+    EXPECT_EQ(RoundTrip("[%{public}5d|%{public}-5d|%{public}05x|%{public}.2f|%{public}e|%{public}-4s|%{public}.2s|"
+        "%{public}p]", { Signed(42), Signed(-42), Unsigned(0x2a), Double(3.14159), Double(1e10), String("ab"),
+        String("abcd"), Pointer(&local) }), expected);
+
+    // long double is narrowed to double
+    HiLogFmtArg ld;
+    ld.ld = 1.5L;
+    EXPECT_EQ(RoundTrip("%{public}Lf", { ld }), "1.500000");
+    EXPECT_EQ(RoundTrip("100%% %{public}s", { String(nullptr) }), "100% (null)");
+    EXPECT_EQ(RoundTrip("no arguments", {}), "no arguments");
+    EXPECT_EQ(RoundTrip("%{public}s", { String("") }), "");
+}
+
+HWTEST_F(LogBinaryTest, PrivateArgs, TestSize.Level1)
+{
+    const char* fmt = "%d %{public}d %{private}s %s";
+    std::vector<HiLogFmtArg> args = { Signed(1), Signed(2), String("secret"), String("hidden") };
+    std::string content = Encode(fmt, args, true);
+    // Masked values never leave the process
+    EXPECT_EQ(content.find("secret"), std::string::npos);
+    EXPECT_EQ(content.find("hidden"), std::string::npos);
+    std::string text;
+    ASSERT_TRUE(Decode(fmt, content, text));
+    EXPECT_EQ(text, "<private> 2 <private> <private>");
+    // Without privacy everything is kept
+    EXPECT_EQ(RoundTrip(fmt, args, false), "1 2 secret hidden");
+}
+
+HWTEST_F(LogBinaryTest, Header, TestSize.Level1)
+{
+    std::string content = Encode("%{public}d %{public}s", { Signed(1), String("a") });
+    HilogBinaryHeader header;
+    ASSERT_TRUE(DecodeBinaryHeader(content.data(), content.size(), header));
+    EXPECT_EQ(header.session, TEST_SESSION);
+    EXPECT_EQ(header.formatIndex, TEST_INDEX);
+    EXPECT_EQ(header.argCount, 2U); // 2 : two conversions
+    EXPECT_FALSE(DecodeBinaryHeader(content.data(), sizeof(HilogBinaryHeader) - 1, header));
+
+    // Format registration carries the format after the header
+    const char fmt[] = "value %{public}d";
+    char buf[BUF_LEN];
+    int len = EncodeBinaryFormat(buf, sizeof(buf), TEST_SESSION, TEST_INDEX, fmt);
+    ASSERT_EQ(len, static_cast<int>(sizeof(HilogBinaryHeader) + strlen(fmt)));
+    EXPECT_STREQ(buf + sizeof(HilogBinaryHeader), fmt);
+    ASSERT_TRUE(DecodeBinaryHeader(buf, len, header));
+    EXPECT_EQ(header.argCount, 0U);
+}
+
+HWTEST_F(LogBinaryTest, EncodeLimits, TestSize.Level1)
+{
+    // Too small buffer is refused instead of cutting arguments
+    std::vector<HiLogFmtPiece> pieces = ParsePieces("%{public}s");
+    HiLogFmtArg arg = String("long enough string");
+    char buf[BUF_LEN];
+    size_t shortLen = sizeof(HilogBinaryHeader) + 4; // 4 : kind, length and a bit of the string
+    EXPECT_LT(EncodeBinaryArgs(buf, shortLen, TEST_SESSION, TEST_INDEX, pieces.data(), pieces.size(), &arg, false), 0);
+    EXPECT_LT(EncodeBinaryFormat(buf, sizeof(HilogBinaryHeader), TEST_SESSION, TEST_INDEX, "fmt"), 0);
+
+    std::string fmt;
+    for (size_t i = 0; i <= MAX_BINARY_ARGS; i++) {
+        fmt += "%{public}d";
+    }
+    pieces = ParsePieces(fmt.c_str());
+    std::vector<HiLogFmtArg> args(pieces.size(), Signed(1));
+    EXPECT_LT(EncodeBinaryArgs(buf, sizeof(buf), TEST_SESSION, TEST_INDEX, pieces.data(), pieces.size(),
+        args.data(), false), 0);
+}
+
+HWTEST_F(LogBinaryTest, Truncated, TestSize.Level1)
+{
+    const char* fmt = "%{public}d %{public}s %{public}f %{public}u";
+    std::string content = Encode(fmt, { Signed(-300), String("text"), Double(0.5), Unsigned(1ULL << 40) });
+    std::string text;
+    ASSERT_TRUE(Decode(fmt, content, text));
+    for (size_t len = 0; len < content.size(); len++) {
+        EXPECT_FALSE(Decode(fmt, content.substr(0, len), text)) << len;
+    }
+}
+
+HWTEST_F(LogBinaryTest, ArgCountMismatch, TestSize.Level1)
+{
+    const char* fmt = "%{public}d %{public}d";
+    std::string content = Encode(fmt, { Signed(1), Signed(2) });
+    std::string text;
+    // Header promises more arguments than the format has
+    std::string more = content;
+    more[ARG_COUNT_OFFSET] = 3; // 3 : one too many
+    EXPECT_FALSE(Decode(fmt, more, text));
+    more[ARG_COUNT_OFFSET] = static_cast<char>(UINT8_MAX);
+    EXPECT_FALSE(Decode(fmt, more, text));
+    // Or less
+    std::string less = content;
+    less[ARG_COUNT_OFFSET] = 1;
+    EXPECT_FALSE(Decode(fmt, less, text));
+    // Format with another number of conversions
+    EXPECT_FALSE(Decode("%{public}d", content, text));
+    EXPECT_FALSE(Decode("%{public}d %{public}d %{public}d", content, text));
+}
+
+HWTEST_F(LogBinaryTest, KindMismatch, TestSize.Level1)
+{
+    std::string content = Encode("%{public}d", { Signed(1) });
+    std::string text;
+    EXPECT_FALSE(Decode("%{public}s", content, text));
+    EXPECT_FALSE(Decode("%{public}f", content, text));
+    EXPECT_FALSE(Decode("%{public}u", content, text));
+}
+
+HWTEST_F(LogBinaryTest, MalformedValues, TestSize.Level1)
+{
+    HilogBinaryHeader header = {TEST_SESSION, TEST_INDEX, 1};
+    std::string prefix(reinterpret_cast<const char*>(&header), sizeof(header));
+    std::string text;
+
+    // String without its '\0', with zero length and longer than the content
+    std::string str = prefix + static_cast<char>(HILOG_FMT_ARG_STRING);
+    EXPECT_FALSE(Decode("%{public}s", str + '\x03' + "abc", text));
+    EXPECT_FALSE(Decode("%{public}s", str + '\x00', text));
+    EXPECT_FALSE(Decode("%{public}s", str + '\x7f' + "abc" + '\0', text));
+    EXPECT_TRUE(Decode("%{public}s", str + '\x04' + "abc" + '\0', text));
+    EXPECT_EQ(text, "abc");
+
+    // Varint longer than 64 bits
+    std::string number = prefix + static_cast<char>(HILOG_FMT_ARG_SIGNED);
+    EXPECT_FALSE(Decode("%{public}d", number + std::string(11, '\x80') + '\x01', text)); // 11 : too many bytes
+    EXPECT_FALSE(Decode("%{public}d", number + '\x80', text));
+
+    // Unknown kind byte
+    EXPECT_FALSE(Decode("%{public}d", prefix + '\x55' + '\x01', text));
+}
+
+HWTEST_F(LogBinaryTest, ArgTypesMatchConversion, TestSize.Level1)
+{
+    using namespace HiLogFormat;
+    // Integers no wider than the length modifier, hh and h take a promoted int
+    EXPECT_TRUE((ArgMatches<HILOG_FMT_ARG_SIGNED, HILOG_FMT_LEN_NONE, int>()));
+    EXPECT_TRUE((ArgMatches<HILOG_FMT_ARG_UNSIGNED, HILOG_FMT_LEN_NONE, int>()));
+    EXPECT_TRUE((ArgMatches<HILOG_FMT_ARG_SIGNED, HILOG_FMT_LEN_HH, int>()));
+    EXPECT_TRUE((ArgMatches<HILOG_FMT_ARG_SIGNED, HILOG_FMT_LEN_LL, long long>()));
+    EXPECT_TRUE((ArgMatches<HILOG_FMT_ARG_UNSIGNED, HILOG_FMT_LEN_Z, size_t>()));
+    EXPECT_TRUE((ArgMatches<HILOG_FMT_ARG_CHAR, HILOG_FMT_LEN_NONE, char>()));
+    EXPECT_FALSE((ArgMatches<HILOG_FMT_ARG_SIGNED, HILOG_FMT_LEN_NONE, long long>()));
+    EXPECT_FALSE((ArgMatches<HILOG_FMT_ARG_SIGNED, HILOG_FMT_LEN_NONE, double>()));
+    EXPECT_FALSE((ArgMatches<HILOG_FMT_ARG_SIGNED, HILOG_FMT_LEN_NONE, const char*>()));
+    EXPECT_FALSE((ArgMatches<HILOG_FMT_ARG_CHAR, HILOG_FMT_LEN_NONE, double>()));
+
+    // Floating numbers only, long double only with L
+    EXPECT_TRUE((ArgMatches<HILOG_FMT_ARG_DOUBLE, HILOG_FMT_LEN_NONE, double>()));
+    EXPECT_TRUE((ArgMatches<HILOG_FMT_ARG_DOUBLE, HILOG_FMT_LEN_NONE, float>()));
+    EXPECT_TRUE((ArgMatches<HILOG_FMT_ARG_LONG_DOUBLE, HILOG_FMT_LEN_BIG_L, long double>()));
+    EXPECT_FALSE((ArgMatches<HILOG_FMT_ARG_DOUBLE, HILOG_FMT_LEN_NONE, int>()));
+    EXPECT_FALSE((ArgMatches<HILOG_FMT_ARG_DOUBLE, HILOG_FMT_LEN_NONE, long double>()));
+    EXPECT_FALSE((ArgMatches<HILOG_FMT_ARG_LONG_DOUBLE, HILOG_FMT_LEN_BIG_L, double>()));
+
+    // C strings and pointers
+    EXPECT_TRUE((ArgMatches<HILOG_FMT_ARG_STRING, HILOG_FMT_LEN_NONE, const char*>()));
+    EXPECT_TRUE((ArgMatches<HILOG_FMT_ARG_STRING, HILOG_FMT_LEN_NONE, char[4]>()));
+    EXPECT_TRUE((ArgMatches<HILOG_FMT_ARG_POINTER, HILOG_FMT_LEN_NONE, const int*>()));
+    EXPECT_TRUE((ArgMatches<HILOG_FMT_ARG_POINTER, HILOG_FMT_LEN_NONE, std::nullptr_t>()));
+    EXPECT_FALSE((ArgMatches<HILOG_FMT_ARG_STRING, HILOG_FMT_LEN_NONE, int>()));
+    EXPECT_FALSE((ArgMatches<HILOG_FMT_ARG_STRING, HILOG_FMT_LEN_NONE, const unsigned char*>()));
+    EXPECT_FALSE((ArgMatches<HILOG_FMT_ARG_POINTER, HILOG_FMT_LEN_NONE, uintptr_t>()));
+}
+
+HWTEST_F(LogBinaryTest, SessionSendsFormatAgain, TestSize.Level1)
+{
+    BinaryFormatSession session(TEST_SESSION);
+    std::atomic<uint32_t> formatId(0);
+    uint16_t index = 0;
+    uint32_t sentId = 0;
+    auto acquire = [&session, &formatId, &index, &sentId]() {
+        BinaryFormatSession::Use use = session.Acquire(formatId, 10, 1, index, sentId); // 10, 1 : any format
+        if (use == BinaryFormatSession::Use::SEND_FORMAT) {
+            formatId.store(sentId);
+        }
+        return use;
+    };
+    session.Update(1, 0);
+    EXPECT_EQ(acquire(), BinaryFormatSession::Use::SEND_FORMAT);
+    uint16_t first = index;
+    EXPECT_EQ(acquire(), BinaryFormatSession::Use::BINARY);
+    // hilogd restarted, writes were lost, process was forked: the same index is sent again once
+    session.Update(2, 0); // 2 : new hilogd
+    EXPECT_EQ(acquire(), BinaryFormatSession::Use::SEND_FORMAT);
+    EXPECT_EQ(acquire(), BinaryFormatSession::Use::BINARY);
+    session.Update(2, 1); // 2, 1 : one lost write
+    EXPECT_EQ(acquire(), BinaryFormatSession::Use::SEND_FORMAT);
+    session.Renew(TEST_SESSION + 1);
+    EXPECT_EQ(session.GetId(), TEST_SESSION + 1);
+    EXPECT_EQ(acquire(), BinaryFormatSession::Use::SEND_FORMAT);
+    EXPECT_EQ(acquire(), BinaryFormatSession::Use::BINARY);
+    EXPECT_EQ(index, first);
+
+    // Sending failed, the call site keeps its index and sends again
+    std::atomic<uint32_t> failedId(0);
+    EXPECT_EQ(session.Acquire(failedId, 10, 1, index, sentId), BinaryFormatSession::Use::SEND_FORMAT); // 10, 1 : any
+    uint16_t failedIndex = index;
+    EXPECT_EQ(session.Acquire(failedId, 10, 1, index, sentId), BinaryFormatSession::Use::SEND_FORMAT); // 10, 1 : any
+    EXPECT_EQ(index, failedIndex);
+}
+
+HWTEST_F(LogBinaryTest, SessionStaysInHilogdLimits, TestSize.Level1)
+{
+    // Formats hilogd would refuse are logged as text
+    BinaryFormatSession session(TEST_SESSION);
+    uint16_t index = 0;
+    uint32_t sentId = 0;
+    std::atomic<uint32_t> tooLong(0);
+    EXPECT_EQ(session.Acquire(tooLong, MAX_LOG_LEN, 1, index, sentId), BinaryFormatSession::Use::TEXT);
+    EXPECT_EQ(session.Acquire(tooLong, 10, 1, index, sentId), BinaryFormatSession::Use::TEXT); // 10, 1 : any
+
+    std::vector<std::atomic<uint32_t>> formatIds(BINARY_MAX_FORMATS_PER_PID + 1);
+    for (size_t i = 0; i < BINARY_MAX_FORMATS_PER_PID; i++) {
+        ASSERT_EQ(session.Acquire(formatIds[i], 10, 1, index, sentId), // 10, 1 : any format
+            BinaryFormatSession::Use::SEND_FORMAT) << i;
+    }
+    EXPECT_EQ(session.Acquire(formatIds.back(), 10, 1, index, sentId), // 10, 1 : any format
+        BinaryFormatSession::Use::TEXT);
+
+    // Bytes of long formats run out before their count
+    BinaryFormatSession longFormats(TEST_SESSION);
+    size_t fmtLen = MAX_LOG_LEN / 2; // 2 : long but sendable
+    size_t taken = 0;
+    for (std::atomic<uint32_t>& formatId : formatIds) {
+        formatId.store(0);
+        if (longFormats.Acquire(formatId, fmtLen, 1, index, sentId) == BinaryFormatSession::Use::TEXT) {
+            break;
+        }
+        taken++;
+    }
+    EXPECT_EQ(taken, BINARY_MAX_FORMAT_BYTES_PER_PID / BinaryFormatBytes(fmtLen, 1));
+}
+} // namespace
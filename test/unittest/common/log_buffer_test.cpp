@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2022 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "log_buffer.h"
+
+using namespace testing::ext;
+using namespace OHOS::HiviewDFX;
+
+namespace {
+constexpr uint16_t ALL_BITS = 0xffff;
+constexpr uint32_t TEST_DOMAIN = 0xD002D03;
+constexpr char TAG[] = "BufferTest";
+constexpr size_t RECORD_NUM = 10;
+
+class LogBufferTest : public testing::Test {
+public:
+    static void SetUpTestCase() {}
+    static void TearDownTestCase() {}
+    void SetUp()
+    {
+        LogFilterExt filter;
+        filter.inclusions.types = ALL_BITS;
+        filter.inclusions.levels = ALL_BITS;
+        m_filter = m_buffer.CompileFilter(filter);
+        m_reader = m_buffer.CreateBufReader([]() {});
+    }
+    void TearDown()
+    {
+        m_buffer.RemoveBufReader(m_reader);
+    }
+
+protected:
+    void Insert(const std::string& content)
+    {
+        std::vector<char> buffer(sizeof(HilogMsg) + sizeof(TAG) + content.size() + 1, '\0');
+        HilogMsg *msg = reinterpret_cast<HilogMsg *>(buffer.data());
+        msg->len = buffer.size();
+        msg->version = HILOG_MSG_VERSION_TEXT;
+        msg->type = LOG_CORE;
+        msg->level = LOG_INFO;
+        msg->tag_len = sizeof(TAG);
+        msg->domain = TEST_DOMAIN;
+        (void)memcpy(msg->tag, TAG, sizeof(TAG));
+        (void)memcpy(msg->tag + msg->tag_len, content.c_str(), content.size() + 1);
+        ASSERT_GT(m_buffer.Insert(*msg), 0u);
+    }
+
+    /* Contents of the logs with TAG the reader gets until Query() returns false */
+    std::vector<std::string> Read(uint64_t endOrder = UINT64_MAX)
+    {
+        std::vector<std::string> contents;
+        while (m_buffer.Query(m_filter, m_reader, [&contents](const HilogData& data) {
+            if (std::string(data.tag) == TAG) {
+                contents.push_back(data.content);
+            }
+        }, endOrder)) {}
+        return contents;
+    }
+
+    HilogBuffer m_buffer;
+    CompiledLogFilter m_filter;
+    HilogBuffer::ReaderId m_reader = 0;
+};
+
+HWTEST_F(LogBufferTest, QueryStopsAtEndOrder, TestSize.Level1)
+{
+    for (size_t i = 0; i < RECORD_NUM; i++) {
+        Insert("old " + std::to_string(i));
+    }
+    uint64_t endOrder = m_buffer.GetEndOrder();
+    for (size_t i = 0; i < RECORD_NUM; i++) {
+        Insert("new " + std::to_string(i));
+    }
+
+    std::vector<std::string> contents = Read(endOrder);
+    ASSERT_EQ(contents.size(), RECORD_NUM);
+    for (size_t i = 0; i < RECORD_NUM; i++) {
+        EXPECT_EQ(contents[i], "old " + std::to_string(i));
+    }
+    // Later logs are kept for the next query
+    contents = Read();
+    ASSERT_EQ(contents.size(), RECORD_NUM);
+    for (size_t i = 0; i < RECORD_NUM; i++) {
+        EXPECT_EQ(contents[i], "new " + std::to_string(i));
+    }
+}
+} // namespace
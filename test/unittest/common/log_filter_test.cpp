@@ -0,0 +1,248 @@
+/*
+ * Copyright (c) 2022 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <regex>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "log_filter.h"
+
+using namespace testing::ext;
+using namespace OHOS::HiviewDFX;
+
+namespace {
+constexpr uint16_t ALL_BITS = 0xffff;
+constexpr uint32_t TEST_DOMAIN = 0xD002D01;
+constexpr uint32_t TEST_PID = 1000;
+const std::string TEST_TAG = "FilterTest";
+
+class LogFilterTest : public testing::Test {
+public:
+    static void SetUpTestCase() {}
+    static void TearDownTestCase() {}
+    void SetUp() {}
+    void TearDown() {}
+
+protected:
+    struct Record {
+        uint16_t type = LOG_CORE;
+        uint16_t level = LOG_INFO;
+        uint32_t pid = TEST_PID;
+        uint32_t domain = TEST_DOMAIN;
+        std::string tag = TEST_TAG;
+        std::string content = "content";
+    };
+
+    static LogFilterExt MatchAll()
+    {
+        LogFilterExt filter;
+        filter.inclusions.types = ALL_BITS;
+        filter.inclusions.levels = ALL_BITS;
+        return filter;
+    }
+
+    /* HilogData points into the record, keep the record alive while it is used */
+    static HilogData ToData(const Record& record)
+    {
+        HilogData data;
+        data.type = record.type;
+        data.level = record.level;
+        data.pid = record.pid;
+        data.domain = record.domain;
+        data.tag = record.tag.c_str();
+        data.tag_len = record.tag.size() + 1;
+        data.content = record.content.c_str();
+        data.len = data.tag_len + record.content.size() + 1;
+        return data;
+    }
+
+    bool Match(const LogFilterExt& filter, const Record& record)
+    {
+        CompiledLogFilter compiled(filter, m_tagTable);
+        HilogData data = ToData(record);
+        LogTagTable::TagId tagId = m_tagTable.Intern(record.tag.c_str(), record.tag.size());
+        return compiled.Match(data, tagId) && compiled.MatchContent(data);
+    }
+
+    LogTagTable m_tagTable;
+};
+
+HWTEST_F(LogFilterTest, TypesAndLevels, TestSize.Level1)
+{
+    LogFilterExt filter;
+    filter.inclusions.types = (0b01 << LOG_CORE) | (0b01 << LOG_APP);
+    filter.inclusions.levels = (0b01 << LOG_WARN) | (0b01 << LOG_ERROR);
+    Record record;
+    record.level = LOG_WARN;
+    EXPECT_TRUE(Match(filter, record));
+    record.type = LOG_INIT;
+    EXPECT_FALSE(Match(filter, record));
+    record.type = LOG_APP;
+    record.level = LOG_INFO;
+    EXPECT_FALSE(Match(filter, record));
+    EXPECT_EQ(CompiledLogFilter(filter, m_tagTable).GetTypes(), filter.inclusions.types);
+
+    filter = MatchAll();
+    filter.exclusions.types = 0b01 << LOG_APP;
+    filter.exclusions.levels = 0b01 << LOG_DEBUG;
+    record.type = LOG_CORE;
+    EXPECT_TRUE(Match(filter, record));
+    record.level = LOG_DEBUG;
+    EXPECT_FALSE(Match(filter, record));
+    record.level = LOG_INFO;
+    record.type = LOG_APP;
+    EXPECT_FALSE(Match(filter, record));
+}
+
+HWTEST_F(LogFilterTest, Pids, TestSize.Level1)
+{
+    LogFilterExt filter = MatchAll();
+    filter.inclusions.pids = { 3, TEST_PID, 1 }; // 3, 1 : unsorted on purpose
+    Record record;
+    EXPECT_TRUE(Match(filter, record));
+    record.pid = 2; // 2 : not in the list
+    EXPECT_FALSE(Match(filter, record));
+
+    filter = MatchAll();
+    filter.exclusions.pids = { TEST_PID };
+    EXPECT_TRUE(Match(filter, record));
+    record.pid = TEST_PID;
+    EXPECT_FALSE(Match(filter, record));
+}
+
+HWTEST_F(LogFilterTest, Domains, TestSize.Level1)
+{
+    LogFilterExt filter = MatchAll();
+    filter.inclusions.domains = { TEST_DOMAIN };
+    Record record;
+    EXPECT_TRUE(Match(filter, record));
+    record.domain = TEST_DOMAIN + 1;
+    EXPECT_FALSE(Match(filter, record));
+
+    // Without the module bits every module of the domain matches
+    filter.inclusions.domains = { TEST_DOMAIN >> 8 }; // 8 : module bits
+    EXPECT_TRUE(Match(filter, record));
+    record.domain = TEST_DOMAIN + 0x100;
+    EXPECT_FALSE(Match(filter, record));
+
+    // Neither a full domain nor one without the module bits, nothing matches
+    filter.inclusions.domains = { 0x100000 };
+    record.domain = 0x100000;
+    EXPECT_FALSE(Match(filter, record));
+
+    filter = MatchAll();
+    filter.exclusions.domains = { TEST_DOMAIN >> 8 }; // 8 : module bits
+    record.domain = TEST_DOMAIN;
+    EXPECT_FALSE(Match(filter, record));
+    record.domain = 0xD003D01;
+    EXPECT_TRUE(Match(filter, record));
+}
+
+HWTEST_F(LogFilterTest, Tags, TestSize.Level1)
+{
+    LogFilterExt filter = MatchAll();
+    // Tags never logged yet match records which come later
+    filter.inclusions.tags = { "Later", TEST_TAG };
+    Record record;
+    EXPECT_TRUE(Match(filter, record));
+    record.tag = "Later";
+    EXPECT_TRUE(Match(filter, record));
+    record.tag = "Other";
+    EXPECT_FALSE(Match(filter, record));
+
+    filter = MatchAll();
+    filter.exclusions.tags = { TEST_TAG };
+    EXPECT_TRUE(Match(filter, record));
+    record.tag = TEST_TAG;
+    EXPECT_FALSE(Match(filter, record));
+}
+
+HWTEST_F(LogFilterTest, ContentLiteral, TestSize.Level1)
+{
+    LogFilterExt filter = MatchAll();
+    filter.content = "failed";
+    EXPECT_TRUE(CompiledLogFilter(filter, m_tagTable).HasContentFilter());
+    Record record;
+    record.content = "Binder transaction failed, code 7";
+    EXPECT_TRUE(Match(filter, record));
+    record.content = "Binder transaction fail";
+    EXPECT_FALSE(Match(filter, record));
+
+    filter.content = "\\(paren\\)";
+    record.content = "(paren)";
+    EXPECT_TRUE(Match(filter, record));
+    record.content = "paren";
+    EXPECT_FALSE(Match(filter, record));
+}
+
+HWTEST_F(LogFilterTest, ContentRegex, TestSize.Level1)
+{
+    const std::vector<std::string> patterns = {
+        "error -[0-9]+",
+        "^(PowerMgr|WifiDevice):",
+        "frame \\d+ dropped.*ms$",
+        "fai?led",
+        "a{2}b",
+        "[(]paren",
+        "x(yz)+",
+        "t.ok",
+    };
+    const std::vector<std::string> contents = {
+        "",
+        "Binder transaction failed, code 7, error -32",
+        "PowerMgr: suspend ok, wakeup reason 0x12, took 35 ms",
+        "WifiDevice: rssi -57",
+        "render_service: frame 18765 dropped, vsync late by 17 ms",
+        "faled aab",
+        "(paren) xyzyz",
+    };
+    for (const std::string& pattern : patterns) {
+        LogFilterExt filter = MatchAll();
+        filter.content = pattern;
+        std::regex regex(pattern);
+        for (const std::string& content : contents) {
+            Record record;
+            record.content = content;
+            EXPECT_EQ(Match(filter, record), std::regex_search(content, regex)) << pattern << " " << content;
+        }
+    }
+}
+
+HWTEST_F(LogFilterTest, ContentNotTaken, TestSize.Level1)
+{
+    // Back references are left to the reader, hilogd passes every record
+    LogFilterExt filter = MatchAll();
+    filter.content = "(a)\\1";
+    EXPECT_FALSE(CompiledLogFilter(filter, m_tagTable).HasContentFilter());
+    Record record;
+    EXPECT_TRUE(Match(filter, record));
+}
+
+HWTEST_F(LogFilterTest, ContentLength, TestSize.Level1)
+{
+    // Content is searched only up to the record length
+    LogFilterExt filter = MatchAll();
+    filter.content = "tail";
+    CompiledLogFilter compiled(filter, m_tagTable);
+    Record record;
+    record.content = "head tail";
+    HilogData data = ToData(record);
+    EXPECT_TRUE(compiled.MatchContent(data));
+    data.len -= 3; // 3 : cut "ail"
+    EXPECT_FALSE(compiled.MatchContent(data));
+}
+} // namespace
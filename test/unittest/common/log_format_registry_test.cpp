@@ -0,0 +1,303 @@
+/*
+ * Copyright (c) 2022 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <cstring>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "hilog_common.h"
+#include "log_binary.h"
+#include "log_format_registry.h"
+
+using namespace testing::ext;
+using namespace OHOS::HiviewDFX;
+
+namespace {
+constexpr uint32_t TEST_PID = 1000;
+constexpr uint32_t OTHER_PID = 2000;
+constexpr uint16_t TEST_INDEX = 1;
+constexpr size_t MAX_FORMATS = 8192; // 8192 : formats hilogd keeps of exited processes
+constexpr size_t ARG_COUNT_OFFSET = sizeof(uint64_t) + sizeof(uint16_t); // session and format index
+const std::string TAG = "RegistryTest";
+const char* const TEST_FMT = "count %{public}d name %{public}s";
+
+uint64_t SessionOf(uint32_t pid, uint64_t number = 1)
+{
+    return (static_cast<uint64_t>(pid) << BINARY_SESSION_PID_SHIFT) | number;
+}
+
+class LogFormatRegistryTest : public testing::Test {
+public:
+    static void SetUpTestCase() {}
+    static void TearDownTestCase() {}
+    void SetUp() {}
+    void TearDown() {}
+
+protected:
+    /* HilogMsg with the content as sent by libhilog, the content ends with '\0' */
+    static std::vector<char> MakeMsg(uint16_t version, uint32_t pid, const std::string& content)
+    {
+        std::vector<char> buf(sizeof(HilogMsg) + TAG.size() + 1 + content.size() + 1, '\0');
+        HilogMsg* msg = reinterpret_cast<HilogMsg*>(buf.data());
+        msg->len = buf.size();
+        msg->version = version;
+        msg->type = LOG_CORE;
+        msg->level = LOG_INFO;
+        msg->tag_len = TAG.size() + 1;
+        msg->pid = pid;
+        msg->tid = pid;
+        std::copy(TAG.begin(), TAG.end(), msg->tag);
+        std::copy(content.begin(), content.end(), CONTENT_PTR(msg));
+        return buf;
+    }
+
+    bool Register(uint32_t pid, uint64_t session, uint16_t index, const char* fmt)
+    {
+        char content[MAX_LOG_LEN];
+        int len = EncodeBinaryFormat(content, sizeof(content), session, index, fmt);
+        EXPECT_GE(len, 0);
+        std::vector<char> msg = MakeMsg(HILOG_MSG_VERSION_FORMAT, pid, std::string(content, len));
+        return m_registry.Register(*reinterpret_cast<const HilogMsg*>(msg.data()));
+    }
+
+    static std::string EncodeArgs(uint64_t session, uint16_t index, const char* fmt, int count, const char* name)
+    {
+        std::vector<HiLogFmtPiece> pieces;
+        size_t pos = 0;
+        HiLogFmtPiece piece;
+        while (HiLogFormat::NextPiece(fmt, pos, piece) == HiLogFormat::ParseResult::PIECE) {
+            pieces.push_back(piece);
+        }
+        HiLogFmtArg args[2]; // 2 : count and name
+        args[0].i = count;
+        args[1].s = name;
+        char content[MAX_LOG_LEN];
+        int len = EncodeBinaryArgs(content, sizeof(content), session, index, pieces.data(), pieces.size(), args,
+            true);
+        EXPECT_GE(len, 0);
+        return (len < 0) ? std::string() : std::string(content, len);
+    }
+
+    std::string Render(uint32_t pid, const std::string& content, size_t bufLen = LogFormatRegistry::RENDER_BUF_LEN)
+    {
+        std::vector<char> msg = MakeMsg(HILOG_MSG_VERSION_BINARY, pid, content);
+        const HilogData data(*reinterpret_cast<const HilogMsg*>(msg.data()));
+        std::vector<char> buf(bufLen, 'x');
+        HilogData text;
+        m_registry.Render(data, buf.data(), buf.size(), text);
+        EXPECT_EQ(text.version, HILOG_MSG_VERSION_TEXT);
+        EXPECT_EQ(text.pid, pid);
+        if (text.tag_len == 0) {
+            EXPECT_EQ(text.len, 0);
+            return text.content;
+        }
+        EXPECT_EQ(TAG, text.tag);
+        EXPECT_EQ(text.len, text.tag_len + strlen(text.content) + 1);
+        EXPECT_LE(text.len, bufLen);
+        return text.content;
+    }
+
+    /* What libhilog does for a log of a call site, returns how hilogd renders it */
+    std::string Log(BinaryFormatSession& session, std::atomic<uint32_t>& formatId, int count)
+    {
+        uint16_t index = 0;
+        uint32_t sentId = 0;
+        BinaryFormatSession::Use use = session.Acquire(formatId, strlen(TEST_FMT), 2, index, sentId); // 2 : pieces
+        EXPECT_NE(use, BinaryFormatSession::Use::TEXT);
+        if (use == BinaryFormatSession::Use::SEND_FORMAT) {
+            EXPECT_TRUE(Register(TEST_PID, session.GetId(), index, TEST_FMT));
+            formatId.store(sentId);
+        }
+        return Render(TEST_PID, EncodeArgs(session.GetId(), index, TEST_FMT, count, "abc"));
+    }
+
+    void RestartHilogd()
+    {
+        m_registry = LogFormatRegistry([this](uint32_t pid) { return m_exited.count(pid) == 0; });
+    }
+
+    std::set<uint32_t> m_exited;
+    LogFormatRegistry m_registry {[this](uint32_t pid) { return m_exited.count(pid) == 0; }};
+};
+
+HWTEST_F(LogFormatRegistryTest, RenderRegistered, TestSize.Level1)
+{
+    ASSERT_TRUE(Register(TEST_PID, SessionOf(TEST_PID), TEST_INDEX, TEST_FMT));
+    EXPECT_EQ(Render(TEST_PID, EncodeArgs(SessionOf(TEST_PID), TEST_INDEX, TEST_FMT, 5, "abc")), // 5 : any value
+        "count 5 name abc");
+    // Private arguments were masked by the sender
+    const char* privFmt = "count %d name %{public}s";
+    ASSERT_TRUE(Register(TEST_PID, SessionOf(TEST_PID), TEST_INDEX + 1, privFmt));
+    EXPECT_EQ(Render(TEST_PID, EncodeArgs(SessionOf(TEST_PID), TEST_INDEX + 1, privFmt, 5, "abc")), // 5 : any value
+        "count <private> name abc");
+}
+
+HWTEST_F(LogFormatRegistryTest, RegisterRefused, TestSize.Level1)
+{
+    // Session of another process
+    EXPECT_FALSE(Register(OTHER_PID, SessionOf(TEST_PID), TEST_INDEX, TEST_FMT));
+    // Formats libhilog never sends binary
+    EXPECT_FALSE(Register(TEST_PID, SessionOf(TEST_PID), TEST_INDEX, "%n"));
+    EXPECT_FALSE(Register(TEST_PID, SessionOf(TEST_PID), TEST_INDEX, "%{secret}d"));
+    EXPECT_FALSE(Register(TEST_PID, SessionOf(TEST_PID), TEST_INDEX, "%ls"));
+    // Twice the same index, sending the same format again is fine
+    EXPECT_TRUE(Register(TEST_PID, SessionOf(TEST_PID), TEST_INDEX, TEST_FMT));
+    EXPECT_TRUE(Register(TEST_PID, SessionOf(TEST_PID), TEST_INDEX, TEST_FMT));
+    EXPECT_FALSE(Register(TEST_PID, SessionOf(TEST_PID), TEST_INDEX, "%{public}d"));
+
+    // Content too short for the header or not ending with '\0'
+    std::vector<char> msg = MakeMsg(HILOG_MSG_VERSION_FORMAT, TEST_PID, "short");
+    EXPECT_FALSE(m_registry.Register(*reinterpret_cast<const HilogMsg*>(msg.data())));
+    char content[MAX_LOG_LEN];
+    int len = EncodeBinaryFormat(content, sizeof(content), SessionOf(TEST_PID), TEST_INDEX + 1, TEST_FMT);
+    ASSERT_GT(len, 0);
+    msg = MakeMsg(HILOG_MSG_VERSION_FORMAT, TEST_PID, std::string(content, len));
+    msg.back() = 'x';
+    EXPECT_FALSE(m_registry.Register(*reinterpret_cast<const HilogMsg*>(msg.data())));
+}
+
+HWTEST_F(LogFormatRegistryTest, UnknownFormat, TestSize.Level1)
+{
+    ASSERT_TRUE(Register(TEST_PID, SessionOf(TEST_PID), TEST_INDEX, TEST_FMT));
+    // Index which was never registered
+    std::string text = Render(TEST_PID, EncodeArgs(SessionOf(TEST_PID), TEST_INDEX + 1, TEST_FMT, 1, "a"));
+    EXPECT_EQ(text.find("<binary log, format "), 0U) << text;
+    EXPECT_NE(text.find("is unknown>"), std::string::npos) << text;
+    // Formats of one process aren't used for another one, even with the same session
+    text = Render(OTHER_PID, EncodeArgs(SessionOf(TEST_PID), TEST_INDEX, TEST_FMT, 1, "a"));
+    EXPECT_NE(text.find("is unknown>"), std::string::npos) << text;
+}
+
+HWTEST_F(LogFormatRegistryTest, Malformed, TestSize.Level1)
+{
+    ASSERT_TRUE(Register(TEST_PID, SessionOf(TEST_PID), TEST_INDEX, TEST_FMT));
+    const std::string malformed = "<malformed binary log>";
+    std::string content = EncodeArgs(SessionOf(TEST_PID), TEST_INDEX, TEST_FMT, 1, "name");
+    ASSERT_EQ(Render(TEST_PID, content), "count 1 name name");
+
+    // Truncated arguments, the last byte is '\0' of the string which the record ends with anyway
+    for (size_t len = sizeof(HilogBinaryHeader); len < content.size() - 1; len++) {
+        EXPECT_EQ(Render(TEST_PID, content.substr(0, len)), malformed) << len;
+    }
+    // Too short for the header
+    EXPECT_EQ(Render(TEST_PID, content.substr(0, sizeof(HilogBinaryHeader) - 1)), malformed);
+    // Argument count which doesn't match the format
+    std::string count = content;
+    count[ARG_COUNT_OFFSET] = 1;
+    EXPECT_EQ(Render(TEST_PID, count), malformed);
+    count[ARG_COUNT_OFFSET] = static_cast<char>(MAX_BINARY_ARGS + 1);
+    EXPECT_EQ(Render(TEST_PID, count), malformed);
+    // Arguments of another format under this index
+    const char* otherFmt = "%{public}d %{public}d";
+    EXPECT_EQ(Render(TEST_PID, EncodeArgs(SessionOf(TEST_PID), TEST_INDEX, otherFmt, 1, "name")), malformed);
+}
+
+HWTEST_F(LogFormatRegistryTest, SmallBuffer, TestSize.Level1)
+{
+    ASSERT_TRUE(Register(TEST_PID, SessionOf(TEST_PID), TEST_INDEX, TEST_FMT));
+    std::string content = EncodeArgs(SessionOf(TEST_PID), TEST_INDEX, TEST_FMT, 1, "name");
+    // No room for the tag
+    EXPECT_EQ(Render(TEST_PID, content, TAG.size()), "");
+    // Text is cut, never written past the buffer
+    EXPECT_EQ(Render(TEST_PID, content, TAG.size() + 1 + 6), "count"); // 6 : "count" and '\0'
+}
+
+HWTEST_F(LogFormatRegistryTest, PerPidLimit, TestSize.Level1)
+{
+    for (size_t i = 0; i < BINARY_MAX_FORMATS_PER_PID; i++) {
+        ASSERT_TRUE(Register(TEST_PID, SessionOf(TEST_PID), static_cast<uint16_t>(i), TEST_FMT)) << i;
+    }
+    EXPECT_FALSE(Register(TEST_PID, SessionOf(TEST_PID), static_cast<uint16_t>(BINARY_MAX_FORMATS_PER_PID),
+        TEST_FMT));
+    // Other processes aren't affected
+    EXPECT_TRUE(Register(OTHER_PID, SessionOf(OTHER_PID), TEST_INDEX, TEST_FMT));
+    EXPECT_EQ(Render(TEST_PID, EncodeArgs(SessionOf(TEST_PID), 0, TEST_FMT, 2, "first")), "count 2 name first");
+
+    // A new process with the pid replaces formats of the old one
+    EXPECT_TRUE(Register(TEST_PID, SessionOf(TEST_PID, 2), TEST_INDEX, TEST_FMT)); // 2 : new session
+    EXPECT_NE(Render(TEST_PID, EncodeArgs(SessionOf(TEST_PID), 0, TEST_FMT, 2, "first")).find("is unknown>"),
+        std::string::npos);
+    EXPECT_EQ(Render(TEST_PID, EncodeArgs(SessionOf(TEST_PID, 2), TEST_INDEX, TEST_FMT, 2, "new")), // 2 : new session
+        "count 2 name new");
+}
+
+HWTEST_F(LogFormatRegistryTest, HilogdRestart, TestSize.Level1)
+{
+    constexpr uint32_t epoch = 7; // 7 : any epoch
+    BinaryFormatSession session(SessionOf(TEST_PID));
+    std::atomic<uint32_t> formatId(0);
+    session.Update(epoch, 0);
+    EXPECT_EQ(Log(session, formatId, 1), "count 1 name abc");
+    EXPECT_EQ(Log(session, formatId, 2), "count 2 name abc"); // 2 : second log
+
+    // Process didn't notice yet, its logs can't be rendered
+    RestartHilogd();
+    std::string text = Log(session, formatId, 3); // 3 : third log
+    EXPECT_NE(text.find("is unknown>"), std::string::npos) << text;
+    // New hilogd published a new epoch, the format is sent again under the same index
+    uint32_t index = formatId.load() & 0xffff; // 0xffff : index part of the id
+    session.Update(epoch + 1, 0);
+    EXPECT_EQ(Log(session, formatId, 4), "count 4 name abc"); // 4 : fourth log
+    EXPECT_EQ(formatId.load() & 0xffff, index); // 0xffff : index part of the id
+}
+
+HWTEST_F(LogFormatRegistryTest, LostWrite, TestSize.Level1)
+{
+    BinaryFormatSession session(SessionOf(TEST_PID));
+    std::atomic<uint32_t> formatId(0);
+    EXPECT_EQ(Log(session, formatId, 1), "count 1 name abc");
+    // A batch which may have carried the format was lost, hilogd gets it again and accepts it
+    session.Update(0, 1);
+    uint16_t index = 0;
+    uint32_t sentId = 0;
+    std::atomic<uint32_t> probe(formatId.load());
+    EXPECT_EQ(session.Acquire(probe, strlen(TEST_FMT), 2, index, sentId), // 2 : pieces
+        BinaryFormatSession::Use::SEND_FORMAT);
+    EXPECT_EQ(Log(session, formatId, 2), "count 2 name abc"); // 2 : second log
+    EXPECT_EQ(Log(session, formatId, 3), "count 3 name abc"); // 3 : third log
+}
+
+HWTEST_F(LogFormatRegistryTest, FullRegistryKeepsLiveProcesses, TestSize.Level1)
+{
+    // Registry is filled by four processes, two of them exit
+    constexpr uint32_t firstPid = 100;
+    constexpr uint32_t pidCount = MAX_FORMATS / BINARY_MAX_FORMATS_PER_PID;
+    for (uint32_t pid = firstPid; pid < firstPid + pidCount; pid++) {
+        for (size_t i = 0; i < BINARY_MAX_FORMATS_PER_PID; i++) {
+            ASSERT_TRUE(Register(pid, SessionOf(pid), static_cast<uint16_t>(i), TEST_FMT)) << pid << " " << i;
+        }
+    }
+    m_exited = {firstPid, firstPid + 1};
+
+    // Formats of exited processes make room, live ones stay even beyond the limit
+    for (uint32_t pid = firstPid + pidCount; pid < firstPid + pidCount + pidCount; pid++) {
+        for (size_t i = 0; i < BINARY_MAX_FORMATS_PER_PID; i++) {
+            ASSERT_TRUE(Register(pid, SessionOf(pid), static_cast<uint16_t>(i), TEST_FMT)) << pid << " " << i;
+        }
+    }
+    for (uint32_t pid = firstPid; pid < firstPid + pidCount + pidCount; pid++) {
+        std::string text = Render(pid, EncodeArgs(SessionOf(pid), 0, TEST_FMT, 1, "a"));
+        if (m_exited.count(pid) != 0) {
+            EXPECT_NE(text.find("is unknown>"), std::string::npos) << pid << " " << text;
+        } else {
+            EXPECT_EQ(text, "count 1 name a") << pid;
+        }
+    }
+}
+} // namespace
@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2022 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "log_buffer.h"
+#include "log_ingest_queue.h"
+
+using namespace testing::ext;
+using namespace OHOS::HiviewDFX;
+
+namespace {
+constexpr uint16_t ALL_BITS = 0xffff;
+constexpr uint32_t TEST_DOMAIN = 0xD002D02;
+constexpr char TAG[] = "IngestTest";
+constexpr size_t RECORD_NUM = 1000; // 1000 : several times the slots of the queue
+constexpr auto PRODUCER_HEAD_START = std::chrono::milliseconds(100);
+
+std::vector<char> MakeMsg(const std::string& content)
+{
+    std::vector<char> buffer(sizeof(HilogMsg) + sizeof(TAG) + content.size() + 1, '\0');
+    HilogMsg *msg = reinterpret_cast<HilogMsg *>(buffer.data());
+    msg->len = buffer.size();
+    msg->version = HILOG_MSG_VERSION_TEXT;
+    msg->type = LOG_CORE;
+    msg->level = LOG_INFO;
+    msg->tag_len = sizeof(TAG);
+    msg->domain = TEST_DOMAIN;
+    (void)memcpy(msg->tag, TAG, sizeof(TAG));
+    (void)memcpy(msg->tag + msg->tag_len, content.c_str(), content.size() + 1);
+    return buffer;
+}
+
+/* Contents of the logs with TAG in the buffer, in order */
+std::vector<std::string> ReadAll(HilogBuffer& buffer)
+{
+    LogFilterExt filter;
+    filter.inclusions.types = ALL_BITS;
+    filter.inclusions.levels = ALL_BITS;
+    CompiledLogFilter compiled = buffer.CompileFilter(filter);
+    HilogBuffer::ReaderId id = buffer.CreateBufReader([]() {});
+    std::vector<std::string> contents;
+    while (buffer.Query(compiled, id, [&contents](const HilogData& data) {
+        if (std::string(data.tag) == TAG) {
+            contents.push_back(data.content);
+        }
+    })) {}
+    buffer.RemoveBufReader(id);
+    return contents;
+}
+
+class LogIngestQueueTest : public testing::Test {
+public:
+    static void SetUpTestCase() {}
+    static void TearDownTestCase() {}
+    void SetUp() {}
+    void TearDown() {}
+};
+
+HWTEST_F(LogIngestQueueTest, FullQueueKeepsLogs, TestSize.Level1)
+{
+    HilogBuffer buffer;
+    LogIngestQueue queue(buffer);
+    // Commit thread isn't running yet, the producer fills the queue and has to wait
+    std::thread producer([&queue]() {
+        for (size_t i = 0; i < RECORD_NUM; i++) {
+            std::vector<char> msg = MakeMsg("record " + std::to_string(i));
+            EXPECT_TRUE(queue.Post(*reinterpret_cast<HilogMsg *>(msg.data()))) << i;
+        }
+    });
+    std::this_thread::sleep_for(PRODUCER_HEAD_START);
+    queue.Start();
+    producer.join();
+    queue.Stop();
+
+    EXPECT_EQ(queue.GetDropped(), 0u);
+    std::vector<std::string> contents = ReadAll(buffer);
+    ASSERT_EQ(contents.size(), RECORD_NUM);
+    for (size_t i = 0; i < RECORD_NUM; i++) {
+        EXPECT_EQ(contents[i], "record " + std::to_string(i));
+    }
+}
+
+HWTEST_F(LogIngestQueueTest, StopReleasesWaitingProducer, TestSize.Level1)
+{
+    HilogBuffer buffer;
+    LogIngestQueue queue(buffer);
+    size_t posted = 0;
+    std::thread producer([&queue, &posted]() {
+        for (size_t i = 0; i < RECORD_NUM; i++) {
+            std::vector<char> msg = MakeMsg("record " + std::to_string(i));
+            if (queue.Post(*reinterpret_cast<HilogMsg *>(msg.data()))) {
+                posted++;
+            }
+        }
+    });
+    std::this_thread::sleep_for(PRODUCER_HEAD_START);
+    queue.Stop();
+    producer.join();
+    EXPECT_LT(posted, RECORD_NUM);
+    EXPECT_EQ(queue.GetDropped(), RECORD_NUM - posted);
+}
+} // namespace
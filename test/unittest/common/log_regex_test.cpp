@@ -0,0 +1,231 @@
+/*
+ * Copyright (c) 2022 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <regex>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "log_regex.h"
+
+using namespace testing::ext;
+using namespace OHOS::HiviewDFX;
+
+namespace {
+const std::vector<std::string> CONTENTS = {
+    "",
+    "a",
+    "abc",
+    "aaab",
+    "xaaay",
+    "failed",
+    "Binder transaction failed, code 7, error -32",
+    "PowerMgr: suspend ok, wakeup reason 0x12, took 35 ms",
+    "render_service: frame 18765 dropped, vsync late by 17 ms\nsecond line",
+    "key=value; key2=value2",
+    "tab\tseparated [bracket] (paren) {brace}",
+    "1234567890",
+    "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaa!",
+    std::string("high \xe4\xbd\xa0\xe5\xa5\xbd bytes"),
+};
+
+class LogRegexTest : public testing::Test {
+public:
+    static void SetUpTestCase() {}
+    static void TearDownTestCase() {}
+    void SetUp() {}
+    void TearDown() {}
+
+protected:
+    static void ExpectSameAsStdRegex(const std::string& pattern, size_t maxStates = LogRegex::DEFAULT_MAX_STATES)
+    {
+        LogRegex logRegex(pattern, LogRegex::DEFAULT_MAX_INSTS, maxStates);
+        ASSERT_TRUE(logRegex.IsValid()) << pattern;
+        std::regex stdRegex(pattern);
+        // Twice, the second round runs on the states built by the first one
+        for (int round = 0; round < 2; round++) {
+            for (const std::string& content : CONTENTS) {
+                EXPECT_EQ(logRegex.Search(content.c_str(), content.size()),
+                    std::regex_search(content, stdRegex)) << "pattern: " << pattern << " content: " << content;
+            }
+        }
+    }
+};
+
+HWTEST_F(LogRegexTest, Literal, TestSize.Level1)
+{
+    ExpectSameAsStdRegex("failed");
+    ExpectSameAsStdRegex("a");
+    ExpectSameAsStdRegex("not there");
+    ExpectSameAsStdRegex("\\[bracket\\] \\(paren\\) \\{brace\\}");
+    ExpectSameAsStdRegex("\\t");
+}
+
+HWTEST_F(LogRegexTest, Anchors, TestSize.Level1)
+{
+    ExpectSameAsStdRegex("^a");
+    ExpectSameAsStdRegex("^abc$");
+    ExpectSameAsStdRegex("ms$");
+    ExpectSameAsStdRegex("^$");
+    ExpectSameAsStdRegex("^(PowerMgr|WifiDevice):");
+    ExpectSameAsStdRegex("line$");
+    ExpectSameAsStdRegex("^second");
+    ExpectSameAsStdRegex("a^b");
+}
+
+HWTEST_F(LogRegexTest, Alternation, TestSize.Level1)
+{
+    ExpectSameAsStdRegex("abc|failed");
+    ExpectSameAsStdRegex("(a|b)*c");
+    ExpectSameAsStdRegex("x(a|aa)*y");
+    ExpectSameAsStdRegex("|z");
+}
+
+HWTEST_F(LogRegexTest, GreedyQuantifiers, TestSize.Level1)
+{
+    ExpectSameAsStdRegex("a*b");
+    ExpectSameAsStdRegex("a+b");
+    ExpectSameAsStdRegex("xa?y");
+    ExpectSameAsStdRegex("error -[0-9]+");
+    ExpectSameAsStdRegex("frame \\d+ dropped.*ms$");
+    ExpectSameAsStdRegex("a*a*a*a*!");
+}
+
+HWTEST_F(LogRegexTest, LazyQuantifiers, TestSize.Level1)
+{
+    ExpectSameAsStdRegex("a*?b");
+    ExpectSameAsStdRegex("a+?b");
+    ExpectSameAsStdRegex("xa??y");
+    ExpectSameAsStdRegex("key=.*?;");
+    ExpectSameAsStdRegex("a{2,}?b");
+}
+
+HWTEST_F(LogRegexTest, CountedQuantifiers, TestSize.Level1)
+{
+    ExpectSameAsStdRegex("a{3}b");
+    ExpectSameAsStdRegex("^a{1,2}b");
+    ExpectSameAsStdRegex("a{2,}");
+    ExpectSameAsStdRegex("a{30}!");
+    ExpectSameAsStdRegex("a{31}");
+    ExpectSameAsStdRegex("(ab){0}c");
+    ExpectSameAsStdRegex("[0-9]{10}");
+}
+
+HWTEST_F(LogRegexTest, Classes, TestSize.Level1)
+{
+    ExpectSameAsStdRegex("[abc]+");
+    ExpectSameAsStdRegex("[^a]");
+    ExpectSameAsStdRegex("^[^a-z]");
+    ExpectSameAsStdRegex("[^\\n]*line");
+    ExpectSameAsStdRegex("\\D\\d");
+    ExpectSameAsStdRegex("\\s\\S");
+    ExpectSameAsStdRegex("\\w+=\\W");
+    ExpectSameAsStdRegex("[\\d.]+ ms");
+    ExpectSameAsStdRegex("[-a]");
+    ExpectSameAsStdRegex("[]a]");
+    ExpectSameAsStdRegex("[^]");
+    ExpectSameAsStdRegex("0x[0-9a-fA-F]+");
+    ExpectSameAsStdRegex("a.c");
+    ExpectSameAsStdRegex("ms.second");
+}
+
+HWTEST_F(LogRegexTest, Escapes, TestSize.Level1)
+{
+    ExpectSameAsStdRegex("\\x30");
+    ExpectSameAsStdRegex("\\.");
+    ExpectSameAsStdRegex("\\$");
+    ExpectSameAsStdRegex("\\^a");
+    ExpectSameAsStdRegex("\\n");
+    ExpectSameAsStdRegex("\\/");
+}
+
+HWTEST_F(LogRegexTest, TinyStateCache, TestSize.Level1)
+{
+    // States are dropped and built again all the time, results must not change
+    ExpectSameAsStdRegex("(a|b)*c(d|e)+f", 1);
+    ExpectSameAsStdRegex("frame \\d+ dropped.*ms$", 1);
+    ExpectSameAsStdRegex("[^a-z]+[0-9]{2,3}", 2);
+    ExpectSameAsStdRegex("a.{5}b", 2);
+    ExpectSameAsStdRegex("^(PowerMgr|WifiDevice):", 3);
+}
+
+HWTEST_F(LogRegexTest, NotRegular, TestSize.Level1)
+{
+    // hilogtool leaves these to std::regex, hilogd refuses them
+    const std::vector<std::string> patterns = {
+        "(a)\\1",
+        "\\bfailed",
+        "\\Bailed",
+        "fail(?=ed)",
+        "fail(?!ed)",
+        "\\cJ",
+        "\\u0041",
+        "\\0",
+        "[[:alpha:]]+",
+        "a**",
+        "2+??",
+    };
+    for (const std::string& pattern : patterns) {
+        LogRegex logRegex(pattern);
+        EXPECT_FALSE(logRegex.IsValid()) << pattern;
+        EXPECT_FALSE(logRegex.Search("failed", sizeof("failed") - 1)) << pattern;
+        EXPECT_NO_THROW(std::regex stdRegex(pattern)) << pattern;
+    }
+}
+
+HWTEST_F(LogRegexTest, Invalid, TestSize.Level1)
+{
+    const std::vector<std::string> patterns = {
+        "(",
+        "a)",
+        "[a",
+        "*a",
+        "a{,2}",
+        "a{2,1}",
+        "\\",
+        "[z-a]",
+    };
+    for (const std::string& pattern : patterns) {
+        LogRegex logRegex(pattern);
+        EXPECT_FALSE(logRegex.IsValid()) << pattern;
+        EXPECT_FALSE(logRegex.Search("a", 1)) << pattern;
+    }
+}
+
+HWTEST_F(LogRegexTest, Limits, TestSize.Level1)
+{
+    LogRegex small("a{100}", 16);
+    EXPECT_FALSE(small.IsValid());
+    LogRegex large("a{100}", 1024);
+    EXPECT_TRUE(large.IsValid());
+    std::string content(100, 'a');
+    EXPECT_TRUE(large.Search(content.c_str(), content.size()));
+    EXPECT_FALSE(large.Search(content.c_str(), content.size() - 1));
+}
+
+HWTEST_F(LogRegexTest, LengthNotNul, TestSize.Level1)
+{
+    // Content isn't '\0' terminated where the length ends
+    LogRegex logRegex("abc$");
+    ASSERT_TRUE(logRegex.IsValid());
+    const char content[] = "xabcdef";
+    EXPECT_TRUE(logRegex.Search(content, sizeof("xabc") - 1));
+    EXPECT_FALSE(logRegex.Search(content, sizeof(content) - 1));
+    const char withNul[] = "ab\0c";
+    LogRegex nul("c");
+    EXPECT_TRUE(nul.Search(withNul, sizeof(withNul) - 1));
+}
+} // namespace
@@ -0,0 +1,266 @@
+/*
+ * Copyright (c) 2022 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "log_ring_buffer.h"
+
+using namespace testing::ext;
+using namespace OHOS::HiviewDFX;
+
+namespace {
+const std::string TAG = "Ring";
+constexpr size_t SMALL_RING = 640; // 640 : ten records of 64 bytes
+constexpr size_t LARGE_RING = 4096;
+constexpr size_t CONTENT_LEN = 8; // 8 : "log NNN" and '\0'
+
+class LogRingBufferTest : public testing::Test {
+public:
+    static void SetUpTestCase() {}
+    static void TearDownTestCase() {}
+    void SetUp() {}
+    void TearDown() {}
+
+protected:
+    /* Record number is the pid and the order, padding makes records of different sizes */
+    static bool PushLog(LogRingBuffer& ring, uint32_t index, size_t padding = 0,
+        LogTagTable::TagId tagId = LogTagTable::INVALID_TAG_ID)
+    {
+        char text[CONTENT_LEN];
+        (void)snprintf(text, sizeof(text), "log %03u", index);
+        std::string content = std::string(text) + std::string(padding, '.');
+        std::vector<char> buf(sizeof(HilogMsg) + TAG.size() + 1 + content.size() + 1, '\0');
+        HilogMsg* msg = reinterpret_cast<HilogMsg*>(buf.data());
+        msg->len = buf.size();
+        msg->tag_len = TAG.size() + 1;
+        msg->pid = index;
+        std::copy(TAG.begin(), TAG.end(), msg->tag);
+        std::copy(content.begin(), content.end(), CONTENT_PTR(msg));
+        return ring.Push(*msg, index, tagId);
+    }
+
+    static std::string ContentOf(const HilogMsg* msg, LogTagTable::TagId tagId)
+    {
+        if (tagId == LogTagTable::INVALID_TAG_ID) {
+            return CONTENT_PTR(msg);
+        }
+        return reinterpret_cast<const char*>(msg) + sizeof(HilogMsg);
+    }
+
+    /* Reads everything behind the cursor and checks that each record is intact */
+    static std::vector<uint32_t> ReadAll(const LogRingBuffer& ring, LogRingBuffer::Cursor& cursor,
+        uint64_t& missed)
+    {
+        std::vector<uint32_t> indexes;
+        uint64_t order = 0;
+        LogTagTable::TagId tagId = 0;
+        while (const HilogMsg* msg = ring.Read(cursor, order, tagId, missed)) {
+            char text[CONTENT_LEN];
+            (void)snprintf(text, sizeof(text), "log %03u", msg->pid);
+            EXPECT_EQ(order, msg->pid);
+            EXPECT_EQ(ContentOf(msg, tagId).compare(0, CONTENT_LEN - 1, text), 0) << msg->pid;
+            if (tagId == LogTagTable::INVALID_TAG_ID) {
+                EXPECT_EQ(TAG, msg->tag);
+            }
+            indexes.push_back(msg->pid);
+            ring.Next(cursor);
+        }
+        return indexes;
+    }
+
+    static std::vector<uint32_t> Range(uint32_t begin, uint32_t end)
+    {
+        std::vector<uint32_t> indexes;
+        for (uint32_t i = begin; i < end; i++) {
+            indexes.push_back(i);
+        }
+        return indexes;
+    }
+};
+
+HWTEST_F(LogRingBufferTest, PushAndRead, TestSize.Level1)
+{
+    LogRingBuffer ring;
+    ring.SetCapacity(LARGE_RING);
+    EXPECT_TRUE(ring.Empty());
+    for (uint32_t i = 0; i < 5; i++) { // 5 : a few records, no wrap
+        ASSERT_TRUE(PushLog(ring, i));
+    }
+    EXPECT_FALSE(ring.Empty());
+    uint64_t missed = 0;
+    LogRingBuffer::Cursor cursor = ring.Begin();
+    EXPECT_EQ(ReadAll(ring, cursor, missed), Range(0, 5)); // 5 : all of them
+    EXPECT_EQ(missed, 0U);
+}
+
+HWTEST_F(LogRingBufferTest, WrapAndEvict, TestSize.Level1)
+{
+    LogRingBuffer ring;
+    ring.SetCapacity(SMALL_RING);
+    uint32_t first = 0;
+    for (uint32_t i = 0; i < 300; i++) { // 300 : wraps the ring many times
+        // Records of different sizes leave wrap markers and gaps at the ring end
+        ASSERT_TRUE(PushLog(ring, i, i % 23)); // 23 : up to three more alignment units
+        uint64_t missed = 0;
+        LogRingBuffer::Cursor cursor = ring.Begin();
+        std::vector<uint32_t> indexes = ReadAll(ring, cursor, missed);
+        ASSERT_FALSE(indexes.empty());
+        // Only the oldest records are evicted, the newest one is always there
+        EXPECT_GE(indexes.front(), first);
+        EXPECT_EQ(indexes, Range(indexes.front(), i + 1));
+        EXPECT_EQ(missed, 0U);
+        first = indexes.front();
+    }
+    EXPECT_GT(first, 0U);
+}
+
+HWTEST_F(LogRingBufferTest, CursorSkipsEvicted, TestSize.Level1)
+{
+    LogRingBuffer ring;
+    ring.SetCapacity(SMALL_RING);
+    for (uint32_t i = 0; i < 3; i++) { // 3 : reader stops at the second one
+        ASSERT_TRUE(PushLog(ring, i));
+    }
+    uint64_t missed = 0;
+    uint64_t order = 0;
+    LogTagTable::TagId tagId = 0;
+    LogRingBuffer::Cursor cursor = ring.Begin();
+    ASSERT_NE(ring.Read(cursor, order, tagId, missed), nullptr);
+    ring.Next(cursor);
+
+    for (uint32_t i = 3; i < 100; i++) { // 100 : the reader falls far behind
+        ASSERT_TRUE(PushLog(ring, i));
+    }
+    std::vector<uint32_t> indexes = ReadAll(ring, cursor, missed);
+    ASSERT_FALSE(indexes.empty());
+    EXPECT_EQ(indexes, Range(indexes.front(), 100)); // 100 : up to the last one
+    EXPECT_EQ(missed, indexes.front() - 1);
+}
+
+HWTEST_F(LogRingBufferTest, CursorAtEndFollowsWrap, TestSize.Level1)
+{
+    LogRingBuffer ring;
+    ring.SetCapacity(SMALL_RING);
+    uint64_t missed = 0;
+    LogRingBuffer::Cursor cursor = ring.Begin();
+    std::vector<uint32_t> indexes;
+    for (uint32_t i = 0; i < 200; i++) { // 200 : wraps the ring many times
+        ASSERT_TRUE(PushLog(ring, i, i % 17)); // 17 : different sizes
+        // Waiting at the end, the next record may land at the ring start
+        std::vector<uint32_t> batch = ReadAll(ring, cursor, missed);
+        indexes.insert(indexes.end(), batch.begin(), batch.end());
+    }
+    EXPECT_EQ(indexes, Range(0, 200)); // 200 : nothing lost by a reader which keeps up
+    EXPECT_EQ(missed, 0U);
+}
+
+HWTEST_F(LogRingBufferTest, RelocateAfterResize, TestSize.Level1)
+{
+    LogRingBuffer ring;
+    ring.SetCapacity(LARGE_RING);
+    for (uint32_t i = 0; i < 20; i++) { // 20 : twice the small ring
+        ASSERT_TRUE(PushLog(ring, i));
+    }
+    uint64_t missed = 0;
+    uint64_t order = 0;
+    LogTagTable::TagId tagId = 0;
+    LogRingBuffer::Cursor behind = ring.Begin();
+    ring.Next(behind); // at record 1
+    ring.Next(behind); // at record 2
+    LogRingBuffer::Cursor middle = ring.Begin();
+    while (ring.Read(middle, order, tagId, missed) != nullptr && order < 15) { // 15 : kept by the small ring
+        ring.Next(middle);
+    }
+
+    // Growing keeps every record, cursors are moved to the new offsets
+    LogRingBuffer::Cursor copy = middle;
+    ring.SetCapacity(LARGE_RING * 2); // 2 : grow
+    EXPECT_EQ(ReadAll(ring, copy, missed), Range(15, 20)); // 15, 20 : rest of the records
+    EXPECT_EQ(missed, 0U);
+
+    // Shrinking drops the oldest records
+    ring.SetCapacity(SMALL_RING);
+    EXPECT_EQ(ReadAll(ring, middle, missed), Range(15, 20)); // 15, 20 : rest of the records
+    EXPECT_EQ(missed, 0U);
+    EXPECT_EQ(ReadAll(ring, behind, missed), Range(10, 20)); // 10, 20 : what fits into the small ring
+    EXPECT_EQ(missed, 8U); // 8 : records 2 to 9
+
+    // Pushing after the repack goes on from the right place
+    ASSERT_TRUE(PushLog(ring, 20)); // 20 : next record
+    EXPECT_EQ(ReadAll(ring, middle, missed), Range(20, 21)); // 20, 21 : the new record only
+}
+
+HWTEST_F(LogRingBufferTest, InternedTag, TestSize.Level1)
+{
+    LogRingBuffer ring;
+    ring.SetCapacity(LARGE_RING);
+    constexpr LogTagTable::TagId interned = 7;
+    ASSERT_TRUE(PushLog(ring, 0, 0, interned));
+    ASSERT_TRUE(PushLog(ring, 1));
+    uint64_t missed = 0;
+    uint64_t order = 0;
+    LogTagTable::TagId tagId = 0;
+    LogRingBuffer::Cursor cursor = ring.Begin();
+    const HilogMsg* msg = ring.Read(cursor, order, tagId, missed);
+    ASSERT_NE(msg, nullptr);
+    EXPECT_EQ(tagId, interned);
+    EXPECT_EQ(ContentOf(msg, tagId), "log 000");
+    ring.Next(cursor);
+    msg = ring.Read(cursor, order, tagId, missed);
+    ASSERT_NE(msg, nullptr);
+    EXPECT_EQ(tagId, LogTagTable::INVALID_TAG_ID);
+    EXPECT_EQ(TAG, msg->tag);
+    EXPECT_EQ(ContentOf(msg, tagId), "log 001");
+}
+
+HWTEST_F(LogRingBufferTest, Clear, TestSize.Level1)
+{
+    LogRingBuffer ring;
+    ring.SetCapacity(SMALL_RING);
+    for (uint32_t i = 0; i < 5; i++) { // 5 : a few records
+        ASSERT_TRUE(PushLog(ring, i));
+    }
+    uint64_t missed = 0;
+    LogRingBuffer::Cursor stale = ring.Begin();
+    LogRingBuffer::Cursor atEnd = ring.Begin();
+    ReadAll(ring, atEnd, missed);
+
+    EXPECT_EQ(ring.Clear(), 5 * CONTENT_LEN); // 5 : records cleared
+    EXPECT_TRUE(ring.Empty());
+    for (uint32_t i = 5; i < 7; i++) { // 7 : two more
+        ASSERT_TRUE(PushLog(ring, i));
+    }
+    EXPECT_EQ(ReadAll(ring, atEnd, missed), Range(5, 7)); // 5, 7 : the new ones
+    // Cleared records aren't reported as lost
+    EXPECT_EQ(ReadAll(ring, stale, missed), Range(5, 7)); // 5, 7 : the new ones
+    EXPECT_EQ(missed, 0U);
+}
+
+HWTEST_F(LogRingBufferTest, RecordTooLarge, TestSize.Level1)
+{
+    LogRingBuffer ring;
+    ring.SetCapacity(SMALL_RING);
+    ASSERT_TRUE(PushLog(ring, 0));
+    EXPECT_FALSE(PushLog(ring, 1, SMALL_RING));
+    uint64_t missed = 0;
+    LogRingBuffer::Cursor cursor = ring.Begin();
+    EXPECT_EQ(ReadAll(ring, cursor, missed), Range(0, 1)); // 0, 1 : the small record is kept
+}
+} // namespace
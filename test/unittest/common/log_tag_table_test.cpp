@@ -0,0 +1,193 @@
+/*
+ * Copyright (c) 2022 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "log_filter.h"
+#include "log_tag_table.h"
+
+using namespace testing::ext;
+using namespace OHOS::HiviewDFX;
+
+namespace {
+constexpr uint16_t ALL_BITS = 0xffff;
+constexpr size_t THREAD_NUM = 4;
+constexpr size_t THREAD_TAGS = 1000;
+
+class LogTagTableTest : public testing::Test {
+public:
+    static void SetUpTestCase() {}
+    static void TearDownTestCase() {}
+    void SetUp() {}
+    void TearDown() {}
+
+protected:
+    static LogTagTable::TagId Intern(LogTagTable& table, const std::string& tag)
+    {
+        return table.Intern(tag.c_str(), tag.size());
+    }
+
+    static LogTagTable::TagId Find(LogTagTable& table, const std::string& tag)
+    {
+        return table.Find(tag.c_str(), tag.size());
+    }
+
+    /* Takes every id, the tags are "fill<N>" */
+    static void Fill(LogTagTable& table)
+    {
+        for (size_t i = 0; i < LogTagTable::MAX_TAG_IDS; i++) {
+            Intern(table, "fill" + std::to_string(i));
+        }
+    }
+
+    static HilogData ToData(const std::string& tag)
+    {
+        static const char content[] = "content";
+        HilogData data;
+        data.type = LOG_CORE;
+        data.level = LOG_INFO;
+        data.tag = tag.c_str();
+        data.tag_len = tag.size() + 1;
+        data.content = content;
+        data.len = data.tag_len + sizeof(content);
+        return data;
+    }
+};
+
+HWTEST_F(LogTagTableTest, InternAndFind, TestSize.Level1)
+{
+    LogTagTable table;
+    EXPECT_EQ(Find(table, "first"), LogTagTable::INVALID_TAG_ID);
+    LogTagTable::TagId first = Intern(table, "first");
+    LogTagTable::TagId second = Intern(table, "second");
+    ASSERT_NE(first, LogTagTable::INVALID_TAG_ID);
+    ASSERT_NE(second, LogTagTable::INVALID_TAG_ID);
+    EXPECT_NE(first, second);
+    EXPECT_EQ(Intern(table, "first"), first);
+    EXPECT_EQ(Find(table, "first"), first);
+    EXPECT_EQ(Find(table, "firs"), LogTagTable::INVALID_TAG_ID);
+    EXPECT_STREQ(table.GetTag(first), "first");
+    EXPECT_STREQ(table.GetTag(second), "second");
+
+    // Tag ends at '\0' or at maxLen, whichever comes first
+    EXPECT_EQ(table.Intern("first\0tail", sizeof("first\0tail") - 1), first);
+    EXPECT_EQ(table.Intern("firstsecond", sizeof("first") - 1), first);
+    EXPECT_EQ(Intern(table, ""), table.Intern("", 0));
+}
+
+HWTEST_F(LogTagTableTest, LongTag, TestSize.Level1)
+{
+    // Only MAX_TAG_LEN - 1 characters are kept, like in the log records
+    LogTagTable table;
+    std::string tag(MAX_TAG_LEN + 8, 't'); // 8 : longer than any tag
+    LogTagTable::TagId id = Intern(table, tag);
+    ASSERT_NE(id, LogTagTable::INVALID_TAG_ID);
+    EXPECT_EQ(std::string(table.GetTag(id)), tag.substr(0, MAX_TAG_LEN - 1));
+    EXPECT_EQ(Intern(table, tag.substr(0, MAX_TAG_LEN - 1)), id);
+}
+
+HWTEST_F(LogTagTableTest, UnknownId, TestSize.Level1)
+{
+    LogTagTable table;
+    EXPECT_STREQ(table.GetTag(LogTagTable::INVALID_TAG_ID), "");
+    EXPECT_STREQ(table.GetTag(LogTagTable::MAX_TAG_IDS - 1), "");
+}
+
+HWTEST_F(LogTagTableTest, Full, TestSize.Level1)
+{
+    LogTagTable table;
+    Fill(table);
+    EXPECT_EQ(Intern(table, "late"), LogTagTable::INVALID_TAG_ID);
+    EXPECT_EQ(Find(table, "late"), LogTagTable::INVALID_TAG_ID);
+    // Everything interned before is still there
+    LogTagTable::TagId last = Find(table, "fill" + std::to_string(LogTagTable::MAX_TAG_IDS - 1));
+    EXPECT_EQ(last, LogTagTable::MAX_TAG_IDS - 1);
+    EXPECT_EQ(Intern(table, "fill0"), 0U);
+    EXPECT_STREQ(table.GetTag(last), ("fill" + std::to_string(LogTagTable::MAX_TAG_IDS - 1)).c_str());
+}
+
+HWTEST_F(LogTagTableTest, Concurrent, TestSize.Level1)
+{
+    LogTagTable table;
+    std::vector<std::vector<LogTagTable::TagId>> ids(THREAD_NUM);
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < THREAD_NUM; t++) {
+        threads.emplace_back([&table, &ids, t]() {
+            for (size_t i = 0; i < THREAD_TAGS; i++) {
+                ids[t].push_back(Intern(table, "tag" + std::to_string(i)));
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    for (size_t t = 1; t < THREAD_NUM; t++) {
+        EXPECT_EQ(ids[t], ids[0]);
+    }
+    for (size_t i = 0; i < THREAD_TAGS; i++) {
+        EXPECT_EQ(std::string(table.GetTag(ids[0][i])), "tag" + std::to_string(i));
+    }
+}
+
+HWTEST_F(LogTagTableTest, FilterWhenFull, TestSize.Level1)
+{
+    LogTagTable table;
+    Fill(table);
+    LogFilterExt filter;
+    filter.inclusions.types = ALL_BITS;
+    filter.inclusions.levels = ALL_BITS;
+    // "fill1" keeps its id, "late" fits nowhere and is compared as a string
+    filter.inclusions.tags = { "late", "fill1" };
+    CompiledLogFilter compiled(filter, table);
+
+    const std::string interned = "fill1";
+    const std::string otherInterned = "fill2";
+    const std::string late = "late";
+    const std::string otherLate = "other";
+    EXPECT_TRUE(compiled.Match(ToData(interned), Find(table, interned)));
+    EXPECT_FALSE(compiled.Match(ToData(otherInterned), Find(table, otherInterned)));
+    // Records which didn't get an id keep their tag inline
+    EXPECT_TRUE(compiled.Match(ToData(late), LogTagTable::INVALID_TAG_ID));
+    EXPECT_FALSE(compiled.Match(ToData(otherLate), LogTagTable::INVALID_TAG_ID));
+
+    LogFilterExt exclusion;
+    exclusion.inclusions.types = ALL_BITS;
+    exclusion.inclusions.levels = ALL_BITS;
+    exclusion.exclusions.tags = { "late", "fill1" };
+    CompiledLogFilter excluding(exclusion, table);
+    EXPECT_FALSE(excluding.Match(ToData(interned), Find(table, interned)));
+    EXPECT_TRUE(excluding.Match(ToData(otherInterned), Find(table, otherInterned)));
+    EXPECT_FALSE(excluding.Match(ToData(late), LogTagTable::INVALID_TAG_ID));
+    EXPECT_TRUE(excluding.Match(ToData(otherLate), LogTagTable::INVALID_TAG_ID));
+}
+
+HWTEST_F(LogTagTableTest, FilterTooLongTag, TestSize.Level1)
+{
+    // A filter tag which no record can have never gets an id
+    LogTagTable table;
+    LogFilterExt filter;
+    filter.inclusions.types = ALL_BITS;
+    filter.inclusions.levels = ALL_BITS;
+    filter.inclusions.tags = { std::string(MAX_TAG_LEN, 't') };
+    CompiledLogFilter compiled(filter, table);
+    const std::string cut(MAX_TAG_LEN - 1, 't');
+    EXPECT_EQ(Find(table, cut), LogTagTable::INVALID_TAG_ID);
+    EXPECT_FALSE(compiled.Match(ToData(cut), Intern(table, cut)));
+}
+} // namespace